@@ -22,6 +22,8 @@
 #include <QDir>
 #include <QIcon>
 #include <QMessageBox>
+#include <QProgressDialog>
+#include <QStringList>
 
 #include "include_var.h"
 
@@ -54,14 +56,24 @@ int Application::exec()
 
     DatabaseManager *databaseManager = ServicesManager::instance()->databaseManager();
 
+    // The database is opened before the window, the upgrade of an old one may be long
+    m_upgradeDialog = NULL;
+    connect(databaseManager, SIGNAL(upgradeProgress(int,int,QString)),
+            this, SLOT(on_databaseManager_upgradeProgress(int,int,QString)));
+    if (!databaseManager->open())
+    {
+        QMessageBox::critical(NULL, tr("Database error"),
+                              tr("The database could not be opened or upgraded."));
+    }
+    delete m_upgradeDialog;
+    m_upgradeDialog = NULL;
+
     m_tmdbkey = "6e4cbac7861ad5b847ef8f60489dc04e";
     m_mainWindow = new MainWindow;
     m_fetchMetadata = NULL;
 
-    connect(databaseManager, SIGNAL(orphanTagDetected(Tag)),
-            this, SLOT(askForOrphanTagDeletion(Tag)));
-    connect(databaseManager, SIGNAL(orphanPeopleDetected(People)),
-            this, SLOT(askForOrphanPeopleDeletion(People)));
+    connect(databaseManager, SIGNAL(orphansDetected(QList<People>,QList<Tag>)),
+            this, SLOT(askForOrphansDeletion(QList<People>,QList<Tag>)));
     connect(m_mainWindow, SIGNAL(startFetchingMetadata(QList<Movie>)),
             this, SLOT(on_startFetchingMetadata(QList<Movie>)));
     connect(this, SIGNAL(updateMainWindow()),
@@ -85,48 +97,57 @@ Application::~Application()
 }
 
 /**
- * @brief Slot triggered when DatabaseManager finds an orphan tag.
- * A QMessageBox asks the user if the tag should be delete or not.
+ * @brief Slot triggered when DatabaseManager finds orphan people and tags.
+ * A single QMessageBox asks the user if they should be deleted or not,
+ * however many they are.
  *
- * @param orphanTag concerned by the choice
+ * @param orphanPeopleList people not linked to any movie anymore
+ * @param orphanTagList tags not used in any movie anymore
  */
-void Application::askForOrphanTagDeletion(const Tag &orphanTag)
+void Application::askForOrphansDeletion(const QList<People> &orphanPeopleList,
+                                        const QList<Tag> &orphanTagList)
 {
     DatabaseManager *databaseManager = ServicesManager::instance()->databaseManager();
 
-    QMessageBox msgBox;
-    msgBox.setIcon(QMessageBox::Question);
-    msgBox.setText(QApplication::tr("The tag <b>%1</b> is not used in any movie now.").arg(orphanTag.name()));
-    msgBox.setInformativeText(tr("Do you want to delete this tag?"));
-    msgBox.setStandardButtons(QMessageBox::Yes | QMessageBox::No);
-    msgBox.setDefaultButton(QMessageBox::No);
-
-    if(msgBox.exec() == QMessageBox::Yes) {
-        databaseManager->deleteTag(orphanTag);
+    QStringList l_nameList;
+    foreach (People l_people, orphanPeopleList)
+    {
+        l_nameList << l_people.name();
+    }
+    foreach (Tag l_tag, orphanTagList)
+    {
+        l_nameList << l_tag.name();
+    }
+    if (l_nameList.isEmpty())
+    {
+        return;
     }
-}
-
-/**
- * @brief Slot triggered when DatabaseManager finds an orphan person.
- * A QMessageBox asks the user if the person should be delete or not.
- *
- * @param orphanPeople concerned by the choice
- */
-void Application::askForOrphanPeopleDeletion(const People &orphanPeople)
-{
-    DatabaseManager *databaseManager = ServicesManager::instance()->databaseManager();
-
-    QString l_name = orphanPeople.name();
 
     QMessageBox msgBox;
     msgBox.setIcon(QMessageBox::Question);
-    msgBox.setText(QApplication::tr("The person <b>%1</b> is not linked to any movie now.").arg(l_name));
-    msgBox.setInformativeText(tr("Do you want to delete it?"));
+    if (orphanTagList.isEmpty() && orphanPeopleList.size() == 1)
+    {
+        msgBox.setText(QApplication::tr("The person <b>%1</b> is not linked to any movie now.").arg(l_nameList.first()));
+        msgBox.setInformativeText(tr("Do you want to delete it?"));
+    }
+    else if (orphanPeopleList.isEmpty() && orphanTagList.size() == 1)
+    {
+        msgBox.setText(QApplication::tr("The tag <b>%1</b> is not used in any movie now.").arg(l_nameList.first()));
+        msgBox.setInformativeText(tr("Do you want to delete this tag?"));
+    }
+    else
+    {
+        msgBox.setText(QApplication::tr("<b>%1</b> people and <b>%2</b> tags are not used in any movie now.")
+                       .arg(orphanPeopleList.size())
+                       .arg(orphanTagList.size()));
+        msgBox.setInformativeText(tr("Do you want to delete them?"));
+        msgBox.setDetailedText(l_nameList.join("\n"));
+    }
     msgBox.setStandardButtons(QMessageBox::Yes | QMessageBox::No);
     msgBox.setDefaultButton(QMessageBox::No);
 
     if(msgBox.exec() == QMessageBox::Yes) {
-        databaseManager->deletePeople(orphanPeople);
+        databaseManager->deleteOrphans(orphanPeopleList, orphanTagList);
     }
 }
 
@@ -165,6 +186,30 @@ void Application::on_fethMetadataUpdatedMovie()
     emit updateMainWindow();
 }
 
+/**
+ * @brief Slot triggered by DatabaseManager::open() during the upgrade of the database.
+ * The dialog is created by the first step, and deleted once the database is open.
+ *
+ * @param int step, number of migrations done
+ * @param int stepCount, number of migrations to do
+ * @param QString description, version of the next migration
+ */
+void Application::on_databaseManager_upgradeProgress(int step, int stepCount, const QString &description)
+{
+    if (m_upgradeDialog == NULL)
+    {
+        m_upgradeDialog = new QProgressDialog;
+        m_upgradeDialog->setWindowTitle(APP_NAME);
+        m_upgradeDialog->setCancelButton(NULL);
+        m_upgradeDialog->setWindowModality(Qt::ApplicationModal);
+        m_upgradeDialog->setMinimumDuration(0);
+    }
+    m_upgradeDialog->setMaximum(stepCount);
+    m_upgradeDialog->setLabelText(tr("Upgrading the database (%1)...").arg(description));
+    // Modal: the dialog is painted by setValue() while the upgrade blocks the event loop
+    m_upgradeDialog->setValue(step);
+}
+
 /**
  * @brief Define the paths used in the app
  * Can be retrieved by `qApp->property("name").toString`
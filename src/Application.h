@@ -22,11 +22,13 @@
 
 #include <QApplication>
 
+#include "Entities/People.h"
+#include "Entities/Tag.h"
+
 class FetchMetadata;
 class MainWindow;
 class Movie;
-class People;
-class Tag;
+class QProgressDialog;
 
 /**
  * @brief The Application class. Core of the application
@@ -47,11 +49,12 @@ signals:
     void updateMainWindow();
 
 private slots:
-    void askForOrphanTagDeletion(const Tag &orphanTag);
-    void askForOrphanPeopleDeletion(const People &orphanPeople);
+    void askForOrphansDeletion(const QList<People> &orphanPeopleList,
+                               const QList<Tag> &orphanTagList);
     void on_startFetchingMetadata(const QList<Movie> &movieList);
     void on_fethMetadataJobDone();
     void on_fethMetadataUpdatedMovie();
+    void on_databaseManager_upgradeProgress(int step, int stepCount, const QString &description);
 
 private:
 
@@ -72,6 +75,11 @@ private:
      */
     FetchMetadata *m_fetchMetadata;
 
+    /**
+     * @brief Shows the progress of the upgrade of the database, if there is one
+     */
+    QProgressDialog *m_upgradeDialog;
+
     /**
      * @brief Define the paths used in the app
      */
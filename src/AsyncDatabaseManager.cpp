@@ -0,0 +1,279 @@
+/* Copyright (C) 2014 Macaw-Movies
+ * (Olivier CHURLAUD, Sébastien TOUZÉ)
+ *
+ * This file is part of Macaw-Movies.
+ *
+ * Macaw-Movies is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Macaw-Movies is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Macaw-Movies.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "AsyncDatabaseManager.h"
+
+#include <QCoreApplication>
+#include <QMetaType>
+#include <QThread>
+
+#include "MacawDebug.h"
+
+/**
+ * @brief Constructor
+ *
+ * @param latestTicketList tickets of the latest requests, owned by AsyncDatabaseManager
+ */
+DatabaseWorker::DatabaseWorker(QAtomicInt *latestTicketList) :
+    m_databaseManager(NULL),
+    m_latestTicketList(latestTicketList)
+{
+}
+
+/**
+ * @brief Destructor
+ */
+DatabaseWorker::~DatabaseWorker()
+{
+    Macaw::DEBUG("[DatabaseWorker] Destructed");
+}
+
+/**
+ * @brief Gets the manager of the database thread, created on first use
+ *
+ * @return DatabaseManager*
+ */
+DatabaseManager *DatabaseWorker::databaseManager()
+{
+    if (m_databaseManager == NULL)
+    {
+        m_databaseManager = DatabaseManager::createThreadReader();
+    }
+
+    return m_databaseManager;
+}
+
+/**
+ * @brief Whether a newer request of the same kind was made, or the request was cancelled
+ *
+ * @param kind of the request
+ * @param ticket of the request
+ * @return bool
+ */
+bool DatabaseWorker::isStale(AsyncRequest::Kind kind, int ticket) const
+{
+    return m_latestTicketList[kind].load() != ticket;
+}
+
+/**
+ * @brief Reads a page of movies, see DatabaseManager::getMoviesPage()
+ *
+ * @param ticket of the request
+ * @param cursor, sent back moved after the page
+ * @param pageSize maximum number of movies
+ */
+void DatabaseWorker::getMoviesPage(int ticket, MovieCursor cursor, int pageSize)
+{
+    if (isStale(AsyncRequest::MoviesPage, ticket))
+    {
+        return;
+    }
+
+    QList<Movie> l_movieList = databaseManager()->getMoviesPage(cursor, pageSize);
+    emit moviesPageReady(ticket, cursor, l_movieList);
+}
+
+/**
+ * @brief Searches the movies, see DatabaseManager::getMoviesByAny()
+ *
+ * @param ticket of the request
+ * @param text to look for
+ * @param show true to look for shows
+ */
+void DatabaseWorker::getMoviesByAny(int ticket, QString text, bool show)
+{
+    if (isStale(AsyncRequest::MoviesByAny, ticket))
+    {
+        return;
+    }
+
+    QList<Movie> l_movieList = databaseManager()->getMoviesByAny(text, show);
+    emit moviesByAnyReady(ticket, l_movieList);
+}
+
+/**
+ * @brief Deletes the manager, so that the connection of the thread can be removed.
+ * Must be called in the database thread before it finishes.
+ */
+void DatabaseWorker::stop()
+{
+    delete m_databaseManager;
+    m_databaseManager = NULL;
+}
+
+/**
+ * @brief Constructor. Starts the database thread.
+ *
+ * @param parent
+ */
+AsyncDatabaseManager::AsyncDatabaseManager(QObject *parent) :
+    QObject(parent),
+    m_lastTicket(0)
+{
+    Macaw::DEBUG_IN("[AsyncDatabaseManager] Enters initialization");
+
+    // Types sent between the threads by queued signals
+    qRegisterMetaType<MovieCursor>("MovieCursor");
+    qRegisterMetaType<QList<Movie> >("QList<Movie>");
+
+    m_thread = new QThread(this);
+    m_worker = new DatabaseWorker(m_latestTicketList);
+    m_worker->moveToThread(m_thread);
+
+    connect(this, SIGNAL(moviesPageRequested(int,MovieCursor,int)),
+            m_worker, SLOT(getMoviesPage(int,MovieCursor,int)));
+    connect(this, SIGNAL(moviesByAnyRequested(int,QString,bool)),
+            m_worker, SLOT(getMoviesByAny(int,QString,bool)));
+    connect(m_worker, SIGNAL(moviesPageReady(int,MovieCursor,QList<Movie>)),
+            this, SLOT(on_worker_moviesPageReady(int,MovieCursor,QList<Movie>)));
+    connect(m_worker, SIGNAL(moviesByAnyReady(int,QList<Movie>)),
+            this, SLOT(on_worker_moviesByAnyReady(int,QList<Movie>)));
+    connect(QCoreApplication::instance(), SIGNAL(aboutToQuit()),
+            this, SLOT(stop()));
+
+    m_thread->start();
+
+    Macaw::DEBUG_OUT("[AsyncDatabaseManager] Initialization done");
+}
+
+/**
+ * @brief Destructor. Stops the database thread.
+ */
+AsyncDatabaseManager::~AsyncDatabaseManager()
+{
+    stop();
+    delete m_worker;
+    Macaw::DEBUG("[AsyncDatabaseManager] Destructed");
+}
+
+/**
+ * @brief Cancels the pending requests and stops the database thread
+ */
+void AsyncDatabaseManager::stop()
+{
+    if (!m_thread->isRunning())
+    {
+        return;
+    }
+
+    for (int i = 0 ; i < AsyncRequest::KindCount ; i++)
+    {
+        m_latestTicketList[i].store(0);
+    }
+    QMetaObject::invokeMethod(m_worker, "stop", Qt::BlockingQueuedConnection);
+    m_thread->quit();
+    m_thread->wait();
+}
+
+/**
+ * @brief Asks for a page of movies. The result is sent by moviesPageReady().
+ * A pending page request is cancelled.
+ *
+ * @param cursor describing the movies, see DatabaseManager::getMoviesPage()
+ * @param pageSize maximum number of movies
+ * @return int ticket of the request
+ */
+int AsyncDatabaseManager::getMoviesPage(const MovieCursor &cursor, int pageSize)
+{
+    int l_ticket = newTicket(AsyncRequest::MoviesPage);
+    emit moviesPageRequested(l_ticket, cursor, pageSize);
+
+    return l_ticket;
+}
+
+/**
+ * @brief Asks for the movies matching a search. The result is sent by moviesByAnyReady().
+ * A pending search is cancelled.
+ *
+ * @param text to look for, see DatabaseManager::getMoviesByAny()
+ * @param show true to look for shows
+ * @return int ticket of the request
+ */
+int AsyncDatabaseManager::getMoviesByAny(const QString &text, bool show)
+{
+    int l_ticket = newTicket(AsyncRequest::MoviesByAny);
+    emit moviesByAnyRequested(l_ticket, text, show);
+
+    return l_ticket;
+}
+
+/**
+ * @brief Cancels the pending request of a kind: no result will be sent for it
+ *
+ * @param kind of the request
+ */
+void AsyncDatabaseManager::cancel(AsyncRequest::Kind kind)
+{
+    m_latestTicketList[kind].store(0);
+}
+
+/**
+ * @brief Whether a request of this kind waits for its result
+ *
+ * @param kind of the request
+ * @return bool
+ */
+bool AsyncDatabaseManager::isPending(AsyncRequest::Kind kind) const
+{
+    return m_latestTicketList[kind].load() != 0;
+}
+
+/**
+ * @brief Gives a ticket to a new request, which becomes the latest of its kind
+ *
+ * @param kind of the request
+ * @return int ticket, never 0
+ */
+int AsyncDatabaseManager::newTicket(AsyncRequest::Kind kind)
+{
+    m_lastTicket++;
+    m_latestTicketList[kind].store(m_lastTicket);
+
+    return m_lastTicket;
+}
+
+/**
+ * @brief Slot triggered when the worker has read a page.
+ * Sends the result unless a newer request was made meanwhile.
+ */
+void AsyncDatabaseManager::on_worker_moviesPageReady(int ticket, MovieCursor cursor, QList<Movie> movieList)
+{
+    if (m_latestTicketList[AsyncRequest::MoviesPage].load() != ticket)
+    {
+        return;
+    }
+    m_latestTicketList[AsyncRequest::MoviesPage].store(0);
+
+    emit moviesPageReady(ticket, cursor, movieList);
+}
+
+/**
+ * @brief Slot triggered when the worker has run a search.
+ * Sends the result unless a newer request was made meanwhile.
+ */
+void AsyncDatabaseManager::on_worker_moviesByAnyReady(int ticket, QList<Movie> movieList)
+{
+    if (m_latestTicketList[AsyncRequest::MoviesByAny].load() != ticket)
+    {
+        return;
+    }
+    m_latestTicketList[AsyncRequest::MoviesByAny].store(0);
+
+    emit moviesByAnyReady(ticket, movieList);
+}
@@ -0,0 +1,131 @@
+/* Copyright (C) 2014 Macaw-Movies
+ * (Olivier CHURLAUD, Sébastien TOUZÉ)
+ *
+ * This file is part of Macaw-Movies.
+ *
+ * Macaw-Movies is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Macaw-Movies is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Macaw-Movies.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ASYNCDATABASEMANAGER_H
+#define ASYNCDATABASEMANAGER_H
+
+#include <QAtomicInt>
+#include <QList>
+#include <QObject>
+
+#include "DatabaseManager.h"
+#include "Entities/Movie.h"
+
+class QThread;
+
+/**
+ * @brief Kinds of requests of AsyncDatabaseManager.
+ * A new request cancels the pending one of the same kind.
+ */
+namespace AsyncRequest {
+enum Kind {
+    MoviesPage,
+    MoviesByAny,
+    KindCount
+};
+}
+
+/**
+ * @brief Runs the requests of AsyncDatabaseManager in the database thread.
+ * Should not be used directly.
+ */
+class DatabaseWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit DatabaseWorker(QAtomicInt *latestTicketList);
+    ~DatabaseWorker();
+
+public slots:
+    void getMoviesPage(int ticket, MovieCursor cursor, int pageSize);
+    void getMoviesByAny(int ticket, QString text, bool show);
+    void stop();
+
+signals:
+    void moviesPageReady(int ticket, MovieCursor cursor, QList<Movie> movieList);
+    void moviesByAnyReady(int ticket, QList<Movie> movieList);
+
+private:
+    DatabaseManager *databaseManager();
+    bool isStale(AsyncRequest::Kind kind, int ticket) const;
+
+    /**
+     * @brief Made by DatabaseManager::createThreadReader() on first use,
+     * in the database thread
+     */
+    DatabaseManager *m_databaseManager;
+    QAtomicInt *m_latestTicketList;
+};
+
+/**
+ * @brief Asynchronous access to the database, for the main window
+ *
+ * The requests run on a dedicated thread with its own read-only connection,
+ * so that the GUI thread is not blocked by SQLite. Each request returns a
+ * ticket, and the result is sent later with the same ticket by a signal.
+ *
+ * Only the latest request of each kind matters: an older one is skipped if it
+ * has not started yet, and its result is dropped if it has.
+ *
+ * The writes, and the dialogs that need an immediate answer, keep using
+ * the synchronous DatabaseManager.
+ */
+class AsyncDatabaseManager : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit AsyncDatabaseManager(QObject *parent = 0);
+    ~AsyncDatabaseManager();
+    int getMoviesPage(const MovieCursor &cursor, int pageSize);
+    int getMoviesByAny(const QString &text, bool show);
+    void cancel(AsyncRequest::Kind kind);
+    bool isPending(AsyncRequest::Kind kind) const;
+
+signals:
+    void moviesPageReady(int ticket, const MovieCursor &cursor, const QList<Movie> &movieList);
+    void moviesByAnyReady(int ticket, const QList<Movie> &movieList);
+
+    // Sent to the worker
+    void moviesPageRequested(int ticket, MovieCursor cursor, int pageSize);
+    void moviesByAnyRequested(int ticket, QString text, bool show);
+
+public slots:
+    void stop();
+
+private slots:
+    void on_worker_moviesPageReady(int ticket, MovieCursor cursor, QList<Movie> movieList);
+    void on_worker_moviesByAnyReady(int ticket, QList<Movie> movieList);
+
+private:
+    int newTicket(AsyncRequest::Kind kind);
+
+    QThread *m_thread;
+    DatabaseWorker *m_worker;
+    int m_lastTicket;
+
+    /**
+     * @brief Ticket of the latest request of each kind, 0 if none is pending.
+     * Shared with the worker, which reads it from the database thread.
+     */
+    QAtomicInt m_latestTicketList[AsyncRequest::KindCount];
+};
+
+#endif // ASYNCDATABASEMANAGER_H
@@ -0,0 +1,499 @@
+/* Copyright (C) 2014 Macaw-Movies
+ * (Olivier CHURLAUD, Sébastien TOUZÉ)
+ *
+ * This file is part of Macaw-Movies.
+ *
+ * Macaw-Movies is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Macaw-Movies is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Macaw-Movies.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "DatabaseBenchmark.h"
+
+#include <QCoreApplication>
+#include <QDate>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QSqlDatabase>
+#include <QVector>
+
+#include "include_var.h"
+
+#include "DatabaseManager.h"
+#include "MacawDebug.h"
+#include "Benchmark/SyntheticLibrary.h"
+#include "Entities/Episode.h"
+
+/**
+ * @brief Constructor
+ *
+ * @param QString workPath, directory where the databases are made
+ * @param int iterations, number of runs of each case
+ */
+DatabaseBenchmark::DatabaseBenchmark(const QString &workPath, int iterations) :
+    m_workPath(workPath),
+    m_iterations(qMax(1, iterations)),
+    m_databaseManager(NULL),
+    m_movieCount(0)
+{
+}
+
+/**
+ * @brief Generates a library of `movieCount` movies and times every case on it
+ *
+ * @param int movieCount
+ * @return QJsonObject
+ */
+QJsonObject DatabaseBenchmark::runLibrary(int movieCount)
+{
+    Macaw::DEBUG_IN("[DatabaseBenchmark] library of " + QString::number(movieCount) + " movies");
+    databaseDirectory("library_" + QString::number(movieCount));
+    SyntheticLibrary l_library(movieCount);
+    m_movieCount = l_library.movieCount();
+    QJsonObject l_result = l_library.description();
+    QElapsedTimer l_timer;
+
+    // The schema is made by DatabaseManager, the rows by SyntheticLibrary
+    l_timer.start();
+    m_databaseManager = new DatabaseManager();
+    m_databaseManager->open();
+    m_databaseManager->closeDB();
+    delete m_databaseManager;
+    bool l_generated;
+    {
+        QSqlDatabase l_db = QSqlDatabase::addDatabase("QSQLITE", "Benchmark-generator");
+        l_db.setDatabaseName(DatabaseManager::databasePath());
+        l_generated = l_db.open() && l_library.generate(l_db);
+        l_db.close();
+    }
+    QSqlDatabase::removeDatabase("Benchmark-generator");
+    l_result.insert("generated", l_generated);
+    l_result.insert("generation_ms", l_timer.nsecsElapsed() / 1000000.0);
+
+    // Builds the full-text search index
+    l_timer.restart();
+    m_databaseManager = new DatabaseManager();
+    m_databaseManager->open();
+    l_result.insert("open_ms", l_timer.nsecsElapsed() / 1000000.0);
+    m_databaseManager->setSlowQueryThreshold(-1);
+    prepareData();
+    m_databaseManager->resetQueryStatistics();
+
+    QJsonArray l_getterList;
+    for (int l_getter = 0 ; l_getter < GetterCount ; l_getter++)
+    {
+        QList<qint64> l_timeList;
+        int l_rowCount = 0;
+        for (int i = 0 ; i < m_iterations ; i++)
+        {
+            l_timer.restart();
+            l_rowCount = runGetter(static_cast<Getter>(l_getter));
+            l_timeList.append(l_timer.nsecsElapsed() / 1000);
+        }
+        l_getterList.append(result(getterName(static_cast<Getter>(l_getter)),
+                                   l_timeList,
+                                   l_rowCount));
+    }
+    l_result.insert("getters", l_getterList);
+
+    // Each iteration inserts movies, changes and deletes them
+    QVector<QList<qint64> > l_writeTimeList(WriteCount);
+    QVector<int> l_writeRowCount(WriteCount);
+    for (int i = 0 ; i < m_iterations ; i++)
+    {
+        for (int l_write = 0 ; l_write < WriteCount ; l_write++)
+        {
+            l_timer.restart();
+            l_writeRowCount[l_write] = runWrite(static_cast<Write>(l_write), i);
+            l_writeTimeList[l_write].append(l_timer.nsecsElapsed() / 1000);
+        }
+    }
+    QJsonArray l_writeList;
+    for (int l_write = 0 ; l_write < WriteCount ; l_write++)
+    {
+        l_writeList.append(result(writeName(static_cast<Write>(l_write)),
+                                  l_writeTimeList.at(l_write),
+                                  l_writeRowCount.at(l_write)));
+    }
+    l_result.insert("writes", l_writeList);
+    l_result.insert("queries", queryStatistics());
+
+    m_databaseManager->closeDB();
+    delete m_databaseManager;
+    m_databaseManager = NULL;
+    Macaw::DEBUG_OUT("[DatabaseBenchmark] library done");
+
+    return l_result;
+}
+
+/**
+ * @brief Generates a version 0.4.0 database of `movieCount` movies and times
+ * its upgrade to DB_VERSION, made by the constructor of DatabaseManager
+ * (backup included).
+ *
+ * @param int movieCount
+ * @return QJsonObject
+ */
+QJsonObject DatabaseBenchmark::runUpgrade(int movieCount)
+{
+    Macaw::DEBUG_IN("[DatabaseBenchmark] upgrade of " + QString::number(movieCount) + " movies");
+    databaseDirectory("upgrade_v040_" + QString::number(movieCount));
+    SyntheticLibrary l_library(movieCount);
+    QJsonObject l_result = l_library.description();
+    l_result.insert("from_version", 40);
+    l_result.insert("to_version", DB_VERSION);
+    QElapsedTimer l_timer;
+
+    l_timer.start();
+    bool l_generated;
+    {
+        QSqlDatabase l_db = QSqlDatabase::addDatabase("QSQLITE", "Benchmark-generator");
+        l_db.setDatabaseName(DatabaseManager::databasePath());
+        l_generated = l_db.open() && l_library.generate(l_db, SyntheticLibrary::V040);
+        l_db.close();
+    }
+    QSqlDatabase::removeDatabase("Benchmark-generator");
+    l_result.insert("generated", l_generated);
+    l_result.insert("generation_ms", l_timer.nsecsElapsed() / 1000000.0);
+
+    l_timer.restart();
+    m_databaseManager = new DatabaseManager();
+    bool l_upgraded = m_databaseManager->open();
+    l_result.insert("upgrade_ms", l_timer.nsecsElapsed() / 1000000.0);
+    l_result.insert("upgraded", l_upgraded);
+
+    // Sanity check, not timed: every movie is still there, under an entry of path_list
+    l_result.insert("movies_after_upgrade", m_databaseManager->getAllMovies().size());
+    l_result.insert("paths_after_upgrade", m_databaseManager->getMoviesPaths().size());
+
+    m_databaseManager->closeDB();
+    delete m_databaseManager;
+    m_databaseManager = NULL;
+    Macaw::DEBUG_OUT("[DatabaseBenchmark] upgrade done");
+
+    return l_result;
+}
+
+/**
+ * @brief Makes an empty directory for a database, and points DatabaseManager at it
+ * through the properties of the application
+ *
+ * @param QString name of the directory
+ * @return QString path of the directory
+ */
+QString DatabaseBenchmark::databaseDirectory(const QString &name) const
+{
+    QString l_path = m_workPath + "/" + name + "/";
+    QDir(l_path).removeRecursively();
+    QDir().mkpath(l_path + "posters");
+    QCoreApplication::instance()->setProperty("filesPath", l_path);
+    QCoreApplication::instance()->setProperty("postersPath", l_path + "posters/");
+
+    return l_path;
+}
+
+/**
+ * @brief Reads the entities used as arguments by the cases
+ */
+void DatabaseBenchmark::prepareData()
+{
+    // A movie with people and tags, see SyntheticLibrary
+    m_movie = m_databaseManager->getOneMovieById(qMin(m_movieCount, (m_movieCount / 2) | 3));
+    m_people = m_databaseManager->getOnePeopleById(1);
+    m_tag = m_databaseManager->getOneTagById(1);
+    m_playlist = m_databaseManager->getOnePlaylistById(2);
+    m_moviesPath = m_databaseManager->getMoviesPaths().value(0);
+
+    MovieCursor l_cursor;
+    m_pageMovieList = m_databaseManager->getMoviesPage(l_cursor, 200);
+    m_pageMovieIdList.clear();
+    foreach (Movie l_movie, m_pageMovieList)
+    {
+        m_pageMovieIdList.append(l_movie.id());
+    }
+
+    m_showMovieList = m_databaseManager->getAllMovies(true);
+    m_showMovieIdList.clear();
+    foreach (Movie l_movie, m_showMovieList)
+    {
+        m_showMovieIdList.append(l_movie.id());
+    }
+}
+
+/**
+ * @brief Runs a getter once
+ *
+ * @param Getter getter
+ * @return int number of entities read
+ */
+int DatabaseBenchmark::runGetter(Getter getter)
+{
+    DatabaseManager *l_db = m_databaseManager;
+
+    switch (getter)
+    {
+    case GetOneMovieById:
+        return l_db->getOneMovieById(m_movie.id()).id() > 0 ? 1 : 0;
+    case GetAllMovies:
+        return l_db->getAllMovies().size();
+    case GetAllMoviesOfShows:
+        return l_db->getAllMovies(true).size();
+    case GetMoviesByPeople:
+        return l_db->getMoviesByPeople(m_people.id(), People::Actor).size();
+    case GetMoviesByTag:
+        return l_db->getMoviesByTag(m_tag.id()).size();
+    case GetMoviesByPlaylist:
+        return l_db->getMoviesByPlaylist(Playlist::ToWatch).size();
+    case GetMoviesByPath:
+        return l_db->getMoviesByPath(m_moviesPath).size();
+    case GetMoviesWithoutPeople:
+        return l_db->getMoviesWithoutPeople(People::Director).size();
+    case GetMoviesWithoutTag:
+        return l_db->getMoviesWithoutTag().size();
+    case GetMoviesByAny:
+        return l_db->getMoviesByAny("Movie 12").size();
+    case GetMoviesNotImported:
+        return l_db->getMoviesNotImported().size();
+    case GetMoviesPage:
+    {
+        MovieCursor l_cursor;
+        return l_db->getMoviesPage(l_cursor, 200).size();
+    }
+    case GetMoviesByReleaseDate:
+        return l_db->getMoviesByReleaseDate(QDate(1990, 1, 1), QDate(1999, 12, 31)).size();
+    case GetOneEpisodeById:
+        return l_db->getOneEpisodeById(1).id() > 0 ? 1 : 0;
+    case GetAllEpisodes:
+        return l_db->getAllEpisodes().size();
+    case GetEpisodesByMovies:
+        return l_db->getEpisodesByMovies(m_showMovieList).size();
+    case GetEpisodesByMovieIds:
+        return l_db->getEpisodesByMovieIds(m_showMovieIdList).size();
+    case GetOnePeopleById:
+        return l_db->getOnePeopleById(m_people.id()).id() > 0 ? 1 : 0;
+    case GetOnePeopleByIdAndType:
+        return l_db->getOnePeopleById(m_people.id(), People::Actor).id() > 0 ? 1 : 0;
+    case GetOnePeopleByName:
+        return l_db->getOnePeopleByName(m_people.name()).id() > 0 ? 1 : 0;
+    case GetPeopleUsedByType:
+        return l_db->getPeopleUsedByType(People::Director).size();
+    case GetPeopleByName:
+        return l_db->getPeopleByName(m_people.name()).size();
+    case GetPeopleByMovie:
+        return l_db->getPeopleByMovie(m_movie, People::Actor).size();
+    case GetPeopleByMovieIds:
+        return l_db->getPeopleByMovieIds(m_pageMovieIdList).size();
+    case GetPeopleByAny:
+        return l_db->getPeopleByAny("Person 12", People::Actor).size();
+    case GetOneTagById:
+        return l_db->getOneTagById(m_tag.id()).id() > 0 ? 1 : 0;
+    case GetOneTagByName:
+        return l_db->getOneTagByName(m_tag.name()).id() > 0 ? 1 : 0;
+    case GetAllTags:
+        return l_db->getAllTags().size();
+    case GetTagsUsed:
+        return l_db->getTagsUsed().size();
+    case GetTagsByAny:
+        return l_db->getTagsByAny("Tag 1").size();
+    case GetTagsByMovieIds:
+        return l_db->getTagsByMovieIds(m_pageMovieIdList).size();
+    case GetOnePlaylistById:
+        return l_db->getOnePlaylistById(m_playlist.id()).movieList().size();
+    case GetAllPlaylists:
+        return l_db->getAllPlaylists().size();
+    case IsMovieInPlaylist:
+        return l_db->isMovieInPlaylist(m_movie.id(), Playlist::ToWatch) ? 1 : 0;
+    case GetMovieIdsByPlaylist:
+        return l_db->getMovieIdsByPlaylist(Playlist::ToWatch).size();
+    case SetPeopleAndTagsToMovies:
+    {
+        QList<Movie> l_movieList = m_pageMovieList;
+        l_db->setPeopleAndTagsToMovies(l_movieList);
+        return l_movieList.size();
+    }
+    case ExistMovie:
+        return l_db->existMovie(m_moviesPath.id(), m_movie.fileRelativePath()) ? 1 : 0;
+    case GetKnownMovieFiles:
+        return l_db->getKnownMovieFiles().value(m_moviesPath.id()).size();
+    case ExistTag:
+        return l_db->existTag(m_tag.name()) ? 1 : 0;
+    case ExistPeople:
+        return l_db->existPeople(m_people.name()) ? 1 : 0;
+    case GetMoviesPaths:
+        return l_db->getMoviesPaths().size();
+    case GetMoviesPathById:
+        return l_db->getMoviesPathById(m_moviesPath.id()).isEmpty() ? 0 : 1;
+    case GetterCount:
+        break;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Runs a write once. The movies, people and tag made at the beginning
+ * of the iteration are used, then deleted at its end.
+ *
+ * @param Write write
+ * @param int iteration, to give new names
+ * @return int number of entities written
+ */
+int DatabaseBenchmark::runWrite(Write write, int iteration)
+{
+    DatabaseManager *l_db = m_databaseManager;
+    QString l_suffix = QString::number(iteration);
+
+    switch (write)
+    {
+    case InsertNewMovie:
+        m_newMovie = Movie();
+        m_newMovie.setTitle("Benchmark movie " + l_suffix);
+        m_newMovie.setFileRelativePath("benchmark/movie_" + l_suffix + ".mkv");
+        m_newMovie.setReleaseDate(QDate(2000, 1, 1));
+        m_newMovie.setImported(true);
+        return l_db->insertNewMovie(m_newMovie, m_moviesPath.id()) ? 1 : 0;
+    case InsertMovies:
+        m_newMovieList.clear();
+        for (int i = 0 ; i < 1000 ; i++)
+        {
+            Movie l_movie;
+            l_movie.setTitle("Benchmark batch " + l_suffix + " movie " + QString::number(i));
+            l_movie.setFileRelativePath("benchmark/batch_" + l_suffix + "/movie_"
+                                        + QString::number(i) + ".mkv");
+            m_newMovieList.append(l_movie);
+        }
+        return l_db->insertMovies(m_newMovieList, m_moviesPath.id()).size();
+    case UpdateMovie:
+        m_movie.setRank((m_movie.rank() + 1) % 6);
+        return l_db->updateMovie(m_movie) ? 1 : 0;
+    case AddPeopleToMovie:
+        m_newPeople = People("Benchmark person " + l_suffix);
+        return l_db->addPeopleToMovie(m_newPeople, m_newMovie, People::Actor) ? 1 : 0;
+    case AddTagToMovie:
+        m_newTag = Tag("Benchmark tag " + l_suffix);
+        return l_db->addTagToMovie(m_newTag, m_newMovie) ? 1 : 0;
+    case UpdatePeople:
+        m_people.setBiography("Biography changed at iteration " + l_suffix);
+        return l_db->updatePeople(m_people) ? 1 : 0;
+    case UpdateTag:
+        m_newTag.setName("Benchmark tag renamed " + l_suffix);
+        return l_db->updateTag(m_newTag) ? 1 : 0;
+    case UpdateMovieInPlaylist:
+        return l_db->updateMovieInPlaylist(m_newMovie, m_playlist) ? 1 : 0;
+    case RemoveMovieFromPlaylist:
+        return l_db->removeMovieFromPlaylist(m_newMovie, m_playlist) ? 1 : 0;
+    case RemovePeopleFromMovie:
+        return l_db->removePeopleFromMovie(m_newPeople, m_newMovie, People::Actor) ? 1 : 0;
+    case RemoveTagFromMovie:
+        return l_db->removeTagFromMovie(m_newTag, m_newMovie) ? 1 : 0;
+    case DeleteMovie:
+        return l_db->deleteMovie(m_newMovie) ? 1 : 0;
+    case DeleteMovies:
+        return l_db->deleteMovies(m_newMovieList) ? m_newMovieList.size() : 0;
+    case WriteCount:
+        break;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Name of a getter in the JSON output
+ *
+ * @param Getter getter
+ * @return QString
+ */
+QString DatabaseBenchmark::getterName(Getter getter)
+{
+    static const char *const l_nameList[GetterCount] = {
+        "getOneMovieById", "getAllMovies", "getAllMovies(show)", "getMoviesByPeople",
+        "getMoviesByTag", "getMoviesByPlaylist", "getMoviesByPath", "getMoviesWithoutPeople",
+        "getMoviesWithoutTag", "getMoviesByAny", "getMoviesNotImported", "getMoviesPage",
+        "getMoviesByReleaseDate", "getOneEpisodeById", "getAllEpisodes", "getEpisodesByMovies",
+        "getEpisodesByMovieIds", "getOnePeopleById", "getOnePeopleById(type)",
+        "getOnePeopleByName", "getPeopleUsedByType", "getPeopleByName", "getPeopleByMovie",
+        "getPeopleByMovieIds", "getPeopleByAny", "getOneTagById", "getOneTagByName", "getAllTags",
+        "getTagsUsed", "getTagsByAny", "getTagsByMovieIds", "getOnePlaylistById", "getAllPlaylists",
+        "isMovieInPlaylist", "getMovieIdsByPlaylist", "setPeopleAndTagsToMovies",
+        "existMovie", "getKnownMovieFiles", "existTag", "existPeople", "getMoviesPaths", "getMoviesPathById"
+    };
+
+    return l_nameList[getter];
+}
+
+/**
+ * @brief Name of a write in the JSON output
+ *
+ * @param Write write
+ * @return QString
+ */
+QString DatabaseBenchmark::writeName(Write write)
+{
+    static const char *const l_nameList[WriteCount] = {
+        "insertNewMovie", "insertMovies(1000)", "updateMovie", "addPeopleToMovie",
+        "addTagToMovie", "updatePeople", "updateTag", "updateMovieInPlaylist",
+        "removeMovieFromPlaylist", "removePeopleFromMovie", "removeTagFromMovie",
+        "deleteMovie", "deleteMovies(1000)"
+    };
+
+    return l_nameList[write];
+}
+
+/**
+ * @brief Result of a case: first run apart, then minimum, median and maximum of all the runs
+ *
+ * @param QString name of the case
+ * @param QList<qint64> timeList, in microseconds, in the order of the runs
+ * @param int rowCount, entities read or written by the last run
+ * @return QJsonObject
+ */
+QJsonObject DatabaseBenchmark::result(const QString &name, const QList<qint64> &timeList, int rowCount)
+{
+    QList<qint64> l_sortedTimeList = timeList;
+    qSort(l_sortedTimeList);
+
+    QJsonObject l_result;
+    l_result.insert("name", name);
+    l_result.insert("rows", rowCount);
+    l_result.insert("runs", timeList.size());
+    l_result.insert("first_ms", timeList.first() / 1000.0);
+    l_result.insert("min_ms", l_sortedTimeList.first() / 1000.0);
+    l_result.insert("median_ms", l_sortedTimeList.at(l_sortedTimeList.size() / 2) / 1000.0);
+    l_result.insert("max_ms", l_sortedTimeList.last() / 1000.0);
+
+    return l_result;
+}
+
+/**
+ * @brief Statistics of the queries of DatabaseManager during the cases,
+ * see DatabaseManager::queryStatistics()
+ *
+ * @return QJsonObject, by calling function
+ */
+QJsonObject DatabaseBenchmark::queryStatistics() const
+{
+    QJsonObject l_statisticsObject;
+    QHash<QString, QueryStatistics> l_statisticsHash = m_databaseManager->queryStatistics();
+    foreach (QString l_caller, l_statisticsHash.keys())
+    {
+        QueryStatistics l_statistics = l_statisticsHash.value(l_caller);
+        QJsonObject l_object;
+        l_object.insert("count", l_statistics.count);
+        l_object.insert("total_ms", l_statistics.totalTime / 1000.0);
+        l_object.insert("max_ms", l_statistics.maxTime / 1000.0);
+        l_object.insert("rows", double(l_statistics.rowCount));
+        l_statisticsObject.insert(l_caller, l_object);
+    }
+
+    return l_statisticsObject;
+}
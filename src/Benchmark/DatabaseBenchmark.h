@@ -0,0 +1,108 @@
+/* Copyright (C) 2014 Macaw-Movies
+ * (Olivier CHURLAUD, Sébastien TOUZÉ)
+ *
+ * This file is part of Macaw-Movies.
+ *
+ * Macaw-Movies is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Macaw-Movies is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Macaw-Movies.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DATABASEBENCHMARK_H
+#define DATABASEBENCHMARK_H
+
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QList>
+#include <QString>
+
+#include "Entities/Movie.h"
+#include "Entities/PathForMovies.h"
+#include "Entities/People.h"
+#include "Entities/Playlist.h"
+#include "Entities/Tag.h"
+
+class DatabaseManager;
+
+/**
+ * @brief Times DatabaseManager on synthetic libraries, see SyntheticLibrary
+ *
+ * Each case is run `iterations` times. The first run is reported apart, since
+ * the following ones may be served by the caches of DatabaseManager.
+ * The results are JSON objects, so that runs on different commits can be compared.
+ */
+class DatabaseBenchmark
+{
+public:
+    DatabaseBenchmark(const QString &workPath, int iterations);
+    QJsonObject runLibrary(int movieCount);
+    QJsonObject runUpgrade(int movieCount);
+
+private:
+    // The public getters of DatabaseManager that are implemented
+    // (getOneShowById(), getAllshow(), getPlaylistByAny(), existEpisode()
+    // and existshow() are only declared)
+    enum Getter {
+        GetOneMovieById, GetAllMovies, GetAllMoviesOfShows, GetMoviesByPeople,
+        GetMoviesByTag, GetMoviesByPlaylist, GetMoviesByPath, GetMoviesWithoutPeople,
+        GetMoviesWithoutTag, GetMoviesByAny, GetMoviesNotImported, GetMoviesPage,
+        GetMoviesByReleaseDate, GetOneEpisodeById, GetAllEpisodes, GetEpisodesByMovies,
+        GetEpisodesByMovieIds, GetOnePeopleById, GetOnePeopleByIdAndType,
+        GetOnePeopleByName, GetPeopleUsedByType, GetPeopleByName, GetPeopleByMovie,
+        GetPeopleByMovieIds, GetPeopleByAny, GetOneTagById, GetOneTagByName, GetAllTags,
+        GetTagsUsed, GetTagsByAny, GetTagsByMovieIds, GetOnePlaylistById, GetAllPlaylists,
+        IsMovieInPlaylist, GetMovieIdsByPlaylist, SetPeopleAndTagsToMovies,
+        ExistMovie, GetKnownMovieFiles, ExistTag, ExistPeople, GetMoviesPaths, GetMoviesPathById,
+        GetterCount
+    };
+
+    // The writes, run in this order at each iteration
+    enum Write {
+        InsertNewMovie, InsertMovies, UpdateMovie, AddPeopleToMovie, AddTagToMovie,
+        UpdatePeople, UpdateTag, UpdateMovieInPlaylist, RemoveMovieFromPlaylist,
+        RemovePeopleFromMovie, RemoveTagFromMovie, DeleteMovie, DeleteMovies,
+        WriteCount
+    };
+
+    static QString getterName(Getter getter);
+    static QString writeName(Write write);
+    int runGetter(Getter getter);
+    int runWrite(Write write, int iteration);
+    QString databaseDirectory(const QString &name) const;
+    void prepareData();
+    static QJsonObject result(const QString &name, const QList<qint64> &timeList, int rowCount);
+    QJsonObject queryStatistics() const;
+
+    QString m_workPath;
+    int m_iterations;
+    DatabaseManager *m_databaseManager;
+    int m_movieCount;
+
+    // Data used by the cases, read after the generation
+    Movie m_movie;
+    People m_people;
+    Tag m_tag;
+    Playlist m_playlist;
+    PathForMovies m_moviesPath;
+    QList<Movie> m_pageMovieList;
+    QList<int> m_pageMovieIdList;
+    QList<Movie> m_showMovieList;
+    QList<int> m_showMovieIdList;
+
+    // Made and removed by the writes
+    Movie m_newMovie;
+    QList<Movie> m_newMovieList;
+    People m_newPeople;
+    Tag m_newTag;
+};
+
+#endif // DATABASEBENCHMARK_H
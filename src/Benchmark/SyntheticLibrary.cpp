@@ -0,0 +1,357 @@
+/* Copyright (C) 2014 Macaw-Movies
+ * (Olivier CHURLAUD, Sébastien TOUZÉ)
+ *
+ * This file is part of Macaw-Movies.
+ *
+ * Macaw-Movies is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Macaw-Movies is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Macaw-Movies.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "SyntheticLibrary.h"
+
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QVariant>
+
+#include "MacawDebug.h"
+#include "Entities/People.h"
+#include "Entities/Playlist.h"
+
+/**
+ * @brief Constructor. The number of people, tags and shows grows with the number of movies.
+ *
+ * @param int movieCount
+ */
+SyntheticLibrary::SyntheticLibrary(int movieCount) :
+    m_movieCount(qMax(1, movieCount)),
+    m_peopleCount(qMax(100, movieCount / 2)),
+    m_tagCount(qBound(50, movieCount / 200, 500)),
+    m_playlistCount(20),
+    m_showCount(qMax(10, movieCount / 200))
+{
+}
+
+/**
+ * @brief Root of the movies of the library, as stored in `path_list`
+ *
+ * @return QString
+ */
+QString SyntheticLibrary::libraryPath()
+{
+    return "/bench/library/";
+}
+
+/**
+ * @brief Sizes of the library, for the JSON output
+ *
+ * @return QJsonObject
+ */
+QJsonObject SyntheticLibrary::description() const
+{
+    QJsonObject l_description;
+    l_description.insert("movies", m_movieCount);
+    l_description.insert("people", m_peopleCount);
+    l_description.insert("tags", m_tagCount);
+    l_description.insert("playlists", m_playlistCount);
+    l_description.insert("shows", m_showCount);
+
+    return l_description;
+}
+
+/**
+ * @brief Fills an empty database with the library, in one transaction.
+ *
+ * With the `Current` schema, the triggers of the full-text search index and of
+ * the facet counts are dropped first: DatabaseManager builds them again in one
+ * pass when it opens the database, see DatabaseManager::initSearchIndex()
+ * and DatabaseManager::initFacetCounts().
+ *
+ * @param QSqlDatabase db, open connection to the database
+ * @param Schema schema
+ * @return bool
+ */
+bool SyntheticLibrary::generate(QSqlDatabase &db, Schema schema)
+{
+    Macaw::DEBUG_IN("[SyntheticLibrary] generate " + QString::number(m_movieCount) + " movies");
+    QSqlQuery l_query(db);
+    QStringList l_queryList;
+
+    if (schema == Current)
+    {
+        l_query.exec("SELECT name FROM sqlite_master WHERE type = 'trigger' "
+                     "AND (name LIKE 'search%' OR name LIKE 'facet%')");
+        while (l_query.next())
+        {
+            l_queryList << "DROP TRIGGER " + l_query.value(0).toString();
+        }
+        l_queryList << currentSchemaQueries();
+    }
+    else
+    {
+        l_queryList << v040SchemaQueries();
+    }
+    l_queryList << linkQueries();
+
+    bool l_ret = db.transaction();
+    foreach (QString l_queryText, l_queryList)
+    {
+        if (l_ret && !l_query.exec(l_queryText))
+        {
+            Macaw::DEBUG("In SyntheticLibrary::generate():");
+            Macaw::DEBUG(l_query.lastError().text());
+            l_ret = false;
+        }
+    }
+
+    if (l_ret)
+    {
+        l_ret = db.commit();
+    }
+    else
+    {
+        db.rollback();
+    }
+    l_ret = l_ret && l_query.exec("ANALYZE");
+    Macaw::DEBUG_OUT("[SyntheticLibrary] generation done");
+
+    return l_ret;
+}
+
+/**
+ * @brief Rows of the current schema, apart from the links of the movies
+ *
+ * @return QStringList
+ */
+QStringList SyntheticLibrary::currentSchemaQueries() const
+{
+    QStringList l_queryList;
+    l_queryList << "INSERT INTO path_list(id, movies_path, type, imported) "
+                   "VALUES (1, '" + libraryPath() + "', 3, 1)";
+
+    // 1 movie out of 20 is an episode, the shows are filled in turn
+    l_queryList << "INSERT INTO movies(id, title, original_title, release_date, country, "
+                       "duration, synopsis, id_path, file_path, poster_path, colored, "
+                       "format, suffix, rank, imported, id_tmdb, show) "
+                   "WITH RECURSIVE " + sequence("seq", m_movieCount) + " "
+                   "SELECT x, 'Movie ' || x, 'Original title ' || x, "
+                       "2447893 + (x * 7919) % 12000, "
+                       "CASE x % 4 WHEN 0 THEN 'France' WHEN 1 THEN 'USA' "
+                                  "WHEN 2 THEN 'Japan' ELSE 'Italy' END, "
+                       "(3600 + (x * 13) % 7200) * 1000, "
+                       "'Synopsis of the movie number ' || x, 1, "
+                       "CASE WHEN x % 20 = 0 "
+                           "THEN 'shows/show_' || (1 + x / 20 % " + QString::number(m_showCount) + ") "
+                                "|| '/episode_' || x || '.mkv' "
+                           "ELSE 'movies/' || (x % 100) || '/movie_' || x || '.mkv' END, "
+                       "'', 1, 'mkv', 'mkv', x % 6, x % 10 <> 0, x, x % 20 = 0 "
+                   "FROM seq";
+
+    l_queryList << "INSERT INTO people(id, name, birthday, biography, imported, id_tmdb) "
+                   "WITH RECURSIVE " + sequence("seq", m_peopleCount) + " "
+                   "SELECT x, 'Person ' || x, 2415021 + (x * 104729) % 30000, "
+                       "'Biography of the person number ' || x, 1, x "
+                   "FROM seq";
+
+    l_queryList << "INSERT INTO show(id, name, finished) "
+                   "WITH RECURSIVE " + sequence("seq", m_showCount) + " "
+                   "SELECT x, 'Show ' || x, x % 3 = 0 "
+                   "FROM seq";
+
+    l_queryList << "INSERT INTO episodes(number, season, id_show, id_movie) "
+                   "WITH RECURSIVE " + sequence("seq", m_movieCount) + " "
+                   "SELECT 1 + x / 20 / %1 / 8, 1 + x / 20 / %1 % 8, 1 + x / 20 % %1, x "
+                   "FROM seq WHERE x % 20 = 0";
+    l_queryList.last() = l_queryList.last().arg(m_showCount);
+
+    return l_queryList;
+}
+
+/**
+ * @brief Tables and rows of a version 0.4.0 database: no shows, no TMDB ids,
+ * text dates, absolute paths of the movies and a `paths_list` table.
+ * The entries of `paths_list` are nested, the upgrade keeps the most specific one.
+ *
+ * @return QStringList
+ */
+QStringList SyntheticLibrary::v040SchemaQueries() const
+{
+    QStringList l_queryList;
+    l_queryList << "CREATE TABLE movies("
+                       "id INTEGER PRIMARY KEY AUTOINCREMENT UNIQUE, "
+                       "title VARCHAR(255) NOT NULL, "
+                       "original_title VARCHAR(255), "
+                       "release_date VARCHAR(10), "
+                       "country VARCHAR(50), "
+                       "duration INTEGER, "
+                       "synopsis TEXT, "
+                       "file_path VARCHAR(255) UNIQUE NOT NULL, "
+                       "poster_path VARCHAR(255), "
+                       "colored BOOLEAN, "
+                       "format VARCHAR(10), "
+                       "suffix VARCHAR(10), "
+                       "rank INTEGER, "
+                       "imported BOOLEAN)"
+                << "CREATE TABLE people("
+                       "id INTEGER PRIMARY KEY AUTOINCREMENT UNIQUE, "
+                       "name VARCHAR(200) NOT NULL, "
+                       "birthday VARCHAR(10), "
+                       "biography TEXT)"
+                << "CREATE TABLE movies_people("
+                       "id INTEGER PRIMARY KEY AUTOINCREMENT UNIQUE, "
+                       "id_movie INTEGER NOT NULL, "
+                       "id_people INTEGER NOT NULL, "
+                       "type INTEGER NOT NULL, "
+                       "UNIQUE (id_people, id_movie, type) ON CONFLICT IGNORE, "
+                       "FOREIGN KEY(id_movie) REFERENCES movies ON DELETE CASCADE, "
+                       "FOREIGN KEY(id_people) REFERENCES people ON DELETE CASCADE)"
+                << "CREATE TABLE playlists("
+                       "id INTEGER PRIMARY KEY AUTOINCREMENT UNIQUE, "
+                       "name VARCHAR(255) UNIQUE NOT NULL, "
+                       "rate INTEGER, "
+                       "creation_date INT)"
+                << "INSERT INTO playlists VALUES(1, 'To Watch', 0, 0)"
+                << "CREATE TABLE movies_playlists("
+                       "id INTEGER PRIMARY KEY AUTOINCREMENT UNIQUE, "
+                       "id_movie INTEGER NOT NULL, "
+                       "id_playlist INTEGER NOT NULL, "
+                       "UNIQUE (id_playlist, id_movie) ON CONFLICT IGNORE, "
+                       "FOREIGN KEY(id_movie) REFERENCES movies ON DELETE CASCADE, "
+                       "FOREIGN KEY(id_playlist) REFERENCES playlists ON DELETE CASCADE)"
+                << "CREATE TABLE tags("
+                       "id INTEGER PRIMARY KEY AUTOINCREMENT UNIQUE, "
+                       "name VARCHAR(255) UNIQUE NOT NULL)"
+                << "CREATE TABLE movies_tags("
+                       "id INTEGER PRIMARY KEY AUTOINCREMENT UNIQUE, "
+                       "id_movie INTEGER NOT NULL, "
+                       "id_tag INTEGER NOT NULL, "
+                       "UNIQUE (id_tag, id_movie) ON CONFLICT IGNORE, "
+                       "FOREIGN KEY(id_movie) REFERENCES movies ON DELETE CASCADE, "
+                       "FOREIGN KEY(id_tag) REFERENCES tags ON DELETE CASCADE)"
+                << "CREATE TABLE paths_list("
+                       "id INTEGER PRIMARY KEY AUTOINCREMENT UNIQUE, "
+                       "movies_path VARCHAR(255) UNIQUE, "
+                       "imported BOOLEAN DEFAULT 0)"
+                << "CREATE TABLE config(db_version INTEGER)"
+                << "INSERT INTO config(db_version) VALUES (40)";
+
+    // Without trailing slash, and a nested entry holding 1 movie out of 100
+    QString l_libraryPath = libraryPath();
+    l_libraryPath.chop(1);
+    l_queryList << "INSERT INTO paths_list(id, movies_path, imported) "
+                   "VALUES (1, '" + l_libraryPath + "', 1), "
+                          "(2, '" + libraryPath() + "movies/5/', 1)";
+
+    l_queryList << "INSERT INTO movies(id, title, original_title, release_date, country, "
+                       "duration, synopsis, file_path, poster_path, colored, "
+                       "format, suffix, rank, imported) "
+                   "WITH RECURSIVE " + sequence("seq", m_movieCount) + " "
+                   "SELECT x, 'Movie ' || x, 'Original title ' || x, "
+                       "strftime('%Y.%m.%d', 2447893 + (x * 7919) % 12000), "
+                       "CASE x % 4 WHEN 0 THEN 'France' WHEN 1 THEN 'USA' "
+                                  "WHEN 2 THEN 'Japan' ELSE 'Italy' END, "
+                       "(3600 + (x * 13) % 7200) * 1000, "
+                       "'Synopsis of the movie number ' || x, "
+                       "'" + libraryPath() + "movies/' || (x % 100) || '/movie_' || x || '.mkv', "
+                       "'', 1, 'mkv', 'mkv', x % 6, x % 10 <> 0 "
+                   "FROM seq";
+
+    l_queryList << "INSERT INTO people(id, name, birthday, biography) "
+                   "WITH RECURSIVE " + sequence("seq", m_peopleCount) + " "
+                   "SELECT x, 'Person ' || x, strftime('%Y.%m.%d', 2415021 + (x * 104729) % 30000), "
+                       "'Biography of the person number ' || x "
+                   "FROM seq";
+
+    return l_queryList;
+}
+
+/**
+ * @brief Tags, playlists, and the links of the movies to people, tags and playlists.
+ * Same tables in both schemas.
+ *
+ * @return QStringList
+ */
+QStringList SyntheticLibrary::linkQueries() const
+{
+    QStringList l_queryList;
+    l_queryList << "INSERT INTO tags(id, name) "
+                   "WITH RECURSIVE " + sequence("seq", m_tagCount) + " "
+                   "SELECT x, 'Tag ' || x "
+                   "FROM seq";
+
+    // "To Watch" is already there
+    l_queryList << "INSERT INTO playlists(id, name, rate, creation_date) "
+                   "WITH RECURSIVE " + sequence("seq", m_playlistCount - 1) + " "
+                   "SELECT x + 1, 'Playlist ' || x, x % 5, 1400000000 + x * 86400 "
+                   "FROM seq";
+
+    // 1 director, 1 producer and 5 actors, none for 1 movie out of 50
+    l_queryList << QString("INSERT INTO movies_people(id_movie, id_people, type) "
+                           "WITH RECURSIVE " + sequence("seq", m_movieCount) + ", "
+                               "slot(k) AS (VALUES (0), (1), (2), (3), (4), (5), (6)) "
+                           "SELECT x, " + pick("x * 7 + k", m_peopleCount) + ", "
+                               "CASE k WHEN 0 THEN %1 WHEN 1 THEN %2 ELSE %3 END "
+                           "FROM seq, slot WHERE x % 50 <> 0")
+                   .arg(People::Director)
+                   .arg(People::Producer)
+                   .arg(People::Actor);
+
+    // x % 4 tags: none for 1 movie out of 4
+    l_queryList << "INSERT INTO movies_tags(id_movie, id_tag) "
+                   "WITH RECURSIVE " + sequence("seq", m_movieCount) + ", "
+                       "slot(k) AS (VALUES (0), (1), (2)) "
+                   "SELECT x, " + pick("x * 3 + k", m_tagCount) + " "
+                   "FROM seq, slot WHERE k < x % 4";
+
+    l_queryList << "INSERT INTO movies_playlists(id_movie, id_playlist) "
+                   "WITH RECURSIVE " + sequence("seq", m_movieCount) + " "
+                   "SELECT x, " + QString::number(Playlist::ToWatch) + " "
+                   "FROM seq WHERE x % 10 = 3";
+
+    // About 1 movie out of 100 in each other playlist
+    l_queryList << "INSERT INTO movies_playlists(id_movie, id_playlist) "
+                   "WITH RECURSIVE " + sequence("seq", m_movieCount) + ", "
+                       + sequence("pl", m_playlistCount) + " "
+                   "SELECT seq.x, pl.x FROM seq, pl "
+                   "WHERE pl.x > 1 AND (seq.x * 7 + pl.x) % 97 = 0";
+
+    return l_queryList;
+}
+
+/**
+ * @brief Common table expression of the integers from 1 to `count`, in the column `x`
+ *
+ * @param QString name of the table
+ * @param int count
+ * @return QString
+ */
+QString SyntheticLibrary::sequence(const QString &name, int count)
+{
+    return QString("%1(x) AS (SELECT 1 UNION ALL SELECT x + 1 FROM %1 WHERE x < %2)")
+            .arg(name)
+            .arg(count);
+}
+
+/**
+ * @brief SQL expression picking an id between 1 and `count` from `value`.
+ * The low ids come out more often, as the most famous actors or the most used tags.
+ *
+ * @param QString value, an integer SQL expression
+ * @param int count
+ * @return QString
+ */
+QString SyntheticLibrary::pick(const QString &value, int count)
+{
+    QString l_hash = "(((" + value + ") * 2654435761) % 4294967296 % " + QString::number(count) + ")";
+
+    return "(1 + " + l_hash + " * " + l_hash + " / " + QString::number(count) + ")";
+}
@@ -0,0 +1,70 @@
+/* Copyright (C) 2014 Macaw-Movies
+ * (Olivier CHURLAUD, Sébastien TOUZÉ)
+ *
+ * This file is part of Macaw-Movies.
+ *
+ * Macaw-Movies is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Macaw-Movies is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Macaw-Movies.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SYNTHETICLIBRARY_H
+#define SYNTHETICLIBRARY_H
+
+#include <QJsonObject>
+#include <QSqlDatabase>
+#include <QString>
+#include <QStringList>
+
+/**
+ * @brief Generates a library of movies directly in SQLite, for macaw-bench-db
+ *
+ * All the values are computed from the row numbers, so that a library of
+ * a given size is the same on every run and every machine. The fan-out follows
+ * a real collection: 7 people per movie (1 director, 1 producer, 5 actors)
+ * picked with a bias toward a few popular ones, 0 to 3 tags per movie, 1 movie
+ * out of 20 is an episode of a show, 1 out of 10 is in "To Watch".
+ * Some movies have no people or no tag, and 1 out of 10 is not imported.
+ */
+class SyntheticLibrary
+{
+public:
+    enum Schema {
+        Current,    // the schema made by DatabaseManager::createTables(), already created
+        V040        // the schema of version 0.4.0, created here
+    };
+
+    explicit SyntheticLibrary(int movieCount);
+    bool generate(QSqlDatabase &db, Schema schema = Current);
+    int movieCount() const { return m_movieCount; }
+    int peopleCount() const { return m_peopleCount; }
+    int tagCount() const { return m_tagCount; }
+    int playlistCount() const { return m_playlistCount; }
+    int showCount() const { return m_showCount; }
+    static QString libraryPath();
+    QJsonObject description() const;
+
+private:
+    QStringList currentSchemaQueries() const;
+    QStringList v040SchemaQueries() const;
+    QStringList linkQueries() const;
+    static QString sequence(const QString &name, int count);
+    static QString pick(const QString &value, int count);
+
+    int m_movieCount;
+    int m_peopleCount;
+    int m_tagCount;
+    int m_playlistCount;
+    int m_showCount;
+};
+
+#endif // SYNTHETICLIBRARY_H
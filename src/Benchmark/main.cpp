@@ -0,0 +1,169 @@
+/* Copyright (C) 2014 Macaw-Movies
+ * (Olivier CHURLAUD, Sébastien TOUZÉ)
+ *
+ * This file is part of Macaw-Movies.
+ *
+ * Macaw-Movies is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Macaw-Movies is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Macaw-Movies.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QTemporaryDir>
+#include <QVariant>
+
+#include "include_var.h"
+
+#include "MacawDebug.h"
+#include "Benchmark/DatabaseBenchmark.h"
+
+/**
+ * @brief Parses a comma-separated list of movie counts, such as "10000,100000"
+ */
+static QList<int> sizeList(const QString &text)
+{
+    QList<int> l_sizeList;
+    foreach (QString l_size, text.split(',', QString::SkipEmptyParts))
+    {
+        bool l_ok;
+        int l_value = l_size.trimmed().toInt(&l_ok);
+        if (l_ok && l_value > 0)
+        {
+            l_sizeList.append(l_value);
+        }
+    }
+
+    return l_sizeList;
+}
+
+/**
+ * @brief Version of the SQLite library used through the Qt driver
+ */
+static QString sqliteVersion()
+{
+    QString l_version;
+    {
+        QSqlDatabase l_db = QSqlDatabase::addDatabase("QSQLITE", "Benchmark-version");
+        l_db.setDatabaseName(":memory:");
+        if (l_db.open())
+        {
+            QSqlQuery l_query(l_db);
+            if (l_query.exec("SELECT sqlite_version()") && l_query.next())
+            {
+                l_version = l_query.value(0).toString();
+            }
+        }
+        l_db.close();
+    }
+    QSqlDatabase::removeDatabase("Benchmark-version");
+
+    return l_version;
+}
+
+int main(int argc, char **argv)
+{
+    QCoreApplication l_app(argc, argv);
+    l_app.setApplicationName("macaw-bench-db");
+    l_app.setApplicationVersion(APP_VERSION);
+
+    QCommandLineParser l_parser;
+    l_parser.setApplicationDescription("Times the database layer of " APP_NAME
+                                       " on synthetic libraries, and prints the results as JSON.");
+    l_parser.addHelpOption();
+    l_parser.addVersionOption();
+    const QCommandLineOption l_sizes(QStringList() << "sizes",
+                                     "Comma-separated numbers of movies of the libraries, "
+                                     "for instance 10000,100000,1000000.",
+                                     "sizes", "10000,100000");
+    l_parser.addOption(l_sizes);
+    const QCommandLineOption l_upgradeSizes(QStringList() << "upgrade-sizes",
+                                            "Comma-separated numbers of movies of the "
+                                            "version 0.4.0 databases to upgrade, none if empty.",
+                                            "sizes", "100000");
+    l_parser.addOption(l_upgradeSizes);
+    const QCommandLineOption l_iterations(QStringList() << "iterations",
+                                          "Number of runs of each case.",
+                                          "count", "5");
+    l_parser.addOption(l_iterations);
+    const QCommandLineOption l_workDir(QStringList() << "work-dir",
+                                       "Directory of the generated databases, "
+                                       "a temporary one by default.",
+                                       "path");
+    l_parser.addOption(l_workDir);
+    const QCommandLineOption l_output(QStringList() << "output",
+                                      "File receiving the JSON results, the standard output by default.",
+                                      "file");
+    l_parser.addOption(l_output);
+    const QCommandLineOption l_debug(QStringList() << "debug", "Define the debug mode");
+    l_parser.addOption(l_debug);
+    l_parser.process(l_app);
+
+    Macaw::macawDebug_extern.setDebug(l_parser.isSet(l_debug));
+
+    QTemporaryDir l_temporaryDir;
+    QString l_workPath = l_parser.isSet(l_workDir) ? l_parser.value(l_workDir)
+                                                   : l_temporaryDir.path();
+
+    DatabaseBenchmark l_benchmark(l_workPath, l_parser.value(l_iterations).toInt());
+    QJsonArray l_libraryList;
+    foreach (int l_size, sizeList(l_parser.value(l_sizes)))
+    {
+        l_libraryList.append(l_benchmark.runLibrary(l_size));
+    }
+    QJsonArray l_upgradeList;
+    foreach (int l_size, sizeList(l_parser.value(l_upgradeSizes)))
+    {
+        l_upgradeList.append(l_benchmark.runUpgrade(l_size));
+    }
+
+    QJsonObject l_result;
+    l_result.insert("benchmark", QString("macaw-bench-db"));
+    l_result.insert("version", QString(APP_VERSION));
+    l_result.insert("db_version", DB_VERSION);
+    l_result.insert("qt_version", QString(qVersion()));
+    l_result.insert("sqlite_version", sqliteVersion());
+    l_result.insert("date", QDateTime::currentDateTime().toString(Qt::ISODate));
+    l_result.insert("iterations", qMax(1, l_parser.value(l_iterations).toInt()));
+    l_result.insert("libraries", l_libraryList);
+    l_result.insert("upgrades", l_upgradeList);
+    QByteArray l_json = QJsonDocument(l_result).toJson();
+
+    QFile l_file;
+    bool l_opened;
+    if (l_parser.isSet(l_output))
+    {
+        l_file.setFileName(l_parser.value(l_output));
+        l_opened = l_file.open(QIODevice::WriteOnly | QIODevice::Truncate);
+    }
+    else
+    {
+        l_opened = l_file.open(stdout, QIODevice::WriteOnly);
+    }
+
+    if (!l_opened)
+    {
+        Macaw::DEBUG("[macaw-bench-db] cannot open the output");
+
+        return EXIT_FAILURE;
+    }
+    l_file.write(l_json);
+
+    return EXIT_SUCCESS;
+}
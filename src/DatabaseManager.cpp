@@ -19,11 +19,14 @@
 
 #include "DatabaseManager.h"
 
-#include <QApplication>
+#include <QAtomicInt>
+#include <QCoreApplication>
 #include <QDir>
+#include <QRegExp>
 #include <QSqlError>
 #include <QSqlQuery>
-#include <QSqlRecord>
+#include <QThread>
+#include <QThreadStorage>
 #include <QVariant>
 
 #include "include_var.h"
@@ -35,11 +38,112 @@
 #include "Entities/Playlist.h"
 #include "Entities/Show.h"
 
+/**
+ * @brief Names of the connections opened by threadDatabase() in one thread.
+ * Deleted by QThreadStorage when the thread finishes, which removes the connections.
+ */
+struct ThreadConnections
+{
+    QStringList nameList;
+
+    ~ThreadConnections()
+    {
+        foreach (QString l_name, nameList) {
+            QSqlDatabase::database(l_name, false).close();
+            QSqlDatabase::removeDatabase(l_name);
+        }
+    }
+};
+
+static QThreadStorage<ThreadConnections*> s_threadConnections;
+
+/**
+ * @brief Incremented by every write, see writeGeneration()
+ */
+static QAtomicInt s_writeGeneration(0);
+
 /**
  * @brief Constructor.
- * Opens the Database. If empty, create the schema.
+ * The database is opened by open(), so that upgradeProgress() can be connected first.
  */
 DatabaseManager::DatabaseManager()
+{
+    initMembers();
+    Macaw::DEBUG("[DatabaseManager] object created");
+}
+
+/**
+ * @brief Opens the Database. If empty, create the schema, and if older, upgrade it:
+ * upgradeProgress() is emitted during the upgrade.
+ *
+ * @return bool
+ */
+bool DatabaseManager::open()
+{
+    bool l_ret = openDB() && createTables();
+    loadMoviesPathCache();
+
+    return l_ret;
+}
+
+/**
+ * @brief Constructor of a manager of another thread than the main one, using `threadDb`.
+ * See createThreadReader() and createThreadWriter().
+ *
+ * @param QSqlDatabase threadDb, connection of the calling thread
+ */
+DatabaseManager::DatabaseManager(const QSqlDatabase &threadDb)
+{
+    initMembers();
+    m_threadManager = true;
+    m_db = threadDb;
+    m_readDb = threadDb;
+
+    // The schema belongs to the main manager: only check that the search index is there
+    QSqlQuery l_query(m_db);
+    m_searchEnabled = execQuery(l_query, "SELECT rowid FROM search_movies LIMIT 0", Q_FUNC_INFO)
+                      && hasTriggers(searchSchema());
+    l_query.finish();
+
+    loadMoviesPathCache();
+    Macaw::DEBUG("[DatabaseManager] thread reader created");
+}
+
+/**
+ * @brief Creates a manager for the calling thread, that is not the main one.
+ *
+ * It uses the read-only connection given by threadDatabase(): only the getters
+ * can be used. It must be deleted by the thread that created it,
+ * before this thread finishes.
+ *
+ * @return DatabaseManager*
+ */
+DatabaseManager *DatabaseManager::createThreadReader()
+{
+    return new DatabaseManager(threadDatabase(true));
+}
+
+/**
+ * @brief Creates a manager for the calling thread, that is not the main one,
+ * able to write.
+ *
+ * Used for long imports that should not block the main thread. The schema
+ * must have been made by the main manager. SQLite runs one write transaction
+ * at a time: the writes of the other connections wait for the end of the
+ * current one (up to the busy timeout), so transactions should stay short.
+ * It must be deleted by the thread that created it, before this thread finishes.
+ *
+ * @return DatabaseManager*
+ */
+DatabaseManager *DatabaseManager::createThreadWriter()
+{
+    return new DatabaseManager(threadDatabase(false));
+}
+
+/**
+ * @brief Initializes the members, the connections excepted
+ */
+void DatabaseManager::initMembers()
 {
     m_movieFields = "m.id, "
                     "m.title, "
@@ -79,9 +183,28 @@ DatabaseManager::DatabaseManager()
     m_tagFields = "t.id, "
                   "t.name ";
 
-    openDB();
-    createTables();
-    Macaw::DEBUG("[DatabaseManager] object created");
+    m_searchEnabled = false;
+    m_queryCacheHits = 0;
+    m_queryCacheMisses = 0;
+    m_transactionDepth = 0;
+    m_insertBatchSize = 500;
+    setEntityCacheSize(2000);
+    m_threadManager = false;
+    m_moviesPathCacheGeneration = -1;
+    m_backupThread = NULL;
+    m_backupCount = 5;
+    m_slowQueryThreshold = 100;
+}
+
+/**
+ * @brief Destructor
+ */
+DatabaseManager::~DatabaseManager()
+{
+    Macaw::DEBUG("[DatabaseManager] Entity cache: "
+                 + QString::number(entityCacheHits()) + " hits, "
+                 + QString::number(entityCacheMisses()) + " misses");
+    dumpQueryStatistics();
 }
 
 /**
@@ -111,7 +234,7 @@ Movie DatabaseManager::hydrateMovieOnly(QSqlQuery &query)
     l_movie.setId(query.value(0).toInt());
     l_movie.setTitle(query.value(1).toString());
     l_movie.setOriginalTitle(query.value(2).toString());
-    l_movie.setReleaseDate(QDate::fromString(query.value(3).toString(), DATE_FORMAT));
+    l_movie.setReleaseDate(dayNumberToDate(query.value(3)));
     l_movie.setCountry(query.value(4).toString());
     l_movie.setDuration(QTime::fromMSecsSinceStartOfDay(query.value(5).toInt()));
     l_movie.setSynopsis(query.value(6).toString());
@@ -121,9 +244,9 @@ Movie DatabaseManager::hydrateMovieOnly(QSqlQuery &query)
     l_movie.setFileRelativePath(query.value(8).toString());
     l_movie.setPosterPath(query.value(9).toString());
     l_movie.setColored(query.value(10).toBool());
-    l_movie.setFormat(query.value(12).toString());
-    l_movie.setSuffix(query.value(13).toString());
-    l_movie.setRank(query.value(14).toInt());
+    l_movie.setFormat(query.value(11).toString());
+    l_movie.setSuffix(query.value(12).toString());
+    l_movie.setRank(query.value(13).toInt());
     l_movie.setImported(query.value(14).toBool());
     l_movie.setTmdbId(query.value(15).toInt());
     l_movie.setShow(query.value(16).toBool());
@@ -206,7 +329,7 @@ People DatabaseManager::hydratePeople(QSqlQuery &query)
     People l_people;
     l_people.setId(query.value(0).toInt());
     l_people.setName(query.value(1).toString());
-    l_people.setBirthday(QDate::fromString(query.value(2).toString(), DATE_FORMAT));
+    l_people.setBirthday(dayNumberToDate(query.value(2)));
     l_people.setBiography(query.value(3).toString());
     l_people.setImported(query.value(4).toBool());
     l_people.setTmdbId(query.value(5).toInt());
@@ -219,6 +342,38 @@ People DatabaseManager::hydratePeople(QSqlQuery &query)
     return l_people;
 }
 
+/**
+ * @brief Converts a date stored in the database (Julian day number) to a QDate
+ *
+ * @param QVariant value of the column, may be NULL
+ * @return QDate, invalid if the value is NULL
+ */
+QDate DatabaseManager::dayNumberToDate(const QVariant &dayNumber)
+{
+    if (dayNumber.isNull()) {
+
+        return QDate();
+    }
+
+    return QDate::fromJulianDay(dayNumber.toLongLong());
+}
+
+/**
+ * @brief Converts a QDate to the value stored in the database (Julian day number)
+ *
+ * @param QDate date
+ * @return QVariant, NULL if the date is invalid
+ */
+QVariant DatabaseManager::dateToDayNumber(const QDate &date)
+{
+    if (!date.isValid()) {
+
+        return QVariant(QVariant::LongLong);
+    }
+
+    return date.toJulianDay();
+}
+
 /**
  * @brief Hydrates a tag from the database
  *
@@ -259,35 +414,150 @@ Playlist DatabaseManager::hydratePlaylist(QSqlQuery &query)
  */
 bool DatabaseManager::openDB()
 {
+    bumpWriteGeneration();
     Macaw::DEBUG("[DatabaseManager] openDB");
     if (QSqlDatabase::contains("Movies-database"))
     {
-        m_db = QSqlDatabase::database("Movies-database");
+        m_db = QSqlDatabase::database("Movies-database", false);
     }
     else
     {
         m_db = QSqlDatabase::addDatabase("QSQLITE", "Movies-database");
     }
 
-    QString l_dbPath = qApp->property("filesPath").toString() + "database.sqlite";
-    m_db.setDatabaseName(l_dbPath);
+    m_db.setDatabaseName(databasePath());
+    m_db.setConnectOptions("QSQLITE_BUSY_TIMEOUT=5000");
 
-    if (!m_db.open()) {
+    if (!m_db.open() || !setConnectionPragmas(m_db, false)) {
         return false;
     }
 
-    QSqlQuery l_query(m_db);
-    l_query.prepare("PRAGMA foreign_keys = ON");
+    // The reading connection needs the file to exist, so it is opened after the writing one
+    if (QSqlDatabase::contains("Movies-database-read"))
+    {
+        m_readDb = QSqlDatabase::database("Movies-database-read", false);
+    }
+    else
+    {
+        m_readDb = QSqlDatabase::addDatabase("QSQLITE", "Movies-database-read");
+    }
 
-    if (!l_query.exec()) {
-        Macaw::DEBUG("In openDB:");
-        Macaw::DEBUG(l_query.lastError().text());
-        return false;
+    m_readDb.setDatabaseName(databasePath());
+    m_readDb.setConnectOptions("QSQLITE_OPEN_READONLY;QSQLITE_BUSY_TIMEOUT=5000");
+
+    if (!m_readDb.open() || !setConnectionPragmas(m_readDb, true)) {
+        Macaw::DEBUG("[DatabaseManager] read connection not available");
+        m_readDb.close();
     }
 
     return true;
 }
 
+/**
+ * @brief Path of the database file
+ *
+ * @return QString
+ */
+QString DatabaseManager::databasePath()
+{
+    return QCoreApplication::instance()->property("filesPath").toString() + "database.sqlite";
+}
+
+/**
+ * @brief Sets the pragmas of a connection to the database.
+ *
+ * The database uses write-ahead logging, so that the readers don't wait for the writer
+ * and the writer doesn't wait for the readers. With WAL, `synchronous = NORMAL` is safe
+ * and syncs only at checkpoints.
+ *
+ * @param db the connection
+ * @param readOnly true if nothing will be written through this connection
+ * @return bool
+ */
+bool DatabaseManager::setConnectionPragmas(QSqlDatabase &db, bool readOnly)
+{
+    QStringList l_pragmaList;
+    l_pragmaList << "PRAGMA foreign_keys = ON"
+                 << "PRAGMA synchronous = NORMAL"
+                 << "PRAGMA cache_size = -16000"        // 16 MiB
+                 << "PRAGMA mmap_size = 268435456"      // 256 MiB
+                 << "PRAGMA temp_store = MEMORY";
+    // The reading connections are opened with QSQLITE_OPEN_READONLY: `query_only`
+    // is not set, as it would also forbid the temporary tables (see fillTempIdList())
+    if (!readOnly) {
+        // Persistent: stored in the database file
+        l_pragmaList << "PRAGMA journal_mode = WAL";
+    }
+
+    QSqlQuery l_query(db);
+    foreach (QString l_pragma, l_pragmaList) {
+        if (!l_query.exec(l_pragma)) {
+            Macaw::DEBUG("In setConnectionPragmas:");
+            Macaw::DEBUG(l_pragma + ": " + l_query.lastError().text());
+
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief Connection used by the getters.
+ *
+ * It is the read-only connection, unless a transaction is running on the
+ * writing connection: the getters then have to see the uncommitted changes.
+ *
+ * @return QSqlDatabase
+ */
+QSqlDatabase DatabaseManager::readDB()
+{
+    if (m_transactionDepth > 0 || !m_readDb.isOpen()) {
+
+        return m_db;
+    }
+
+    return m_readDb;
+}
+
+/**
+ * @brief Gets a connection to the database owned by the calling thread.
+ * A QSqlDatabase can only be used by the thread that created it: any thread other
+ * than the main one must use this function instead of the DatabaseManager connections.
+ *
+ * The connection is opened on first use and removed when the thread finishes.
+ *
+ * @param readOnly true to get a connection that cannot write
+ * @return QSqlDatabase
+ */
+QSqlDatabase DatabaseManager::threadDatabase(bool readOnly)
+{
+    if (!s_threadConnections.hasLocalData()) {
+        s_threadConnections.setLocalData(new ThreadConnections);
+    }
+
+    QString l_name = "Movies-database-thread-"
+                     + QString::number(reinterpret_cast<quintptr>(QThread::currentThreadId()))
+                     + (readOnly ? "-read" : "");
+    if (QSqlDatabase::contains(l_name)) {
+
+        return QSqlDatabase::database(l_name);
+    }
+
+    QSqlDatabase l_db = QSqlDatabase::addDatabase("QSQLITE", l_name);
+    l_db.setDatabaseName(databasePath());
+    l_db.setConnectOptions(readOnly ? "QSQLITE_OPEN_READONLY;QSQLITE_BUSY_TIMEOUT=5000"
+                                    : "QSQLITE_BUSY_TIMEOUT=5000");
+    if (!l_db.open() || !setConnectionPragmas(l_db, readOnly)) {
+        Macaw::DEBUG("In threadDatabase:");
+        Macaw::DEBUG(l_db.lastError().text());
+    }
+    s_threadConnections.localData()->nameList.append(l_name);
+
+    return l_db;
+}
+
+
 /**
  * @brief Closes the database.
  *
@@ -296,201 +566,264 @@ bool DatabaseManager::openDB()
 bool DatabaseManager::closeDB()
 {
     Macaw::DEBUG("[DatabaseManager] Close database");
+    Macaw::DEBUG("[DatabaseManager] Statement cache: "
+                 + QString::number(m_queryCacheHits) + " hits, "
+                 + QString::number(m_queryCacheMisses) + " misses");
+    clearQueryCache();
+    m_readDb.close();
+    if (m_db.isOpen()) {
+        // Refreshes the statistics of the query planner when they are outdated
+        QSqlQuery l_query(m_db);
+        execQuery(l_query, "PRAGMA optimize", Q_FUNC_INFO);
+    }
     m_db.close();
 
     return true;
 }
 
 /**
- * @brief Deletes the database.
+ * @brief Starts a transaction.
+ * Transactions can be nested: only the outermost one is sent to SQLite.
  *
  * @return bool
  */
-bool DatabaseManager::deleteDB()
+bool DatabaseManager::beginTransaction()
 {
-    Macaw::DEBUG("[DatabaseManager] deleteDB");
-    closeDB();
+    if (m_transactionDepth == 0 && !m_db.transaction()) {
+        Macaw::DEBUG("In beginTransaction:");
+        Macaw::DEBUG(m_db.lastError().text());
 
-    return QFile::remove(m_db.databaseName());
+        return false;
+    }
+    m_transactionDepth++;
+
+    return true;
 }
 
 /**
- * @brief Upgrades DB between diffent DB versions
- * This function needs to be updated each time a change to the DB structure is made
+ * @brief Commits the transaction started by beginTransaction().
+ * Nested transactions are committed with the outermost one.
  *
  * @return bool
  */
-bool DatabaseManager::upgradeDB(int fromVersion, int toVersion)
+bool DatabaseManager::commitTransaction()
 {
-    Macaw::DEBUG_IN("[DatabaseManager] upgradeDB");
-    bool  l_ret = false;
-    int l_fromVersion(fromVersion);
+    if (m_transactionDepth == 0) {
 
-    if (m_db.isOpen())
-    {
-        // We need to have a clean version of the db instance.
-        //There might be a better way to do this.
-        m_db.close();
+        return false;
+    }
+    if (m_transactionDepth == 1 && !m_db.commit()) {
+        Macaw::DEBUG("In commitTransaction:");
+        Macaw::DEBUG(m_db.lastError().text());
 
-        Macaw::DEBUG_IN("[DatabaseManager] backup database");
-        QFile::copy(m_db.databaseName(),
-                    m_db.databaseName()+"_backup"
-                                       + QDateTime::currentDateTime().toString("yyyyMMdd_HHmmss"));
+        return false;
+    }
+    m_transactionDepth--;
+    if (m_transactionDepth == 0) {
+        // Entities read during the transaction may predate some of its writes
+        bumpWriteGeneration();
+    }
 
-        Macaw::DEBUG_OUT("[DatabaseManager] database backup done");
+    return true;
+}
 
-        m_db.open();
+/**
+ * @brief Cancels the transaction started by beginTransaction().
+ * A nested rollback cancels the whole outermost transaction.
+ *
+ * @return bool
+ */
+bool DatabaseManager::rollbackTransaction()
+{
+    if (m_transactionDepth == 0) {
 
-        QSqlQuery l_query(m_db);
+        return false;
+    }
+    m_transactionDepth = 0;
+    // The cache may hold entities read during the transaction
+    bumpWriteGeneration();
 
-        // PRAGMA is disabled so that renaming and deleting a database don't act on cascade
-        l_ret = l_query.exec("PRAGMA foreign_keys = OFF");
+    return m_db.rollback();
+}
 
-        //switch to DB_VERSION 050
-        if (toVersion >= 50) {
+/**
+ * @brief Number of movies inserted in one transaction by insertMovies()
+ *
+ * @return int
+ */
+int DatabaseManager::insertBatchSize() const
+{
+    return m_insertBatchSize;
+}
 
-            Macaw::DEBUG_IN("[DatabaseManager] upgrade to v050");
-            l_query.finish();
-            l_query.clear();
-
-            if (!m_db.record("config").contains("media_player")) {
-                l_ret &= l_query.exec("ALTER TABLE config ADD media_player VARCHAR(255)");
-                if(!l_ret)
-                {
-                    Macaw::DEBUG(l_query.lastError().text());
-                }
-            }
+/**
+ * @brief Sets the number of movies inserted in one transaction by insertMovies()
+ *
+ * @param int batchSize, at least 1
+ */
+void DatabaseManager::setInsertBatchSize(int batchSize)
+{
+    m_insertBatchSize = qMax(1, batchSize);
+}
 
-            if (!m_db.record("movies").contains("id_tmdb")) {
-                l_ret &= l_query.exec("ALTER TABLE movies ADD id_tmdb INTEGER");
-                l_ret &= l_query.exec("UPDATE movies SET id_tmdb = 0");
-                if(!l_ret)
-                {
-                    Macaw::DEBUG(l_query.lastError().text());
-                }
-            }
+/**
+ * @brief Gets a query prepared with `queryText`, from the statement cache when possible.
+ * SQLite then does not parse and plan the statement again.
+ *
+ * The caller binds the values, executes the query and must call `finish()`
+ * on it once the results are read, so that the statement can be reused.
+ * If the cached statement is still active (nested use), a new one is prepared.
+ *
+ * @param queryText, which must not contain any value (use bindValue())
+ * @return QSqlQuery
+ */
+QSqlQuery DatabaseManager::cachedQuery(const QString &queryText)
+{
+    return cachedQuery(queryText, m_db);
+}
 
-            if (!m_db.record("movies").contains("show")) {
-                l_ret &= l_query.exec("ALTER TABLE movies ADD show BOOLEAN");
-                l_ret &= l_query.exec("UPDATE movies SET show = 0");
-                if(!l_ret)
-                {
-                    Macaw::DEBUG(l_query.lastError().text());
-                }
-            }
-            if (!m_db.tables().contains("path_list")) {
-                Macaw::DEBUG_IN("[DatabaseManager] upgrade path_list table");
-                l_ret &= createTablePathList(l_query);
-                l_ret &= l_query.exec("INSERT INTO path_list(id, movies_path, imported) SELECT id, movies_path, imported FROM paths_list");
-                l_ret &= l_query.exec("DROP TABLE paths_list");
-                l_ret &= l_query.exec("UPDATE path_list SET type = 1");
-                if(!l_ret)
-                {
-                    Macaw::DEBUG(l_query.lastError().text());
-                }
-                Macaw::DEBUG_OUT("[DatabaseManager] upgrade path_list table finished");
-            }
+/**
+ * @brief Same as cachedQuery(const QString&), on the connection `db`
+ *
+ * @param queryText
+ * @param db connection of the DatabaseManager
+ * @return QSqlQuery
+ */
+QSqlQuery DatabaseManager::cachedQuery(const QString &queryText, const QSqlDatabase &db)
+{
+    QString l_key = db.connectionName() + '\n' + queryText;
+    if (m_queryCache.contains(l_key)) {
+        QSqlQuery l_query = m_queryCache.value(l_key);
+        if (!l_query.isActive()) {
+            m_queryCacheHits++;
 
-            if (!m_db.record("people").contains("id_tmdb")) {
-                Macaw::DEBUG_IN("[DatabaseManager] upgrade people table");
-                l_ret &= l_query.exec("ALTER TABLE people ADD id_tmdb INTEGER");
-                l_ret &= l_query.exec("ALTER TABLE people ADD imported BOOLEAN");
-                l_ret &= l_query.exec("UPDATE people SET imported = 0, id_tmdb = 0");
-                if(!l_ret){
-                    Macaw::DEBUG(l_query.lastError().text());
-                }
-            }
+            return l_query;
+        }
+    }
 
-            if (!m_db.record("movies").contains("id_path")) {
-                Macaw::DEBUG_IN("[DatabaseManager] upgrade movies table");
-                l_ret &= l_query.exec("ALTER TABLE movies ADD id_path INTEGER");
-                if(!l_ret){
-                    Macaw::DEBUG(l_query.lastError().text());
-                }
-                l_ret &= l_query.exec("ALTER TABLE movies RENAME TO movies_old");
-                if(!l_ret){
-                    Macaw::DEBUG(l_query.lastError().text());
-                }
-                l_ret &= createTableMovies(l_query);
-                if(!l_ret){
-                    Macaw::DEBUG(l_query.lastError().text());
-                }
-                l_ret &= l_query.exec("UPDATE movies_old SET id_path=1");
-                if(!l_ret){
-                    Macaw::DEBUG(l_query.lastError().text());
-                }
-                l_ret &= l_query.exec("INSERT INTO movies SELECT "+ m_movieFields +"FROM movies_old AS m");
-                if(!l_ret){
-                    Macaw::DEBUG("Copying table movies failed");
-                    Macaw::DEBUG(l_query.lastError().text());
-                }
-                l_ret &= l_query.exec("DROP TABLE movies_old");
-                if(!l_ret){
-                    Macaw::DEBUG(l_query.lastError().text());
-                }
-
-                l_query.exec("SELECT id, movies_path FROM path_list");
-                QStringList l_pathList;
-                QList<int> l_idList;
-                while (l_query.next())
-                {
-                    l_idList.append(l_query.value(0).toInt());
-                    l_pathList.append(l_query.value(1).toString());
-                }
-                l_query.exec("SELECT file_path FROM movies");
-
-                while (l_query.next())
-                {
-                    for (int i = 0 ; i < l_pathList.count() ; i++) {
-                        if (l_query.value(0).toString().startsWith(l_pathList.at(i))) {
-                            QString l_moviePath = l_query.value(0).toString();
-                            QString l_moviePath_new = l_moviePath;
-                            l_moviePath_new.remove(0, l_pathList.at(i).count()+1);
-                            QSqlQuery l_query2(m_db);
-                            l_ret &= l_query2.exec("UPDATE movies "
-                                                   "SET file_path='"+l_moviePath_new+"', "+
-                                                   "id_path="+QString::number(l_idList.at(i))+' '+
-                                                   "WHERE file_path='"+l_moviePath+'\'');
-                            if(!l_ret){
-                                Macaw::DEBUG(l_query2.lastError().text());
-                            }
-                        }
-                    }
-                }
-                Macaw::DEBUG_OUT("[DatabaseManager] upgrade movies table finished");
-            }
+    m_queryCacheMisses++;
+    QSqlQuery l_query(db);
+    if (!l_query.prepare(queryText)) {
+        Macaw::DEBUG("In cachedQuery:");
+        Macaw::DEBUG(l_query.lastError().text());
+    } else if (!m_queryCache.contains(l_key)) {
+        m_queryCache.insert(l_key, l_query);
+    }
 
-            l_ret &= createTableShow(l_query);
-            l_ret &= createTableEpisodes(l_query);
+    return l_query;
+}
 
-            if(l_ret) {
-                l_ret &= l_query.exec("UPDATE config "
-                                      "SET db_version = 050");
-                l_fromVersion = 050;
-            } else {
-                m_db.close();
+/**
+ * @brief Releases all the prepared statements of the cache.
+ * Must be called before the connection is closed.
+ */
+void DatabaseManager::clearQueryCache()
+{
+    m_queryCache.clear();
+}
 
-                Macaw::DEBUG_IN("[DatabaseManager] FAILED => Come back to backup");
-                QDir l_backups = m_db.databaseName();
-                l_backups.cdUp();
-                QStringList l_backupNameList = l_backups.entryList(QDir::Files|QDir::NoDotAndDotDot,
-                                                                   QDir::Name);
-                Macaw::DEBUG("Return to "+l_backupNameList.last());
+/**
+ * @brief Number of times a prepared statement was reused by cachedQuery()
+ *
+ * @return int
+ */
+int DatabaseManager::queryCacheHits() const
+{
+    return m_queryCacheHits;
+}
 
-                this->deleteDB();
-                QFile::copy(l_backups.absolutePath()+QDir::separator()+l_backupNameList.last(),
-                            m_db.databaseName());
+/**
+ * @brief Number of statements cachedQuery() had to prepare
+ *
+ * @return int
+ */
+int DatabaseManager::queryCacheMisses() const
+{
+    return m_queryCacheMisses;
+}
 
-                Macaw::DEBUG_OUT("[DatabaseManager] Returned to backup");
+/**
+ * @brief Counter incremented by every insertion, update and deletion, in all
+ * the DatabaseManager instances.
+ * The entity caches and the callers keeping results around compare it to know
+ * if what they hold may be outdated.
+ *
+ * @return int
+ */
+int DatabaseManager::writeGeneration()
+{
+    return s_writeGeneration.load();
+}
 
-                this->openDB();
-            }
-            Macaw::DEBUG_OUT("[DatabaseManager] exits upgrade to v050");
-        }
-    }
-    Macaw::DEBUG_OUT("[DatabaseManager] exits upgradeDB");
+/**
+ * @brief Makes every entity cache outdated. Called at the beginning of each write,
+ * and again once it is committed, see commitTransaction() and bumpAfterWrite().
+ */
+void DatabaseManager::bumpWriteGeneration()
+{
+    s_writeGeneration.ref();
+}
 
-    return l_ret;
+/**
+ * @brief Sets the maximum number of entries of each entity cache
+ *
+ * @param int cacheSize, 0 disables the caches
+ */
+void DatabaseManager::setEntityCacheSize(int cacheSize)
+{
+    m_movieCache.setMaxSize(cacheSize);
+    m_peopleCache.setMaxSize(cacheSize);
+    m_tagCache.setMaxSize(cacheSize);
+    m_playlistCache.setMaxSize(cacheSize);
+    m_moviesPathEntityCache.setMaxSize(cacheSize);
+}
+
+/**
+ * @brief Maximum number of entries of each entity cache
+ *
+ * @return int
+ */
+int DatabaseManager::entityCacheSize() const
+{
+    return m_movieCache.maxSize();
+}
+
+/**
+ * @brief Number of entities read from the entity caches instead of SQLite
+ *
+ * @return int
+ */
+int DatabaseManager::entityCacheHits() const
+{
+    return m_movieCache.hits() + m_peopleCache.hits() + m_tagCache.hits()
+            + m_playlistCache.hits() + m_moviesPathEntityCache.hits();
+}
+
+/**
+ * @brief Number of entities looked for in the entity caches and read from SQLite
+ *
+ * @return int
+ */
+int DatabaseManager::entityCacheMisses() const
+{
+    return m_movieCache.misses() + m_peopleCache.misses() + m_tagCache.misses()
+            + m_playlistCache.misses() + m_moviesPathEntityCache.misses();
+}
+
+/**
+ * @brief Deletes the database.
+ *
+ * @return bool
+ */
+bool DatabaseManager::deleteDB()
+{
+    Macaw::DEBUG("[DatabaseManager] deleteDB");
+    closeDB();
+
+    QFile::remove(m_db.databaseName() + "-wal");
+    QFile::remove(m_db.databaseName() + "-shm");
+
+    return QFile::remove(m_db.databaseName());
 }
 
 /**
@@ -511,18 +844,23 @@ bool DatabaseManager::createTables()
         if(m_db.tables().contains("config"))
         {
             Macaw::DEBUG("[DatabaseManager.createTable] config table exists");
-            l_query.exec("SELECT db_version FROM config");
+            execQuery(l_query, "SELECT db_version FROM config", Q_FUNC_INFO);
             l_query.next();
-            if(l_query.value(0).toInt() != DB_VERSION)
+            int l_version = l_query.value(0).toInt();
+            l_query.finish();
+            l_ret = true;
+            if(l_version != DB_VERSION)
             {
-                l_ret = upgradeDB(l_query.value(0).toInt(), DB_VERSION);
+                l_ret = upgradeDB(l_version, DB_VERSION);
             }
+            initSearchIndex();
+            initFacetCounts();
         }
         else    //if config table do not exists then the db is empty...
         {
             Macaw::DEBUG("[DatabaseManager.createTable] configTable does not exist");
 
-            l_ret = l_query.exec("PRAGMA foreign_keys = ON");
+            l_ret = execQuery(l_query, "PRAGMA foreign_keys = ON", Q_FUNC_INFO);
 
             l_ret &= createTableMovies(l_query);
             l_ret &= createTablePeople(l_query);
@@ -534,9 +872,13 @@ bool DatabaseManager::createTables()
             l_ret &= createTableShow(l_query);
             l_ret &= createTableEpisodes(l_query);
             l_ret &= createTablePathList(l_query);
+            l_ret &= createTableScanState(l_query);
+            l_ret &= createIndexes(l_query);
+            l_ret &= createTableFacetCounts(l_query);
             if (l_ret) {
                 l_ret &= createTableConfig(l_query);
             }
+            initSearchIndex();
         }
     }
 
@@ -546,15 +888,16 @@ bool DatabaseManager::createTables()
 /**
  * @brief Create the table `movies`
  * @param query
+ * @param tableName, to create the table under another name (when migrating it)
  * @return
  */
-bool DatabaseManager::createTableMovies(QSqlQuery &query)
+bool DatabaseManager::createTableMovies(QSqlQuery &query, const QString &tableName)
 {
-    query.prepare("CREATE TABLE IF NOT EXISTS movies("
+    query.prepare("CREATE TABLE IF NOT EXISTS " + tableName + "("
                   "id INTEGER PRIMARY KEY AUTOINCREMENT UNIQUE, "
                   "title VARCHAR(255) NOT NULL, "
                   "original_title VARCHAR(255), "
-                  "release_date VARCHAR(10), "
+                  "release_date INTEGER, "
                   "country VARCHAR(50), "
                   "duration INTEGER, "
                   "synopsis TEXT, "
@@ -568,10 +911,12 @@ bool DatabaseManager::createTableMovies(QSqlQuery &query)
                   "imported BOOLEAN, "
                   "id_tmdb INTEGER, "
                   "show BOOLEAN, "
+                  "fingerprint BLOB, "
+                  "missing_since INTEGER, "
                   "UNIQUE (id_path, file_path) ON CONFLICT IGNORE "
                   ")");
 
-    if (!query.exec()) {
+    if (!execQuery(query, Q_FUNC_INFO)) {
         Macaw::DEBUG("In createTableMovies:");
         Macaw::DEBUG(query.lastError().text());
 
@@ -584,20 +929,21 @@ bool DatabaseManager::createTableMovies(QSqlQuery &query)
 /**
  * @brief Create the table `people`
  * @param query
+ * @param tableName, to create the table under another name (when migrating it)
  * @return
  */
-bool DatabaseManager::createTablePeople(QSqlQuery &query)
+bool DatabaseManager::createTablePeople(QSqlQuery &query, const QString &tableName)
 {
-    query.prepare("CREATE TABLE IF NOT EXISTS people("
+    query.prepare("CREATE TABLE IF NOT EXISTS " + tableName + "("
                   "id INTEGER PRIMARY KEY AUTOINCREMENT UNIQUE, "
                   "name VARCHAR(200) NOT NULL, "
-                  "birthday VARCHAR(10), "
+                  "birthday INTEGER, "
                   "biography TEXT, "
                   "imported BOOLEAN, "
                   "id_tmdb INTEGER"
                   ")");
 
-    if (!query.exec()) {
+    if (!execQuery(query, Q_FUNC_INFO)) {
         Macaw::DEBUG("In createTablePeople:");
         Macaw::DEBUG(query.lastError().text());
 
@@ -623,7 +969,7 @@ bool DatabaseManager::createTableMoviesPeople(QSqlQuery &query)
                   "FOREIGN KEY(id_people) REFERENCES people ON DELETE CASCADE"
                   ")");
 
-    if (!query.exec()) {
+    if (!execQuery(query, Q_FUNC_INFO)) {
         Macaw::DEBUG("In createTableMoviesPeople:");
         Macaw::DEBUG(query.lastError().text());
 
@@ -647,7 +993,7 @@ bool DatabaseManager::createTablePlaylists(QSqlQuery &query)
                   "creation_date INT"
                   ")");
 
-    if (!query.exec()) {
+    if (!execQuery(query, Q_FUNC_INFO)) {
         Macaw::DEBUG("In createTablePlaylists:");
         Macaw::DEBUG(query.lastError().text());
 
@@ -658,7 +1004,7 @@ bool DatabaseManager::createTablePlaylists(QSqlQuery &query)
     query.prepare("INSERT INTO playlists "
                   "VALUES(1, 'To Watch', 0, 0)");
 
-    if (!query.exec()) {
+    if (!execQuery(query, Q_FUNC_INFO)) {
         Macaw::DEBUG("In createTablePlaylists:");
         Macaw::DEBUG(query.lastError().text());
 
@@ -684,7 +1030,7 @@ bool DatabaseManager::createTableMoviesPlaylists(QSqlQuery &query)
                   "FOREIGN KEY(id_playlist) REFERENCES playlists ON DELETE CASCADE"
                   ")");
 
-    if (!query.exec()) {
+    if (!execQuery(query, Q_FUNC_INFO)) {
         Macaw::DEBUG("In createTableMoviesPlaylists:");
         Macaw::DEBUG(query.lastError().text());
 
@@ -706,7 +1052,7 @@ bool DatabaseManager::createTableTags(QSqlQuery &query)
                   "name VARCHAR(255) UNIQUE NOT NULL"
                   ")");
 
-    if (!query.exec()) {
+    if (!execQuery(query, Q_FUNC_INFO)) {
         Macaw::DEBUG("In createTableTags:");
         Macaw::DEBUG(query.lastError().text());
 
@@ -732,7 +1078,7 @@ bool DatabaseManager::createTableMoviesTags(QSqlQuery &query)
                   "FOREIGN KEY(id_tag) REFERENCES tags ON DELETE CASCADE"
                   ")");
 
-    if (!query.exec()) {
+    if (!execQuery(query, Q_FUNC_INFO)) {
         Macaw::DEBUG("In createTableMoviesTags:");
         Macaw::DEBUG(query.lastError().text());
 
@@ -750,7 +1096,7 @@ bool DatabaseManager::createTableShow(QSqlQuery &query)
                   "finished BOOLEAN"
                   ")");
 
-    if (!query.exec()) {
+    if (!execQuery(query, Q_FUNC_INFO)) {
         Macaw::DEBUG("In createTableShow:");
         Macaw::DEBUG(query.lastError().text());
 
@@ -772,7 +1118,7 @@ bool DatabaseManager::createTableEpisodes(QSqlQuery &query)
                   "FOREIGN KEY(id_show) REFERENCES show ON DELETE CASCADE "
                   ")");
 
-    if (!query.exec()) {
+    if (!execQuery(query, Q_FUNC_INFO)) {
         Macaw::DEBUG("In createTableEpisodes:");
         Macaw::DEBUG(query.lastError().text());
 
@@ -796,7 +1142,7 @@ bool DatabaseManager::createTablePathList(QSqlQuery &query)
                   "imported BOOLEAN DEFAULT 0"
                   ")");
 
-    if (!query.exec()) {
+    if (!execQuery(query, Q_FUNC_INFO)) {
         Macaw::DEBUG("In createTablePathList:");
         Macaw::DEBUG(query.lastError().text());
 
@@ -806,6 +1152,377 @@ bool DatabaseManager::createTablePathList(QSqlQuery &query)
     return true;
 }
 
+/**
+ * @brief Create table `scan_state`, where the state of each directory of the
+ * movies paths is stored after a scan, so that the next one can skip what did not change
+ * @param query
+ * @return bool
+ */
+bool DatabaseManager::createTableScanState(QSqlQuery &query)
+{
+    query.prepare("CREATE TABLE IF NOT EXISTS scan_state("
+                  "id_path INTEGER NOT NULL, "
+                  "dir_path TEXT NOT NULL, "
+                  "mtime INTEGER NOT NULL, "
+                  "inode INTEGER NOT NULL, "
+                  "device INTEGER NOT NULL DEFAULT 0, "
+                  "entry_count INTEGER NOT NULL, "
+                  "list_hash BLOB, "
+                  "PRIMARY KEY (id_path, dir_path), "
+                  "FOREIGN KEY(id_path) REFERENCES path_list ON DELETE CASCADE"
+                  ") WITHOUT ROWID");
+
+    if (!execQuery(query, Q_FUNC_INFO)) {
+        Macaw::DEBUG("In createTableScanState:");
+        Macaw::DEBUG(query.lastError().text());
+
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Create the secondary indexes.
+ * Each one covers the lookups of a getter, so that none has to scan a whole table.
+ * (The UNIQUE constraints already index movies(id_path, file_path),
+ * movies_people(id_people, ...), movies_tags(id_tag, ...), movies_playlists(id_playlist, ...),
+ * tags(name) and episodes(id_movie).)
+ *
+ * @param query
+ * @return bool
+ */
+bool DatabaseManager::createIndexes(QSqlQuery &query)
+{
+    QStringList l_queryList;
+    l_queryList << "CREATE INDEX IF NOT EXISTS movies_people_movie "
+                   "ON movies_people(id_movie, type, id_people)"
+                << "CREATE INDEX IF NOT EXISTS movies_people_type "
+                   "ON movies_people(type, id_people)"
+                << "CREATE INDEX IF NOT EXISTS movies_tags_movie "
+                   "ON movies_tags(id_movie, id_tag)"
+                << "CREATE INDEX IF NOT EXISTS movies_playlists_movie "
+                   "ON movies_playlists(id_movie, id_playlist)"
+                << "CREATE INDEX IF NOT EXISTS movies_show_title "
+                   "ON movies(show, title)"
+                << "CREATE INDEX IF NOT EXISTS movies_imported "
+                   "ON movies(imported, show)"
+                << "CREATE INDEX IF NOT EXISTS movies_file_path "
+                   "ON movies(file_path)"
+                << "CREATE INDEX IF NOT EXISTS movies_show_release_date "
+                   "ON movies(show, release_date)"
+                << "CREATE INDEX IF NOT EXISTS movies_missing "
+                   "ON movies(id_path, missing_since) WHERE missing_since IS NOT NULL"
+                << "CREATE INDEX IF NOT EXISTS movies_missing_fingerprint "
+                   "ON movies(fingerprint) WHERE missing_since IS NOT NULL"
+                << "CREATE INDEX IF NOT EXISTS people_name "
+                   "ON people(name)"
+                << "CREATE INDEX IF NOT EXISTS people_birthday "
+                   "ON people(birthday)"
+                << "CREATE INDEX IF NOT EXISTS episodes_show "
+                   "ON episodes(id_show, season, number)";
+
+    foreach (QString l_queryText, l_queryList) {
+        if (!execQuery(query, l_queryText, Q_FUNC_INFO)) {
+            Macaw::DEBUG("In createIndexes:");
+            Macaw::DEBUG(query.lastError().text());
+
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief Create the FTS5 tables `search_movies`, `search_people` and `search_tags`,
+ * and the triggers keeping them in sync with the other tables.
+ *
+ * `search_movies` has one row per movie (same rowid as in `movies`) containing
+ * its titles and the names of its people and tags.
+ * @param query
+ * @return false if FTS5 is not available
+ */
+bool DatabaseManager::createTableSearch(QSqlQuery &query)
+{
+    foreach (QString l_queryText, searchSchema()) {
+        if (!execQuery(query, l_queryText, Q_FUNC_INFO)) {
+            Macaw::DEBUG("In createTableSearch:");
+            Macaw::DEBUG(query.lastError().text());
+
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief Statements creating the full-text search tables and their triggers,
+ * see createTableSearch()
+ *
+ * @return QStringList
+ */
+QStringList DatabaseManager::searchSchema()
+{
+    QStringList l_queryList;
+    l_queryList << "CREATE VIRTUAL TABLE IF NOT EXISTS search_movies USING fts5("
+                        "title, original_title, people, tags, "
+                        "tokenize = 'unicode61 remove_diacritics 1', prefix = '2 3')"
+                << "CREATE VIRTUAL TABLE IF NOT EXISTS search_people USING fts5("
+                        "name, "
+                        "tokenize = 'unicode61 remove_diacritics 1', prefix = '2 3')"
+                << "CREATE VIRTUAL TABLE IF NOT EXISTS search_tags USING fts5("
+                        "name, "
+                        "tokenize = 'unicode61 remove_diacritics 1', prefix = '2 3')"
+
+                // Movies
+                << "CREATE TRIGGER IF NOT EXISTS search_movies_insert "
+                   "AFTER INSERT ON movies BEGIN "
+                   + searchMoviesRefresh("= NEW.id") +
+                   "END"
+                << "CREATE TRIGGER IF NOT EXISTS search_movies_update "
+                   "AFTER UPDATE OF title, original_title ON movies "
+                   "WHEN OLD.title IS NOT NEW.title OR OLD.original_title IS NOT NEW.original_title BEGIN "
+                   + searchMoviesRefresh("= NEW.id") +
+                   "END"
+                << "CREATE TRIGGER IF NOT EXISTS search_movies_delete "
+                   "AFTER DELETE ON movies BEGIN "
+                   "DELETE FROM search_movies WHERE rowid = OLD.id; "
+                   "END"
+
+                // Links between movies and people/tags
+                << "CREATE TRIGGER IF NOT EXISTS search_movies_people_insert "
+                   "AFTER INSERT ON movies_people BEGIN "
+                   + searchMoviesRefresh("= NEW.id_movie") +
+                   "END"
+                << "CREATE TRIGGER IF NOT EXISTS search_movies_people_delete "
+                   "AFTER DELETE ON movies_people BEGIN "
+                   + searchMoviesRefresh("= OLD.id_movie") +
+                   "END"
+                << "CREATE TRIGGER IF NOT EXISTS search_movies_tags_insert "
+                   "AFTER INSERT ON movies_tags BEGIN "
+                   + searchMoviesRefresh("= NEW.id_movie") +
+                   "END"
+                << "CREATE TRIGGER IF NOT EXISTS search_movies_tags_delete "
+                   "AFTER DELETE ON movies_tags BEGIN "
+                   + searchMoviesRefresh("= OLD.id_movie") +
+                   "END"
+
+                // People
+                << "CREATE TRIGGER IF NOT EXISTS search_people_insert "
+                   "AFTER INSERT ON people BEGIN "
+                   "INSERT INTO search_people(rowid, name) VALUES (NEW.id, NEW.name); "
+                   "END"
+                << "CREATE TRIGGER IF NOT EXISTS search_people_update "
+                   "AFTER UPDATE OF name ON people "
+                   "WHEN OLD.name IS NOT NEW.name BEGIN "
+                   "DELETE FROM search_people WHERE rowid = OLD.id; "
+                   "INSERT INTO search_people(rowid, name) VALUES (NEW.id, NEW.name); "
+                   + searchMoviesRefresh("IN (SELECT id_movie FROM movies_people WHERE id_people = NEW.id)") +
+                   "END"
+                << "CREATE TRIGGER IF NOT EXISTS search_people_delete "
+                   "AFTER DELETE ON people BEGIN "
+                   "DELETE FROM search_people WHERE rowid = OLD.id; "
+                   "END"
+
+                // Tags
+                << "CREATE TRIGGER IF NOT EXISTS search_tags_insert "
+                   "AFTER INSERT ON tags BEGIN "
+                   "INSERT INTO search_tags(rowid, name) VALUES (NEW.id, NEW.name); "
+                   "END"
+                << "CREATE TRIGGER IF NOT EXISTS search_tags_update "
+                   "AFTER UPDATE OF name ON tags "
+                   "WHEN OLD.name IS NOT NEW.name BEGIN "
+                   "DELETE FROM search_tags WHERE rowid = OLD.id; "
+                   "INSERT INTO search_tags(rowid, name) VALUES (NEW.id, NEW.name); "
+                   + searchMoviesRefresh("IN (SELECT id_movie FROM movies_tags WHERE id_tag = NEW.id)") +
+                   "END"
+                << "CREATE TRIGGER IF NOT EXISTS search_tags_delete "
+                   "AFTER DELETE ON tags BEGIN "
+                   "DELETE FROM search_tags WHERE rowid = OLD.id; "
+                   "END";
+
+    return l_queryList;
+}
+
+/**
+ * @brief Builds the statements (to be used in a trigger) that recompute the
+ * `search_movies` rows of the movies whose id matches `idCondition`
+ *
+ * @param idCondition, for instance "= NEW.id"
+ * @return QString
+ */
+QString DatabaseManager::searchMoviesRefresh(const QString &idCondition)
+{
+    return "DELETE FROM search_movies WHERE rowid " + idCondition + "; "
+           + searchMoviesInsert(idCondition) + "; ";
+}
+
+/**
+ * @brief Builds the statement filling `search_movies` for the movies whose id matches `idCondition`
+ *
+ * @param idCondition, for instance "IN (SELECT id FROM movies)"
+ * @return QString
+ */
+QString DatabaseManager::searchMoviesInsert(const QString &idCondition)
+{
+    return "INSERT INTO search_movies(rowid, title, original_title, people, tags) "
+           "SELECT m.id, m.title, m.original_title, "
+                  "(SELECT group_concat(p.name, ' ') "
+                   "FROM people AS p, movies_people AS mp "
+                   "WHERE mp.id_movie = m.id AND mp.id_people = p.id), "
+                  "(SELECT group_concat(t.name, ' ') "
+                   "FROM tags AS t, movies_tags AS mt "
+                   "WHERE mt.id_movie = m.id AND mt.id_tag = t.id) "
+           "FROM movies AS m "
+           "WHERE m.id " + idCondition;
+}
+
+/**
+ * @brief Checks that the full-text search index can be used, creates and fills it if needed.
+ *
+ * If the SQLite library has no FTS5 support, the triggers are dropped (so that
+ * the writes keep working) and the search falls back to LIKE queries.
+ */
+void DatabaseManager::initSearchIndex()
+{
+    m_searchEnabled = false;
+    QSqlQuery l_query(m_db);
+
+    if (!execQuery(l_query, "CREATE VIRTUAL TABLE IF NOT EXISTS temp.search_probe USING fts5(content)",
+                   Q_FUNC_INFO, TempTables)) {
+        Macaw::DEBUG("[DatabaseManager] FTS5 not available, full-text search disabled");
+        dropSearchTriggers();
+
+        return;
+    }
+    execQuery(l_query, "DROP TABLE temp.search_probe", Q_FUNC_INFO, TempTables);
+
+    if (!m_db.tables().contains("search_movies") || !hasTriggers(searchSchema())) {
+        Macaw::DEBUG("[DatabaseManager] Build the full-text search index");
+        dropSearchTriggers();
+        if (!createTableSearch(l_query) || !rebuildSearchIndex()) {
+
+            return;
+        }
+    }
+
+    m_searchEnabled = true;
+}
+
+/**
+ * @brief Checks that all the triggers created by the statements of `schema` exist,
+ * see searchSchema() and facetCountsSchema()
+ *
+ * @param QStringList schema
+ * @return false if one of them is missing
+ */
+bool DatabaseManager::hasTriggers(const QStringList &schema)
+{
+    QSqlQuery l_query(m_db);
+    if (!execQuery(l_query, "SELECT name FROM sqlite_master WHERE type = 'trigger'", Q_FUNC_INFO)) {
+        Macaw::DEBUG("In hasTriggers():");
+        Macaw::DEBUG(l_query.lastError().text());
+
+        return false;
+    }
+    QSet<QString> l_triggerSet;
+    while (l_query.next()) {
+        l_triggerSet.insert(l_query.value(0).toString());
+    }
+
+    // "CREATE TRIGGER IF NOT EXISTS <name> ..."
+    foreach (QString l_queryText, schema) {
+        if (l_queryText.startsWith("CREATE TRIGGER")
+                && !l_triggerSet.contains(l_queryText.section(' ', 5, 5))) {
+
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief Drops the triggers maintaining the full-text search index.
+ * initSearchIndex() creates them again.
+ */
+void DatabaseManager::dropSearchTriggers()
+{
+    QSqlQuery l_query(m_db);
+    execQuery(l_query, "SELECT name FROM sqlite_master WHERE type = 'trigger' AND name LIKE 'search%'",
+              Q_FUNC_INFO);
+    QStringList l_triggerList;
+    while (l_query.next()) {
+        l_triggerList.append(l_query.value(0).toString());
+    }
+    foreach (QString l_trigger, l_triggerList) {
+        execQuery(l_query, "DROP TRIGGER IF EXISTS " + l_trigger, Q_FUNC_INFO);
+    }
+}
+
+/**
+ * @brief Fills again the full-text search index from the other tables.
+ * Can be used to repair the index.
+ *
+ * @return bool
+ */
+bool DatabaseManager::rebuildSearchIndex()
+{
+    Macaw::DEBUG_IN("[DatabaseManager] Enters rebuildSearchIndex()");
+    QSqlQuery l_query(m_db);
+    QStringList l_queryList;
+    l_queryList << "DELETE FROM search_movies"
+                << "DELETE FROM search_people"
+                << "DELETE FROM search_tags"
+                << "INSERT INTO search_people(rowid, name) SELECT id, name FROM people"
+                << "INSERT INTO search_tags(rowid, name) SELECT id, name FROM tags"
+                << searchMoviesInsert("IN (SELECT id FROM movies)")
+                << "INSERT INTO search_movies(search_movies) VALUES('optimize')";
+
+    bool l_ret = beginTransaction();
+    foreach (QString l_queryText, l_queryList) {
+        if (l_ret && !execQuery(l_query, l_queryText, Q_FUNC_INFO)) {
+            Macaw::DEBUG("In rebuildSearchIndex:");
+            Macaw::DEBUG(l_query.lastError().text());
+            l_ret = false;
+        }
+    }
+
+    if (l_ret) {
+        l_ret = commitTransaction();
+    } else {
+        rollbackTransaction();
+    }
+    Macaw::DEBUG_OUT("[DatabaseManager] Exits rebuildSearchIndex()");
+
+    return l_ret;
+}
+
+/**
+ * @brief Converts a text typed by the user into a FTS5 query.
+ * Each word is searched as a prefix, all the words have to match.
+ *
+ * @param text typed by the user
+ * @param columns FTS5 columns to search in, separated by spaces. All if empty.
+ * @return QString empty if there is no word in `text`
+ */
+QString DatabaseManager::searchMatchExpression(const QString &text, const QString &columns)
+{
+    QStringList l_wordList = text.split(QRegExp("\\s+"), QString::SkipEmptyParts);
+    QStringList l_phraseList;
+    foreach (QString l_word, l_wordList) {
+        QString l_phrase = '"' + l_word.replace('"', "\"\"") + "\"*";
+        if (!columns.isEmpty()) {
+            l_phrase = "{" + columns + "} : " + l_phrase;
+        }
+        l_phraseList.append(l_phrase);
+    }
+
+    return l_phraseList.join(" AND ");
+}
+
 /**
  * @brief Create table `config`, for update purpose and app configuration
  * Then set the version of the db
@@ -818,7 +1535,7 @@ bool DatabaseManager::createTableConfig(QSqlQuery &query)
                   "db_version INTEGER,"
                   "media_player VARCHAR(255))");
 
-    if (!query.exec()) {
+    if (!execQuery(query, Q_FUNC_INFO)) {
         Macaw::DEBUG("In createTableConfig:");
         Macaw::DEBUG(query.lastError().text());
 
@@ -829,7 +1546,7 @@ bool DatabaseManager::createTableConfig(QSqlQuery &query)
     query.prepare("INSERT INTO config (`db_version`) "
                   "VALUES ('" + QString::number(DB_VERSION) + "')");
 
-    if (!query.exec()) {
+    if (!execQuery(query, Q_FUNC_INFO)) {
         Macaw::DEBUG("In createTableConfig:");
         Macaw::DEBUG(query.lastError().text());
 
@@ -847,11 +1564,12 @@ bool DatabaseManager::createTableConfig(QSqlQuery &query)
  */
 int DatabaseManager::createTag(QString name)
 {
+    bumpWriteGeneration();
     QSqlQuery l_query(m_db);
     l_query.prepare("INSERT INTO `tags` (name) VALUES (:name)");
     l_query.bindValue(":name", name);
 
-    if (!l_query.exec())
+    if (!execQuery(l_query, Q_FUNC_INFO))
     {
         Macaw::DEBUG("In createTag():");
         Macaw::DEBUG(l_query.lastError().text());
@@ -859,7 +1577,7 @@ int DatabaseManager::createTag(QString name)
         return -1;
     }
 
-    if(l_query.exec("SELECT last_insert_rowid()"))
+    if(execQuery(l_query, "SELECT last_insert_rowid()", Q_FUNC_INFO))
     {
         l_query.next();
         return l_query.value(0).toInt();
@@ -876,18 +1594,20 @@ int DatabaseManager::createTag(QString name)
  */
 bool DatabaseManager::addMoviesPath(PathForMovies moviesPath)
 {
+    bumpWriteGeneration();
     QSqlQuery l_query(m_db);
     l_query.prepare("INSERT INTO path_list (movies_path, type) VALUES (:movies_path, :type)");
     l_query.bindValue(":movies_path", moviesPath.path());
     l_query.bindValue(":type", moviesPath.type());
 
-    if(!l_query.exec())
+    if(!execQuery(l_query, Q_FUNC_INFO))
     {
         Macaw::DEBUG("[DatabaseManager] In addMoviesPath():");
         Macaw::DEBUG(l_query.lastError().text());
 
         return false;
     }
+    m_moviesPathCache.insert(l_query.lastInsertId().toInt(), moviesPath.path());
 
     return true;
 }
@@ -903,7 +1623,7 @@ bool DatabaseManager::addMediaPlayerPath(QString mediaPlayerPath)
     QSqlQuery l_query(m_db);
     l_query.prepare("DELETE FROM media_player");
 
-    if(!l_query.exec()) {
+    if(!execQuery(l_query, Q_FUNC_INFO)) {
         Macaw::DEBUG("[DatabaseManager] In addMediaPlayerPath():");
         Macaw::DEBUG(l_query.lastError().text());
 
@@ -914,7 +1634,7 @@ bool DatabaseManager::addMediaPlayerPath(QString mediaPlayerPath)
         l_query.prepare("INSERT INTO media_player (media_player_path) VALUES (:media_player_path)");
         l_query.bindValue(":media_player_path", mediaPlayerPath);
 
-        if(!l_query.exec()) {
+        if(!execQuery(l_query, Q_FUNC_INFO)) {
             Macaw::DEBUG("[DatabaseManager] In addMediaPlayerPath():");
             Macaw::DEBUG(l_query.lastError().text());
 
@@ -934,12 +1654,13 @@ bool DatabaseManager::addMediaPlayerPath(QString mediaPlayerPath)
  */
 bool DatabaseManager::setMoviesPathImported(QString moviesPath, bool imported)
 {
+    bumpWriteGeneration();
     QSqlQuery l_query(m_db);
     l_query.prepare("UPDATE path_list SET imported=:imported WHERE movies_path = :movies_path");
     l_query.bindValue(":movies_path", moviesPath);
     l_query.bindValue(":imported", imported);
 
-    if(!l_query.exec())
+    if(!execQuery(l_query, Q_FUNC_INFO))
     {
         Macaw::DEBUG("In setMoviesPathImported():");
         Macaw::DEBUG(l_query.lastError().text());
@@ -958,6 +1679,7 @@ bool DatabaseManager::setMoviesPathImported(QString moviesPath, bool imported)
  */
 bool DatabaseManager::updateMoviesPath(PathForMovies moviesPath)
 {
+    bumpWriteGeneration();
     QSqlQuery l_query(m_db);
     l_query.prepare("UPDATE path_list "
                     "SET movies_path=:movies_path, type=:type "
@@ -965,42 +1687,67 @@ bool DatabaseManager::updateMoviesPath(PathForMovies moviesPath)
     l_query.bindValue(":movies_path", moviesPath.path());
     l_query.bindValue(":type", moviesPath.type());
     l_query.bindValue(":id", moviesPath.id());
+    bool l_ret = execQuery(l_query, Q_FUNC_INFO);
+
+    // The directories scanned before may not be the same ones anymore
+    if (l_ret)
+    {
+        l_query.prepare("DELETE FROM scan_state WHERE id_path = :id");
+        l_query.bindValue(":id", moviesPath.id());
+        l_ret = execQuery(l_query, Q_FUNC_INFO);
+    }
 
-    if(!l_query.exec())
+    if(!l_ret)
     {
         Macaw::DEBUG("[DatabaseManager] In updateMoviesPath():");
         Macaw::DEBUG(l_query.lastError().text());
 
         return false;
     }
+    m_moviesPathCache.insert(moviesPath.id(), moviesPath.path());
 
     return true;
 }
 
 /**
  * @brief Get the movies directory having the id `id`
+ * The answer comes from m_moviesPathCache, no query is run.
+ *
  * @param id
  * @return QString containing the path of this directory
  */
 QString DatabaseManager::getMoviesPathById(int id)
 {
-    QString l_moviesPath;
+    // A thread manager does not see the changes made by the main manager
+    if (m_threadManager && m_moviesPathCacheGeneration != writeGeneration())
+    {
+        loadMoviesPathCache();
+    }
+
+    return m_moviesPathCache.value(id);
+}
+
+/**
+ * @brief Loads the whole `path_list` table in m_moviesPathCache
+ */
+void DatabaseManager::loadMoviesPathCache()
+{
+    m_moviesPathCache.clear();
+    m_moviesPathCacheGeneration = writeGeneration();
+
     QSqlQuery l_query(m_db);
-    l_query.prepare("SELECT movies_path FROM path_list WHERE id=:id");
-    l_query.bindValue(":id", id);
+    l_query.prepare("SELECT id, movies_path FROM path_list");
 
-    if(!l_query.exec())
+    if(!execQuery(l_query, Q_FUNC_INFO))
     {
-        Macaw::DEBUG("In getMoviesPathById():");
+        Macaw::DEBUG("In loadMoviesPathCache():");
         Macaw::DEBUG(l_query.lastError().text());
     }
 
-    if(l_query.next())
+    while(l_query.next())
     {
-        l_moviesPath = l_query.value(0).toString();
+        m_moviesPathCache.insert(l_query.value(0).toInt(), l_query.value(1).toString());
     }
-
-    return l_moviesPath;
 }
 
 /**
@@ -1012,26 +1759,162 @@ QList<PathForMovies> DatabaseManager::getMoviesPaths(bool imported)
 {
     QList<PathForMovies> l_moviesPathList;
 
-    QSqlQuery l_query(m_db);
-    l_query.prepare("SELECT id, movies_path, type FROM path_list where imported=:imported");
-    l_query.bindValue(":imported", imported);
+    if (!m_moviesPathEntityCache.isComplete(writeGeneration()))
+    {
+        int l_generation = writeGeneration();
+        QSqlQuery l_query(m_db);
+        l_query.prepare("SELECT id, movies_path, type, imported FROM path_list");
+
+        if(!execQuery(l_query, Q_FUNC_INFO))
+        {
+            Macaw::DEBUG("In getMoviesPaths():");
+            Macaw::DEBUG(l_query.lastError().text());
+
+            return l_moviesPathList;
+        }
+
+        while(l_query.next())
+        {
+            PathForMovies l_moviesPath;
+            l_moviesPath.setId(l_query.value(0).toInt());
+            l_moviesPath.setPath(l_query.value(1).toString());
+            l_moviesPath.setType(l_query.value(2).toInt());
+            l_moviesPath.setImported(l_query.value(3).toBool());
+            m_moviesPathEntityCache.insert(l_moviesPath.id(), l_generation, l_moviesPath);
+        }
+        m_moviesPathEntityCache.setComplete(l_generation);
+    }
+
+    // Sorted by id, as in the table
+    QMap<int, PathForMovies> l_moviesPathMap;
+    foreach (PathForMovies l_moviesPath, m_moviesPathEntityCache.values())
+    {
+        if (l_moviesPath.isImported() == imported)
+        {
+            l_moviesPathMap.insert(l_moviesPath.id(), l_moviesPath);
+        }
+    }
+    l_moviesPathList = l_moviesPathMap.values();
+
+    return l_moviesPathList;
+}
 
-    if(!l_query.exec())
+/**
+ * @brief Gets the state of the directories of a movies path, as saved by the last scan
+ *
+ * @param int moviesPathId
+ * @return QHash<QString, DirectoryState> by path relative to the movies path
+ */
+QHash<QString, DirectoryState> DatabaseManager::getDirectoryStates(const int moviesPathId)
+{
+    QHash<QString, DirectoryState> l_stateHash;
+    QSqlQuery l_query(readDB());
+    l_query.setForwardOnly(true);
+    l_query.prepare("SELECT dir_path, mtime, inode, device, entry_count, list_hash "
+                    "FROM scan_state "
+                    "WHERE id_path = :id_path");
+    l_query.bindValue(":id_path", moviesPathId);
+
+    if (!execQuery(l_query, Q_FUNC_INFO))
     {
-        Macaw::DEBUG("In getMoviesPaths():");
+        Macaw::DEBUG("In getDirectoryStates():");
         Macaw::DEBUG(l_query.lastError().text());
+
+        return l_stateHash;
     }
 
-    while(l_query.next())
+    while (l_query.next())
     {
-        PathForMovies l_moviesPath;
-        l_moviesPath.setId(l_query.value(0).toInt());
-        l_moviesPath.setPath(l_query.value(1).toString());
-        l_moviesPath.setType(l_query.value(2).toInt());
-        l_moviesPathList.append(l_moviesPath);
+        DirectoryState l_state;
+        l_state.path = l_query.value(0).toString();
+        l_state.mtime = l_query.value(1).toLongLong();
+        l_state.inode = l_query.value(2).toULongLong();
+        l_state.device = l_query.value(3).toULongLong();
+        l_state.entryCount = l_query.value(4).toInt();
+        l_state.listHash = l_query.value(5).toByteArray();
+        l_stateHash.insert(l_state.path, l_state);
     }
 
-    return l_moviesPathList;
+    return l_stateHash;
+}
+
+/**
+ * @brief Saves the state of the directories of a movies path after a scan,
+ * in one transaction
+ *
+ * @param int moviesPathId
+ * @param QList<DirectoryState> stateList, directories listed during the scan
+ * @param QStringList removedPathList, directories that do not exist anymore
+ * @return bool
+ */
+bool DatabaseManager::updateDirectoryStates(const int moviesPathId,
+                                            const QList<DirectoryState> &stateList,
+                                            const QStringList &removedPathList)
+{
+    if (!beginTransaction())
+    {
+        return false;
+    }
+
+    QSqlQuery l_query(m_db);
+    bool l_ret = true;
+
+    // 100 rows per statement, under the limit of 999 parameters of SQLite
+    for (int l_begin = 0 ; l_ret && l_begin < stateList.size() ; l_begin += 100)
+    {
+        int l_end = qMin(l_begin + 100, stateList.size());
+        QStringList l_valueList;
+        for (int i = l_begin ; i < l_end ; i++)
+        {
+            l_valueList << "(?, ?, ?, ?, ?, ?, ?)";
+        }
+
+        l_query.prepare("INSERT OR REPLACE INTO scan_state"
+                        "(id_path, dir_path, mtime, inode, device, entry_count, list_hash) "
+                        "VALUES " + l_valueList.join(", "));
+        for (int i = l_begin ; i < l_end ; i++)
+        {
+            const DirectoryState &l_state = stateList.at(i);
+            l_query.addBindValue(moviesPathId);
+            l_query.addBindValue(l_state.path);
+            l_query.addBindValue(l_state.mtime);
+            l_query.addBindValue(l_state.inode);
+            l_query.addBindValue(l_state.device);
+            l_query.addBindValue(l_state.entryCount);
+            l_query.addBindValue(l_state.listHash);
+        }
+        l_ret = execQuery(l_query, Q_FUNC_INFO);
+    }
+
+    for (int l_begin = 0 ; l_ret && l_begin < removedPathList.size() ; l_begin += 500)
+    {
+        int l_end = qMin(l_begin + 500, removedPathList.size());
+        QStringList l_valueList;
+        for (int i = l_begin ; i < l_end ; i++)
+        {
+            l_valueList << "?";
+        }
+
+        l_query.prepare("DELETE FROM scan_state "
+                        "WHERE id_path = ? AND dir_path IN (" + l_valueList.join(", ") + ")");
+        l_query.addBindValue(moviesPathId);
+        for (int i = l_begin ; i < l_end ; i++)
+        {
+            l_query.addBindValue(removedPathList.at(i));
+        }
+        l_ret = execQuery(l_query, Q_FUNC_INFO);
+    }
+
+    if (!l_ret || !commitTransaction())
+    {
+        Macaw::DEBUG("In updateDirectoryStates():");
+        Macaw::DEBUG(l_query.lastError().text());
+        rollbackTransaction();
+
+        return false;
+    }
+
+    return true;
 }
 
 bool DatabaseManager::existMoviesPath(PathForMovies moviesPath)
@@ -1041,26 +1924,44 @@ bool DatabaseManager::existMoviesPath(PathForMovies moviesPath)
 
 bool DatabaseManager::deleteMoviesPath(PathForMovies moviesPath)
 {
+    bumpWriteGeneration();
     QList<Movie> l_movieList = getMoviesByPath(moviesPath);
+    QList<People> l_orphanPeopleList;
+    QList<Tag> l_orphanTagList;
 
-    foreach (Movie l_movie, l_movieList) {
-        if (!deleteMovie(l_movie))
-        {
+    if (!beginTransaction())
+    {
+        return false;
+    }
 
-            return false;
-        }
+    if (!l_movieList.isEmpty()
+            && !deleteMovieRows(l_movieList, l_orphanPeopleList, l_orphanTagList))
+    {
+        rollbackTransaction();
+
+        return false;
     }
 
     QSqlQuery l_query(m_db);
     l_query.prepare("DELETE FROM path_list WHERE movies_path LIKE :movies_path||'%'");
     l_query.bindValue(":movies_path", moviesPath.path());
-    if(!l_query.exec())
+    if(!execQuery(l_query, Q_FUNC_INFO) || !commitTransaction())
     {
         Macaw::DEBUG("In removeMoviesPath(), deleting path:");
         Macaw::DEBUG(l_query.lastError().text());
+        rollbackTransaction();
+        loadMoviesPathCache();
 
         return false;
     }
+    // Several paths can match the LIKE above, so the cache is simply reloaded
+    loadMoviesPathCache();
+
+    removePosters(l_movieList);
+    if (!l_orphanPeopleList.isEmpty() || !l_orphanTagList.isEmpty())
+    {
+        emit orphansDetected(l_orphanPeopleList, l_orphanTagList);
+    }
 
     return true;
 }
@@ -1074,7 +1975,7 @@ QString DatabaseManager::getMediaPlayerPath()
     QSqlQuery l_query(m_db);
     l_query.prepare("SELECT media_player FROM config");
 
-    if(!l_query.exec())
+    if(!execQuery(l_query, Q_FUNC_INFO))
     {
         Macaw::DEBUG("In getMediaPlayerPath():");
         Macaw::DEBUG(l_query.lastError().text());
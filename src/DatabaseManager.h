@@ -20,9 +20,20 @@
 #ifndef DATABASEMANAGER_H
 #define DATABASEMANAGER_H
 
+#include <QDate>
+#include <QDateTime>
+#include <QHash>
+#include <QMap>
 #include <QObject>
+#include <QSet>
 #include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QStringList>
+#include <QVariant>
 
+#include "EntityCache.h"
+
+class BackupThread;
 class Episode;
 class Movie;
 class PathForMovies;
@@ -31,6 +42,76 @@ class Playlist;
 class Show;
 class Tag;
 
+/**
+ * @brief A list of movies read page by page with DatabaseManager::getMoviesPage()
+ *
+ * The caller sets the filters. getMoviesPage() keeps the position of the last
+ * row read (value of `fieldOrder` and id) and sets `atEnd` after the last page.
+ */
+struct MovieCursor
+{
+    enum Filter { All, ByPeople, WithoutPeople, ByTag, WithoutTag, ByPlaylist };
+
+    MovieCursor() : filter(All), filterId(0), peopleType(0), show(false),
+                    toWatchOnly(false), fieldOrder("title"), lastId(0), atEnd(false) {}
+
+    Filter filter;
+    int filterId;           // id of the people, tag or playlist
+    int peopleType;         // for ByPeople and WithoutPeople
+    bool show;
+    bool toWatchOnly;
+    QString searchText;     // as typed in the search field, see getMoviesByAny()
+    QString fieldOrder;     // a NOT NULL column of `movies`
+
+    QVariant lastValue;
+    int lastId;
+    bool atEnd;
+};
+
+/**
+ * @brief Statistics of the queries run by one function of DatabaseManager,
+ * see DatabaseManager::queryStatistics()
+ */
+struct QueryStatistics
+{
+    QueryStatistics() : count(0), totalTime(0), maxTime(0), rowCount(0), slowCount(0) {}
+
+    int count;
+    qint64 totalTime;       // in microseconds
+    qint64 maxTime;         // in microseconds
+    qint64 rowCount;        // rows changed, and rows read when the slow-query log is on
+    int slowCount;          // queries slower than the threshold
+};
+
+/**
+ * @brief A person or a tag with the number of matching movies linked to it,
+ * see DatabaseManager::getPeopleFacets()
+ */
+struct FacetCount
+{
+    FacetCount() : id(0), movieCount(0) {}
+
+    int id;                 // 0 for all the movies, -1 for the movies without any
+    QString name;
+    int movieCount;
+};
+
+/**
+ * @brief What a scan found in one directory of a movies path,
+ * see DatabaseManager::getDirectoryStates()
+ */
+struct DirectoryState
+{
+    DirectoryState() : mtime(0), inode(0), device(0), entryCount(0) {}
+
+    QString path;           // relative to the movies path, empty for the root
+    qint64 mtime;           // in milliseconds, 0 to list the directory again
+    quint64 inode;          // 0 when unknown
+    quint64 device;         // 0 when unknown
+    int entryCount;
+    QByteArray listHash;    // of the names of the entries
+};
+
 /**
  * @brief Manages all the access to the database
  *
@@ -38,18 +119,23 @@ class Tag;
  */
 class DatabaseManager : public QObject
 {
-    #define DATE_FORMAT "yyyy.MM.dd"
     Q_OBJECT
 
 public:
     DatabaseManager();
+    ~DatabaseManager();
+    static DatabaseManager *createThreadReader();
+    static DatabaseManager *createThreadWriter();
     // Database management
+    bool open();
     bool openDB();
+    static QString databasePath();
+    static QSqlDatabase threadDatabase(bool readOnly = true);
     bool closeDB();
     bool deleteDB();
     bool createTables();
-    bool createTableMovies(QSqlQuery&);
-    bool createTablePeople(QSqlQuery&);
+    bool createTableMovies(QSqlQuery&, const QString &tableName = "movies");
+    bool createTablePeople(QSqlQuery&, const QString &tableName = "people");
     bool createTableMoviesPeople(QSqlQuery&);
     bool createTablePlaylists(QSqlQuery&);
     bool createTableMoviesPlaylists(QSqlQuery&);
@@ -59,13 +145,29 @@ public:
     bool createTableEpisodes(QSqlQuery&);
     bool createTablePathList(QSqlQuery&);
     bool createTableConfig(QSqlQuery&);
+    bool createTableScanState(QSqlQuery&);
+    bool createTableSearch(QSqlQuery&);
+    bool createIndexes(QSqlQuery&);
+    bool rebuildSearchIndex();
     QSqlError lastError();
-    bool upgradeDB(int fromVersion, int toVersion);
+    int queryCacheHits() const;
+    int queryCacheMisses() const;
+    static int writeGeneration();
+    int entityCacheSize() const;
+    void setEntityCacheSize(int cacheSize);
+    int entityCacheHits() const;
+    int entityCacheMisses() const;
+    bool beginTransaction();
+    bool commitTransaction();
+    bool rollbackTransaction();
+    int insertBatchSize() const;
+    void setInsertBatchSize(int batchSize);
 
     // Getters for paths, config
     QString getMoviesPathById(int id);
     QList<PathForMovies> getMoviesPaths(bool imported = true);
     QString getMediaPlayerPath();
+    QHash<QString, DirectoryState> getDirectoryStates(const int moviesPathId);
 
     // Insertions for paths, config
     bool addMoviesPath(PathForMovies moviesPath);
@@ -73,12 +175,85 @@ public:
     bool updateMoviesPath(PathForMovies moviesPath);
     int createTag(QString name);
     bool setMoviesPathImported(QString moviesPath, bool imported);
+    bool updateDirectoryStates(const int moviesPathId, const QList<DirectoryState> &stateList,
+                               const QStringList &removedPathList);
     bool deleteMoviesPath(PathForMovies moviesPath);
     bool existMoviesPath(PathForMovies moviesPath);
 
 signals:
-    void orphanTagDetected(const Tag &tag);
-    void orphanPeopleDetected(const People &people);
+    void orphansDetected(const QList<People> &peopleList, const QList<Tag> &tagList);
+    void upgradeProgress(int step, int stepCount, const QString &description);
+
+//// Backups - in DatabaseManager_backup.cpp
+public:
+    bool backupDB(QDateTime &timestamp);
+    bool startBackupDB();
+    QList<QDateTime> backupList() const;
+    bool restoreBackup(const QDateTime &timestamp);
+    int backupCount() const;
+    void setBackupCount(int backupCount);
+
+signals:
+    void backupFinished(bool succeeded, const QString &backupPath);
+
+private slots:
+    void on_backupThread_finished();
+
+private:
+    QString backupPath(const QDateTime &timestamp) const;
+    void rotateBackups();
+
+//// Profiling - in DatabaseManager_profiling.cpp
+public:
+    int slowQueryThreshold() const;
+    void setSlowQueryThreshold(int msec);
+    static QString slowQueryLogPath();
+    QHash<QString, QueryStatistics> queryStatistics() const;
+    void resetQueryStatistics();
+    void dumpQueryStatistics() const;
+
+private:
+    // The writes to the temporary tables leave the entity caches valid
+    enum QueryTables { MainTables, TempTables };
+
+    bool execQuery(QSqlQuery &query, const char *caller, QueryTables tables = MainTables);
+    bool execQuery(QSqlQuery &query, const QString &queryText, const char *caller,
+                   QueryTables tables = MainTables);
+    bool execBatchQuery(QSqlQuery &query, const char *caller, QueryTables tables = MainTables);
+    void recordQuery(QSqlQuery &query, const char *caller, qint64 time);
+    void bumpAfterWrite(const QSqlQuery &query, bool succeeded);
+    void logSlowQuery(QSqlQuery &query, const char *caller, qint64 time, qint64 rowCount);
+
+//// Facet counts - in DatabaseManager_facets.cpp
+public:
+    bool rebuildFacetCounts();
+
+private:
+    // `facet_counts.type` of the row counting all the movies
+    enum { FacetMovies = -1 };
+    bool createTableFacetCounts(QSqlQuery &query);
+    static QStringList facetCountsSchema();
+    bool initFacetCounts();
+    static QString facetCountsAdd(const QString &type, const QString &id,
+                                  const QString &show, const QString &delta);
+    static QString facetKeys(const QString &idCondition);
+    QList<FacetCount> getStoredFacets(const int type, const bool show);
+
+//// Upgrades - in DatabaseManager_upgrade.cpp
+public:
+    bool upgradeDB(int fromVersion, int toVersion);
+
+private:
+    typedef bool (DatabaseManager::*Migration)(QSqlQuery &query);
+    QMap<int, Migration> migrationList();
+    bool upgradeToV050(QSqlQuery &query);
+    bool upgradeToV051(QSqlQuery &query);
+    bool upgradeToV052(QSqlQuery &query);
+    bool upgradeToV053(QSqlQuery &query);
+    bool upgradeToV054(QSqlQuery &query);
+    bool upgradeToV055(QSqlQuery &query);
+    bool upgradeToV056(QSqlQuery &query);
+    bool upgradeToV057(QSqlQuery &query);
 
 //// Getters - in DatabaseManager_getters.cpp
 public:
@@ -92,15 +267,19 @@ public:
     QList<Movie> getMoviesByPlaylist(const int id, const bool show = false, const QString fieldOrder = "title");
     QList<Movie> getMoviesByPlaylist(const Playlist &playlist, const bool show = false, const QString fieldOrder = "title");
     QList<Movie> getMoviesByPath(const PathForMovies &path, const QString fieldOrder = "title");
+    QList<Movie> getMoviesByFilePath(const int moviesPathId, const QString &relativePath);
     QList<Movie> getMoviesWithoutPeople(const int type, const bool show = false, const QString fieldOrder = "title");
     QList<Movie> getMoviesWithoutTag(const bool show = false, const QString fieldOrder = "title");
     QList<Movie> getMoviesByAny(const QString text, const bool show = false, const QString fieldOrder = "title");
     QList<Movie> getMoviesNotImported(const bool show = false, const QString fieldOrder = "title");
+    QList<Movie> getMoviesPage(MovieCursor &cursor, const int pageSize);
+    QList<Movie> getMoviesByReleaseDate(const QDate &from, const QDate &to, const bool show = false, const QString fieldOrder = "release_date");
 
     // Episodes
     Episode getOneEpisodeById(const int id);
     QList<Episode> getAllEpisodes();
-    QList<Episode> getEpisodesByMovies(QList<Movie> movieList); // Do not pass by reference !
+    QList<Episode> getEpisodesByMovies(const QList<Movie> &movieList);
+    QList<Episode> getEpisodesByMovieIds(const QList<int> &movieIdList);
 /*    QList<Episode> getEpisodesByPeople(const int id, const int type, const QString fieldOrder = "s.name, e.season, e.number");
     QList<Episode> getEpisodesByPeople(const People &people, const int type, const QString fieldOrder = "s.name, e.season, e.number");
     QList<Episode> getEpisodesByTag(const int id, const QString fieldOrder = "s.name, e.season, e.number");
@@ -123,7 +302,9 @@ public:
     QList<People> getPeopleUsedByType(const int type, const QString fieldOrder = "name");
     QList<People> getPeopleByName(const QString name, const QString fieldOrder = "name");
     QList<People> getPeopleByMovie(const Movie &movie, int type, const QString fieldOrder = "name");
+    QHash<int, QList<People> > getPeopleByMovieIds(const QList<int> &movieIdList, const int type = 0);
     QList<People> getPeopleByAny(const QString text, const int type, const QString fieldOrder = "name");
+    QList<FacetCount> getPeopleFacets(const MovieCursor &cursor, const int type);
 
     // Tags
     Tag getOneTagById(const int id);
@@ -131,6 +312,8 @@ public:
     QList<Tag> getAllTags(const QString fieldOrder = "name");
     QList<Tag> getTagsUsed(const QString fieldOrder = "name");
     QList<Tag> getTagsByAny(const QString text, const QString fieldOrder = "name");
+    QHash<int, QList<Tag> > getTagsByMovieIds(const QList<int> &movieIdList);
+    QList<FacetCount> getTagFacets(const MovieCursor &cursor);
 
     // Playlists
     Playlist getOnePlaylistById(const int id);
@@ -139,16 +322,36 @@ public:
     bool isMovieInPlaylist(int movieId, int playlistId);
     bool isMovieInPlaylist(Movie &movie, int playlistId);
     bool isMovieInPlaylist(Movie &movie, Playlist &playlist);
+    QSet<int> getMovieIdsByPlaylist(const int playlistId);
+
+    // Hydration of lists
+    void setPeopleAndTagsToMovies(QList<Movie> &movieList);
 
     // Does element exist ?
     bool existEpisode(const QString);
     bool existshow(const QString);
-    bool existMovie(const QString);
+    bool existMovie(const int moviesPathId, const QString &filePath);
+    QHash<int, QSet<QString> > getKnownMovieFiles();
+    QHash<int, QHash<QString, int> > getMissingMovieFiles();
+    QHash<QByteArray, int> getMissingMoviesByFingerprint(const QList<QByteArray> &fingerprintList);
+    QHash<int, QByteArray> getFingerprintsByMovieIds(const QList<int> &movieIdList);
+    QList<Movie> getMoviesWithoutFingerprint(const int moviesPathId);
+    QList<Movie> getMoviesMissingSince(const int moviesPathId, const qint64 before);
     bool existTag(const QString);
     bool existPeople(const QString name);
 
 private:
     // Other functions for getters
+    static QString idListToString(const QList<int> &idList);
+    static QList<QList<int> > splitIdList(const QList<int> &idList);
+    static QString searchMatchExpression(const QString &text, const QString &columns = QString());
+    QList<Movie> getMoviesByAnyLike(const QString text, const bool show, const QString fieldOrder);
+    QStringList movieConditions(const MovieCursor &cursor, QString &match);
+    void bindMovieConditions(QSqlQuery &query, const MovieCursor &cursor, const QString &match);
+    QList<FacetCount> getFacets(const MovieCursor &cursor, const QString &linkJoin,
+                                const QString &linkedMovies, const int type);
+    QList<People> getPeopleByAnyLike(const QString text, const int type, const QString fieldOrder);
+    QList<Tag> getTagsByAnyLike(const QString text, const QString fieldOrder);
     void setMovieToEpisode(Episode &episode);
     void setPeopleToMovie(Movie &movie);
     void setTagsToMovie(Movie &movie);
@@ -159,12 +362,15 @@ private:
     Movie hydrateMovieOnly(QSqlQuery &query);
     People hydratePeople(QSqlQuery &query);
     Show hydrateShow(QSqlQuery &query);
+    static QDate dayNumberToDate(const QVariant &dayNumber);
+    static QVariant dateToDayNumber(const QDate &date);
     Tag hydrateTag(QSqlQuery &query);
     Playlist hydratePlaylist(QSqlQuery &query);
 
 //// Inserts - in DatabaseManager_insert.cpp
 public:
     bool insertNewMovie(Movie &movie, int moviesPathId);
+    QList<int> insertMovies(QList<Movie> &movieList, int moviesPathId);
     bool insertNewPlaylist(Playlist &playlist);
     bool addTagToMovie(Tag &tag, Movie &movie);
     bool addPeopleToMovie(People &people, Movie &movie, const int type);
@@ -183,19 +389,128 @@ public:
     bool updateTagInMovie(Tag &tag, Movie &movie);
     bool updatePlaylist(Playlist &playlist);
     bool updateMovieInPlaylist(Movie &movie, Playlist &playlist);
+    bool moveMovieFiles(const int moviesPathId, const QString &oldRelativePath,
+                        const int newMoviesPathId, const QString &newRelativePath);
+    bool relinkMovie(const int movieId, const int newMovieId);
+    bool updateFingerprints(const QHash<int, QByteArray> &fingerprintHash);
+    bool setMoviesMissing(const QList<int> &movieIdList, const bool missing);
+
+private:
+    bool updatePeopleLinksOfMovie(Movie &movie, QList<People> &orphanPeopleList);
+    bool updateTagLinksOfMovie(Movie &movie, QList<Tag> &orphanTagList);
+    bool insertLinkRows(const QString &table, const QStringList &columnList,
+                        const QList<QVariantList> &rowList);
+    static bool samePeopleData(const People &stored, const People &other);
 
 //// Delete - in DatabaseManager_delete.cpp
 public:
     bool deleteMovie(Movie &movie);
+    bool deleteMovies(const QList<Movie> &movieList);
     bool removePeopleFromMovie(People &people, Movie &movie, const int type);
     bool removeTagFromMovie(Tag &tag, Movie &movie);
     bool removeMovieFromPlaylist(Movie &movie, Playlist &playlist);
     bool deletePlaylist(Playlist &playlist);
     bool deleteTag(const Tag &tag);
     bool deletePeople(const People &people);
+    bool deleteOrphans(const QList<People> &peopleList, const QList<Tag> &tagList);
+
+private:
+    bool deleteMovieRows(const QList<Movie> &movieList,
+                         QList<People> &orphanPeopleList,
+                         QList<Tag> &orphanTagList);
+    bool findOrphans(const QList<int> &peopleIdList,
+                     const QList<int> &tagIdList,
+                     QList<People> &orphanPeopleList,
+                     QList<Tag> &orphanTagList);
+    void removePosters(const QList<Movie> &movieList);
 
 private:
+    QList<Episode> getEpisodesOfIdList(const QHash<int, Movie> &movieHash);
+    bool fillTempIdList(const QList<int> &idList);
+    explicit DatabaseManager(const QSqlDatabase &threadDb);
+    void initMembers();
+    void loadMoviesPathCache();
+    void initSearchIndex();
+    void dropSearchTriggers();
+    void dropFacetTriggers();
+    bool hasTriggers(const QStringList &schema);
+    QSqlQuery cachedQuery(const QString &queryText);
+    QSqlQuery cachedQuery(const QString &queryText, const QSqlDatabase &db);
+    QSqlDatabase readDB();
+    static bool setConnectionPragmas(QSqlDatabase &db, bool readOnly);
+    void clearQueryCache();
+    static void bumpWriteGeneration();
+    static QStringList searchSchema();
+    static QString searchMoviesRefresh(const QString &idCondition);
+    static QString searchMoviesInsert(const QString &idCondition);
+
     QSqlDatabase m_db;
+
+    /**
+     * @brief Read-only connection used by the getters, see readDB().
+     * With WAL journaling, it does not wait for the writes made through m_db.
+     */
+    QSqlDatabase m_readDb;
+
+    /**
+     * @brief True when the FTS5 tables `search_*` are available and up to date.
+     * Otherwise the ...ByAny() getters use LIKE queries.
+     */
+    bool m_searchEnabled;
+
+    /**
+     * @brief Prepared statements reused across calls, keyed by their connection and SQL text.
+     * See cachedQuery().
+     */
+    QHash<QString, QSqlQuery> m_queryCache;
+    int m_queryCacheHits;
+    int m_queryCacheMisses;
+
+    /**
+     * @brief Number of nested beginTransaction() not yet committed
+     */
+    int m_transactionDepth;
+    int m_insertBatchSize;
+
+    /**
+     * @brief Backup running in the background, see startBackupDB()
+     */
+    BackupThread *m_backupThread;
+    int m_backupCount;
+
+    /**
+     * @brief Statistics of the queries run through execQuery(), by calling function
+     */
+    QHash<QString, QueryStatistics> m_queryStatistics;
+
+    /**
+     * @brief Queries slower than this (in ms) go to the slow-query log, -1 to disable it
+     */
+    int m_slowQueryThreshold;
+
+    /**
+     * @brief In-memory copy of `path_list` (id => movies_path)
+     *
+     * Used when hydrating movies so that no query is run per row.
+     * Kept up to date by addMoviesPath(), updateMoviesPath() and deleteMoviesPath().
+     */
+    QHash<int, QString> m_moviesPathCache;
+    int m_moviesPathCacheGeneration;
+
+    /**
+     * @brief True for the managers made by createThreadReader() and createThreadWriter()
+     */
+    bool m_threadManager;
+
+    /**
+     * @brief Entities already read, see EntityCache.
+     * Any write empties them, see writeGeneration().
+     */
+    EntityCache<Movie> m_movieCache;
+    EntityCache<People> m_peopleCache;
+    EntityCache<Tag> m_tagCache;
+    EntityCache<Playlist> m_playlistCache;
+    EntityCache<PathForMovies> m_moviesPathEntityCache;
     QString m_movieFields;
     QString m_episodeFields;
     QString m_showFields;
@@ -0,0 +1,286 @@
+/* Copyright (C) 2014 Macaw-Movies
+ * (Olivier CHURLAUD, Sébastien TOUZÉ)
+ *
+ * This file is part of Macaw-Movies.
+ *
+ * Macaw-Movies is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Macaw-Movies is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Macaw-Movies.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "DatabaseManager.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMap>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QThread>
+#include <QVariant>
+
+#include "MacawDebug.h"
+
+#define BACKUP_SUFFIX "_backup"
+#define BACKUP_TIMESTAMP_FORMAT "yyyyMMdd_HHmmss"
+
+/**
+ * @brief Thread making a backup with its own connection, see DatabaseManager::startBackupDB()
+ *
+ * With WAL journaling, the reading connection neither waits for nor blocks
+ * the writes made meanwhile by the application.
+ */
+class BackupThread : public QThread
+{
+public:
+    BackupThread(const QString &databasePath, const QString &backupPath, QObject *parent) :
+        QThread(parent),
+        m_databasePath(databasePath),
+        m_backupPath(backupPath),
+        m_succeeded(false) {}
+
+    QString backupPath() const { return m_backupPath; }
+    bool succeeded() const { return m_succeeded; }
+
+protected:
+    void run()
+    {
+        QString l_name = "Movies-database-backup";
+        {
+            QSqlDatabase l_db = QSqlDatabase::addDatabase("QSQLITE", l_name);
+            l_db.setDatabaseName(m_databasePath);
+            // VACUUM INTO is accepted on a read-only connection
+            l_db.setConnectOptions("QSQLITE_OPEN_READONLY;QSQLITE_BUSY_TIMEOUT=5000");
+
+            if (l_db.open())
+            {
+                QSqlQuery l_query(l_db);
+                l_query.prepare("VACUUM INTO :path");
+                l_query.bindValue(":path", m_backupPath);
+                m_succeeded = l_query.exec();
+                if (!m_succeeded)
+                {
+                    Macaw::DEBUG("In BackupThread::run():");
+                    Macaw::DEBUG(l_query.lastError().text());
+                }
+            }
+            l_db.close();
+        }
+        QSqlDatabase::removeDatabase(l_name);
+    }
+
+private:
+    QString m_databasePath;
+    QString m_backupPath;
+    bool m_succeeded;
+};
+
+/**
+ * @brief Makes a backup of the database, and waits for it.
+ *
+ * `VACUUM INTO` copies a consistent state of the database through the open
+ * connection, without closing it. If the SQLite library is too old for it,
+ * the WAL is checkpointed and the file is copied.
+ * Cannot be called during a transaction.
+ *
+ * @param QDateTime timestamp, set to the timestamp of the backup, see restoreBackup()
+ * @return bool
+ */
+bool DatabaseManager::backupDB(QDateTime &timestamp)
+{
+    Macaw::DEBUG_IN("[DatabaseManager] backup database");
+    if (m_transactionDepth > 0)
+    {
+        Macaw::DEBUG("In backupDB(): a transaction is running");
+        Macaw::DEBUG_OUT("[DatabaseManager] database backup failed");
+
+        return false;
+    }
+
+    timestamp = QDateTime::currentDateTime();
+    QString l_backupPath = backupPath(timestamp);
+
+    QSqlQuery l_query(m_db);
+    l_query.prepare("VACUUM INTO :path");
+    l_query.bindValue(":path", l_backupPath);
+    bool l_ret = execQuery(l_query, Q_FUNC_INFO);
+    if (!l_ret)
+    {
+        Macaw::DEBUG("In backupDB(), VACUUM INTO:");
+        Macaw::DEBUG(l_query.lastError().text());
+
+        l_ret = execQuery(l_query, "PRAGMA wal_checkpoint(TRUNCATE)", Q_FUNC_INFO)
+                && QFile::copy(databasePath(), l_backupPath);
+    }
+    l_query.finish();
+
+    if (l_ret)
+    {
+        rotateBackups();
+    }
+    Macaw::DEBUG_OUT("[DatabaseManager] database backup done");
+
+    return l_ret;
+}
+
+/**
+ * @brief Starts a backup of the database in another thread.
+ * backupFinished() is emitted once it is done.
+ *
+ * @return bool false if a backup is already running
+ */
+bool DatabaseManager::startBackupDB()
+{
+    if (m_backupThread != NULL)
+    {
+        return false;
+    }
+
+    m_backupThread = new BackupThread(databasePath(),
+                                      backupPath(QDateTime::currentDateTime()),
+                                      this);
+    connect(m_backupThread, SIGNAL(finished()),
+            this, SLOT(on_backupThread_finished()));
+    m_backupThread->start(QThread::LowPriority);
+
+    return true;
+}
+
+/**
+ * @brief Slot triggered when the backup started by startBackupDB() is over
+ */
+void DatabaseManager::on_backupThread_finished()
+{
+    bool l_succeeded = m_backupThread->succeeded();
+    QString l_backupPath = m_backupThread->backupPath();
+    m_backupThread->deleteLater();
+    m_backupThread = NULL;
+
+    if (l_succeeded)
+    {
+        rotateBackups();
+    }
+    else
+    {
+        QFile::remove(l_backupPath);
+    }
+
+    emit backupFinished(l_succeeded, l_backupPath);
+}
+
+/**
+ * @brief Gets the timestamps of the existing backups, the most recent first
+ *
+ * @return QList<QDateTime>
+ */
+QList<QDateTime> DatabaseManager::backupList() const
+{
+    QFileInfo l_databaseInfo(databasePath());
+    QString l_prefix = l_databaseInfo.fileName() + BACKUP_SUFFIX;
+
+    // Sorted by date, whatever the order of the directory entries
+    QMap<QDateTime, QString> l_backupMap;
+    foreach (QString l_fileName, l_databaseInfo.dir().entryList(QStringList() << l_prefix + "*",
+                                                                  QDir::Files))
+    {
+        QDateTime l_timestamp = QDateTime::fromString(l_fileName.mid(l_prefix.size()),
+                                                      BACKUP_TIMESTAMP_FORMAT);
+        if (l_timestamp.isValid())
+        {
+            l_backupMap.insert(l_timestamp, l_fileName);
+        }
+    }
+
+    QList<QDateTime> l_backupList;
+    foreach (QDateTime l_timestamp, l_backupMap.keys())
+    {
+        l_backupList.prepend(l_timestamp);
+    }
+
+    return l_backupList;
+}
+
+/**
+ * @brief Replaces the database by one of its backups.
+ * The connections are closed during the copy, then opened again.
+ *
+ * @param QDateTime timestamp of the backup, as given by backupList()
+ * @return bool
+ */
+bool DatabaseManager::restoreBackup(const QDateTime &timestamp)
+{
+    Macaw::DEBUG_IN("[DatabaseManager] restore backup");
+    QString l_backupPath = backupPath(timestamp);
+    Macaw::DEBUG("Return to " + l_backupPath);
+
+    if (!QFile::exists(l_backupPath))
+    {
+        Macaw::DEBUG_OUT("[DatabaseManager] no such backup");
+
+        return false;
+    }
+
+    clearQueryCache();
+    deleteDB();
+    bool l_ret = QFile::copy(l_backupPath, databasePath());
+    l_ret = openDB() && l_ret;
+    loadMoviesPathCache();
+
+    Macaw::DEBUG_OUT("[DatabaseManager] Returned to backup");
+
+    return l_ret;
+}
+
+/**
+ * @brief Number of backups kept by rotateBackups()
+ *
+ * @return int
+ */
+int DatabaseManager::backupCount() const
+{
+    return m_backupCount;
+}
+
+/**
+ * @brief Sets the number of backups kept by rotateBackups()
+ *
+ * @param int backupCount, at least 1
+ */
+void DatabaseManager::setBackupCount(int backupCount)
+{
+    m_backupCount = qMax(1, backupCount);
+}
+
+/**
+ * @brief Path of the backup made at `timestamp`
+ *
+ * @param QDateTime timestamp
+ * @return QString
+ */
+QString DatabaseManager::backupPath(const QDateTime &timestamp) const
+{
+    return databasePath() + BACKUP_SUFFIX + timestamp.toString(BACKUP_TIMESTAMP_FORMAT);
+}
+
+/**
+ * @brief Removes the oldest backups, so that only backupCount() are kept
+ */
+void DatabaseManager::rotateBackups()
+{
+    QList<QDateTime> l_backupList = backupList();
+    for (int i = m_backupCount ; i < l_backupList.size() ; i++)
+    {
+        Macaw::DEBUG("[DatabaseManager] remove old backup " + backupPath(l_backupList.at(i)));
+        QFile::remove(backupPath(l_backupList.at(i)));
+    }
+}
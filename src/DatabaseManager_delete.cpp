@@ -19,8 +19,9 @@
 
 #include "DatabaseManager.h"
 
-#include <QApplication>
+#include <QCoreApplication>
 #include <QDir>
+#include <QSet>
 #include <QSqlError>
 #include <QSqlQuery>
 #include <QVariant>
@@ -40,48 +41,195 @@
  */
 bool DatabaseManager::deleteMovie(Movie &movie)
 {
-    foreach(People l_people, movie.peopleList())
+    return deleteMovies(QList<Movie>() << movie);
+}
+
+/**
+ * @brief Removes several movies from the database in one transaction.
+ * The links to people, tags, playlists and episodes are removed by the
+ * `ON DELETE CASCADE` foreign keys. The people and tags that are not used
+ * anymore are then reported all at once with orphansDetected().
+ *
+ * @param QList<Movie> movies to remove
+ * @return boolean
+ */
+bool DatabaseManager::deleteMovies(const QList<Movie> &movieList)
+{
+    bumpWriteGeneration();
+    if (movieList.isEmpty())
+    {
+        return true;
+    }
+
+    QList<People> l_orphanPeopleList;
+    QList<Tag> l_orphanTagList;
+    if (!beginTransaction())
+    {
+        return false;
+    }
+    if (!deleteMovieRows(movieList, l_orphanPeopleList, l_orphanTagList)
+            || !commitTransaction())
+    {
+        rollbackTransaction();
+
+        return false;
+    }
+
+    removePosters(movieList);
+    if (!l_orphanPeopleList.isEmpty() || !l_orphanTagList.isEmpty())
+    {
+        emit orphansDetected(l_orphanPeopleList, l_orphanTagList);
+    }
+
+    return true;
+}
+
+/**
+ * @brief Deletes the rows of the given movies and looks for the people and tags
+ * that were only used by them. Must be called inside a transaction.
+ *
+ * @param QList<Movie> movies to remove
+ * @param QList<People> orphanPeopleList, filled with the people not used anymore
+ * @param QList<Tag> orphanTagList, filled with the tags not used anymore
+ * @return boolean
+ */
+bool DatabaseManager::deleteMovieRows(const QList<Movie> &movieList,
+                                      QList<People> &orphanPeopleList,
+                                      QList<Tag> &orphanTagList)
+{
+    QList<int> l_movieIdList;
+    foreach (Movie l_movie, movieList)
     {
-        if (!removePeopleFromMovie(l_people, movie, l_people.type()))
+        l_movieIdList.append(l_movie.id());
+    }
+
+    // Only the people and tags of these movies may become orphans
+    QSet<int> l_peopleIdSet;
+    QSet<int> l_tagIdSet;
+    QSqlQuery l_query(m_db);
+    foreach (QList<int> l_idList, splitIdList(l_movieIdList))
+    {
+        QString l_movieIds = idListToString(l_idList);
+        l_query.prepare("SELECT DISTINCT id_people FROM movies_people "
+                        "WHERE id_movie IN (" + l_movieIds + ")");
+        if (!execQuery(l_query, Q_FUNC_INFO))
         {
+            Macaw::DEBUG("In deleteMovieRows():");
+            Macaw::DEBUG(l_query.lastError().text());
+
             return false;
         }
-    }
-    foreach(Tag l_tag, movie.tagList())
-    {
-        if (!removeTagFromMovie(l_tag, movie))
+        while (l_query.next())
+        {
+            l_peopleIdSet.insert(l_query.value(0).toInt());
+        }
+
+        l_query.prepare("SELECT DISTINCT id_tag FROM movies_tags "
+                        "WHERE id_movie IN (" + l_movieIds + ")");
+        if (!execQuery(l_query, Q_FUNC_INFO))
         {
+            Macaw::DEBUG("In deleteMovieRows():");
+            Macaw::DEBUG(l_query.lastError().text());
+
             return false;
         }
-    }
-    QList<Playlist> l_playlistList;
-    foreach(Playlist l_playlist, l_playlistList)
-    {
-        if (!removeMovieFromPlaylist(movie, l_playlist))
+        while (l_query.next())
         {
+            l_tagIdSet.insert(l_query.value(0).toInt());
+        }
+
+        // The links are removed by the foreign keys
+        l_query.prepare("DELETE FROM movies WHERE id IN (" + l_movieIds + ")");
+        if (!execQuery(l_query, Q_FUNC_INFO))
+        {
+            Macaw::DEBUG("In deleteMovieRows():");
+            Macaw::DEBUG(l_query.lastError().text());
+
             return false;
         }
     }
 
-    if (!movie.posterPath().isEmpty()) {
-        QDir l_posterPath(qApp->property("postersPath").toString());
-        l_posterPath.remove(movie.posterPath());
-    }
+    return findOrphans(l_peopleIdSet.toList(), l_tagIdSet.toList(), orphanPeopleList, orphanTagList);
+}
+
+/**
+ * @brief Among the given people and tags, finds the ones that are not linked
+ * to any movie anymore. They are sorted by name in each group of splitIdList().
+ *
+ * @param QList<int> ids of the people to check
+ * @param QList<int> ids of the tags to check
+ * @param QList<People> orphanPeopleList, filled with the orphan people
+ * @param QList<Tag> orphanTagList, filled with the orphan tags
+ * @return boolean
+ */
+bool DatabaseManager::findOrphans(const QList<int> &peopleIdList,
+                                  const QList<int> &tagIdList,
+                                  QList<People> &orphanPeopleList,
+                                  QList<Tag> &orphanTagList)
+{
     QSqlQuery l_query(m_db);
-    l_query.prepare("DELETE FROM movies WHERE id = :id");
-    l_query.bindValue(":id", movie.id());
+    foreach (QList<int> l_idList, splitIdList(peopleIdList))
+    {
+        l_query.prepare("SELECT " + m_peopleFields +
+                        "FROM people AS p "
+                        "WHERE p.id IN (" + idListToString(l_idList) + ") "
+                          "AND NOT EXISTS (SELECT 1 FROM movies_people AS mp "
+                                          "WHERE mp.id_people = p.id) "
+                        "ORDER BY p.name");
+        if (!execQuery(l_query, Q_FUNC_INFO))
+        {
+            Macaw::DEBUG("In findOrphans():");
+            Macaw::DEBUG(l_query.lastError().text());
 
-    if(!l_query.exec())
+            return false;
+        }
+        while (l_query.next())
+        {
+            orphanPeopleList.append(hydratePeople(l_query));
+        }
+    }
+
+    foreach (QList<int> l_idList, splitIdList(tagIdList))
     {
-        Macaw::DEBUG("In deleteMovie():");
-        Macaw::DEBUG(l_query.lastError().text());
+        l_query.prepare("SELECT " + m_tagFields +
+                        "FROM tags AS t "
+                        "WHERE t.id IN (" + idListToString(l_idList) + ") "
+                          "AND NOT EXISTS (SELECT 1 FROM movies_tags AS mt "
+                                          "WHERE mt.id_tag = t.id) "
+                        "ORDER BY t.name");
+        if (!execQuery(l_query, Q_FUNC_INFO))
+        {
+            Macaw::DEBUG("In findOrphans():");
+            Macaw::DEBUG(l_query.lastError().text());
 
-        return false;
+            return false;
+        }
+        while (l_query.next())
+        {
+            orphanTagList.append(hydrateTag(l_query));
+        }
     }
 
     return true;
 }
 
+/**
+ * @brief Removes the poster files of deleted movies
+ *
+ * @param QList<Movie> deleted movies
+ */
+void DatabaseManager::removePosters(const QList<Movie> &movieList)
+{
+    QDir l_posterPath(QCoreApplication::instance()->property("postersPath").toString());
+    foreach (Movie l_movie, movieList)
+    {
+        if (!l_movie.posterPath().isEmpty())
+        {
+            l_posterPath.remove(l_movie.posterPath());
+        }
+    }
+}
+
 /**
  * @brief Removes the link between a person and a movie
  * If there is no more link with the person, it is deleted
@@ -95,6 +243,7 @@ bool DatabaseManager::removePeopleFromMovie(People &people,
                                             Movie &movie,
                                             const int type)
 {
+    bumpWriteGeneration();
     QSqlQuery l_query(m_db);
     l_query.prepare("DELETE FROM movies_people "
                    "WHERE id_people = :id_people "
@@ -104,7 +253,7 @@ bool DatabaseManager::removePeopleFromMovie(People &people,
     l_query.bindValue(":id_movie", movie.id());
     l_query.bindValue(":type", type);
 
-    if(!l_query.exec())
+    if(!execQuery(l_query, Q_FUNC_INFO))
     {
         Macaw::DEBUG("In removePeopleFromMovie():");
         Macaw::DEBUG(l_query.lastError().text());
@@ -115,7 +264,7 @@ bool DatabaseManager::removePeopleFromMovie(People &people,
     // Checks if this people is still used, if not asks for deleting it.
     l_query.prepare("SELECT id FROM movies_people WHERE id_people = :id_people");
     l_query.bindValue(":id_people", people.id());
-    if(!l_query.exec())
+    if(!execQuery(l_query, Q_FUNC_INFO))
     {
         Macaw::DEBUG("In removePeopleFromMovie():");
         Macaw::DEBUG(l_query.lastError().text());
@@ -124,7 +273,7 @@ bool DatabaseManager::removePeopleFromMovie(People &people,
     }
     if (!l_query.next()) {
         Macaw::DEBUG("[DatabaseManager] orphan people detected");
-        emit orphanPeopleDetected(people);
+        emit orphansDetected(QList<People>() << people, QList<Tag>());
     }
 
     return true;
@@ -140,13 +289,14 @@ bool DatabaseManager::removePeopleFromMovie(People &people,
  */
 bool DatabaseManager::removeTagFromMovie(Tag &tag, Movie &movie)
 {
+    bumpWriteGeneration();
     QSqlQuery l_query(m_db);
     l_query.prepare("DELETE FROM movies_tags "
                    "WHERE id_tag = :id_tag "
                      "AND id_movie = :id_movie");
     l_query.bindValue(":id_tag", tag.id());
     l_query.bindValue(":id_movie", movie.id());
-    if(!l_query.exec())
+    if(!execQuery(l_query, Q_FUNC_INFO))
     {
         Macaw::DEBUG("In removeTagFromMovie():");
         Macaw::DEBUG(l_query.lastError().text());
@@ -157,7 +307,7 @@ bool DatabaseManager::removeTagFromMovie(Tag &tag, Movie &movie)
     // Checks if this tag is still used, if not; asks for deleting it.
     l_query.prepare("SELECT id FROM movies_tags WHERE id_tag = :id_tag");
     l_query.bindValue(":id_tag", tag.id());
-    if(!l_query.exec())
+    if(!execQuery(l_query, Q_FUNC_INFO))
     {
         Macaw::DEBUG("In removeTagFromMovie():");
         Macaw::DEBUG(l_query.lastError().text());
@@ -167,7 +317,7 @@ bool DatabaseManager::removeTagFromMovie(Tag &tag, Movie &movie)
 
     if(!l_query.next())
     {
-        emit orphanTagDetected(tag);
+        emit orphansDetected(QList<People>(), QList<Tag>() << tag);
     }
 
     return true;
@@ -182,13 +332,14 @@ bool DatabaseManager::removeTagFromMovie(Tag &tag, Movie &movie)
  */
 bool DatabaseManager::removeMovieFromPlaylist(Movie &movie, Playlist &playlist)
 {
+    bumpWriteGeneration();
     QSqlQuery l_query(m_db);
     l_query.prepare("DELETE FROM movies_playlists "
                     "WHERE id_playlist = :id_playlist "
                         "AND id_movie = :id_movie");
     l_query.bindValue(":id_playlist", playlist.id());
     l_query.bindValue(":id_movie", movie.id());
-    if(!l_query.exec())
+    if(!execQuery(l_query, Q_FUNC_INFO))
     {
         Macaw::DEBUG("In removeMovieFromPlaylist():");
         Macaw::DEBUG(l_query.lastError().text());
@@ -207,6 +358,7 @@ bool DatabaseManager::removeMovieFromPlaylist(Movie &movie, Playlist &playlist)
  */
 bool DatabaseManager::deletePlaylist(Playlist &playlist)
 {
+    bumpWriteGeneration();
     if (playlist.id() == 1)
     {
         Macaw::DEBUG("ToWatch cannot be deleted");
@@ -223,7 +375,7 @@ bool DatabaseManager::deletePlaylist(Playlist &playlist)
                    "WHERE id = :id");
     l_query.bindValue(":id", playlist.id());
 
-    if(!l_query.exec())
+    if(!execQuery(l_query, Q_FUNC_INFO))
     {
         Macaw::DEBUG("In deletePlaylist():");
         Macaw::DEBUG(l_query.lastError().text());
@@ -242,13 +394,14 @@ bool DatabaseManager::deletePlaylist(Playlist &playlist)
  */
 bool DatabaseManager::deletePeople(const People &people)
 {
+    bumpWriteGeneration();
     QSqlQuery l_query(m_db);
 
     // Deleting all references to the people in movies_people
     l_query.prepare("DELETE FROM movies_people WHERE id_people = :id");
     l_query.bindValue(":id", people.id());
 
-    if(!l_query.exec())
+    if(!execQuery(l_query, Q_FUNC_INFO))
     {
         Macaw::DEBUG("In deletePeople():");
         Macaw::DEBUG(l_query.lastError().text());
@@ -259,7 +412,7 @@ bool DatabaseManager::deletePeople(const People &people)
     l_query.prepare("DELETE FROM people WHERE id = :id");
     l_query.bindValue(":id", people.id());
 
-    if(!l_query.exec())
+    if(!execQuery(l_query, Q_FUNC_INFO))
     {
         Macaw::DEBUG("In deletePeople():");
         Macaw::DEBUG(l_query.lastError().text());
@@ -277,13 +430,14 @@ bool DatabaseManager::deletePeople(const People &people)
  */
 bool DatabaseManager::deleteTag(const Tag &tag)
 {
+    bumpWriteGeneration();
     QSqlQuery l_query(m_db);
 
     // Deleting all references to the tag in movies_tags
     l_query.prepare("DELETE FROM movies_tags WHERE id_tag = :id");
     l_query.bindValue(":id", tag.id());
 
-    if(!l_query.exec())
+    if(!execQuery(l_query, Q_FUNC_INFO))
     {
         Macaw::DEBUG("In deleteTag():");
         Macaw::DEBUG(l_query.lastError().text());
@@ -295,7 +449,7 @@ bool DatabaseManager::deleteTag(const Tag &tag)
     l_query.prepare("DELETE FROM tags WHERE id = :id");
     l_query.bindValue(":id", tag.id());
 
-    if(!l_query.exec())
+    if(!execQuery(l_query, Q_FUNC_INFO))
     {
         Macaw::DEBUG("In deleteTag():");
         Macaw::DEBUG(l_query.lastError().text());
@@ -305,3 +459,62 @@ bool DatabaseManager::deleteTag(const Tag &tag)
 
     return true;
 }
+
+/**
+ * @brief Removes people and tags from the database in one transaction,
+ * typically the orphans reported by orphansDetected().
+ * The references in movies_people and movies_tags go with the foreign keys.
+ *
+ * @param QList<People> people to remove
+ * @param QList<Tag> tags to remove
+ * @return boolean
+ */
+bool DatabaseManager::deleteOrphans(const QList<People> &peopleList, const QList<Tag> &tagList)
+{
+    bumpWriteGeneration();
+    QList<int> l_peopleIdList;
+    foreach (People l_people, peopleList)
+    {
+        l_peopleIdList.append(l_people.id());
+    }
+    QList<int> l_tagIdList;
+    foreach (Tag l_tag, tagList)
+    {
+        l_tagIdList.append(l_tag.id());
+    }
+
+    if (!beginTransaction())
+    {
+        return false;
+    }
+
+    QSqlQuery l_query(m_db);
+    bool l_ret = true;
+    foreach (QList<int> l_idList, splitIdList(l_peopleIdList))
+    {
+        if (l_ret)
+        {
+            l_query.prepare("DELETE FROM people WHERE id IN (" + idListToString(l_idList) + ")");
+            l_ret = execQuery(l_query, Q_FUNC_INFO);
+        }
+    }
+    foreach (QList<int> l_idList, splitIdList(l_tagIdList))
+    {
+        if (l_ret)
+        {
+            l_query.prepare("DELETE FROM tags WHERE id IN (" + idListToString(l_idList) + ")");
+            l_ret = execQuery(l_query, Q_FUNC_INFO);
+        }
+    }
+
+    if (!l_ret || !commitTransaction())
+    {
+        Macaw::DEBUG("In deleteOrphans():");
+        Macaw::DEBUG(l_query.lastError().text());
+        rollbackTransaction();
+
+        return false;
+    }
+
+    return true;
+}
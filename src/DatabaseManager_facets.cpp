@@ -0,0 +1,340 @@
+/* Copyright (C) 2014 Macaw-Movies
+ * (Olivier CHURLAUD, Sébastien TOUZÉ)
+ *
+ * This file is part of Macaw-Movies.
+ *
+ * Macaw-Movies is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Macaw-Movies is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Macaw-Movies.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "DatabaseManager.h"
+
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QStringList>
+#include <QVariant>
+
+#include "MacawDebug.h"
+
+/**
+ * @brief Create the table `facet_counts` and the triggers keeping it in sync
+ * with `movies`, `movies_people` and `movies_tags`.
+ *
+ * One row per (type, show, id_entity) counts the movies of this show flag:
+ * - type 0 is for the tags, People::typePeople for the people,
+ *   and FacetMovies for all the movies (with id_entity 0);
+ * - id_entity 0 counts the movies linked to at least one entity of the type.
+ *
+ * Rows reaching 0 are deleted, so the table only grows with the entities in use.
+ * The missing movies (`missing_since` set) are not counted, as they are not listed.
+ * @param query
+ * @return bool
+ */
+bool DatabaseManager::createTableFacetCounts(QSqlQuery &query)
+{
+    foreach (QString l_queryText, facetCountsSchema()) {
+        if (!execQuery(query, l_queryText, Q_FUNC_INFO)) {
+            Macaw::DEBUG("In createTableFacetCounts:");
+            Macaw::DEBUG(query.lastError().text());
+
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief Statements creating `facet_counts` and its triggers, see createTableFacetCounts()
+ *
+ * @return QStringList
+ */
+QStringList DatabaseManager::facetCountsSchema()
+{
+    QString l_movieShow = "(SELECT show FROM movies WHERE id = %1)";
+    QString l_moviePresent = "WHEN (SELECT missing_since FROM movies WHERE id = %1) IS NULL ";
+    QString l_clean = "DELETE FROM facet_counts WHERE movie_count <= 0; ";
+
+    QStringList l_queryList;
+    l_queryList << "CREATE TABLE IF NOT EXISTS facet_counts("
+                   "type INTEGER NOT NULL, "
+                   "id_entity INTEGER NOT NULL, "
+                   "show BOOLEAN NOT NULL, "
+                   "movie_count INTEGER NOT NULL, "
+                   "PRIMARY KEY (type, show, id_entity)"
+                   ") WITHOUT ROWID"
+
+                // Movies
+                << "CREATE TRIGGER IF NOT EXISTS facet_movies_insert "
+                   "AFTER INSERT ON movies "
+                   "WHEN NEW.missing_since IS NULL BEGIN "
+                   + facetCountsAdd(QString::number(FacetMovies), "0", "NEW.show", "1") +
+                   "END"
+                // The links are removed before the movie, while its show flag can be read.
+                // The foreign keys then have nothing left to delete.
+                << "CREATE TRIGGER IF NOT EXISTS facet_movies_delete "
+                   "BEFORE DELETE ON movies BEGIN "
+                   "DELETE FROM movies_people WHERE id_movie = OLD.id; "
+                   "DELETE FROM movies_tags WHERE id_movie = OLD.id; "
+                   + facetCountsAdd(QString::number(FacetMovies), "0", "OLD.show",
+                                    "CASE WHEN OLD.missing_since IS NULL THEN -1 ELSE 0 END")
+                   + l_clean +
+                   "END"
+                << "CREATE TRIGGER IF NOT EXISTS facet_movies_update "
+                   "AFTER UPDATE OF show ON movies "
+                   "WHEN OLD.show IS NOT NEW.show "
+                   "AND OLD.missing_since IS NULL AND NEW.missing_since IS NULL BEGIN "
+                   "UPDATE facet_counts SET movie_count = movie_count - 1 "
+                   "WHERE show = OLD.show AND (type, id_entity) IN (" + facetKeys("= NEW.id") + "); "
+                   "INSERT INTO facet_counts(type, id_entity, show, movie_count) "
+                   "SELECT type, id_entity, NEW.show, 1 FROM (" + facetKeys("= NEW.id") + ") WHERE 1 "
+                   "ON CONFLICT(type, show, id_entity) DO UPDATE SET movie_count = movie_count + 1; "
+                   + l_clean +
+                   "END"
+                // A movie whose file is gone leaves the counts, and comes back with its file
+                << "CREATE TRIGGER IF NOT EXISTS facet_movies_missing "
+                   "AFTER UPDATE OF missing_since ON movies "
+                   "WHEN OLD.missing_since IS NULL AND NEW.missing_since IS NOT NULL BEGIN "
+                   "UPDATE facet_counts SET movie_count = movie_count - 1 "
+                   "WHERE show = OLD.show AND (type, id_entity) IN (" + facetKeys("= NEW.id") + "); "
+                   + l_clean +
+                   "END"
+                << "CREATE TRIGGER IF NOT EXISTS facet_movies_found "
+                   "AFTER UPDATE OF missing_since ON movies "
+                   "WHEN OLD.missing_since IS NOT NULL AND NEW.missing_since IS NULL BEGIN "
+                   "INSERT INTO facet_counts(type, id_entity, show, movie_count) "
+                   "SELECT type, id_entity, NEW.show, 1 FROM (" + facetKeys("= NEW.id") + ") WHERE 1 "
+                   "ON CONFLICT(type, show, id_entity) DO UPDATE SET movie_count = movie_count + 1; "
+                   "END"
+
+                // Links between movies and people/tags
+                << "CREATE TRIGGER IF NOT EXISTS facet_movies_people_insert "
+                   "AFTER INSERT ON movies_people "
+                   + l_moviePresent.arg("NEW.id_movie") + "BEGIN "
+                   + facetCountsAdd("NEW.type", "NEW.id_people", l_movieShow.arg("NEW.id_movie"), "1") +
+                   "INSERT INTO facet_counts(type, id_entity, show, movie_count) "
+                   "SELECT NEW.type, 0, " + l_movieShow.arg("NEW.id_movie") + ", 1 "
+                   "WHERE (SELECT COUNT(*) FROM movies_people "
+                          "WHERE id_movie = NEW.id_movie AND type = NEW.type) = 1 "
+                   "ON CONFLICT(type, show, id_entity) DO UPDATE SET movie_count = movie_count + 1; "
+                   "END"
+                << "CREATE TRIGGER IF NOT EXISTS facet_movies_people_delete "
+                   "AFTER DELETE ON movies_people "
+                   + l_moviePresent.arg("OLD.id_movie") + "BEGIN "
+                   + facetCountsAdd("OLD.type", "OLD.id_people", l_movieShow.arg("OLD.id_movie"), "-1") +
+                   "UPDATE facet_counts SET movie_count = movie_count - 1 "
+                   "WHERE type = OLD.type AND id_entity = 0 "
+                   "AND show = " + l_movieShow.arg("OLD.id_movie") + " "
+                   "AND NOT EXISTS (SELECT 1 FROM movies_people "
+                                   "WHERE id_movie = OLD.id_movie AND type = OLD.type); "
+                   + l_clean +
+                   "END"
+                << "CREATE TRIGGER IF NOT EXISTS facet_movies_tags_insert "
+                   "AFTER INSERT ON movies_tags "
+                   + l_moviePresent.arg("NEW.id_movie") + "BEGIN "
+                   + facetCountsAdd("0", "NEW.id_tag", l_movieShow.arg("NEW.id_movie"), "1") +
+                   "INSERT INTO facet_counts(type, id_entity, show, movie_count) "
+                   "SELECT 0, 0, " + l_movieShow.arg("NEW.id_movie") + ", 1 "
+                   "WHERE (SELECT COUNT(*) FROM movies_tags WHERE id_movie = NEW.id_movie) = 1 "
+                   "ON CONFLICT(type, show, id_entity) DO UPDATE SET movie_count = movie_count + 1; "
+                   "END"
+                << "CREATE TRIGGER IF NOT EXISTS facet_movies_tags_delete "
+                   "AFTER DELETE ON movies_tags "
+                   + l_moviePresent.arg("OLD.id_movie") + "BEGIN "
+                   + facetCountsAdd("0", "OLD.id_tag", l_movieShow.arg("OLD.id_movie"), "-1") +
+                   "UPDATE facet_counts SET movie_count = movie_count - 1 "
+                   "WHERE type = 0 AND id_entity = 0 "
+                   "AND show = " + l_movieShow.arg("OLD.id_movie") + " "
+                   "AND NOT EXISTS (SELECT 1 FROM movies_tags WHERE id_movie = OLD.id_movie); "
+                   + l_clean +
+                   "END";
+
+    return l_queryList;
+}
+
+/**
+ * @brief Builds the statement (to be used in a trigger) adding `delta` to one
+ * row of `facet_counts`, created if needed
+ *
+ * @param type, id, show, delta: SQL expressions
+ * @return QString
+ */
+QString DatabaseManager::facetCountsAdd(const QString &type, const QString &id,
+                                        const QString &show, const QString &delta)
+{
+    return "INSERT INTO facet_counts(type, id_entity, show, movie_count) "
+           "VALUES (" + type + ", " + id + ", " + show + ", " + delta + ") "
+           "ON CONFLICT(type, show, id_entity) "
+           "DO UPDATE SET movie_count = movie_count + excluded.movie_count; ";
+}
+
+/**
+ * @brief Builds the query selecting the (type, id_entity) keys of `facet_counts`
+ * counting the movie whose id matches `idCondition`
+ *
+ * @param idCondition, for instance "= NEW.id"
+ * @return QString
+ */
+QString DatabaseManager::facetKeys(const QString &idCondition)
+{
+    return "SELECT " + QString::number(FacetMovies) + " AS type, 0 AS id_entity "
+           "UNION SELECT type, id_people FROM movies_people WHERE id_movie " + idCondition + " "
+           "UNION SELECT type, 0 FROM movies_people WHERE id_movie " + idCondition + " "
+           "UNION SELECT 0, id_tag FROM movies_tags WHERE id_movie " + idCondition + " "
+           "UNION SELECT 0, 0 FROM movies_tags WHERE id_movie " + idCondition;
+}
+
+/**
+ * @brief Checks that `facet_counts` and its triggers exist, creates and fills them if needed.
+ * The triggers are dropped with the tables they are on, when a migration copies a table.
+ *
+ * @return bool
+ */
+bool DatabaseManager::initFacetCounts()
+{
+    if (m_db.tables().contains("facet_counts") && hasTriggers(facetCountsSchema())) {
+
+        return true;
+    }
+
+    Macaw::DEBUG("[DatabaseManager] Build the facet counts");
+    QSqlQuery l_query(m_db);
+
+    return createTableFacetCounts(l_query) && rebuildFacetCounts();
+}
+
+/**
+ * @brief Drops the triggers maintaining `facet_counts`.
+ * initFacetCounts() creates them again and counts the facets.
+ */
+void DatabaseManager::dropFacetTriggers()
+{
+    QSqlQuery l_query(m_db);
+    execQuery(l_query, "SELECT name FROM sqlite_master WHERE type = 'trigger' AND name LIKE 'facet%'",
+              Q_FUNC_INFO);
+    QStringList l_triggerList;
+    while (l_query.next()) {
+        l_triggerList.append(l_query.value(0).toString());
+    }
+    foreach (QString l_trigger, l_triggerList) {
+        execQuery(l_query, "DROP TRIGGER IF EXISTS " + l_trigger, Q_FUNC_INFO);
+    }
+}
+
+/**
+ * @brief Counts again all the facets from the other tables.
+ * Can be used to repair `facet_counts`.
+ *
+ * @return bool
+ */
+bool DatabaseManager::rebuildFacetCounts()
+{
+    Macaw::DEBUG_IN("[DatabaseManager] Enters rebuildFacetCounts()");
+    QSqlQuery l_query(m_db);
+    QStringList l_queryList;
+    l_queryList << "DELETE FROM facet_counts"
+                << "INSERT INTO facet_counts(type, id_entity, show, movie_count) "
+                   "SELECT " + QString::number(FacetMovies) + ", 0, show, COUNT(*) "
+                   "FROM movies WHERE missing_since IS NULL GROUP BY show"
+                << "INSERT INTO facet_counts(type, id_entity, show, movie_count) "
+                   "SELECT l.type, l.id_people, m.show, COUNT(*) "
+                   "FROM movies_people AS l JOIN movies AS m ON m.id = l.id_movie "
+                   "WHERE m.missing_since IS NULL "
+                   "GROUP BY l.type, l.id_people, m.show"
+                << "INSERT INTO facet_counts(type, id_entity, show, movie_count) "
+                   "SELECT l.type, 0, m.show, COUNT(DISTINCT m.id) "
+                   "FROM movies_people AS l JOIN movies AS m ON m.id = l.id_movie "
+                   "WHERE m.missing_since IS NULL "
+                   "GROUP BY l.type, m.show"
+                << "INSERT INTO facet_counts(type, id_entity, show, movie_count) "
+                   "SELECT 0, l.id_tag, m.show, COUNT(*) "
+                   "FROM movies_tags AS l JOIN movies AS m ON m.id = l.id_movie "
+                   "WHERE m.missing_since IS NULL "
+                   "GROUP BY l.id_tag, m.show"
+                << "INSERT INTO facet_counts(type, id_entity, show, movie_count) "
+                   "SELECT 0, 0, m.show, COUNT(DISTINCT m.id) "
+                   "FROM movies_tags AS l JOIN movies AS m ON m.id = l.id_movie "
+                   "WHERE m.missing_since IS NULL "
+                   "GROUP BY m.show";
+
+    bool l_ret = beginTransaction();
+    foreach (QString l_queryText, l_queryList) {
+        if (l_ret && !execQuery(l_query, l_queryText, Q_FUNC_INFO)) {
+            Macaw::DEBUG("In rebuildFacetCounts:");
+            Macaw::DEBUG(l_query.lastError().text());
+            l_ret = false;
+        }
+    }
+
+    if (l_ret) {
+        l_ret = commitTransaction();
+    } else {
+        rollbackTransaction();
+    }
+    Macaw::DEBUG_OUT("[DatabaseManager] Exits rebuildFacetCounts()");
+
+    return l_ret;
+}
+
+/**
+ * @brief Reads the facets of a type from `facet_counts`, for all the movies
+ * (or all the shows). Same entries as getFacets().
+ *
+ * @param int type, 0 for the tags
+ * @param bool show
+ * @return QList<FacetCount>
+ */
+QList<FacetCount> DatabaseManager::getStoredFacets(const int type, const bool show)
+{
+    QList<FacetCount> l_facetList;
+    QString l_entityTable = type == 0 ? "tags" : "people";
+
+    // Missing rows count 0 movies
+    QString l_moviesCount = "IFNULL((SELECT movie_count FROM facet_counts "
+                                    "WHERE type = :movies AND show = :show AND id_entity = 0), 0)";
+    QString l_linkedCount = "IFNULL((SELECT movie_count FROM facet_counts "
+                                    "WHERE type = :type AND show = :show AND id_entity = 0), 0)";
+
+    QSqlQuery l_query = cachedQuery("SELECT 0, NULL, " + l_moviesCount + " "
+                                    "UNION ALL "
+                                    "SELECT -1, NULL, " + l_moviesCount + " - " + l_linkedCount + " "
+                                    "UNION ALL "
+                                    "SELECT * FROM (SELECT e.id, e.name, f.movie_count "
+                                                   "FROM facet_counts AS f "
+                                                   "JOIN " + l_entityTable + " AS e ON e.id = f.id_entity "
+                                                   "WHERE f.type = :type AND f.show = :show "
+                                                   "AND f.id_entity != 0 "
+                                                   "ORDER BY e.name)",
+                                    readDB());
+    l_query.bindValue(":movies", FacetMovies);
+    l_query.bindValue(":type", type);
+    l_query.bindValue(":show", show);
+
+    if (!execQuery(l_query, Q_FUNC_INFO))
+    {
+        Macaw::DEBUG("In getStoredFacets():");
+        Macaw::DEBUG(l_query.lastError().text());
+    }
+
+    while (l_query.next())
+    {
+        FacetCount l_facet;
+        l_facet.id = l_query.value(0).toInt();
+        l_facet.name = l_query.value(1).toString();
+        l_facet.movieCount = l_query.value(2).toInt();
+        l_facetList.append(l_facet);
+    }
+    l_query.finish();
+
+    return l_facetList;
+}
@@ -23,6 +23,8 @@
 #include <QSqlQuery>
 #include <QVariant>
 
+#include <limits>
+
 #include "MacawDebug.h"
 #include "Entities/Episode.h"
 #include "Entities/Movie.h"
@@ -32,6 +34,7 @@
 
 /**
  * @brief Gets the one movie that has the id `id`
+ * Served from m_movieCache when nothing was written since the last read.
  *
  * @param int id of the movie
  * @return Movie
@@ -39,13 +42,19 @@
 Movie DatabaseManager::getOneMovieById(const int id)
 {
     Movie l_movie;
-    QSqlQuery l_query(m_db);
-    l_query.prepare("SELECT " + m_movieFields +
-                    "FROM movies AS m "
-                    "WHERE id = :id");
+    int l_generation = writeGeneration();
+    if (m_movieCache.find(id, l_generation, l_movie))
+    {
+        return l_movie;
+    }
+
+    QSqlQuery l_query = cachedQuery("SELECT " + m_movieFields +
+                                    "FROM movies AS m "
+                                    "WHERE id = :id",
+                                    readDB());
     l_query.bindValue(":id", id);
 
-    if (!l_query.exec())
+    if (!execQuery(l_query, Q_FUNC_INFO))
     {
         Macaw::DEBUG("In getOneMovieById(int):");
         Macaw::DEBUG(l_query.lastError().text());
@@ -54,7 +63,9 @@ Movie DatabaseManager::getOneMovieById(const int id)
     if(l_query.next())
     {
         l_movie = hydrateMovie(l_query);
+        m_movieCache.insert(id, l_generation, l_movie);
     }
+    l_query.finish();
 
     return l_movie;
 }
@@ -67,15 +78,15 @@ Movie DatabaseManager::getOneMovieById(const int id)
 QList<Movie> DatabaseManager::getAllMovies(const bool show, const QString fieldOrder)
 {
     QList<Movie> l_movieList;
-    QSqlQuery l_query(m_db);
+    QSqlQuery l_query(readDB());
     l_query.prepare("SELECT " + m_movieFields +
                     "FROM movies AS m "
-                    "WHERE show = :show "
+                    "WHERE show = :show AND missing_since IS NULL "
                     "ORDER BY " + fieldOrder);
 
     l_query.bindValue(":show", show);
 
-    if (!l_query.exec())
+    if (!execQuery(l_query, Q_FUNC_INFO))
     {
         Macaw::DEBUG("In getAllMovies():");
         Macaw::DEBUG(l_query.lastError().text());
@@ -103,19 +114,19 @@ QList<Movie> DatabaseManager::getMoviesByPeople(const int id,
                                                 const QString fieldOrder)
 {
     QList<Movie> l_movieList;
-    QSqlQuery l_query(m_db);
+    QSqlQuery l_query(readDB());
     l_query.prepare("SELECT " + m_movieFields +
                     "FROM movies AS m "
                     "WHERE id IN (SELECT id_movie "
                                  "FROM movies_people "
                                  "WHERE id_people = :id AND type = :type) "
-                           "AND show = :show "
+                           "AND show = :show AND missing_since IS NULL "
                     "ORDER BY " + fieldOrder);
     l_query.bindValue(":id", id);
     l_query.bindValue(":type", type);
     l_query.bindValue(":show", show);
 
-    if (!l_query.exec())
+    if (!execQuery(l_query, Q_FUNC_INFO))
     {
         Macaw::DEBUG("In getMoviesByPeople():");
         Macaw::DEBUG(l_query.lastError().text());
@@ -159,18 +170,18 @@ QList<Movie> DatabaseManager::getMoviesByTag(const int id,
                                              const QString fieldOrder)
 {
     QList<Movie> l_movieList;
-    QSqlQuery l_query(m_db);
+    QSqlQuery l_query(readDB());
     l_query.prepare("SELECT " + m_movieFields +
                     "FROM movies AS m "
                     "WHERE id IN (SELECT id_movie "
                                  "FROM movies_tags "
                                  "WHERE id_tag = :id) "
-                        "AND show = :show "
+                        "AND show = :show AND missing_since IS NULL "
                     "ORDER BY " + fieldOrder);
     l_query.bindValue(":id", id);
     l_query.bindValue(":show", show);
 
-    if (!l_query.exec())
+    if (!execQuery(l_query, Q_FUNC_INFO))
     {
         Macaw::DEBUG("In getMoviesByTag(Tag):");
         Macaw::DEBUG(l_query.lastError().text());
@@ -210,18 +221,18 @@ QList<Movie> DatabaseManager::getMoviesByPlaylist(const int id,
                                                   const QString fieldOrder)
 {
     QList<Movie> l_movieList;
-    QSqlQuery l_query(m_db);
+    QSqlQuery l_query(readDB());
     l_query.prepare("SELECT " + m_movieFields +
                     "FROM movies AS m "
                     "WHERE m.id IN (SELECT id_movie "
                                  "FROM movies_playlists "
                                  "WHERE id_playlist = :id) "
-                        "AND show = :show "
+                        "AND show = :show AND missing_since IS NULL "
                     "ORDER BY " + fieldOrder);
     l_query.bindValue(":id", id);
     l_query.bindValue(":show", show);
 
-    if (!l_query.exec())
+    if (!execQuery(l_query, Q_FUNC_INFO))
     {
         Macaw::DEBUG("In getMoviesByPlaylist(Playlist):");
         Macaw::DEBUG(l_query.lastError().text());
@@ -252,7 +263,7 @@ QList<Movie> DatabaseManager::getMoviesByPlaylist(const Playlist &playlist,
 }
 
 /**
- * @brief DatabaseManager::getMoviesByPath
+ * @brief Gets all the movies of a movies path, the missing ones included
  * @param path
  * @param fieldOrder
  * @return
@@ -260,7 +271,7 @@ QList<Movie> DatabaseManager::getMoviesByPlaylist(const Playlist &playlist,
 QList<Movie> DatabaseManager::getMoviesByPath(const PathForMovies &path, const QString fieldOrder)
 {
     QList<Movie> l_movieList;
-    QSqlQuery l_query(m_db);
+    QSqlQuery l_query(readDB());
     l_query.prepare("SELECT " + m_movieFields +
                     "FROM movies AS m "
                     "WHERE id_path = :id_path "
@@ -268,7 +279,7 @@ QList<Movie> DatabaseManager::getMoviesByPath(const PathForMovies &path, const Q
 
     l_query.bindValue(":id_path", path.id());
 
-    if (!l_query.exec())
+    if (!execQuery(l_query, Q_FUNC_INFO))
     {
         Macaw::DEBUG("In getMoviesByPath():");
         Macaw::DEBUG(l_query.lastError().text());
@@ -284,23 +295,62 @@ QList<Movie> DatabaseManager::getMoviesByPath(const PathForMovies &path, const Q
 
 }
 
+/**
+ * @brief Gets the movies of a file, or of all the files of a directory,
+ * the missing ones included
+ *
+ * @param int moviesPathId, id of the movies path
+ * @param QString relativePath of the file or directory, relative to the movies path
+ * @return QList<Movie>
+ */
+QList<Movie> DatabaseManager::getMoviesByFilePath(const int moviesPathId, const QString &relativePath)
+{
+    QList<Movie> l_movieList;
+    QSqlQuery l_query(readDB());
+
+    // The files of the directory are between "dir/" and "dir0" ('0' follows '/'),
+    // which uses the index of (id_path, file_path)
+    l_query.prepare("SELECT " + m_movieFields +
+                    "FROM movies AS m "
+                    "WHERE id_path = :id_path "
+                      "AND (file_path = :file_path "
+                           "OR (file_path >= :dir_begin AND file_path < :dir_end))");
+    l_query.bindValue(":id_path", moviesPathId);
+    l_query.bindValue(":file_path", relativePath);
+    l_query.bindValue(":dir_begin", relativePath + '/');
+    l_query.bindValue(":dir_end", relativePath + '0');
+
+    if (!execQuery(l_query, Q_FUNC_INFO))
+    {
+        Macaw::DEBUG("In getMoviesByFilePath():");
+        Macaw::DEBUG(l_query.lastError().text());
+    }
+
+    while(l_query.next())
+    {
+        l_movieList.append(hydrateMovieOnly(l_query));
+    }
+
+    return l_movieList;
+}
+
 QList<Movie> DatabaseManager::getMoviesWithoutPeople(const int type,
                                                      const bool show,
                                                      const QString fieldOrder)
 {
     QList<Movie> l_movieList;
-    QSqlQuery l_query(m_db);
+    QSqlQuery l_query(readDB());
     l_query.prepare("SELECT " + m_movieFields +
                     "FROM movies AS m "
                     "WHERE (SELECT COUNT(*) "
                                 "FROM movies_people AS mp "
                                 "WHERE mp.id_movie = m.id AND mp.type = :type) = 0 "
-                        "AND show = :show "
+                        "AND show = :show AND missing_since IS NULL "
                     "ORDER BY " + fieldOrder);
     l_query.bindValue(":type", type);
     l_query.bindValue(":show", show);
 
-    if (!l_query.exec())
+    if (!execQuery(l_query, Q_FUNC_INFO))
     {
         Macaw::DEBUG("In getMoviesWithoutPeople():");
         Macaw::DEBUG(l_query.lastError().text());
@@ -318,18 +368,18 @@ QList<Movie> DatabaseManager::getMoviesWithoutPeople(const int type,
 QList<Movie> DatabaseManager::getMoviesWithoutTag(const bool show, const QString fieldOrder)
 {
     QList<Movie> l_movieList;
-    QSqlQuery l_query(m_db);
+    QSqlQuery l_query(readDB());
     l_query.prepare("SELECT " + m_movieFields +
                     "FROM movies AS m "
                     "WHERE (SELECT COUNT(*) "
                                 "FROM movies_tags AS mt "
                                 "WHERE mt.id_movie = m.id) = 0 "
-                        "AND show = :show "
+                        "AND show = :show AND missing_since IS NULL "
                     "ORDER BY " + fieldOrder);
 
     l_query.bindValue(":show", show);
 
-    if (!l_query.exec())
+    if (!execQuery(l_query, Q_FUNC_INFO))
     {
         Macaw::DEBUG("In getMoviesWithoutTag():");
         Macaw::DEBUG(l_query.lastError().text());
@@ -345,22 +395,72 @@ QList<Movie> DatabaseManager::getMoviesWithoutTag(const bool show, const QString
 }
 
 /**
- * @brief DatabaseManager::getMoviesByAny
+ * @brief Gets the movies matching every word of `text` in their title, original title,
+ * people or tags. Each word is matched as a prefix.
+ * The movies are ranked by relevance (title first), then sorted by `fieldOrder`.
+ *
  * @param text
  * @param show
  * @param fieldOrder
- * @return
+ * @return QList<Movie>
  */
 QList<Movie> DatabaseManager::getMoviesByAny(const QString text,
                                              const bool show,
                                              const QString fieldOrder)
 {
-    // @TODO: too long
+    if (!m_searchEnabled) {
+
+        return getMoviesByAnyLike(text, show, fieldOrder);
+    }
+
+    QString l_match = searchMatchExpression(text);
+    if (l_match.isEmpty()) {
+
+        return getAllMovies(show, fieldOrder);
+    }
+
+    QList<Movie> l_movieList;
+    QSqlQuery l_query(readDB());
+    l_query.prepare("SELECT " + m_movieFields + " "
+                    "FROM search_movies, movies AS m "
+                    "WHERE search_movies MATCH :match "
+                      "AND m.id = search_movies.rowid "
+                      "AND m.show = :show AND m.missing_since IS NULL "
+                    "ORDER BY bm25(search_movies, 10.0, 5.0, 2.0, 1.0), m." + fieldOrder);
+    l_query.bindValue(":match", l_match);
+    l_query.bindValue(":show", show);
+
+    if (!execQuery(l_query, Q_FUNC_INFO))
+    {
+        Macaw::DEBUG("In getMoviesByAny():");
+        Macaw::DEBUG(l_query.lastError().text());
+    }
+
+    while(l_query.next())
+    {
+        Movie l_movie = hydrateMovieOnly(l_query);
+        l_movieList.append(l_movie);
+    }
+
+    return l_movieList;
+}
+
+/**
+ * @brief Same as getMoviesByAny() without the full-text search index (slow)
+ * @param text
+ * @param show
+ * @param fieldOrder
+ * @return
+ */
+QList<Movie> DatabaseManager::getMoviesByAnyLike(const QString text,
+                                                 const bool show,
+                                                 const QString fieldOrder)
+{
     QList<Movie> l_movieList;
-    QSqlQuery l_query(m_db);
+    QSqlQuery l_query(readDB());
     QStringList l_splittedText = text.split(' ');
 
-    QString l_queryText = "SELECT " + m_movieFields + " FROM movies AS m WHERE show = :show AND ";
+    QString l_queryText = "SELECT " + m_movieFields + " FROM movies AS m WHERE show = :show AND missing_since IS NULL AND ";
     for( int i = 0 ; i < l_splittedText.size() ; i++)
     {
         if (i != 0)
@@ -396,7 +496,7 @@ QList<Movie> DatabaseManager::getMoviesByAny(const QString text,
         l_query.bindValue(":text"+ QString::number(i), l_splittedText.at(i));
     }
 
-    if (!l_query.exec())
+    if (!execQuery(l_query, Q_FUNC_INFO))
     {
         Macaw::DEBUG("In getMoviesByAny():");
         Macaw::DEBUG(l_query.lastError().text());
@@ -414,17 +514,17 @@ QList<Movie> DatabaseManager::getMoviesByAny(const QString text,
 QList<Movie> DatabaseManager::getMoviesNotImported(const bool show, const QString fieldOrder)
 {
     QList<Movie> l_movieList;
-    QSqlQuery l_query(m_db);
+    QSqlQuery l_query(readDB());
     l_query.prepare("SELECT " + m_movieFields +
                     "FROM movies AS m "
                     "WHERE m.imported = :imported "
-                    "AND m.show = :show "
+                    "AND m.show = :show AND m.missing_since IS NULL "
                     "ORDER BY " + fieldOrder);
     l_query.bindValue(":imported", false);
     l_query.bindValue(":show", show);
 
 
-    if (!l_query.exec())
+    if (!execQuery(l_query, Q_FUNC_INFO))
     {
         Macaw::DEBUG("In getMoviesNotImported():");
         Macaw::DEBUG(l_query.lastError().text());
@@ -439,10 +539,307 @@ QList<Movie> DatabaseManager::getMoviesNotImported(const bool show, const QStrin
     return l_movieList;
 }
 
+/**
+ * @brief Gets the movies released between `from` and `to` (included).
+ * An invalid date leaves the range open on that side.
+ *
+ * @param QDate from
+ * @param QDate to
+ * @return QList<Movie>
+ */
+QList<Movie> DatabaseManager::getMoviesByReleaseDate(const QDate &from,
+                                                     const QDate &to,
+                                                     const bool show,
+                                                     const QString fieldOrder)
+{
+    QList<Movie> l_movieList;
+    QSqlQuery l_query(readDB());
+    l_query.prepare("SELECT " + m_movieFields +
+                    "FROM movies AS m "
+                    "WHERE m.show = :show AND m.missing_since IS NULL "
+                        "AND m.release_date BETWEEN :from AND :to "
+                    "ORDER BY m." + fieldOrder);
+    l_query.bindValue(":show", show);
+    l_query.bindValue(":from", from.isValid() ? from.toJulianDay() : std::numeric_limits<qint64>::min());
+    l_query.bindValue(":to", to.isValid() ? to.toJulianDay() : std::numeric_limits<qint64>::max());
+
+    if (!execQuery(l_query, Q_FUNC_INFO))
+    {
+        Macaw::DEBUG("In getMoviesByReleaseDate():");
+        Macaw::DEBUG(l_query.lastError().text());
+    }
+
+    while(l_query.next())
+    {
+        Movie l_movie = hydrateMovieOnly(l_query);
+        l_movieList.append(l_movie);
+    }
+
+    return l_movieList;
+}
+
+/**
+ * @brief Gets the next page of the list of movies described by `cursor`.
+ *
+ * Keyset pagination: the rows are sorted by `cursor.fieldOrder`, then by id, and the
+ * page starts right after the last row returned before. The cost of a page only
+ * depends on `pageSize`, not on the size of the library.
+ *
+ * @param MovieCursor cursor, updated to the end of the page
+ * @param int pageSize maximal number of movies to return
+ * @return QList<Movie>
+ */
+QList<Movie> DatabaseManager::getMoviesPage(MovieCursor &cursor, const int pageSize)
+{
+    QList<Movie> l_movieList;
+    if (cursor.atEnd) {
+
+        return l_movieList;
+    }
+
+    QString l_match;
+    QStringList l_conditionList = movieConditions(cursor, l_match);
+
+    if (cursor.lastId != 0) {
+        l_conditionList << "(m." + cursor.fieldOrder + ", m.id) > (:lastValue, :lastId)";
+    }
+
+    QSqlQuery l_query = cachedQuery("SELECT " + m_movieFields + ", m." + cursor.fieldOrder + " "
+                                    "FROM movies AS m "
+                                    "WHERE " + l_conditionList.join(" AND ") + " "
+                                    "ORDER BY m." + cursor.fieldOrder + ", m.id "
+                                    "LIMIT :pageSize",
+                                    readDB());
+    bindMovieConditions(l_query, cursor, l_match);
+    if (cursor.lastId != 0) {
+        l_query.bindValue(":lastValue", cursor.lastValue);
+        l_query.bindValue(":lastId", cursor.lastId);
+    }
+    l_query.bindValue(":pageSize", pageSize);
+
+    if (!execQuery(l_query, Q_FUNC_INFO))
+    {
+        Macaw::DEBUG("In getMoviesPage():");
+        Macaw::DEBUG(l_query.lastError().text());
+        cursor.atEnd = true;
+    }
+
+    while(l_query.next())
+    {
+        Movie l_movie = hydrateMovieOnly(l_query);
+        l_movieList.append(l_movie);
+        cursor.lastValue = l_query.value(17);
+        cursor.lastId = l_movie.id();
+    }
+    l_query.finish();
+
+    if (l_movieList.count() < pageSize) {
+        cursor.atEnd = true;
+    }
+
+    return l_movieList;
+}
+
+/**
+ * @brief Gets the people of a type linked to the movies described by `cursor`,
+ * with the number of these movies for each person, in one grouped query.
+ *
+ * Two more entries are given: id 0 with the number of movies described by
+ * `cursor`, and id -1 with the number of those without people of this type.
+ * Without search, filter nor To Watch, the counts are read from `facet_counts`.
+ *
+ * @param MovieCursor cursor, its position is not used
+ * @param int type of the people
+ * @return QList<FacetCount>
+ */
+QList<FacetCount> DatabaseManager::getPeopleFacets(const MovieCursor &cursor, const int type)
+{
+    if (cursor.filter == MovieCursor::All && !cursor.toWatchOnly
+            && cursor.searchText.trimmed().isEmpty()) {
+
+        return getStoredFacets(type, cursor.show);
+    }
+
+    return getFacets(cursor,
+                     "JOIN movies_people AS l ON l.id_movie = m.id AND l.type = :facetType "
+                     "JOIN people AS e ON e.id = l.id_people",
+                     "SELECT id_movie FROM movies_people WHERE type = :facetType",
+                     type);
+}
+
+/**
+ * @brief Gets the tags of the movies described by `cursor`, with the number
+ * of these movies for each tag, in one grouped query. See getPeopleFacets().
+ *
+ * @param MovieCursor cursor, its position is not used
+ * @return QList<FacetCount>
+ */
+QList<FacetCount> DatabaseManager::getTagFacets(const MovieCursor &cursor)
+{
+    if (cursor.filter == MovieCursor::All && !cursor.toWatchOnly
+            && cursor.searchText.trimmed().isEmpty()) {
+
+        return getStoredFacets(0, cursor.show);
+    }
+
+    return getFacets(cursor,
+                     "JOIN movies_tags AS l ON l.id_movie = m.id "
+                     "JOIN tags AS e ON e.id = l.id_tag",
+                     "SELECT id_movie FROM movies_tags",
+                     0);
+}
+
+/**
+ * @brief Counts the movies described by `cursor` for each entity linked to them.
+ * The movies are selected once, in a common table expression.
+ *
+ * @param MovieCursor cursor
+ * @param QString linkJoin, joins `m` to the entities `e`
+ * @param QString linkedMovies, selects the movies linked to any entity
+ * @param int type of the people, 0 for the tags
+ * @return QList<FacetCount> ordered by name, after the entries 0 and -1
+ */
+QList<FacetCount> DatabaseManager::getFacets(const MovieCursor &cursor,
+                                             const QString &linkJoin,
+                                             const QString &linkedMovies,
+                                             const int type)
+{
+    QList<FacetCount> l_facetList;
+    QString l_match;
+    QStringList l_conditionList = movieConditions(cursor, l_match);
+
+    QSqlQuery l_query = cachedQuery("WITH matching(id) AS "
+                                        "(SELECT m.id FROM movies AS m "
+                                        "WHERE " + l_conditionList.join(" AND ") + ") "
+                                    "SELECT 0, NULL, COUNT(*) FROM matching "
+                                    "UNION ALL "
+                                    "SELECT -1, NULL, COUNT(*) FROM matching AS m "
+                                    "WHERE m.id NOT IN (" + linkedMovies + ") "
+                                    "UNION ALL "
+                                    "SELECT * FROM (SELECT e.id, e.name, COUNT(*) "
+                                                   "FROM matching AS m " + linkJoin + " "
+                                                   "GROUP BY e.id ORDER BY e.name)",
+                                    readDB());
+    bindMovieConditions(l_query, cursor, l_match);
+    if (type != 0) {
+        l_query.bindValue(":facetType", type);
+    }
+
+    if (!execQuery(l_query, Q_FUNC_INFO))
+    {
+        Macaw::DEBUG("In getFacets():");
+        Macaw::DEBUG(l_query.lastError().text());
+    }
+
+    while (l_query.next())
+    {
+        FacetCount l_facet;
+        l_facet.id = l_query.value(0).toInt();
+        l_facet.name = l_query.value(1).toString();
+        l_facet.movieCount = l_query.value(2).toInt();
+        l_facetList.append(l_facet);
+    }
+    l_query.finish();
+
+    return l_facetList;
+}
+
+/**
+ * @brief Conditions on the movies `m` described by `cursor`, apart from its position.
+ * The values are bound by bindMovieConditions().
+ *
+ * Without full-text search, the movies matching the search are put in `temp.id_list`
+ * (see fillTempIdList()), so that the text of the conditions does not change
+ * with the search and its statement stays in the cache of cachedQuery().
+ *
+ * @param MovieCursor cursor
+ * @param QString match, set to the full-text query of `cursor.searchText`
+ * @return QStringList conditions to join with AND
+ */
+QStringList DatabaseManager::movieConditions(const MovieCursor &cursor, QString &match)
+{
+    QStringList l_conditionList;
+    l_conditionList << "m.show = :show" << "m.missing_since IS NULL";
+
+    switch (cursor.filter) {
+    case MovieCursor::ByPeople:
+        l_conditionList << "m.id IN (SELECT id_movie FROM movies_people "
+                                    "WHERE id_people = :filterId AND type = :type)";
+        break;
+    case MovieCursor::WithoutPeople:
+        l_conditionList << "m.id NOT IN (SELECT id_movie FROM movies_people WHERE type = :type)";
+        break;
+    case MovieCursor::ByTag:
+        l_conditionList << "m.id IN (SELECT id_movie FROM movies_tags WHERE id_tag = :filterId)";
+        break;
+    case MovieCursor::WithoutTag:
+        l_conditionList << "m.id NOT IN (SELECT id_movie FROM movies_tags)";
+        break;
+    case MovieCursor::ByPlaylist:
+        l_conditionList << "m.id IN (SELECT id_movie FROM movies_playlists "
+                                    "WHERE id_playlist = :filterId)";
+        break;
+    default:
+        break;
+    }
+
+    if (cursor.toWatchOnly) {
+        l_conditionList << "m.id IN (SELECT id_movie FROM movies_playlists "
+                                    "WHERE id_playlist = :toWatch)";
+    }
+
+    match.clear();
+    if (m_searchEnabled) {
+        match = searchMatchExpression(cursor.searchText);
+        if (!match.isEmpty()) {
+            l_conditionList << "m.id IN (SELECT rowid FROM search_movies "
+                                        "WHERE search_movies MATCH :match)";
+        }
+    } else if (!cursor.searchText.trimmed().isEmpty()) {
+        QList<int> l_idList;
+        foreach (Movie l_movie, getMoviesByAnyLike(cursor.searchText, cursor.show, "id")) {
+            l_idList.append(l_movie.id());
+        }
+        if (fillTempIdList(l_idList)) {
+            l_conditionList << "m.id IN (SELECT id FROM temp.id_list)";
+        } else {
+            l_conditionList << "0";
+        }
+    }
+
+    return l_conditionList;
+}
+
+/**
+ * @brief Binds the values of the conditions given by movieConditions()
+ *
+ * @param QSqlQuery query
+ * @param MovieCursor cursor
+ * @param QString match, as set by movieConditions()
+ */
+void DatabaseManager::bindMovieConditions(QSqlQuery &query, const MovieCursor &cursor, const QString &match)
+{
+    query.bindValue(":show", cursor.show);
+    if (cursor.filter == MovieCursor::ByPeople
+            || cursor.filter == MovieCursor::ByTag
+            || cursor.filter == MovieCursor::ByPlaylist) {
+        query.bindValue(":filterId", cursor.filterId);
+    }
+    if (cursor.filter == MovieCursor::ByPeople || cursor.filter == MovieCursor::WithoutPeople) {
+        query.bindValue(":type", cursor.peopleType);
+    }
+    if (cursor.toWatchOnly) {
+        query.bindValue(":toWatch", Playlist::ToWatch);
+    }
+    if (!match.isEmpty()) {
+        query.bindValue(":match", match);
+    }
+}
+
 Episode DatabaseManager::getOneEpisodeById(const int id)
 {
     Episode l_episode;
-    QSqlQuery l_query(m_db);
+    QSqlQuery l_query(readDB());
     l_query.prepare("SELECT " + m_episodeFields + ", " + m_showFields +
                     "FROM episodes AS e "
                     "LEFT JOIN show AS s "
@@ -451,7 +848,7 @@ Episode DatabaseManager::getOneEpisodeById(const int id)
     l_query.bindValue(":id", id);
 
 
-    if (!l_query.exec())
+    if (!execQuery(l_query, Q_FUNC_INFO))
     {
         Macaw::DEBUG("In getEpisodeById:");
         Macaw::DEBUG(l_query.lastError().text());
@@ -469,14 +866,14 @@ QList<Episode> DatabaseManager::getAllEpisodes()
 {
     QList<Episode> l_episodeList;
 
-    QSqlQuery l_query(m_db);
+    QSqlQuery l_query(readDB());
     l_query.prepare("SELECT " + m_episodeFields + ", " + m_showFields +
                     "FROM episodes AS e "
                     "LEFT JOIN show AS s "
                     "ON s.id = e.id_show "
                     "ORDER BY s.name, e.season, e.number");
 
-    if (!l_query.exec())
+    if (!execQuery(l_query, Q_FUNC_INFO))
     {
         Macaw::DEBUG("In getAllEpisodes:");
         Macaw::DEBUG(l_query.lastError().text());
@@ -490,48 +887,146 @@ QList<Episode> DatabaseManager::getAllEpisodes()
     return l_episodeList;
 }
 
-QList<Episode> DatabaseManager::getEpisodesByMovies(QList<Movie> movieList)
+/**
+ * @brief Gets the episodes of the given movies, which are set to the episodes as they are
+ *
+ * @param QList<Movie> movieList
+ * @return QList<Episode> ordered by show, season and number
+ */
+QList<Episode> DatabaseManager::getEpisodesByMovies(const QList<Movie> &movieList)
 {
-    QList<Episode> l_episodeList;
+    QHash<int, Movie> l_movieHash;
+    l_movieHash.reserve(movieList.size());
+    foreach (Movie l_movie, movieList)
+    {
+        l_movieHash.insert(l_movie.id(), l_movie);
+    }
+    if (l_movieHash.isEmpty() || !fillTempIdList(l_movieHash.keys()))
+    {
+        return QList<Episode>();
+    }
 
-    QString l_queryText;
-    l_queryText = "SELECT " + m_episodeFields + ", " + m_showFields +
-                  "FROM episodes AS e "
-                  "LEFT JOIN show AS s "
-                  "ON s.id = e.id_show "
-                  "WHERE e.id_movie IN (";
+    return getEpisodesOfIdList(l_movieHash);
+}
 
-    foreach (Movie l_movie, movieList) {
-        l_queryText += QString::number(l_movie.id()) +',';
+/**
+ * @brief Gets the episodes of the movies having the given ids.
+ * The movies of the episodes are read without their people and tags.
+ *
+ * @param QList<int> movieIdList
+ * @return QList<Episode> ordered by show, season and number
+ */
+QList<Episode> DatabaseManager::getEpisodesByMovieIds(const QList<int> &movieIdList)
+{
+    QHash<int, Movie> l_movieHash;
+    if (movieIdList.isEmpty() || !fillTempIdList(movieIdList))
+    {
+        return QList<Episode>();
     }
 
-    if (l_queryText.endsWith(',')) {
-        l_queryText.remove(l_queryText.count()-1,1);
+    // Only the movies that are episodes are read.
+    // The temporary table has no statistics: CROSS JOIN makes it the outer loop.
+    QSqlQuery l_query(readDB());
+    l_query.prepare("SELECT " + m_movieFields +
+                    "FROM temp.id_list AS l "
+                    "CROSS JOIN episodes AS e ON e.id_movie = l.id "
+                    "JOIN movies AS m ON m.id = l.id");
+    if (!execQuery(l_query, Q_FUNC_INFO))
+    {
+        Macaw::DEBUG("In getEpisodesByMovieIds:");
+        Macaw::DEBUG(l_query.lastError().text());
     }
-    l_queryText += ") ORDER BY s.name, e.season, e.number";
 
-    QSqlQuery l_query(m_db);
-    l_query.prepare(l_queryText);
+    while (l_query.next())
+    {
+        Movie l_movie = hydrateMovieOnly(l_query);
+        l_movieHash.insert(l_movie.id(), l_movie);
+    }
+
+    return getEpisodesOfIdList(l_movieHash);
+}
+
+/**
+ * @brief Gets the episodes of the movies whose ids are in the temporary table
+ * `id_list`, filled by fillTempIdList(), and sets the movies of `movieHash` to them.
+ *
+ * @param QHash<int, Movie> movieHash, movies by id
+ * @return QList<Episode> ordered by show, season and number
+ */
+QList<Episode> DatabaseManager::getEpisodesOfIdList(const QHash<int, Movie> &movieHash)
+{
+    QList<Episode> l_episodeList;
+    if (movieHash.isEmpty())
+    {
+        return l_episodeList;
+    }
+
+    QSqlQuery l_query(readDB());
+    l_query.prepare("SELECT " + m_episodeFields + ", " + m_showFields +
+                    "FROM temp.id_list AS l "
+                    "CROSS JOIN episodes AS e ON e.id_movie = l.id "
+                    "LEFT JOIN show AS s ON s.id = e.id_show "
+                    "ORDER BY s.name, e.season, e.number");
 
-    if (!l_query.exec())
+    if (!execQuery(l_query, Q_FUNC_INFO))
     {
-        Macaw::DEBUG("In getEpisodesByMovies:");
+        Macaw::DEBUG("In getEpisodesOfIdList:");
         Macaw::DEBUG(l_query.lastError().text());
     }
 
     while(l_query.next())
     {
-        foreach (Movie l_movie, movieList) {
-            if (l_movie.id() == l_query.value(4)) {
-                l_episodeList.append(hydrateEpisode(l_query, l_movie));
-                movieList.removeOne(l_movie);
-                break;
-            }
-        }
+        l_episodeList.append(hydrateEpisode(l_query, movieHash.value(l_query.value(4).toInt())));
     }
 
     return l_episodeList;
 }
+
+/**
+ * @brief Replaces the content of the temporary table `id_list` by `idList`,
+ * so that a query can join it instead of using a long `IN (...)` list.
+ * The table belongs to the connection given by readDB(): the query must use it too.
+ *
+ * @param QList<int> idList
+ * @return bool
+ */
+bool DatabaseManager::fillTempIdList(const QList<int> &idList)
+{
+    QSqlQuery l_query(readDB());
+    bool l_ret = execQuery(l_query, "CREATE TEMP TABLE IF NOT EXISTS id_list(id INTEGER PRIMARY KEY)",
+                           Q_FUNC_INFO, TempTables)
+                 && execQuery(l_query, "DELETE FROM temp.id_list", Q_FUNC_INFO, TempTables);
+
+    QVariantList l_idList;
+    l_idList.reserve(idList.size());
+    foreach (int l_id, idList)
+    {
+        l_idList.append(l_id);
+    }
+
+    // One statement run for every id, in a single transaction of the temporary database
+    if (l_ret && !l_idList.isEmpty())
+    {
+        l_ret = execQuery(l_query, "SAVEPOINT id_list", Q_FUNC_INFO, TempTables);
+        l_ret = l_ret && l_query.prepare("INSERT OR IGNORE INTO temp.id_list(id) VALUES (?)");
+        l_query.addBindValue(l_idList);
+        l_ret = l_ret && execBatchQuery(l_query, Q_FUNC_INFO, TempTables);
+        if (!l_ret)
+        {
+            execQuery(l_query, "ROLLBACK TO id_list", Q_FUNC_INFO, TempTables);
+        }
+        l_ret = execQuery(l_query, "RELEASE id_list", Q_FUNC_INFO, TempTables) && l_ret;
+    }
+
+    if (!l_ret)
+    {
+        Macaw::DEBUG("In fillTempIdList:");
+        Macaw::DEBUG(l_query.lastError().text());
+    }
+
+    return l_ret;
+}
+
 /*
 QList<Episode> DatabaseManager::getEpisodesByPeople(const int id, const int type, const QString fieldOrder)
 {
@@ -605,6 +1100,7 @@ QList<Episode> DatabaseManager::getEpisodesNotImported(const QString fieldOrder)
 */
 /**
  * @brief Gets the one person that has the id `id`
+ * Served from m_peopleCache when nothing was written since the last read.
  *
  * @param int id of the person
  * @return People
@@ -612,14 +1108,19 @@ QList<Episode> DatabaseManager::getEpisodesNotImported(const QString fieldOrder)
 People DatabaseManager::getOnePeopleById(const int id)
 {
     People l_people;
-    QSqlQuery l_query(m_db);
+    int l_generation = writeGeneration();
+    if (m_peopleCache.find(id, l_generation, l_people))
+    {
+        return l_people;
+    }
 
-    l_query.prepare("SELECT " + m_peopleFields +
-                    "FROM people AS p "
-                    "WHERE p.id = :id ");
+    QSqlQuery l_query = cachedQuery("SELECT " + m_peopleFields +
+                                    "FROM people AS p "
+                                    "WHERE p.id = :id ",
+                                    readDB());
     l_query.bindValue(":id", id);
 
-    if (!l_query.exec())
+    if (!execQuery(l_query, Q_FUNC_INFO))
     {
         Macaw::DEBUG("In getOnePeopleById(int):");
         Macaw::DEBUG(l_query.lastError().text());
@@ -628,7 +1129,9 @@ People DatabaseManager::getOnePeopleById(const int id)
     if(l_query.next())
     {
         l_people = hydratePeople(l_query);
+        m_peopleCache.insert(id, l_generation, l_people);
     }
+    l_query.finish();
 
     return l_people;
 }
@@ -643,15 +1146,14 @@ People DatabaseManager::getOnePeopleById(const int id)
 People DatabaseManager::getOnePeopleById(const int id, const int type)
 {
     People l_people;
-    QSqlQuery l_query(m_db);
-
-    l_query.prepare("SELECT " + m_peopleFields +
-                    "FROM people AS p, movies_people AS pm "
-                    "WHERE p.id = :id AND pm.id_people = p.id AND pm.type = :type ");
+    QSqlQuery l_query = cachedQuery("SELECT " + m_peopleFields +
+                                    "FROM people AS p, movies_people AS pm "
+                                    "WHERE p.id = :id AND pm.id_people = p.id AND pm.type = :type ",
+                                    readDB());
     l_query.bindValue(":id", id);
     l_query.bindValue(":type", type);
 
-    if (!l_query.exec())
+    if (!execQuery(l_query, Q_FUNC_INFO))
     {
         Macaw::DEBUG("In getOnePeopleById(int, type):");
         Macaw::DEBUG(l_query.lastError().text());
@@ -661,6 +1163,7 @@ People DatabaseManager::getOnePeopleById(const int id, const int type)
     {
         l_people = hydratePeople(l_query);
     }
+    l_query.finish();
 
     return l_people;
 }
@@ -674,14 +1177,13 @@ People DatabaseManager::getOnePeopleById(const int id, const int type)
 People DatabaseManager::getOnePeopleByName(const QString name)
 {
     People l_people;
-    QSqlQuery l_query(m_db);
-
-    l_query.prepare("SELECT " + m_peopleFields +
-                    "FROM people AS p "
-                    "WHERE p.name = :name ");
+    QSqlQuery l_query = cachedQuery("SELECT " + m_peopleFields +
+                                    "FROM people AS p "
+                                    "WHERE p.name = :name ",
+                                    readDB());
     l_query.bindValue(":name", name);
 
-    if (!l_query.exec())
+    if (!execQuery(l_query, Q_FUNC_INFO))
     {
         Macaw::DEBUG("In getOnePeopleByName():");
         Macaw::DEBUG(l_query.lastError().text());
@@ -691,6 +1193,7 @@ People DatabaseManager::getOnePeopleByName(const QString name)
     {
         l_people = hydratePeople(l_query);
     }
+    l_query.finish();
 
     return l_people;
 }
@@ -706,7 +1209,7 @@ QList<People> DatabaseManager::getPeopleUsedByType(const int type,
                                             const QString fieldOrder)
 {
     QList<People> l_peopleList;
-    QSqlQuery l_query(m_db);
+    QSqlQuery l_query(readDB());
 
     l_query.prepare("SELECT " + m_peopleFields +
                     "FROM people AS p "
@@ -714,7 +1217,7 @@ QList<People> DatabaseManager::getPeopleUsedByType(const int type,
                     "ORDER BY " + fieldOrder);
     l_query.bindValue(":type", type);
 
-    if (!l_query.exec())
+    if (!execQuery(l_query, Q_FUNC_INFO))
     {
         Macaw::DEBUG("In getPeopleUsedByType():");
         Macaw::DEBUG(l_query.lastError().text());
@@ -742,7 +1245,7 @@ QList<People> DatabaseManager::getPeopleByName(const QString name,
                                                const QString fieldOrder)
 {
     QList<People> l_peopleList;
-    QSqlQuery l_query(m_db);
+    QSqlQuery l_query(readDB());
 
     l_query.prepare("SELECT " + m_peopleFields +
                     "FROM people AS p "
@@ -750,7 +1253,7 @@ QList<People> DatabaseManager::getPeopleByName(const QString name,
                     "ORDER BY " + fieldOrder);
     l_query.bindValue(":name", name);
 
-    if (!l_query.exec())
+    if (!execQuery(l_query, Q_FUNC_INFO))
     {
         Macaw::DEBUG("In getPeopleByName(QString):");
         Macaw::DEBUG(l_query.lastError().text());
@@ -773,7 +1276,7 @@ QList<People> DatabaseManager::getPeopleByMovie(const Movie &movie,
                                const QString fieldOrder)
 {
     QList<People> l_peopleList;
-    QSqlQuery l_query(m_db);
+    QSqlQuery l_query(readDB());
 
     l_query.prepare("SELECT " + m_peopleFields +", mp.type "
                     "FROM people AS p, movies_people AS mp "
@@ -784,7 +1287,7 @@ QList<People> DatabaseManager::getPeopleByMovie(const Movie &movie,
     l_query.bindValue(":type", type);
     l_query.bindValue(":id_movie", movie.id());
 
-    if (!l_query.exec())
+    if (!execQuery(l_query, Q_FUNC_INFO))
     {
         Macaw::DEBUG("In getPeopleByMovie:");
         Macaw::DEBUG(l_query.lastError().text());
@@ -799,24 +1302,141 @@ QList<People> DatabaseManager::getPeopleByMovie(const Movie &movie,
     return l_peopleList;
 }
 
-QList<People> DatabaseManager::getPeopleByAny(QString text, int type, QString fieldOrder)
+/**
+ * @brief Gets the people of several movies in one query
+ *
+ * @param QList<int> ids of the movies
+ * @param int type of the people, 0 (People::None) to get every type
+ * @return QHash<int, QList<People> > people of each movie, by movie id
+ */
+QHash<int, QList<People> > DatabaseManager::getPeopleByMovieIds(const QList<int> &movieIdList,
+                                                                const int type)
 {
-    Macaw::DEBUG("[DatabaseManager] Enters getPeopleByAny");
-    QList<People> l_peopleList;
-    QSqlQuery l_query(m_db);
-    QStringList l_splittedText = text.split(' ');
+    QHash<int, QList<People> > l_peopleHash;
+    if (movieIdList.isEmpty())
+    {
+        return l_peopleHash;
+    }
 
-    QString l_queryText = "SELECT " + m_peopleFields + " FROM people AS p WHERE ";
-    for( int i = 0 ; i < l_splittedText.size() ; i++)
+    QString l_queryText = "SELECT " + m_peopleFields + ", mp.type, mp.id_movie "
+                          "FROM people AS p, movies_people AS mp "
+                          "WHERE mp.id_people = p.id "
+                            "AND mp.id_movie IN (" + idListToString(movieIdList) + ") ";
+    if (type != People::None)
     {
-        if (i != 0)
-        {
-            l_queryText += "AND ";
-        }
-    l_queryText = l_queryText
-            + '(' +
-                    "p.name LIKE '%'||:text"+ QString::number(i) +"||'%' "
-                 "OR ( "
+        l_queryText += "AND mp.type = :type ";
+    }
+    l_queryText += "ORDER BY p.name";
+
+    QSqlQuery l_query(readDB());
+    l_query.setForwardOnly(true);
+    l_query.prepare(l_queryText);
+    l_query.bindValue(":type", type);
+
+    if (!execQuery(l_query, Q_FUNC_INFO))
+    {
+        Macaw::DEBUG("In getPeopleByMovieIds():");
+        Macaw::DEBUG(l_query.lastError().text());
+    }
+
+    while(l_query.next())
+    {
+        People l_people = hydratePeople(l_query);
+        l_peopleHash[l_query.value(7).toInt()].append(l_people);
+    }
+
+    return l_peopleHash;
+}
+
+/**
+ * @brief Gets the people of type `type` whose name matches every word of `text`,
+ * or who appear in a movie whose title, original title or tags match every word of `text`.
+ * The people matching by name come first.
+ *
+ * @param text
+ * @param type
+ * @param fieldOrder
+ * @return QList<People>
+ */
+QList<People> DatabaseManager::getPeopleByAny(QString text, int type, QString fieldOrder)
+{
+    if (!m_searchEnabled) {
+
+        return getPeopleByAnyLike(text, type, fieldOrder);
+    }
+
+    QString l_match = searchMatchExpression(text);
+    if (l_match.isEmpty()) {
+
+        return getPeopleUsedByType(type, fieldOrder);
+    }
+
+    Macaw::DEBUG("[DatabaseManager] Enters getPeopleByAny");
+    QList<People> l_peopleList;
+    QSqlQuery l_query(readDB());
+    l_query.prepare("SELECT " + m_peopleFields + " "
+                    "FROM people AS p, ("
+                        "SELECT rowid AS id_people, bm25(search_people) AS score "
+                        "FROM search_people "
+                        "WHERE search_people MATCH :matchName "
+                        "UNION ALL "
+                        "SELECT mp.id_people, 0.0 "
+                        "FROM search_movies, movies_people AS mp "
+                        "WHERE search_movies MATCH :matchMovie "
+                          "AND mp.id_movie = search_movies.rowid "
+                    ") AS s "
+                    "WHERE p.id = s.id_people "
+                      "AND EXISTS (SELECT 1 FROM movies_people AS mpt "
+                                  "WHERE mpt.id_people = p.id AND mpt.type = :type) "
+                    "GROUP BY p.id "
+                    "ORDER BY MIN(s.score), p." + fieldOrder);
+    l_query.bindValue(":matchName", l_match);
+    l_query.bindValue(":matchMovie", searchMatchExpression(text, "title original_title tags"));
+    l_query.bindValue(":type", type);
+
+    if (!execQuery(l_query, Q_FUNC_INFO))
+    {
+        Macaw::DEBUG("In getPeopleByAny():");
+        Macaw::DEBUG(l_query.lastError().text());
+    }
+
+    while(l_query.next())
+    {
+        People l_people = hydratePeople(l_query);
+        l_peopleList.append(l_people);
+    }
+
+    Macaw::DEBUG("[DatabaseManager] getPeopleByAny returns "
+          + QString::number(l_peopleList.count()) + " people");
+
+    return l_peopleList;
+}
+
+/**
+ * @brief Same as getPeopleByAny() without the full-text search index (slow)
+ * @param text
+ * @param type
+ * @param fieldOrder
+ * @return
+ */
+QList<People> DatabaseManager::getPeopleByAnyLike(QString text, int type, QString fieldOrder)
+{
+    Macaw::DEBUG("[DatabaseManager] Enters getPeopleByAnyLike");
+    QList<People> l_peopleList;
+    QSqlQuery l_query(readDB());
+    QStringList l_splittedText = text.split(' ');
+
+    QString l_queryText = "SELECT " + m_peopleFields + " FROM people AS p WHERE ";
+    for( int i = 0 ; i < l_splittedText.size() ; i++)
+    {
+        if (i != 0)
+        {
+            l_queryText += "AND ";
+        }
+    l_queryText = l_queryText
+            + '(' +
+                    "p.name LIKE '%'||:text"+ QString::number(i) +"||'%' "
+                 "OR ( "
                       "SELECT COUNT(*) "
                       "FROM movies AS m "
                       "WHERE (m.title LIKE '%'||:text"+ QString::number(i) +"||'%' OR m.original_title LIKE '%'||:text"+ QString::number(i) +"||'%' ) "
@@ -841,7 +1461,7 @@ QList<People> DatabaseManager::getPeopleByAny(QString text, int type, QString fi
     }
     l_query.bindValue(":type", type);
 
-    if (!l_query.exec())
+    if (!execQuery(l_query, Q_FUNC_INFO))
     {
         Macaw::DEBUG("In getPeopleByAny():");
         Macaw::DEBUG(l_query.lastError().text());
@@ -861,6 +1481,7 @@ QList<People> DatabaseManager::getPeopleByAny(QString text, int type, QString fi
 
 /**
  * @brief Gets the tag which id is `id`
+ * Served from m_tagCache when nothing was written since the last read.
  *
  * @param int id
  * @return Tag
@@ -869,13 +1490,19 @@ Tag DatabaseManager::getOneTagById(const int id)
 {
     Macaw::DEBUG("[DatabaseManager] Enters getOneTagById");
     Tag l_tag;
-    QSqlQuery l_query(m_db);
-    l_query.prepare("SELECT id, name "
-                    "FROM tags "
-                    "WHERE id = :id");
+    int l_generation = writeGeneration();
+    if (m_tagCache.find(id, l_generation, l_tag))
+    {
+        return l_tag;
+    }
+
+    QSqlQuery l_query = cachedQuery("SELECT id, name "
+                                    "FROM tags "
+                                    "WHERE id = :id",
+                                    readDB());
     l_query.bindValue(":id", id);
 
-    if (!l_query.exec())
+    if (!execQuery(l_query, Q_FUNC_INFO))
     {
         Macaw::DEBUG("In getOneTagBy(int):");
         Macaw::DEBUG(l_query.lastError().text());
@@ -885,7 +1512,9 @@ Tag DatabaseManager::getOneTagById(const int id)
     {
         l_tag.setId(l_query.value(0).toInt());
         l_tag.setName(l_query.value(1).toString());
+        m_tagCache.insert(id, l_generation, l_tag);
     }
+    l_query.finish();
 
     return l_tag;
 }
@@ -899,13 +1528,13 @@ Tag DatabaseManager::getOneTagById(const int id)
 Tag DatabaseManager::getOneTagByName(QString tagName)
 {
     Tag l_tag;
-    QSqlQuery l_query(m_db);
-    l_query.prepare("SELECT id, name "
-                    "FROM tags "
-                    "WHERE name = :name");
+    QSqlQuery l_query = cachedQuery("SELECT id, name "
+                                    "FROM tags "
+                                    "WHERE name = :name",
+                                    readDB());
     l_query.bindValue(":name", tagName);
 
-    if (!l_query.exec())
+    if (!execQuery(l_query, Q_FUNC_INFO))
     {
         Macaw::DEBUG("In tagByName(QString):");
         Macaw::DEBUG(l_query.lastError().text());
@@ -916,6 +1545,7 @@ Tag DatabaseManager::getOneTagByName(QString tagName)
         l_tag.setId(l_query.value(0).toInt());
         l_tag.setName(l_query.value(1).toString());
     }
+    l_query.finish();
 
     return l_tag;
 }
@@ -930,12 +1560,12 @@ QList<Tag> DatabaseManager::getAllTags(const QString fieldOrder)
 {
     Macaw::DEBUG("[DatabaseManager] Enters getAllTags");
     QList<Tag> l_tagList;
-    QSqlQuery l_query(m_db);
+    QSqlQuery l_query(readDB());
     l_query.prepare("SELECT id, name "
                     "FROM tags "
                     "ORDER BY " + fieldOrder);
 
-    if (!l_query.exec())
+    if (!execQuery(l_query, Q_FUNC_INFO))
     {
         Macaw::DEBUG("In getAllTags():");
         Macaw::DEBUG(l_query.lastError().text());
@@ -964,7 +1594,7 @@ QList<Tag> DatabaseManager::getTagsUsed(const QString fieldOrder)
 {
     Macaw::DEBUG("[DatabaseManager] Enters getTagsUsed");
     QList<Tag> l_tagList;
-    QSqlQuery l_query(m_db);
+    QSqlQuery l_query(readDB());
     l_query.prepare("SELECT " +m_tagFields+
                     "FROM tags AS t "
                     "WHERE ( "
@@ -974,7 +1604,7 @@ QList<Tag> DatabaseManager::getTagsUsed(const QString fieldOrder)
                     " ) > 0 "
                     "ORDER BY " + fieldOrder);
 
-    if (!l_query.exec())
+    if (!execQuery(l_query, Q_FUNC_INFO))
     {
         Macaw::DEBUG(m_tagFields);
         Macaw::DEBUG("In getTagsUsed():");
@@ -995,11 +1625,77 @@ QList<Tag> DatabaseManager::getTagsUsed(const QString fieldOrder)
     return l_tagList;
 }
 
+/**
+ * @brief Gets the tags whose name matches every word of `text`,
+ * or used by a movie whose title, original title or people match every word of `text`.
+ * The tags matching by name come first.
+ *
+ * @param text
+ * @param fieldOrder
+ * @return QList<Tag>
+ */
 QList<Tag> DatabaseManager::getTagsByAny(const QString text, const QString fieldOrder)
 {
+    if (!m_searchEnabled) {
+
+        return getTagsByAnyLike(text, fieldOrder);
+    }
+
+    QString l_match = searchMatchExpression(text);
+    if (l_match.isEmpty()) {
+
+        return getAllTags(fieldOrder);
+    }
+
     Macaw::DEBUG("[DatabaseManager] Enters tagsByAny");
     QList<Tag> l_tagList;
-    QSqlQuery l_query(m_db);
+    QSqlQuery l_query(readDB());
+    l_query.prepare("SELECT " + m_tagFields + " "
+                    "FROM tags AS t, ("
+                        "SELECT rowid AS id_tag, bm25(search_tags) AS score "
+                        "FROM search_tags "
+                        "WHERE search_tags MATCH :matchName "
+                        "UNION ALL "
+                        "SELECT mt.id_tag, 0.0 "
+                        "FROM search_movies, movies_tags AS mt "
+                        "WHERE search_movies MATCH :matchMovie "
+                          "AND mt.id_movie = search_movies.rowid "
+                    ") AS s "
+                    "WHERE t.id = s.id_tag "
+                    "GROUP BY t.id "
+                    "ORDER BY MIN(s.score), t." + fieldOrder);
+    l_query.bindValue(":matchName", l_match);
+    l_query.bindValue(":matchMovie", searchMatchExpression(text, "title original_title people"));
+
+    if (!execQuery(l_query, Q_FUNC_INFO))
+    {
+        Macaw::DEBUG("In tagsByAny():");
+        Macaw::DEBUG(l_query.lastError().text());
+    }
+
+    while(l_query.next())
+    {
+        Tag l_tag = hydrateTag(l_query);
+        l_tagList.append(l_tag);
+    }
+
+    Macaw::DEBUG("[DatabaseManager] tagsByAny returns "
+          + QString::number(l_tagList.count()) + " tags");
+
+    return l_tagList;
+}
+
+/**
+ * @brief Same as getTagsByAny() without the full-text search index (slow)
+ * @param text
+ * @param fieldOrder
+ * @return
+ */
+QList<Tag> DatabaseManager::getTagsByAnyLike(const QString text, const QString fieldOrder)
+{
+    Macaw::DEBUG("[DatabaseManager] Enters tagsByAnyLike");
+    QList<Tag> l_tagList;
+    QSqlQuery l_query(readDB());
     QStringList l_splittedText = text.split(' ');
 
     QString l_queryText = "SELECT " + m_tagFields + " FROM tags AS t WHERE ";
@@ -1037,7 +1733,7 @@ QList<Tag> DatabaseManager::getTagsByAny(const QString text, const QString field
         l_query.bindValue(":text"+ QString::number(i), l_splittedText.at(i));
     }
 
-    if (!l_query.exec())
+    if (!execQuery(l_query, Q_FUNC_INFO))
     {
         Macaw::DEBUG("In tagsByAny():");
         Macaw::DEBUG(l_query.lastError().text());
@@ -1055,8 +1751,46 @@ QList<Tag> DatabaseManager::getTagsByAny(const QString text, const QString field
     return l_tagList;
 }
 
+/**
+ * @brief Gets the tags of several movies in one query
+ *
+ * @param QList<int> ids of the movies
+ * @return QHash<int, QList<Tag> > tags of each movie, by movie id
+ */
+QHash<int, QList<Tag> > DatabaseManager::getTagsByMovieIds(const QList<int> &movieIdList)
+{
+    QHash<int, QList<Tag> > l_tagHash;
+    if (movieIdList.isEmpty())
+    {
+        return l_tagHash;
+    }
+
+    QSqlQuery l_query(readDB());
+    l_query.setForwardOnly(true);
+    l_query.prepare("SELECT " + m_tagFields + ", mt.id_movie "
+                    "FROM tags AS t, movies_tags AS mt "
+                    "WHERE mt.id_tag = t.id "
+                      "AND mt.id_movie IN (" + idListToString(movieIdList) + ") "
+                    "ORDER BY t.name");
+
+    if (!execQuery(l_query, Q_FUNC_INFO))
+    {
+        Macaw::DEBUG("In getTagsByMovieIds():");
+        Macaw::DEBUG(l_query.lastError().text());
+    }
+
+    while(l_query.next())
+    {
+        Tag l_tag = hydrateTag(l_query);
+        l_tagHash[l_query.value(2).toInt()].append(l_tag);
+    }
+
+    return l_tagHash;
+}
+
 /**
  * @brief Get the playlist having the id `id`
+ * Served from m_playlistCache when nothing was written since the last read.
  *
  * @param int id of the playlist
  * @return Playlist
@@ -1064,13 +1798,19 @@ QList<Tag> DatabaseManager::getTagsByAny(const QString text, const QString field
 Playlist DatabaseManager::getOnePlaylistById(const int id)
 {
     Playlist l_playlist;
-    QSqlQuery l_query(m_db);
-    l_query.prepare("SELECT pl.id, pl.name, pl.rate, pl.creation_date "
-                    "FROM playlists AS pl "
-                    "WHERE pl.id = :id");
+    int l_generation = writeGeneration();
+    if (m_playlistCache.find(id, l_generation, l_playlist))
+    {
+        return l_playlist;
+    }
+
+    QSqlQuery l_query = cachedQuery("SELECT pl.id, pl.name, pl.rate, pl.creation_date "
+                                    "FROM playlists AS pl "
+                                    "WHERE pl.id = :id",
+                                    readDB());
     l_query.bindValue(":id", id);
 
-    if(!l_query.exec())
+    if(!execQuery(l_query, Q_FUNC_INFO))
     {
         Macaw::DEBUG("In getOnePlaylistById():");
         Macaw::DEBUG(l_query.lastError().text());
@@ -1079,7 +1819,9 @@ Playlist DatabaseManager::getOnePlaylistById(const int id)
     if(l_query.next())
     {
         l_playlist = hydratePlaylist(l_query);
+        m_playlistCache.insert(id, l_generation, l_playlist);
     }
+    l_query.finish();
 
     return l_playlist;
 }
@@ -1092,13 +1834,13 @@ Playlist DatabaseManager::getOnePlaylistById(const int id)
 QList<Playlist> DatabaseManager::getAllPlaylists(QString fieldOrder)
 {
     QList<Playlist> l_playlistList;
-    QSqlQuery l_query(m_db);
+    QSqlQuery l_query(readDB());
     l_query.prepare("SELECT pl.id, pl.name, pl.rate, pl.creation_date "
                     "FROM playlists AS pl "
                     "WHERE pl.id != 1 "
                     "ORDER BY pl." +fieldOrder);
 
-    if(!l_query.exec())
+    if(!execQuery(l_query, Q_FUNC_INFO))
     {
         Macaw::DEBUG("In getAllPlaylist():");
         Macaw::DEBUG(l_query.lastError().text());
@@ -1115,21 +1857,24 @@ QList<Playlist> DatabaseManager::getAllPlaylists(QString fieldOrder)
 
 bool DatabaseManager::isMovieInPlaylist(int movieId, int playlistId)
 {
-    QSqlQuery l_query(m_db);
-    l_query.prepare("SELECT id "
-                    "FROM movies_playlists "
-                    "WHERE id_movie = :id_movie "
-                        "AND id_playlist = :id_playlist");
+    QSqlQuery l_query = cachedQuery("SELECT id "
+                                    "FROM movies_playlists "
+                                    "WHERE id_movie = :id_movie "
+                                        "AND id_playlist = :id_playlist",
+                                    readDB());
     l_query.bindValue(":id_movie", movieId);
     l_query.bindValue(":id_playlist", playlistId);
 
-    if (!l_query.exec())
+    if (!execQuery(l_query, Q_FUNC_INFO))
     {
         Macaw::DEBUG("In isMovieInPlaylist():");
         Macaw::DEBUG(l_query.lastError().text());
     }
 
-    return l_query.next();
+    bool l_ret = l_query.next();
+    l_query.finish();
+
+    return l_ret;
 }
 
 bool DatabaseManager::isMovieInPlaylist(Movie &movie, int playlistId)
@@ -1142,47 +1887,268 @@ bool DatabaseManager::isMovieInPlaylist(Movie &movie, Playlist &playlist)
     return isMovieInPlaylist(movie.id(), playlist.id());
 }
 
+/**
+ * @brief Gets the ids of all the movies of a playlist
+ *
+ * @param int id of the playlist
+ * @return QSet<int>
+ */
+QSet<int> DatabaseManager::getMovieIdsByPlaylist(const int playlistId)
+{
+    QSet<int> l_movieIdSet;
+    QSqlQuery l_query(readDB());
+    l_query.prepare("SELECT id_movie "
+                    "FROM movies_playlists "
+                    "WHERE id_playlist = :id_playlist");
+    l_query.bindValue(":id_playlist", playlistId);
+
+    if (!execQuery(l_query, Q_FUNC_INFO))
+    {
+        Macaw::DEBUG("In getMovieIdsByPlaylist():");
+        Macaw::DEBUG(l_query.lastError().text());
+    }
+
+    while (l_query.next())
+    {
+        l_movieIdSet.insert(l_query.value(0).toInt());
+    }
+
+    return l_movieIdSet;
+}
+
 /**
  * @brief Retuns whether a movie is known by the database or not
  *
- * @param QString path of the movie
+ * @param int moviesPathId, id of the movies path of the file
+ * @param QString filePath of the movie, relative to the movies path
  * @return bool
  */
-bool DatabaseManager::existMovie(const QString filePath)
+bool DatabaseManager::existMovie(const int moviesPathId, const QString &filePath)
 {
-    QSqlQuery l_query(m_db);
-    l_query.prepare("SELECT id FROM movies WHERE file_path = :file_path ");
+    QSqlQuery l_query = cachedQuery("SELECT id FROM movies "
+                                    "WHERE id_path = :id_path AND file_path = :file_path ",
+                                    readDB());
+    l_query.bindValue(":id_path", moviesPathId);
     l_query.bindValue(":file_path", filePath);
 
-    if (!l_query.exec())
+    if (!execQuery(l_query, Q_FUNC_INFO))
     {
         Macaw::DEBUG("In existMovie():");
         Macaw::DEBUG(l_query.lastError().text());
     }
 
-    return l_query.next();
+    bool l_ret = l_query.next();
+    l_query.finish();
+
+    return l_ret;
 }
 
 /**
- * @brief Retuns whether a person is known by the database or not
+ * @brief Gets the files of all the movies in one query, so that many files
+ * can be checked in memory instead of calling existMovie() for each of them
  *
- * @param QString fullname of the person
- * @return bool
+ * @return QHash<int, QSet<QString> > paths of the files relative to their
+ * movies path, by id of movies path
  */
-bool DatabaseManager::existPeople(const QString name)
+QHash<int, QSet<QString> > DatabaseManager::getKnownMovieFiles()
 {
-    QSqlQuery l_query(m_db);
-    l_query.prepare("SELECT id FROM people AS p "
-                    "WHERE p.name = :name");
-    l_query.bindValue(":name", name);
+    QHash<int, QSet<QString> > l_knownFileHash;
+    QSqlQuery l_query(readDB());
+    l_query.setForwardOnly(true);
+    l_query.prepare("SELECT id_path, file_path FROM movies");
+
+    if (!execQuery(l_query, Q_FUNC_INFO))
+    {
+        Macaw::DEBUG("In getKnownMovieFiles():");
+        Macaw::DEBUG(l_query.lastError().text());
+
+        return l_knownFileHash;
+    }
+
+    while (l_query.next())
+    {
+        l_knownFileHash[l_query.value(0).toInt()].insert(l_query.value(1).toString());
+    }
+
+    return l_knownFileHash;
+}
+
+/**
+ * @brief Gets the movies whose file was not found by the last scans,
+ * see setMoviesMissing()
+ *
+ * @return QHash<int, QHash<QString, int> > ids of the movies, by relative path of
+ * their file, by movies path id
+ */
+QHash<int, QHash<QString, int> > DatabaseManager::getMissingMovieFiles()
+{
+    QHash<int, QHash<QString, int> > l_missingFileHash;
+    QSqlQuery l_query(readDB());
+    l_query.setForwardOnly(true);
+    l_query.prepare("SELECT id_path, file_path, id FROM movies "
+                    "WHERE missing_since IS NOT NULL");
+
+    if (!execQuery(l_query, Q_FUNC_INFO))
+    {
+        Macaw::DEBUG("In getMissingMovieFiles():");
+        Macaw::DEBUG(l_query.lastError().text());
+
+        return l_missingFileHash;
+    }
+
+    while (l_query.next())
+    {
+        l_missingFileHash[l_query.value(0).toInt()].insert(l_query.value(1).toString(),
+                                                           l_query.value(2).toInt());
+    }
+
+    return l_missingFileHash;
+}
+
+/**
+ * @brief Gets the missing movies whose file had one of some fingerprints,
+ * to give them their file again once moved. See FileFingerprint.
+ *
+ * @param QList<QByteArray> fingerprintList
+ * @return QHash<QByteArray, int> ids of the movies by fingerprint, 0 when several
+ * movies had the same: copies of a same file cannot be told apart
+ */
+QHash<QByteArray, int> DatabaseManager::getMissingMoviesByFingerprint(const QList<QByteArray> &fingerprintList)
+{
+    QHash<QByteArray, int> l_movieIdHash;
+    QSqlQuery l_query(readDB());
+    l_query.setForwardOnly(true);
 
-    if (!l_query.exec())
+    // 500 fingerprints per statement, under the limit of 999 parameters of SQLite
+    for (int l_begin = 0 ; l_begin < fingerprintList.size() ; l_begin += 500)
     {
-        Macaw::DEBUG("In existPeople():");
+        int l_end = qMin(l_begin + 500, fingerprintList.size());
+        QStringList l_valueList;
+        for (int i = l_begin ; i < l_end ; i++)
+        {
+            l_valueList << "?";
+        }
+
+        l_query.prepare("SELECT fingerprint, id FROM movies "
+                        "WHERE missing_since IS NOT NULL "
+                          "AND fingerprint IN (" + l_valueList.join(", ") + ")");
+        for (int i = l_begin ; i < l_end ; i++)
+        {
+            l_query.addBindValue(fingerprintList.at(i));
+        }
+
+        if (!execQuery(l_query, Q_FUNC_INFO))
+        {
+            Macaw::DEBUG("In getMissingMoviesByFingerprint():");
+            Macaw::DEBUG(l_query.lastError().text());
+
+            return l_movieIdHash;
+        }
+
+        while (l_query.next())
+        {
+            QByteArray l_fingerprint = l_query.value(0).toByteArray();
+            l_movieIdHash.insert(l_fingerprint, l_movieIdHash.contains(l_fingerprint)
+                                                ? 0 : l_query.value(1).toInt());
+        }
+    }
+
+    return l_movieIdHash;
+}
+
+/**
+ * @brief Gets the fingerprints of the files of some movies, see FileFingerprint
+ *
+ * @param QList<int> movieIdList
+ * @return QHash<int, QByteArray> fingerprints by movie id, without the movies
+ * having none
+ */
+QHash<int, QByteArray> DatabaseManager::getFingerprintsByMovieIds(const QList<int> &movieIdList)
+{
+    QHash<int, QByteArray> l_fingerprintHash;
+    if (movieIdList.isEmpty())
+    {
+        return l_fingerprintHash;
+    }
+
+    QSqlQuery l_query(readDB());
+    l_query.setForwardOnly(true);
+    l_query.prepare("SELECT id, fingerprint FROM movies "
+                    "WHERE fingerprint IS NOT NULL "
+                      "AND id IN (" + idListToString(movieIdList) + ")");
+
+    if (!execQuery(l_query, Q_FUNC_INFO))
+    {
+        Macaw::DEBUG("In getFingerprintsByMovieIds():");
         Macaw::DEBUG(l_query.lastError().text());
     }
 
-    return l_query.next();
+    while (l_query.next())
+    {
+        l_fingerprintHash.insert(l_query.value(0).toInt(), l_query.value(1).toByteArray());
+    }
+
+    return l_fingerprintHash;
+}
+
+/**
+ * @brief Gets the movies of a movies path whose file has no fingerprint yet
+ *
+ * @param int moviesPathId
+ * @return QList<Movie>
+ */
+QList<Movie> DatabaseManager::getMoviesWithoutFingerprint(const int moviesPathId)
+{
+    QList<Movie> l_movieList;
+    QSqlQuery l_query(readDB());
+    l_query.prepare("SELECT " + m_movieFields +
+                    "FROM movies AS m "
+                    "WHERE id_path = :id_path AND fingerprint IS NULL");
+    l_query.bindValue(":id_path", moviesPathId);
+
+    if (!execQuery(l_query, Q_FUNC_INFO))
+    {
+        Macaw::DEBUG("In getMoviesWithoutFingerprint():");
+        Macaw::DEBUG(l_query.lastError().text());
+    }
+
+    while(l_query.next())
+    {
+        l_movieList.append(hydrateMovieOnly(l_query));
+    }
+
+    return l_movieList;
+}
+
+/**
+ * @brief Gets the movies of a movies path whose file is missing since before a date
+ *
+ * @param int moviesPathId
+ * @param qint64 before, in milliseconds since the epoch
+ * @return QList<Movie>
+ */
+QList<Movie> DatabaseManager::getMoviesMissingSince(const int moviesPathId, const qint64 before)
+{
+    QList<Movie> l_movieList;
+    QSqlQuery l_query(readDB());
+    l_query.prepare("SELECT " + m_movieFields +
+                    "FROM movies AS m "
+                    "WHERE id_path = :id_path AND missing_since < :before");
+    l_query.bindValue(":id_path", moviesPathId);
+    l_query.bindValue(":before", before);
+
+    if (!execQuery(l_query, Q_FUNC_INFO))
+    {
+        Macaw::DEBUG("In getMoviesMissingSince():");
+        Macaw::DEBUG(l_query.lastError().text());
+    }
+
+    while(l_query.next())
+    {
+        l_movieList.append(hydrateMovieOnly(l_query));
+    }
+
+    return l_movieList;
 }
 
 /**
@@ -1193,17 +2159,20 @@ bool DatabaseManager::existPeople(const QString name)
  */
 bool DatabaseManager::existTag(const QString name)
 {
-    QSqlQuery l_query(m_db);
-    l_query.prepare("SELECT id FROM tags WHERE name = :name ");
+    QSqlQuery l_query = cachedQuery("SELECT id FROM tags WHERE name = :name ",
+                                    readDB());
     l_query.bindValue(":name", name);
 
-    if (!l_query.exec())
+    if (!execQuery(l_query, Q_FUNC_INFO))
     {
         Macaw::DEBUG("In existTag():");
         Macaw::DEBUG(l_query.lastError().text());
     }
 
-    return l_query.next();
+    bool l_ret = l_query.next();
+    l_query.finish();
+
+    return l_ret;
 }
 
 /**
@@ -1212,13 +2181,13 @@ bool DatabaseManager::existTag(const QString name)
  */
 void DatabaseManager::setPeopleToMovie(Movie &movie)
 {
-    QSqlQuery l_query(m_db);
-    l_query.prepare("SELECT " + m_peopleFields + ", pm.type "
-                    "FROM people AS p, movies_people AS pm "
-                    "WHERE pm.id_movie = :id_movie AND pm.id_people = p.id");
+    QSqlQuery l_query = cachedQuery("SELECT " + m_peopleFields + ", pm.type "
+                                    "FROM people AS p, movies_people AS pm "
+                                    "WHERE pm.id_movie = :id_movie AND pm.id_people = p.id",
+                                    readDB());
     l_query.bindValue(":id_movie", movie.id());
 
-    if (!l_query.exec())
+    if (!execQuery(l_query, Q_FUNC_INFO))
     {
         Macaw::DEBUG("In setPeopleToMovie(Movie):");
         Macaw::DEBUG(l_query.lastError().text());
@@ -1228,6 +2197,7 @@ void DatabaseManager::setPeopleToMovie(Movie &movie)
         People l_people = hydratePeople(l_query);
         movie.addPeople(l_people);
     }
+    l_query.finish();
 }
 
 /**
@@ -1236,13 +2206,13 @@ void DatabaseManager::setPeopleToMovie(Movie &movie)
  */
 void DatabaseManager::setTagsToMovie(Movie &movie)
 {
-    QSqlQuery l_query(m_db);
-    l_query.prepare("SELECT " + m_tagFields +
-                    "FROM tags AS t, movies_tags AS tm "
-                    "WHERE tm.id_movie = :id_movie AND tm.id_tag = t.id");
+    QSqlQuery l_query = cachedQuery("SELECT " + m_tagFields +
+                                    "FROM tags AS t, movies_tags AS tm "
+                                    "WHERE tm.id_movie = :id_movie AND tm.id_tag = t.id",
+                                    readDB());
     l_query.bindValue(":id_movie", movie.id());
 
-    if (!l_query.exec())
+    if (!execQuery(l_query, Q_FUNC_INFO))
     {
         Macaw::DEBUG("In setTagToMovie(Movie):");
         Macaw::DEBUG(l_query.lastError().text());
@@ -1254,6 +2224,68 @@ void DatabaseManager::setTagsToMovie(Movie &movie)
         l_tag.setName(l_query.value(1).toString());
         movie.addTag(l_tag);
     }
+    l_query.finish();
+}
+
+/**
+ * @brief Gets the people and the tags of a list of movies and adds them to the objects.
+ * Only two queries are run, whatever the size of the list.
+ *
+ * @param QList<Movie>
+ */
+void DatabaseManager::setPeopleAndTagsToMovies(QList<Movie> &movieList)
+{
+    QList<int> l_movieIdList;
+    foreach (Movie l_movie, movieList)
+    {
+        l_movieIdList.append(l_movie.id());
+    }
+
+    QHash<int, QList<People> > l_peopleHash = getPeopleByMovieIds(l_movieIdList);
+    QHash<int, QList<Tag> > l_tagHash = getTagsByMovieIds(l_movieIdList);
+
+    for (int i = 0 ; i < movieList.size() ; i++)
+    {
+        Movie &l_movie = movieList[i];
+        l_movie.setPeopleList(l_peopleHash.value(l_movie.id()));
+        l_movie.setTagList(l_tagHash.value(l_movie.id()));
+    }
+}
+
+/**
+ * @brief Builds a comma separated list of ids, to be used in a `IN (...)` clause
+ *
+ * @param QList<int>
+ * @return QString
+ */
+QString DatabaseManager::idListToString(const QList<int> &idList)
+{
+    QStringList l_idStringList;
+    foreach (int l_id, idList)
+    {
+        l_idStringList.append(QString::number(l_id));
+    }
+
+    return l_idStringList.join(',');
+}
+
+/**
+ * @brief Splits a list of ids into lists of 500 ids at most, so that the
+ * `IN (...)` clauses made by idListToString() stay short whatever the size
+ * of the library
+ *
+ * @param QList<int>
+ * @return QList<QList<int> >
+ */
+QList<QList<int> > DatabaseManager::splitIdList(const QList<int> &idList)
+{
+    QList<QList<int> > l_idListList;
+    for (int l_begin = 0 ; l_begin < idList.size() ; l_begin += 500)
+    {
+        l_idListList.append(idList.mid(l_begin, 500));
+    }
+
+    return l_idListList;
 }
 
 /**
@@ -1262,22 +2294,24 @@ void DatabaseManager::setTagsToMovie(Movie &movie)
  */
 void DatabaseManager::setMoviesToPlaylist(Playlist &playlist)
 {
-    QSqlQuery l_query(m_db);
+    QSqlQuery l_query(readDB());
     l_query.prepare("SELECT " +m_movieFields +
                     "FROM movies AS m, movies_playlists AS plm "
                     "WHERE plm.id_movie = m.id AND plm.id_playlist = :id_playlist");
     l_query.bindValue(":id_playlist", playlist.id());
 
-    if (!l_query.exec())
+    if (!execQuery(l_query, Q_FUNC_INFO))
     {
         Macaw::DEBUG("In setMoviesToPlaylist():");
         Macaw::DEBUG(l_query.lastError().text());
     }
+    QList<Movie> l_movieList;
     while (l_query.next())
     {
-        Movie l_movie = hydrateMovie(l_query);
-        playlist.addMovie(l_movie);
+        l_movieList.append(hydrateMovieOnly(l_query));
     }
+    setPeopleAndTagsToMovies(l_movieList);
+    playlist.setMovieList(l_movieList);
 }
 
 /**
@@ -1286,13 +2320,13 @@ void DatabaseManager::setMoviesToPlaylist(Playlist &playlist)
  */
 void DatabaseManager::setMovieToEpisode(Episode &episode)
 {
-    QSqlQuery l_query(m_db);
+    QSqlQuery l_query(readDB());
     l_query.prepare("SELECT " +m_movieFields +
                     "FROM movies AS m, episodes AS e "
                     "WHERE e.id_movie = m.id AND e.id = :id");
     l_query.bindValue(":id", episode.id());
 
-    if (!l_query.exec())
+    if (!execQuery(l_query, Q_FUNC_INFO))
     {
         Macaw::DEBUG("In setMovieToEpisode():");
         Macaw::DEBUG(l_query.lastError().text());
@@ -33,13 +33,13 @@
 /**
  * @brief Adds a movie to the database
  *
- * @param Movie
+ * @param Movie, its id is set; 0 if its file is already in the database
  * @return bool
  */
 bool DatabaseManager::insertNewMovie(Movie &movie, int moviesPathId)
 {
-    QSqlQuery l_query(m_db);
-    l_query.prepare("INSERT INTO movies ("
+    bumpWriteGeneration();
+    QSqlQuery l_query = cachedQuery("INSERT INTO movies ("
                                             "title, "
                                             "original_title, "
                                             "release_date, "
@@ -76,7 +76,7 @@ bool DatabaseManager::insertNewMovie(Movie &movie, int moviesPathId)
                                         ")");
     l_query.bindValue(":title", movie.title());
     l_query.bindValue(":original_title", movie.originalTitle()   );
-    l_query.bindValue(":release_date", movie.releaseDate().toString(DATE_FORMAT));
+    l_query.bindValue(":release_date", dateToDayNumber(movie.releaseDate()));
     l_query.bindValue(":country", movie.country());
     l_query.bindValue(":duration", movie.duration().msecsSinceStartOfDay());
     l_query.bindValue(":synopsis", movie.synopsis());
@@ -91,17 +91,29 @@ bool DatabaseManager::insertNewMovie(Movie &movie, int moviesPathId)
     l_query.bindValue(":id_tmdb", movie.tmdbId());
     l_query.bindValue(":show", movie.isShow());
 
-    if (!l_query.exec())
+    if (!execQuery(l_query, Q_FUNC_INFO))
     {
         Macaw::DEBUG("In insertNewMovie():");
         Macaw::DEBUG(l_query.lastError().text());
+        l_query.finish();
 
         return false;
     }
 
+    // The file is already in the database (UNIQUE ... ON CONFLICT IGNORE): lastInsertId() would be stale
+    if (l_query.numRowsAffected() == 0)
+    {
+        Macaw::DEBUG("[DatabaseManager] Movie already there: " + movie.fileRelativePath());
+        movie.setId(0);
+        l_query.finish();
+
+        return true;
+    }
+
     Macaw::DEBUG("[DatabaseManager] Movie added");
 
     movie.setId(l_query.lastInsertId().toInt());
+    l_query.finish();
 
     for(int i = 0 ; i < movie.peopleList().size() ; i++)
     {
@@ -115,6 +127,59 @@ bool DatabaseManager::insertNewMovie(Movie &movie, int moviesPathId)
     return true;
 }
 
+/**
+ * @brief Adds several movies to the database.
+ * The movies are inserted by groups of insertBatchSize(), each group in one transaction,
+ * so that the disk is synced once per group instead of once per movie.
+ *
+ * If a group fails, it is rolled back and the next groups are still inserted.
+ *
+ * @param QList<Movie> movies to add, their ids are set; 0 for the files already in the database
+ * @param int id of the path containing the movies
+ * @return QList<int> ids of the movies that were added
+ */
+QList<int> DatabaseManager::insertMovies(QList<Movie> &movieList, int moviesPathId)
+{
+    bumpWriteGeneration();
+    Macaw::DEBUG_IN("[DatabaseManager] Enters insertMovies");
+    QList<int> l_idList;
+
+    for (int l_begin = 0 ; l_begin < movieList.size() ; l_begin += m_insertBatchSize)
+    {
+        int l_end = qMin(l_begin + m_insertBatchSize, movieList.size());
+        QList<int> l_batchIdList;
+        bool l_ret = beginTransaction();
+
+        for (int i = l_begin ; l_ret && i < l_end ; i++)
+        {
+            l_ret = insertNewMovie(movieList[i], moviesPathId);
+            if (movieList[i].id() > 0)
+            {
+                l_batchIdList.append(movieList[i].id());
+            }
+        }
+
+        if (l_ret && commitTransaction())
+        {
+            l_idList.append(l_batchIdList);
+        }
+        else
+        {
+            Macaw::DEBUG("In insertMovies(): batch rolled back");
+            rollbackTransaction();
+            for (int i = l_begin ; i < l_end ; i++)
+            {
+                movieList[i].setId(0);
+            }
+        }
+    }
+
+    Macaw::DEBUG_OUT("[DatabaseManager] insertMovies added "
+                     + QString::number(l_idList.count()) + " movies");
+
+    return l_idList;
+}
+
 /**
  * @brief Adds a person to the database and links it to a movie
  *
@@ -124,6 +189,7 @@ bool DatabaseManager::insertNewMovie(Movie &movie, int moviesPathId)
  */
 bool DatabaseManager::addPeopleToMovie(People &people, Movie &movie, const int type)
 {
+    bumpWriteGeneration();
     if (!insertNewPeople(people))
     {
         return false;
@@ -135,7 +201,7 @@ bool DatabaseManager::addPeopleToMovie(People &people, Movie &movie, const int t
     l_query.bindValue(":id_movie", movie.id());
     l_query.bindValue(":type", type);
 
-    if (!l_query.exec())
+    if (!execQuery(l_query, Q_FUNC_INFO))
     {
         Macaw::DEBUG("In addPeopleToMovie():");
         Macaw::DEBUG(l_query.lastError().text());
@@ -155,6 +221,7 @@ bool DatabaseManager::addPeopleToMovie(People &people, Movie &movie, const int t
  */
 bool DatabaseManager::addTagToMovie(Tag &tag, Movie &movie)
 {
+    bumpWriteGeneration();
     if (!insertNewTag(tag))
     {
         return false;
@@ -166,7 +233,7 @@ bool DatabaseManager::addTagToMovie(Tag &tag, Movie &movie)
     l_query.bindValue(":id_tag", tag.id());
     l_query.bindValue(":id_movie", movie.id());
 
-    if (!l_query.exec())
+    if (!execQuery(l_query, Q_FUNC_INFO))
     {
         Macaw::DEBUG("In addTagToMovie():");
         Macaw::DEBUG(l_query.lastError().text());
@@ -187,6 +254,7 @@ bool DatabaseManager::addTagToMovie(Tag &tag, Movie &movie)
  */
 bool DatabaseManager::insertNewPeople(People &people)
 {
+    bumpWriteGeneration();
     QSqlQuery l_query(m_db);
     // If a people with the same name exist, we update it
     // else we insert
@@ -214,12 +282,12 @@ bool DatabaseManager::insertNewPeople(People &people)
                                             ")"
                         );
         l_query.bindValue(":name", people.name());
-        l_query.bindValue(":birthday", people.birthday().toString(DATE_FORMAT));
+        l_query.bindValue(":birthday", dateToDayNumber(people.birthday()));
         l_query.bindValue(":biography", people.biography());
         l_query.bindValue(":imported", people.isImported());
         l_query.bindValue(":id_tmdb", people.tmdbId());
 
-        if (!l_query.exec()) {
+        if (!execQuery(l_query, Q_FUNC_INFO)) {
             Macaw::DEBUG("In insertNewPeople():");
             Macaw::DEBUG(l_query.lastError().text());
 
@@ -240,12 +308,21 @@ bool DatabaseManager::insertNewPeople(People &people)
  */
 bool DatabaseManager::insertNewTag(Tag &tag)
 {
+    bumpWriteGeneration();
+    // The names of the tags are unique: reuse the existing one
+    if (existTag(tag.name()))
+    {
+        tag.setId(getOneTagByName(tag.name()).id());
+
+        return true;
+    }
+
     QSqlQuery l_query(m_db);
-    l_query.prepare("INSERT INTO tag (name) "
+    l_query.prepare("INSERT INTO tags (name) "
                     "VALUES (:name)");
     l_query.bindValue(":name", tag.name());
 
-    if (!l_query.exec())
+    if (!execQuery(l_query, Q_FUNC_INFO))
     {
         Macaw::DEBUG("In insertNewTag():");
         Macaw::DEBUG(l_query.lastError().text());
@@ -265,6 +342,7 @@ bool DatabaseManager::insertNewTag(Tag &tag)
  */
 bool DatabaseManager::insertNewPlaylist(Playlist &playlist)
 {
+    bumpWriteGeneration();
     QSqlQuery l_query(m_db);
     l_query.prepare("INSERT INTO playlists (name, creation_date, rate) "
                     "VALUES (:name, :creation_date, :rate)");
@@ -272,7 +350,7 @@ bool DatabaseManager::insertNewPlaylist(Playlist &playlist)
     l_query.bindValue(":creation_date", playlist.creationDate().toTime_t());
     l_query.bindValue(":rate", playlist.rate());
 
-    if (!l_query.exec())
+    if (!execQuery(l_query, Q_FUNC_INFO))
     {
         Macaw::DEBUG("In insertNewPlaylist():");
         Macaw::DEBUG(l_query.lastError().text());
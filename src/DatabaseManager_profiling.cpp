@@ -0,0 +1,343 @@
+/* Copyright (C) 2014 Macaw-Movies
+ * (Olivier CHURLAUD, Sébastien TOUZÉ)
+ *
+ * This file is part of Macaw-Movies.
+ *
+ * Macaw-Movies is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Macaw-Movies is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Macaw-Movies.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "DatabaseManager.h"
+
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QMap>
+#include <QMutex>
+#include <QSqlDriver>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QSqlResult>
+#include <QTextStream>
+#include <QVariant>
+
+#include "MacawDebug.h"
+
+/**
+ * @brief Serializes the writes to the slow-query log, shared by the managers of all threads
+ */
+static QMutex s_slowQueryLogMutex;
+
+/**
+ * @brief Queries slower than this, in milliseconds, are written to slowQueryLogPath()
+ *
+ * @return int, -1 if the log is disabled
+ */
+int DatabaseManager::slowQueryThreshold() const
+{
+    return m_slowQueryThreshold;
+}
+
+/**
+ * @brief Sets the threshold of the slow-query log
+ *
+ * @param int msec, -1 to disable the log
+ */
+void DatabaseManager::setSlowQueryThreshold(int msec)
+{
+    m_slowQueryThreshold = qMax(-1, msec);
+}
+
+/**
+ * @brief Path of the slow-query log, next to the database
+ *
+ * @return QString
+ */
+QString DatabaseManager::slowQueryLogPath()
+{
+    return QFileInfo(databasePath()).absolutePath() + "/slow_queries.log";
+}
+
+/**
+ * @brief Statistics of the queries run by this manager, by calling function
+ *
+ * @return QHash<QString, QueryStatistics>
+ */
+QHash<QString, QueryStatistics> DatabaseManager::queryStatistics() const
+{
+    return m_queryStatistics;
+}
+
+/**
+ * @brief Empties the statistics, for instance before measuring an action
+ */
+void DatabaseManager::resetQueryStatistics()
+{
+    m_queryStatistics.clear();
+}
+
+/**
+ * @brief Writes the statistics of the queries to the debug output,
+ * the functions taking the most time first
+ */
+void DatabaseManager::dumpQueryStatistics() const
+{
+    if (m_queryStatistics.isEmpty())
+    {
+        return;
+    }
+
+    QMultiMap<qint64, QString> l_callerMap;
+    foreach (QString l_caller, m_queryStatistics.keys())
+    {
+        l_callerMap.insert(m_queryStatistics.value(l_caller).totalTime, l_caller);
+    }
+
+    Macaw::DEBUG_IN("[DatabaseManager] Query statistics (calls, total ms, max ms, rows, slow)");
+    QMapIterator<qint64, QString> l_iterator(l_callerMap);
+    l_iterator.toBack();
+    while (l_iterator.hasPrevious())
+    {
+        l_iterator.previous();
+        QueryStatistics l_statistics = m_queryStatistics.value(l_iterator.value());
+        Macaw::DEBUG(QString("%1 | %2 | %3 | %4 | %5 | %6")
+                     .arg(l_statistics.count, 6)
+                     .arg(l_statistics.totalTime / 1000.0, 9, 'f', 1)
+                     .arg(l_statistics.maxTime / 1000.0, 8, 'f', 1)
+                     .arg(l_statistics.rowCount, 8)
+                     .arg(l_statistics.slowCount, 4)
+                     .arg(l_iterator.value()));
+    }
+    Macaw::DEBUG_OUT("[DatabaseManager] End of query statistics");
+}
+
+/**
+ * @brief Executes a prepared query, and records its time and number of rows.
+ * Used in place of `QSqlQuery::exec()`.
+ *
+ * @param QSqlQuery query, prepared and bound
+ * @param const char* caller, the calling function given by Q_FUNC_INFO
+ * @param QueryTables tables, TempTables if the query only writes temporary tables
+ * @return bool as QSqlQuery::exec()
+ */
+bool DatabaseManager::execQuery(QSqlQuery &query, const char *caller, QueryTables tables)
+{
+    QElapsedTimer l_timer;
+    l_timer.start();
+    bool l_ret = query.exec();
+    recordQuery(query, caller, l_timer.nsecsElapsed() / 1000);
+    if (tables == MainTables)
+    {
+        bumpAfterWrite(query, l_ret);
+    }
+
+    return l_ret;
+}
+
+/**
+ * @brief Same as execQuery() for `QSqlQuery::exec(const QString&)`, the statements
+ * without bound values: PRAGMA, savepoints, migrations
+ *
+ * @param QSqlQuery query
+ * @param QString queryText
+ * @param const char* caller, the calling function given by Q_FUNC_INFO
+ * @param QueryTables tables, TempTables if the query only writes temporary tables
+ * @return bool as QSqlQuery::exec(const QString&)
+ */
+bool DatabaseManager::execQuery(QSqlQuery &query, const QString &queryText, const char *caller,
+                                QueryTables tables)
+{
+    QElapsedTimer l_timer;
+    l_timer.start();
+    bool l_ret = query.exec(queryText);
+    recordQuery(query, caller, l_timer.nsecsElapsed() / 1000);
+    if (tables == MainTables)
+    {
+        bumpAfterWrite(query, l_ret);
+    }
+
+    return l_ret;
+}
+
+/**
+ * @brief Same as execQuery() for `QSqlQuery::execBatch()`
+ *
+ * @param QSqlQuery query, prepared and bound with lists
+ * @param const char* caller, the calling function given by Q_FUNC_INFO
+ * @param QueryTables tables, TempTables if the query only writes temporary tables
+ * @return bool as QSqlQuery::execBatch()
+ */
+bool DatabaseManager::execBatchQuery(QSqlQuery &query, const char *caller, QueryTables tables)
+{
+    QElapsedTimer l_timer;
+    l_timer.start();
+    bool l_ret = query.execBatch();
+    recordQuery(query, caller, l_timer.nsecsElapsed() / 1000);
+    if (tables == MainTables)
+    {
+        bumpAfterWrite(query, l_ret);
+    }
+
+    return l_ret;
+}
+
+/**
+ * @brief Makes the entity caches outdated once a write run outside of a transaction
+ * is committed, as commitTransaction() does for the transactions.
+ *
+ * The writers also bump the generation before writing, but another thread may
+ * read the old row in between and cache it under the new generation.
+ * Not called for the temporary tables (TempTables): they belong to their
+ * connection and are not cached.
+ *
+ * @param QSqlQuery query, just executed
+ * @param bool succeeded, returned by exec()
+ */
+void DatabaseManager::bumpAfterWrite(const QSqlQuery &query, bool succeeded)
+{
+    if (succeeded && m_transactionDepth == 0 && !query.isSelect())
+    {
+        bumpWriteGeneration();
+    }
+}
+
+/**
+ * @brief Adds an executed query to the statistics of its caller.
+ *
+ * SQLite only computes the first row in `exec()`. When the slow-query log is on,
+ * the rows of a SELECT are fetched here, then the query is moved back before the
+ * first row, so that the time and the count cover the whole result. The rows are
+ * kept in the cache of the query anyway, unless it is forward only. Otherwise,
+ * or for a forward only query, only `exec()` is timed and the rows are not counted.
+ *
+ * @param QSqlQuery query, just executed
+ * @param const char* caller
+ * @param qint64 time spent in exec(), in microseconds
+ */
+void DatabaseManager::recordQuery(QSqlQuery &query, const char *caller, qint64 time)
+{
+    qint64 l_rowCount = 0;
+    if (query.isActive() && query.isSelect())
+    {
+        if (m_slowQueryThreshold >= 0 && !query.isForwardOnly())
+        {
+            QElapsedTimer l_timer;
+            l_timer.start();
+            if (query.last())
+            {
+                l_rowCount = query.at() + 1;
+            }
+            query.seek(QSql::BeforeFirstRow);
+            time += l_timer.nsecsElapsed() / 1000;
+        }
+    }
+    else if (query.isActive())
+    {
+        l_rowCount = qMax(0, query.numRowsAffected());
+    }
+
+    QueryStatistics &l_statistics = m_queryStatistics[caller];
+    l_statistics.count++;
+    l_statistics.totalTime += time;
+    l_statistics.maxTime = qMax(l_statistics.maxTime, time);
+    l_statistics.rowCount += l_rowCount;
+
+    if (m_slowQueryThreshold >= 0 && time >= m_slowQueryThreshold * 1000)
+    {
+        l_statistics.slowCount++;
+        logSlowQuery(query, caller, time, l_rowCount);
+    }
+}
+
+/**
+ * @brief Appends a query and its `EXPLAIN QUERY PLAN` to the slow-query log.
+ *
+ * The plan is computed on the connection of the query, with the same values.
+ * A batch is explained with NULL values.
+ *
+ * @param QSqlQuery query, just executed
+ * @param const char* caller
+ * @param qint64 time, in microseconds
+ * @param qint64 rowCount
+ */
+void DatabaseManager::logSlowQuery(QSqlQuery &query, const char *caller, qint64 time, qint64 rowCount)
+{
+    QString l_queryText = query.executedQuery();
+    Macaw::DEBUG("[DatabaseManager] Slow query ("
+                 + QString::number(time / 1000) + " ms) in " + caller);
+
+    QStringList l_planList;
+    QSqlQuery l_explain(query.driver()->createResult());
+    if (l_explain.prepare("EXPLAIN QUERY PLAN " + l_queryText))
+    {
+        // The SQLite driver keeps the named placeholders in the executed query:
+        // the values are bound by name, or by position for the "?" placeholders
+        QMap<QString, QVariant> l_valueMap = query.boundValues();
+        bool l_named = false;
+        foreach (QString l_placeholder, l_valueMap.keys())
+        {
+            if (l_queryText.contains(l_placeholder))
+            {
+                QVariant l_value = l_valueMap.value(l_placeholder);
+                l_explain.bindValue(l_placeholder, l_value.type() == QVariant::List ? QVariant() : l_value);
+                l_named = true;
+            }
+        }
+        if (!l_named)
+        {
+            for (int i = 0 ; i < l_valueMap.size() ; i++)
+            {
+                QVariant l_value = query.boundValue(i);
+                l_explain.bindValue(i, l_value.type() == QVariant::List ? QVariant() : l_value);
+            }
+        }
+    }
+
+    if (l_explain.exec())
+    {
+        // Each row gives its id and the id of its parent in the plan tree
+        QHash<int, int> l_depthHash;
+        while (l_explain.next())
+        {
+            int l_depth = l_depthHash.value(l_explain.value(1).toInt(), -1) + 1;
+            l_depthHash.insert(l_explain.value(0).toInt(), l_depth);
+            l_planList.append(QString(2 * l_depth, ' ') + l_explain.value(3).toString());
+        }
+    }
+    else
+    {
+        l_planList.append("(no plan: " + l_explain.lastError().text() + ")");
+    }
+
+    QMutexLocker l_locker(&s_slowQueryLogMutex);
+    QFile l_logFile(slowQueryLogPath());
+    if (!l_logFile.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text))
+    {
+        Macaw::DEBUG("In logSlowQuery(): cannot open " + slowQueryLogPath());
+
+        return;
+    }
+
+    QTextStream l_stream(&l_logFile);
+    l_stream << QDateTime::currentDateTime().toString(Qt::ISODate)
+             << " | " << QString::number(time / 1000.0, 'f', 1) << " ms"
+             << " | " << rowCount << " rows"
+             << " | " << caller << "\n"
+             << l_queryText.simplified() << "\n";
+    foreach (QString l_plan, l_planList)
+    {
+        l_stream << "    " << l_plan << "\n";
+    }
+    l_stream << "\n";
+}
@@ -19,6 +19,7 @@
 
 #include "DatabaseManager.h"
 
+#include <QDateTime>
 #include <QSqlError>
 #include <QSqlQuery>
 #include <QVariant>
@@ -31,31 +32,40 @@
 #include "Entities/Show.h"
 
 /**
- * @brief Updates a movie from database
+ * @brief Updates a movie from database, with its people and tags.
+ *
+ * The links to the people and tags are compared in memory with the stored ones,
+ * then the differences are written with a few set-based statements.
+ * Everything is done in one transaction.
  *
  * @param Movie
  * @return bool
  */
 bool DatabaseManager::updateMovie(Movie &movie)
 {
+    bumpWriteGeneration();
     Macaw::DEBUG("[DatabaseManager] Enters updateMovie()");
-    QSqlQuery l_query(m_db);
-    l_query.prepare("UPDATE movies "
-                    "SET title = :title, "
-                        "original_title = :original_title, "
-                        "release_date = :release_date, "
-                        "country = :country, "
-                        "synopsis = :synopsis, "
-                        "colored = :colored, "
-                        "format = :format, "
-                        "rank = :rank, "
-                        "poster_path = :poster_path, "
-                        "imported = :imported, "
-                        "id_tmdb = :id_tmdb "
-                    "WHERE id = :id");
+    if (!beginTransaction())
+    {
+        return false;
+    }
+
+    QSqlQuery l_query = cachedQuery("UPDATE movies "
+                                    "SET title = :title, "
+                                        "original_title = :original_title, "
+                                        "release_date = :release_date, "
+                                        "country = :country, "
+                                        "synopsis = :synopsis, "
+                                        "colored = :colored, "
+                                        "format = :format, "
+                                        "rank = :rank, "
+                                        "poster_path = :poster_path, "
+                                        "imported = :imported, "
+                                        "id_tmdb = :id_tmdb "
+                                    "WHERE id = :id");
     l_query.bindValue(":title", movie.title());
     l_query.bindValue(":original_title", movie.originalTitle());
-    l_query.bindValue(":release_date", movie.releaseDate().toString(DATE_FORMAT));
+    l_query.bindValue(":release_date", dateToDayNumber(movie.releaseDate()));
     l_query.bindValue(":country", movie.country());
     l_query.bindValue(":synopsis", movie.synopsis());
     l_query.bindValue(":colored", movie.isColored());
@@ -66,87 +76,289 @@ bool DatabaseManager::updateMovie(Movie &movie)
     l_query.bindValue(":id_tmdb", movie.tmdbId());
     l_query.bindValue(":id", movie.id());
 
-
-    if (!l_query.exec())
+    bool l_ret = execQuery(l_query, Q_FUNC_INFO);
+    if (!l_ret)
     {
         Macaw::DEBUG("In updateMovie():");
         Macaw::DEBUG(l_query.lastError().text());
+    }
+    else if (l_query.numRowsAffected() == 0)
+    {
+        // Removed meanwhile, given to a moved movie by relinkMovie() for instance
+        Macaw::DEBUG("[DatabaseManager] updateMovie(): the movie does not exist anymore");
+        l_ret = false;
+    }
+    l_query.finish();
+
+    QList<People> l_orphanPeopleList;
+    QList<Tag> l_orphanTagList;
+    l_ret = l_ret && updatePeopleLinksOfMovie(movie, l_orphanPeopleList);
+    l_ret = l_ret && updateTagLinksOfMovie(movie, l_orphanTagList);
+
+    if (!l_ret || !commitTransaction())
+    {
+        rollbackTransaction();
 
         return false;
     }
 
-    // Insertions/Updates of the linked elements
-    foreach (People l_people, movie.peopleList())
+    // The signal is sent once the transaction is over: the slots may ask the user
+    if (!l_orphanPeopleList.isEmpty() || !l_orphanTagList.isEmpty())
     {
-        movie.removePeople(l_people);
-        updatePeopleInMovie(l_people, movie, l_people.type());
-        movie.addPeople(l_people);
+        emit orphansDetected(l_orphanPeopleList, l_orphanTagList);
     }
 
-    foreach (Tag l_tag, movie.tagList())
+    movie = getOneMovieById(movie.id());
+
+    Macaw::DEBUG("[DatabaseManager] Movie updated");
+
+    return true;
+}
+
+/**
+ * @brief Writes the people of a movie: inserts the unknown ones, updates the modified
+ * ones, then adds and removes links so that `movies_people` matches movie.peopleList().
+ * Must be called inside a transaction.
+ *
+ * @param Movie movie, the ids of its new people are set
+ * @param QList<People> orphanPeopleList, filled with the people not used by any movie anymore
+ * @return bool
+ */
+bool DatabaseManager::updatePeopleLinksOfMovie(Movie &movie, QList<People> &orphanPeopleList)
+{
+    // Stored state
+    QHash<int, People> l_storedPeopleHash;
+    QSet<QPair<int, int> > l_storedLinkSet;
+    foreach (People l_people, getPeopleByMovieIds(QList<int>() << movie.id()).value(movie.id()))
     {
-        movie.removeTag(l_tag);
-        updateTagInMovie(l_tag, movie);
-        movie.addTag(l_tag);
+        l_storedPeopleHash.insert(l_people.id(), l_people);
+        l_storedLinkSet.insert(qMakePair(l_people.id(), l_people.type()));
     }
 
-    // Deletion of the old linked elements
-    l_query.prepare("SELECT t.id, t.name "
-                    "FROM tags AS t, movies_tags AS mt "
-                    "WHERE mt.id_movie = :id_movie AND mt.id_tag = t.id");
-    l_query.bindValue(":id_movie", movie.id());
-    if (!l_query.exec())
+    // Wanted state
+    QList<People> l_peopleList = movie.peopleList();
+    QSet<QPair<int, int> > l_wantedLinkSet;
+    for (int i = 0 ; i < l_peopleList.size() ; i++)
     {
-        Macaw::DEBUG("In updateMovie():");
-        Macaw::DEBUG(l_query.lastError().text());
+        People &l_people = l_peopleList[i];
+        if (l_people.id() == 0)
+        {
+            if (!insertNewPeople(l_people))
+            {
+                return false;
+            }
+        }
+        else if (!l_storedPeopleHash.contains(l_people.id())
+                 || !samePeopleData(l_storedPeopleHash.value(l_people.id()), l_people))
+        {
+            if (!updatePeople(l_people))
+            {
+                return false;
+            }
+        }
+        l_wantedLinkSet.insert(qMakePair(l_people.id(), l_people.type()));
+    }
+    movie.setPeopleList(l_peopleList);
+
+    // New links: multi-row inserts
+    QList<QVariantList> l_newLinkList;
+    foreach (QPair<int, int> l_link, l_wantedLinkSet - l_storedLinkSet)
+    {
+        l_newLinkList.append(QVariantList() << movie.id() << l_link.first << l_link.second);
+    }
+    if (!insertLinkRows("movies_people", QStringList() << "id_movie" << "id_people" << "type",
+                        l_newLinkList))
+    {
+        Macaw::DEBUG("In updatePeopleLinksOfMovie():");
 
         return false;
     }
-    while(l_query.next())
+
+    // Old links: one delete per type
+    QHash<int, QList<int> > l_oldPeopleIdHash;
+    QList<int> l_oldPeopleIdList;
+    foreach (QPair<int, int> l_link, l_storedLinkSet - l_wantedLinkSet)
+    {
+        l_oldPeopleIdHash[l_link.second].append(l_link.first);
+        l_oldPeopleIdList.append(l_link.first);
+    }
+    foreach (int l_type, l_oldPeopleIdHash.keys())
     {
-        Tag l_tag;
-        l_tag.setId(l_query.value(0).toInt());
-        l_tag.setName(l_query.value(1).toString());
-        if(movie.tagList().indexOf(l_tag) < 0)
+        QSqlQuery l_query(m_db);
+        l_query.prepare("DELETE FROM movies_people "
+                        "WHERE id_movie = :id_movie "
+                          "AND type = :type "
+                          "AND id_people IN (" + idListToString(l_oldPeopleIdHash.value(l_type)) + ")");
+        l_query.bindValue(":id_movie", movie.id());
+        l_query.bindValue(":type", l_type);
+
+        if (!execQuery(l_query, Q_FUNC_INFO))
         {
-            removeTagFromMovie(l_tag, movie);
+            Macaw::DEBUG("In updatePeopleLinksOfMovie():");
+            Macaw::DEBUG(l_query.lastError().text());
+
+            return false;
         }
     }
 
-    QList<int> types;
-    types << People::Director << People::Producer << People::Actor;
-    foreach (int type, types)
+    // People of the old links that are not used anymore
+    QList<Tag> l_noTagList;
+
+    return findOrphans(l_oldPeopleIdList, QList<int>(), orphanPeopleList, l_noTagList);
+}
+
+/**
+ * @brief Writes the tags of a movie: inserts the unknown ones, renames the modified
+ * ones, then adds and removes links so that `movies_tags` matches movie.tagList().
+ * Must be called inside a transaction.
+ *
+ * @param Movie movie, the ids of its new tags are set
+ * @param QList<Tag> orphanTagList, filled with the tags not used by any movie anymore
+ * @return bool
+ */
+bool DatabaseManager::updateTagLinksOfMovie(Movie &movie, QList<Tag> &orphanTagList)
+{
+    // Stored state
+    QHash<int, Tag> l_storedTagHash;
+    foreach (Tag l_tag, getTagsByMovieIds(QList<int>() << movie.id()).value(movie.id()))
+    {
+        l_storedTagHash.insert(l_tag.id(), l_tag);
+    }
+
+    // Wanted state
+    QList<Tag> l_tagList = movie.tagList();
+    QSet<int> l_wantedIdSet;
+    for (int i = 0 ; i < l_tagList.size() ; i++)
+    {
+        Tag &l_tag = l_tagList[i];
+        if (l_tag.id() == 0)
+        {
+            if (!insertNewTag(l_tag))
+            {
+                return false;
+            }
+        }
+        else if (!l_storedTagHash.contains(l_tag.id())
+                 || l_storedTagHash.value(l_tag.id()).name() != l_tag.name())
+        {
+            if (!updateTag(l_tag))
+            {
+                return false;
+            }
+        }
+        l_wantedIdSet.insert(l_tag.id());
+    }
+    movie.setTagList(l_tagList);
+
+    QSet<int> l_storedIdSet = l_storedTagHash.keys().toSet();
+    QList<int> l_newIdList = (l_wantedIdSet - l_storedIdSet).toList();
+    QList<int> l_oldIdList = (l_storedIdSet - l_wantedIdSet).toList();
+
+    // New links: multi-row inserts
+    QList<QVariantList> l_newLinkList;
+    foreach (int l_tagId, l_newIdList)
+    {
+        l_newLinkList.append(QVariantList() << movie.id() << l_tagId);
+    }
+    if (!insertLinkRows("movies_tags", QStringList() << "id_movie" << "id_tag", l_newLinkList))
+    {
+        Macaw::DEBUG("In updateTagLinksOfMovie():");
+
+        return false;
+    }
+
+    // Old links: one delete
+    if (!l_oldIdList.isEmpty())
     {
-        l_query.prepare("SELECT " + m_peopleFields + ", mp.type "
-                        "FROM people AS p, movies_people AS mp "
-                        "WHERE mp.id_movie = :id_movie "
-                          "AND mp.type = :type "
-                          "AND mp.id_people = p.id");
+        QSqlQuery l_query(m_db);
+        l_query.prepare("DELETE FROM movies_tags "
+                        "WHERE id_movie = :id_movie "
+                          "AND id_tag IN (" + idListToString(l_oldIdList) + ")");
         l_query.bindValue(":id_movie", movie.id());
-        l_query.bindValue(":type", type);
-        if (!l_query.exec())
+
+        if (!execQuery(l_query, Q_FUNC_INFO))
         {
-            Macaw::DEBUG("In updateMovie():");
+            Macaw::DEBUG("In updateTagLinksOfMovie():");
             Macaw::DEBUG(l_query.lastError().text());
 
             return false;
         }
-        while(l_query.next())
+    }
+
+    // Tags of the old links that are not used anymore
+    QList<People> l_noPeopleList;
+
+    return findOrphans(QList<int>(), l_oldIdList, l_noPeopleList, orphanTagList);
+}
+
+/**
+ * @brief Inserts rows into a link table, 300 rows per statement so that
+ * the bound values stay under the limit of 999 parameters of SQLite.
+ * Must be called inside a transaction.
+ *
+ * @param QString table, such as "movies_tags"
+ * @param QStringList columnList
+ * @param QList<QVariantList> rowList, one value per column in each row
+ * @return bool
+ */
+bool DatabaseManager::insertLinkRows(const QString &table, const QStringList &columnList,
+                                     const QList<QVariantList> &rowList)
+{
+    QStringList l_placeholderList;
+    for (int i = 0 ; i < columnList.size() ; i++)
+    {
+        l_placeholderList << "?";
+    }
+    QString l_rowText = "(" + l_placeholderList.join(", ") + ")";
+
+    for (int l_begin = 0 ; l_begin < rowList.size() ; l_begin += 300)
+    {
+        int l_end = qMin(l_begin + 300, rowList.size());
+        QStringList l_valueList;
+        for (int i = l_begin ; i < l_end ; i++)
+        {
+            l_valueList << l_rowText;
+        }
+
+        QSqlQuery l_query(m_db);
+        l_query.prepare("INSERT INTO " + table + "(" + columnList.join(", ") + ") "
+                        "VALUES " + l_valueList.join(", "));
+        for (int i = l_begin ; i < l_end ; i++)
         {
-            People l_people = hydratePeople(l_query);
-            if(movie.peopleList().indexOf(l_people) < 0)
+            foreach (QVariant l_value, rowList.at(i))
             {
-                removePeopleFromMovie(l_people, movie, l_people.type());
+                l_query.addBindValue(l_value);
             }
         }
-    }
-    movie = getOneMovieById(movie.id());
 
-    Macaw::DEBUG("[DatabaseManager] Movie updated");
+        if (!execQuery(l_query, Q_FUNC_INFO))
+        {
+            Macaw::DEBUG("In insertLinkRows():");
+            Macaw::DEBUG(l_query.lastError().text());
+
+            return false;
+        }
+    }
 
     return true;
 }
 
+/**
+ * @brief Whether two objects hold the same data for the `people` table
+ *
+ * @param People stored
+ * @param People other
+ * @return bool
+ */
+bool DatabaseManager::samePeopleData(const People &stored, const People &other)
+{
+    return stored.name() == other.name()
+            && stored.birthday() == other.birthday()
+            && stored.biography() == other.biography()
+            && stored.isImported() == other.isImported()
+            && stored.tmdbId() == other.tmdbId();
+}
+
 /**
  * @brief Updates a people in database
  *
@@ -155,6 +367,7 @@ bool DatabaseManager::updateMovie(Movie &movie)
  */
 bool DatabaseManager::updatePeople(People &people)
 {
+    bumpWriteGeneration();
     Macaw::DEBUG("[DatabaseManager] Enters updatePeople()");
 
     QSqlQuery l_query(m_db);
@@ -166,13 +379,13 @@ bool DatabaseManager::updatePeople(People &people)
                         "id_tmdb = :id_tmdb "
                     "WHERE id = :id");
     l_query.bindValue(":name", people.name());
-    l_query.bindValue(":birthday",  people.birthday().toString(DATE_FORMAT));
+    l_query.bindValue(":birthday",  dateToDayNumber(people.birthday()));
     l_query.bindValue(":biography", people.biography());
     l_query.bindValue(":imported", people.isImported());
     l_query.bindValue(":id_tmdb", people.tmdbId());
     l_query.bindValue(":id", people.id());
 
-    if (!l_query.exec())
+    if (!execQuery(l_query, Q_FUNC_INFO))
     {
         Macaw::DEBUG("In updatePeople():");
         Macaw::DEBUG(l_query.lastError().text());
@@ -195,6 +408,7 @@ bool DatabaseManager::updatePeopleInMovie(People &people,
                                           Movie &movie,
                                           const int type)
 {
+    bumpWriteGeneration();
     // If the id is 0, then the person doesn't exist
     if (people.id() == 0)
     {
@@ -216,7 +430,7 @@ bool DatabaseManager::updatePeopleInMovie(People &people,
         l_query.bindValue(":id_people", people.id());
         l_query.bindValue(":type", type);
 
-        if (!l_query.exec())
+        if (!execQuery(l_query, Q_FUNC_INFO))
         {
             Macaw::DEBUG("In updatePeopleInMovie():");
             Macaw::DEBUG(l_query.lastError().text());
@@ -232,7 +446,7 @@ bool DatabaseManager::updatePeopleInMovie(People &people,
             l_query.bindValue(":id_movie", movie.id());
             l_query.bindValue(":id_people", people.id());
             l_query.bindValue(":type", type);
-            if (!l_query.exec())
+            if (!execQuery(l_query, Q_FUNC_INFO))
             {
                 Macaw::DEBUG("In updatePeopleInMovie():");
                 Macaw::DEBUG(l_query.lastError().text());
@@ -253,6 +467,7 @@ bool DatabaseManager::updatePeopleInMovie(People &people,
  */
 bool DatabaseManager::updateTag(Tag &tag)
 {
+    bumpWriteGeneration();
     QSqlQuery l_query(m_db);
     l_query.prepare("UPDATE tags "
                     "SET name = :name "
@@ -260,7 +475,7 @@ bool DatabaseManager::updateTag(Tag &tag)
     l_query.bindValue(":name", tag.name());
     l_query.bindValue(":id", tag.id());
 
-    if (!l_query.exec())
+    if (!execQuery(l_query, Q_FUNC_INFO))
     {
         Macaw::DEBUG("In updateTag():");
         Macaw::DEBUG(l_query.lastError().text());
@@ -280,6 +495,7 @@ bool DatabaseManager::updateTag(Tag &tag)
  */
 bool DatabaseManager::updateTagInMovie(Tag &tag, Movie &movie)
 {
+    bumpWriteGeneration();
     // If the id is 0, then the tag doesn't exist
     if (tag.id() == 0)
     {
@@ -299,7 +515,7 @@ bool DatabaseManager::updateTagInMovie(Tag &tag, Movie &movie)
                         "WHERE id_movie = :id_movie AND id_tag = :id_tag");
         l_query.bindValue(":id_movie", movie.id());
         l_query.bindValue(":id_tag", tag.id());
-        if (!l_query.exec())
+        if (!execQuery(l_query, Q_FUNC_INFO))
         {
             Macaw::DEBUG("In updateTagInMovie():");
             Macaw::DEBUG(l_query.lastError().text());
@@ -314,7 +530,7 @@ bool DatabaseManager::updateTagInMovie(Tag &tag, Movie &movie)
                             "VALUES(:id_movie, :id_tag)");
             l_query.bindValue(":id_movie", movie.id());
             l_query.bindValue(":id_tag", tag.id());
-            if (!l_query.exec())
+            if (!execQuery(l_query, Q_FUNC_INFO))
             {
                 Macaw::DEBUG("In updateTagInMovie():");
                 Macaw::DEBUG(l_query.lastError().text());
@@ -335,6 +551,7 @@ bool DatabaseManager::updateTagInMovie(Tag &tag, Movie &movie)
  */
 bool DatabaseManager::updatePlaylist(Playlist &playlist)
 {
+    bumpWriteGeneration();
     Macaw::DEBUG("[DatabaseManager] Enters updatePlaylist()");
     QSqlQuery l_query(m_db);
     l_query.prepare("UPDATE playlists "
@@ -345,7 +562,7 @@ bool DatabaseManager::updatePlaylist(Playlist &playlist)
     l_query.bindValue(":rate", playlist.rate());
     l_query.bindValue(":id", playlist.id());
 
-    if (!l_query.exec())
+    if (!execQuery(l_query, Q_FUNC_INFO))
     {
         Macaw::DEBUG("In updatePlaylist():");
         Macaw::DEBUG(l_query.lastError().text());
@@ -364,7 +581,7 @@ bool DatabaseManager::updatePlaylist(Playlist &playlist)
                     "FROM movies AS m, movies_playlists AS mpl "
                     "WHERE mpl.id_movie = m.id AND mpl.id_playlist = :id_playlist");
     l_query.bindValue(":id_playlist", playlist.id());
-    if (!l_query.exec())
+    if (!execQuery(l_query, Q_FUNC_INFO))
     {
         Macaw::DEBUG("In updatePlaylist():");
         Macaw::DEBUG(l_query.lastError().text());
@@ -394,6 +611,7 @@ bool DatabaseManager::updatePlaylist(Playlist &playlist)
  */
 bool DatabaseManager::updateMovieInPlaylist(Movie &movie, Playlist &playlist)
 {
+    bumpWriteGeneration();
     // Checks if the people and the movie are connected, if not connects them
     QSqlQuery l_query(m_db);
     l_query.prepare("SELECT id "
@@ -401,7 +619,7 @@ bool DatabaseManager::updateMovieInPlaylist(Movie &movie, Playlist &playlist)
                     "WHERE id_movie = :id_movie AND id_playlist = :id_playlist");
     l_query.bindValue(":id_movie", movie.id());
     l_query.bindValue(":id_playlist", playlist.id());
-    if (!l_query.exec())
+    if (!execQuery(l_query, Q_FUNC_INFO))
     {
         Macaw::DEBUG("In updateMovieInPlaylist():");
         Macaw::DEBUG(l_query.lastError().text());
@@ -416,7 +634,7 @@ bool DatabaseManager::updateMovieInPlaylist(Movie &movie, Playlist &playlist)
                         "VALUES(:id_movie, :id_playlist)");
         l_query.bindValue(":id_movie", movie.id());
         l_query.bindValue(":id_playlist", playlist.id());
-        if (!l_query.exec())
+        if (!execQuery(l_query, Q_FUNC_INFO))
         {
             Macaw::DEBUG("In updateMovieInPlaylist():");
             Macaw::DEBUG(l_query.lastError().text());
@@ -427,3 +645,230 @@ bool DatabaseManager::updateMovieInPlaylist(Movie &movie, Playlist &playlist)
 
     return true;
 }
+
+/**
+ * @brief Changes the path of the movies of a moved file, or of all the files
+ * of a moved directory. The movies keep their id, and so their metadata and links.
+ *
+ * @param int moviesPathId, id of the movies path
+ * @param QString oldRelativePath of the file or directory, relative to the movies path
+ * @param int newMoviesPathId, id of the movies path it was moved to
+ * @param QString newRelativePath
+ * @return bool
+ */
+bool DatabaseManager::moveMovieFiles(const int moviesPathId, const QString &oldRelativePath,
+                                     const int newMoviesPathId, const QString &newRelativePath)
+{
+    bumpWriteGeneration();
+    QSqlQuery l_query(m_db);
+
+    // See getMoviesByFilePath() for the files of a directory
+    l_query.prepare("UPDATE movies "
+                    "SET id_path = :new_id_path, "
+                        "file_path = :new_path || substr(file_path, :old_length + 1) "
+                    "WHERE id_path = :id_path "
+                      "AND (file_path = :old_path "
+                           "OR (file_path >= :dir_begin AND file_path < :dir_end))");
+    l_query.bindValue(":new_id_path", newMoviesPathId);
+    l_query.bindValue(":new_path", newRelativePath);
+    l_query.bindValue(":old_length", oldRelativePath.length());
+    l_query.bindValue(":id_path", moviesPathId);
+    l_query.bindValue(":old_path", oldRelativePath);
+    l_query.bindValue(":dir_begin", oldRelativePath + '/');
+    l_query.bindValue(":dir_end", oldRelativePath + '0');
+
+    if (!execQuery(l_query, Q_FUNC_INFO))
+    {
+        Macaw::DEBUG("In moveMovieFiles():");
+        Macaw::DEBUG(l_query.lastError().text());
+
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Gives the file of a new movie to a movie whose file was moved,
+ * and removes the new movie. The movie keeps its metadata and links.
+ *
+ * Only a new movie that is not imported and has no links is removed: once its
+ * metadata is fetched, it is kept and the movie whose file was moved stays missing.
+ *
+ * @param int movieId, the movie whose file was moved
+ * @param int newMovieId, the movie added for the file at its new place
+ * @return bool false if the new movie was not removed
+ */
+bool DatabaseManager::relinkMovie(const int movieId, const int newMovieId)
+{
+    bumpWriteGeneration();
+    if (!beginTransaction())
+    {
+        return false;
+    }
+
+    QSqlQuery l_query(m_db);
+    l_query.prepare("SELECT id_path, file_path, suffix, fingerprint "
+                    "FROM movies AS m "
+                    "WHERE m.id = :id AND m.imported = 0 "
+                      "AND NOT EXISTS (SELECT 1 FROM movies_people WHERE id_movie = m.id) "
+                      "AND NOT EXISTS (SELECT 1 FROM movies_tags WHERE id_movie = m.id) "
+                      "AND NOT EXISTS (SELECT 1 FROM movies_playlists WHERE id_movie = m.id)");
+    l_query.bindValue(":id", newMovieId);
+    if (!execQuery(l_query, Q_FUNC_INFO))
+    {
+        Macaw::DEBUG("In relinkMovie():");
+        Macaw::DEBUG(l_query.lastError().text());
+        rollbackTransaction();
+
+        return false;
+    }
+    if (!l_query.next())
+    {
+        Macaw::DEBUG("[DatabaseManager] relinkMovie(): the new movie is gone or has metadata");
+        l_query.finish();
+        rollbackTransaction();
+
+        return false;
+    }
+    QVariant l_moviesPathId = l_query.value(0);
+    QVariant l_filePath = l_query.value(1);
+    QVariant l_suffix = l_query.value(2);
+    QVariant l_fingerprint = l_query.value(3);
+    l_query.finish();
+
+    // The new movie has no links: nothing is cascaded
+    l_query.prepare("DELETE FROM movies WHERE id = :id");
+    l_query.bindValue(":id", newMovieId);
+    if (!execQuery(l_query, Q_FUNC_INFO))
+    {
+        Macaw::DEBUG("In relinkMovie():");
+        Macaw::DEBUG(l_query.lastError().text());
+        rollbackTransaction();
+
+        return false;
+    }
+
+    l_query.prepare("UPDATE movies "
+                    "SET id_path = :id_path, file_path = :file_path, "
+                        "suffix = :suffix, fingerprint = :fingerprint, "
+                        "missing_since = NULL "
+                    "WHERE id = :id");
+    l_query.bindValue(":id_path", l_moviesPathId);
+    l_query.bindValue(":file_path", l_filePath);
+    l_query.bindValue(":suffix", l_suffix);
+    l_query.bindValue(":fingerprint", l_fingerprint);
+    l_query.bindValue(":id", movieId);
+    if (!execQuery(l_query, Q_FUNC_INFO) || !commitTransaction())
+    {
+        Macaw::DEBUG("In relinkMovie():");
+        Macaw::DEBUG(l_query.lastError().text());
+        rollbackTransaction();
+
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Saves the fingerprints of the files of some movies, in one transaction
+ *
+ * @param QHash<int, QByteArray> fingerprintHash, fingerprints by movie id
+ * @return bool
+ */
+bool DatabaseManager::updateFingerprints(const QHash<int, QByteArray> &fingerprintHash)
+{
+    bumpWriteGeneration();
+    if (fingerprintHash.isEmpty())
+    {
+        return true;
+    }
+    if (!beginTransaction())
+    {
+        return false;
+    }
+
+    QSqlQuery l_query = cachedQuery("UPDATE movies SET fingerprint = :fingerprint WHERE id = :id");
+    QHashIterator<int, QByteArray> l_iterator(fingerprintHash);
+    while (l_iterator.hasNext())
+    {
+        l_iterator.next();
+        l_query.bindValue(":fingerprint", l_iterator.value());
+        l_query.bindValue(":id", l_iterator.key());
+        if (!execQuery(l_query, Q_FUNC_INFO))
+        {
+            Macaw::DEBUG("In updateFingerprints():");
+            Macaw::DEBUG(l_query.lastError().text());
+            rollbackTransaction();
+
+            return false;
+        }
+    }
+
+    if (!commitTransaction())
+    {
+        rollbackTransaction();
+
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Marks movies as missing, their file being gone, or as found again.
+ * A missing movie keeps the date it was found missing, see getMoviesMissingSince().
+ *
+ * @param QList<int> movieIdList
+ * @param bool missing
+ * @return bool
+ */
+bool DatabaseManager::setMoviesMissing(const QList<int> &movieIdList, const bool missing)
+{
+    if (movieIdList.isEmpty())
+    {
+        return true;
+    }
+    if (!beginTransaction())
+    {
+        return false;
+    }
+
+    QSqlQuery l_query(m_db);
+    qint64 l_now = QDateTime::currentMSecsSinceEpoch();
+    foreach (QList<int> l_idList, splitIdList(movieIdList))
+    {
+        if (missing)
+        {
+            l_query.prepare("UPDATE movies SET missing_since = :now "
+                            "WHERE missing_since IS NULL "
+                              "AND id IN (" + idListToString(l_idList) + ")");
+            l_query.bindValue(":now", l_now);
+        }
+        else
+        {
+            l_query.prepare("UPDATE movies SET missing_since = NULL "
+                            "WHERE missing_since IS NOT NULL "
+                              "AND id IN (" + idListToString(l_idList) + ")");
+        }
+
+        if (!execQuery(l_query, Q_FUNC_INFO))
+        {
+            Macaw::DEBUG("In setMoviesMissing():");
+            Macaw::DEBUG(l_query.lastError().text());
+            rollbackTransaction();
+
+            return false;
+        }
+    }
+
+    if (!commitTransaction())
+    {
+        rollbackTransaction();
+
+        return false;
+    }
+
+    return true;
+}
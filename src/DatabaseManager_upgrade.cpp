@@ -0,0 +1,433 @@
+/* Copyright (C) 2014 Macaw-Movies
+ * (Olivier CHURLAUD, Sébastien TOUZÉ)
+ *
+ * This file is part of Macaw-Movies.
+ *
+ * Macaw-Movies is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Macaw-Movies is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Macaw-Movies.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "DatabaseManager.h"
+
+#include <QDateTime>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QSqlRecord>
+#include <QVariant>
+
+#include "MacawDebug.h"
+
+/**
+ * @brief Upgrades DB between diffent DB versions.
+ *
+ * The database is backed up (see backupDB()), then every migration of migrationList() numbered
+ * after `fromVersion` and up to `toVersion` is run, in order. Each migration runs
+ * in its own transaction, together with the update of `config.db_version`.
+ * If one fails, the backup is restored. Since `db_version` is committed with
+ * each migration, an interrupted upgrade resumes after the last one done.
+ * upgradeProgress() is emitted before each migration and at the end.
+ *
+ * To change the structure of the DB, add a migration and increase DB_VERSION.
+ *
+ * @return bool
+ */
+bool DatabaseManager::upgradeDB(int fromVersion, int toVersion)
+{
+    Macaw::DEBUG_IN("[DatabaseManager] upgradeDB");
+    bool l_ret = false;
+
+    if (m_db.isOpen())
+    {
+        QDateTime l_backupTimestamp;
+        bool l_backedUp = backupDB(l_backupTimestamp);
+
+        QSqlQuery l_query(m_db);
+
+        // PRAGMA is disabled so that renaming and deleting a database don't act on cascade
+        // It cannot be changed inside a transaction.
+        l_ret = execQuery(l_query, "PRAGMA foreign_keys = OFF", Q_FUNC_INFO);
+
+        QMap<int, Migration> l_migrationList = migrationList();
+        int l_stepCount = 0;
+        foreach (int l_version, l_migrationList.keys()) {
+            if (l_version > fromVersion && l_version <= toVersion) {
+                l_stepCount++;
+            }
+        }
+        int l_step = 0;
+
+        QMap<int, Migration>::const_iterator l_migration = l_migrationList.constBegin();
+        for ( ; l_ret && l_migration != l_migrationList.constEnd() ; ++l_migration)
+        {
+            int l_version = l_migration.key();
+            if (l_version <= fromVersion || l_version > toVersion) {
+                continue;
+            }
+
+            emit upgradeProgress(l_step, l_stepCount, "v" + QString::number(l_version));
+            l_step++;
+            Macaw::DEBUG_IN("[DatabaseManager] upgrade to v" + QString::number(l_version));
+            l_ret = beginTransaction();
+            l_ret = l_ret && (this->*l_migration.value())(l_query);
+            l_query.finish();
+
+            if (l_ret) {
+                l_query.prepare("UPDATE config SET db_version = :version");
+                l_query.bindValue(":version", l_version);
+                l_ret = execQuery(l_query, Q_FUNC_INFO);
+                if (!l_ret) {
+                    Macaw::DEBUG(l_query.lastError().text());
+                }
+            }
+
+            if (l_ret) {
+                l_ret = commitTransaction();
+            } else {
+                rollbackTransaction();
+            }
+            Macaw::DEBUG_OUT("[DatabaseManager] exits upgrade to v" + QString::number(l_version));
+        }
+
+        // The indexes read the columns of the last version: they are made once
+        // all the migrations are done
+        l_ret = l_ret && createIndexes(l_query);
+
+        if (l_ret) {
+            l_ret = execQuery(l_query, "PRAGMA foreign_keys = ON", Q_FUNC_INFO);
+            emit upgradeProgress(l_stepCount, l_stepCount, "v" + QString::number(toVersion));
+        } else {
+            l_query.clear();
+
+            Macaw::DEBUG("[DatabaseManager] FAILED => Come back to backup");
+            // Without backup, the failed migration was rolled back anyway
+            if (l_backedUp) {
+                restoreBackup(l_backupTimestamp);
+            } else {
+                execQuery(l_query, "PRAGMA foreign_keys = ON", Q_FUNC_INFO);
+            }
+        }
+    }
+    Macaw::DEBUG_OUT("[DatabaseManager] exits upgradeDB");
+
+    return l_ret;
+}
+
+/**
+ * @brief The migrations of the database, by the version they lead to
+ *
+ * @return QMap<int, Migration>
+ */
+QMap<int, DatabaseManager::Migration> DatabaseManager::migrationList()
+{
+    QMap<int, Migration> l_migrationList;
+    l_migrationList.insert(50, &DatabaseManager::upgradeToV050);
+    l_migrationList.insert(51, &DatabaseManager::upgradeToV051);
+    l_migrationList.insert(52, &DatabaseManager::upgradeToV052);
+    l_migrationList.insert(53, &DatabaseManager::upgradeToV053);
+    l_migrationList.insert(54, &DatabaseManager::upgradeToV054);
+    l_migrationList.insert(55, &DatabaseManager::upgradeToV055);
+    l_migrationList.insert(56, &DatabaseManager::upgradeToV056);
+    l_migrationList.insert(57, &DatabaseManager::upgradeToV057);
+
+    return l_migrationList;
+}
+
+/**
+ * @brief Migration to v050: TMDB ids, shows and episodes, paths of the movies
+ * relative to the entries of `path_list`
+ *
+ * @param query
+ * @return bool
+ */
+bool DatabaseManager::upgradeToV050(QSqlQuery &query)
+{
+    bool l_ret = true;
+
+    if (!m_db.record("config").contains("media_player")) {
+        l_ret &= execQuery(query, "ALTER TABLE config ADD media_player VARCHAR(255)", Q_FUNC_INFO);
+        if(!l_ret)
+        {
+            Macaw::DEBUG(query.lastError().text());
+        }
+    }
+
+    if (!m_db.record("movies").contains("id_tmdb")) {
+        l_ret &= execQuery(query, "ALTER TABLE movies ADD id_tmdb INTEGER", Q_FUNC_INFO);
+        l_ret &= execQuery(query, "UPDATE movies SET id_tmdb = 0", Q_FUNC_INFO);
+        if(!l_ret)
+        {
+            Macaw::DEBUG(query.lastError().text());
+        }
+    }
+
+    if (!m_db.record("movies").contains("show")) {
+        l_ret &= execQuery(query, "ALTER TABLE movies ADD show BOOLEAN", Q_FUNC_INFO);
+        l_ret &= execQuery(query, "UPDATE movies SET show = 0", Q_FUNC_INFO);
+        if(!l_ret)
+        {
+            Macaw::DEBUG(query.lastError().text());
+        }
+    }
+    if (!m_db.tables().contains("path_list")) {
+        Macaw::DEBUG_IN("[DatabaseManager] upgrade path_list table");
+        l_ret &= createTablePathList(query);
+        l_ret &= execQuery(query, "INSERT INTO path_list(id, movies_path, imported) SELECT id, movies_path, imported FROM paths_list", Q_FUNC_INFO);
+        l_ret &= execQuery(query, "DROP TABLE paths_list", Q_FUNC_INFO);
+        l_ret &= execQuery(query, "UPDATE path_list SET type = 1", Q_FUNC_INFO);
+        if(!l_ret)
+        {
+            Macaw::DEBUG(query.lastError().text());
+        }
+        Macaw::DEBUG_OUT("[DatabaseManager] upgrade path_list table finished");
+    }
+
+    if (!m_db.record("people").contains("id_tmdb")) {
+        Macaw::DEBUG_IN("[DatabaseManager] upgrade people table");
+        l_ret &= execQuery(query, "ALTER TABLE people ADD id_tmdb INTEGER", Q_FUNC_INFO);
+        l_ret &= execQuery(query, "ALTER TABLE people ADD imported BOOLEAN", Q_FUNC_INFO);
+        l_ret &= execQuery(query, "UPDATE people SET imported = 0, id_tmdb = 0", Q_FUNC_INFO);
+        if(!l_ret){
+            Macaw::DEBUG(query.lastError().text());
+        }
+    }
+
+    if (!m_db.record("movies").contains("id_path")) {
+        Macaw::DEBUG_IN("[DatabaseManager] upgrade movies table");
+        l_ret &= execQuery(query, "ALTER TABLE movies ADD id_path INTEGER", Q_FUNC_INFO);
+        if(!l_ret){
+            Macaw::DEBUG(query.lastError().text());
+        }
+        l_ret &= execQuery(query, "ALTER TABLE movies RENAME TO movies_old", Q_FUNC_INFO);
+        if(!l_ret){
+            Macaw::DEBUG(query.lastError().text());
+        }
+        l_ret &= createTableMovies(query);
+        if(!l_ret){
+            Macaw::DEBUG(query.lastError().text());
+        }
+        l_ret &= execQuery(query, "UPDATE movies_old SET id_path=1", Q_FUNC_INFO);
+        if(!l_ret){
+            Macaw::DEBUG(query.lastError().text());
+        }
+        l_ret &= execQuery(query, "INSERT INTO movies (" + QString(m_movieFields).remove("m.") + ") "
+                                  "SELECT "+ m_movieFields +"FROM movies_old AS m", Q_FUNC_INFO);
+        if(!l_ret){
+            Macaw::DEBUG("Copying table movies failed");
+            Macaw::DEBUG(query.lastError().text());
+        }
+        l_ret &= execQuery(query, "DROP TABLE movies_old", Q_FUNC_INFO);
+        if(!l_ret){
+            Macaw::DEBUG(query.lastError().text());
+        }
+
+        // The paths of the movies become relative to the most specific entry of
+        // path_list they start with. Exact prefix comparison with substr():
+        // LIKE would be case-insensitive and take '_' and '%' of the paths as wildcards.
+        l_ret = l_ret && execQuery(query, "CREATE TEMP TABLE path_prefix AS "
+                                          "SELECT id, rtrim(movies_path, '/') || '/' AS prefix "
+                                          "FROM path_list", Q_FUNC_INFO, TempTables);
+        QString l_bestPath = "(SELECT %1 FROM temp.path_prefix AS p "
+                             "WHERE substr(movies.file_path, 1, length(p.prefix)) = p.prefix "
+                             "ORDER BY length(p.prefix) DESC LIMIT 1)";
+        l_ret = l_ret && execQuery(query, "UPDATE movies "
+                                          "SET id_path = " + l_bestPath.arg("p.id") + ", "
+                                              "file_path = substr(file_path, "
+                                                                 + l_bestPath.arg("length(p.prefix)") + " + 1) "
+                                          "WHERE EXISTS (SELECT 1 FROM temp.path_prefix AS p "
+                                                        "WHERE substr(movies.file_path, 1, length(p.prefix)) = p.prefix)",
+                                   Q_FUNC_INFO);
+        if(!l_ret){
+            Macaw::DEBUG(query.lastError().text());
+        }
+        Macaw::DEBUG("[DatabaseManager] " + QString::number(query.numRowsAffected())
+                     + " movie paths made relative");
+        execQuery(query, "DROP TABLE temp.path_prefix", Q_FUNC_INFO, TempTables);
+        Macaw::DEBUG_OUT("[DatabaseManager] upgrade movies table finished");
+    }
+
+    l_ret &= createTableShow(query);
+    l_ret &= createTableEpisodes(query);
+
+    return l_ret;
+}
+
+/**
+ * @brief Migration to v051: full-text search index
+ *
+ * @param query
+ * @return bool
+ */
+bool DatabaseManager::upgradeToV051(QSqlQuery &query)
+{
+    Q_UNUSED(query);
+
+    // Not fatal: without FTS5 the search falls back to LIKE queries
+    initSearchIndex();
+
+    return true;
+}
+
+/**
+ * @brief Migration to v052: secondary indexes, and statistics for the query planner
+ *
+ * @param query
+ * @return bool
+ */
+bool DatabaseManager::upgradeToV052(QSqlQuery &query)
+{
+    bool l_ret = createIndexes(query);
+    l_ret = l_ret && execQuery(query, "ANALYZE", Q_FUNC_INFO);
+    if (!l_ret) {
+        Macaw::DEBUG(query.lastError().text());
+    }
+
+    return l_ret;
+}
+
+/**
+ * @brief Migration to v053: `movies.release_date` and `people.birthday` are stored
+ * as Julian day numbers (INTEGER) instead of "yyyy.MM.dd" strings.
+ *
+ * SQLite cannot change the type of a column, so both tables are copied into new ones.
+ * The triggers and indexes dropped with the old tables are created again.
+ *
+ * @param query
+ * @return bool
+ */
+bool DatabaseManager::upgradeToV053(QSqlQuery &query)
+{
+    // The triggers of the search index use both tables
+    dropSearchTriggers();
+
+    // Text dates have the form yyyy.MM.dd, anything else becomes NULL
+    QString l_dayNumber = "CASE WHEN typeof(%1) = 'integer' THEN %1 "
+                               "WHEN %1 GLOB '[0-9][0-9][0-9][0-9].[0-9][0-9].[0-9][0-9]' "
+                               "THEN CAST(julianday(replace(%1, '.', '-')) + 0.5 AS INTEGER) "
+                               "ELSE NULL END";
+
+    bool l_ret = createTableMovies(query, "movies_new");
+    l_ret = l_ret && execQuery(query, "INSERT INTO movies_new (id, title, original_title, "
+                                          "release_date, country, duration, synopsis, id_path, "
+                                          "file_path, poster_path, colored, format, suffix, rank, "
+                                          "imported, id_tmdb, show) "
+                                      "SELECT id, title, original_title, "
+                                          + l_dayNumber.arg("release_date") + ", "
+                                          "country, duration, synopsis, id_path, file_path, poster_path, "
+                                          "colored, format, suffix, rank, imported, id_tmdb, show "
+                                      "FROM movies", Q_FUNC_INFO);
+    l_ret = l_ret && execQuery(query, "DROP TABLE movies", Q_FUNC_INFO);
+    l_ret = l_ret && execQuery(query, "ALTER TABLE movies_new RENAME TO movies", Q_FUNC_INFO);
+
+    l_ret = l_ret && createTablePeople(query, "people_new");
+    l_ret = l_ret && execQuery(query, "INSERT INTO people_new "
+                                      "SELECT id, name, "
+                                          + l_dayNumber.arg("birthday") + ", "
+                                          "biography, imported, id_tmdb "
+                                      "FROM people", Q_FUNC_INFO);
+    l_ret = l_ret && execQuery(query, "DROP TABLE people", Q_FUNC_INFO);
+    l_ret = l_ret && execQuery(query, "ALTER TABLE people_new RENAME TO people", Q_FUNC_INFO);
+
+    l_ret = l_ret && createIndexes(query);
+    l_ret = l_ret && execQuery(query, "ANALYZE", Q_FUNC_INFO);
+    if (!l_ret) {
+        Macaw::DEBUG(query.lastError().text());
+    }
+
+    // The search triggers are created again by initSearchIndex(), called by createTables()
+
+    return l_ret;
+}
+
+/**
+ * @brief Migration to v054: table `facet_counts`, the number of movies of each
+ * people and tag, kept up to date by triggers
+ *
+ * The table is made and filled by initFacetCounts(), called by createTables()
+ * after the migrations, as its triggers read columns added by later migrations.
+ *
+ * @param query
+ * @return bool
+ */
+bool DatabaseManager::upgradeToV054(QSqlQuery &query)
+{
+    Q_UNUSED(query);
+
+    return true;
+}
+
+/**
+ * @brief Migration to v055: table `scan_state`, for the incremental scans
+ *
+ * @param query
+ * @return bool
+ */
+bool DatabaseManager::upgradeToV055(QSqlQuery &query)
+{
+    return createTableScanState(query);
+}
+
+/**
+ * @brief Migration to v056: `movies.missing_since`, so that a movie whose file
+ * is not found anymore is kept for a while instead of being removed, and
+ * `scan_state.device`, to know when a movies path is on another disk. The index
+ * of the missing movies is made by createIndexes(), after the migrations.
+ *
+ * The facet triggers are dropped, initFacetCounts() makes them again without
+ * the missing movies and counts the facets.
+ *
+ * The columns may already be there, when the tables were made by an older migration.
+ *
+ * @param query
+ * @return bool
+ */
+bool DatabaseManager::upgradeToV056(QSqlQuery &query)
+{
+    bool l_ret = true;
+    if (!m_db.record("movies").contains("missing_since")) {
+        l_ret = execQuery(query, "ALTER TABLE movies ADD COLUMN missing_since INTEGER", Q_FUNC_INFO);
+    }
+    if (l_ret && !m_db.record("scan_state").contains("device")) {
+        l_ret = execQuery(query, "ALTER TABLE scan_state ADD COLUMN device INTEGER NOT NULL DEFAULT 0",
+                          Q_FUNC_INFO);
+    }
+    if (!l_ret) {
+        Macaw::DEBUG(query.lastError().text());
+    }
+    dropFacetTriggers();
+
+    return l_ret;
+}
+
+/**
+ * @brief Migration to v057: `movies.fingerprint`, to find the files that were moved.
+ * See FileFingerprint. Its index is made by createIndexes(), after the migrations.
+ *
+ * The column may already be there, when the table was made again by upgradeToV053().
+ *
+ * @param query
+ * @return bool
+ */
+bool DatabaseManager::upgradeToV057(QSqlQuery &query)
+{
+    if (m_db.record("movies").contains("fingerprint")) {
+
+        return true;
+    }
+
+    bool l_ret = execQuery(query, "ALTER TABLE movies ADD COLUMN fingerprint BLOB", Q_FUNC_INFO);
+    if (!l_ret) {
+        Macaw::DEBUG(query.lastError().text());
+    }
+
+    return l_ret;
+}
@@ -23,7 +23,8 @@
 
 PathForMovies::PathForMovies(QString path, bool movies, bool shows) :
     m_id(0),
-    m_path(path)
+    m_path(path),
+    m_imported(false)
 {
     setMovies(movies);
     setShows(shows);
@@ -86,3 +87,13 @@ void PathForMovies::setType(const int type)
 {
     m_type = type;
 }
+
+bool PathForMovies::isImported() const
+{
+    return m_imported;
+}
+
+void PathForMovies::setImported(const bool imported)
+{
+    m_imported = imported;
+}
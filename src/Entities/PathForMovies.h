@@ -41,11 +41,14 @@ public:
     void setShows(const bool shows);
     int type() const;
     void setType(int type);
+    bool isImported() const;
+    void setImported(const bool imported);
 
 private:
     int m_id;
     QString m_path;
     int m_type;
+    bool m_imported;
 };
 
 #endif // PATHFORMOVIES_H
@@ -0,0 +1,160 @@
+/* Copyright (C) 2014 Macaw-Movies
+ * (Olivier CHURLAUD, Sébastien TOUZÉ)
+ *
+ * This file is part of Macaw-Movies.
+ *
+ * Macaw-Movies is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Macaw-Movies is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Macaw-Movies.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ENTITYCACHE_H
+#define ENTITYCACHE_H
+
+#include <QCache>
+#include <QList>
+
+/**
+ * @brief Identity map of entities read from the database, keyed by their id
+ *
+ * Each entry belongs to a write generation (see DatabaseManager::writeGeneration()).
+ * As soon as the generation given to find() or insert() differs from the one of
+ * the entries, the whole cache is dropped: any write makes it stale.
+ * The least recently used entries are removed when `maxSize` is reached.
+ *
+ * The cache can also be marked complete when it holds the whole table.
+ */
+template <typename T>
+class EntityCache
+{
+public:
+    explicit EntityCache(int maxSize = 2000) :
+        m_cache(maxSize),
+        m_generation(-1),
+        m_completeCount(-1),
+        m_hits(0),
+        m_misses(0) {}
+
+    /**
+     * @brief Copies the entity `id` into `entity` if it is cached
+     *
+     * @param int id of the entity
+     * @param int current write generation
+     * @param T entity, set on success
+     * @return bool true on a hit
+     */
+    bool find(int id, int generation, T &entity)
+    {
+        checkGeneration(generation);
+
+        T *l_entity = m_cache.object(id);
+        if (l_entity == NULL)
+        {
+            m_misses++;
+
+            return false;
+        }
+        m_hits++;
+        entity = *l_entity;
+
+        return true;
+    }
+
+    /**
+     * @brief Stores a copy of an entity just read from the database
+     *
+     * @param int id of the entity
+     * @param int write generation at the time of the read
+     * @param T entity
+     */
+    void insert(int id, int generation, const T &entity)
+    {
+        checkGeneration(generation);
+        m_cache.insert(id, new T(entity));
+    }
+
+    /**
+     * @brief Marks the cache as holding the whole table, see isComplete()
+     *
+     * @param int write generation at the time of the read
+     */
+    void setComplete(int generation)
+    {
+        checkGeneration(generation);
+        m_completeCount = m_cache.size();
+    }
+
+    /**
+     * @brief Whether the cache still holds the whole table: nothing was written
+     * nor evicted since setComplete()
+     *
+     * @param int current write generation
+     * @return bool
+     */
+    bool isComplete(int generation)
+    {
+        checkGeneration(generation);
+
+        return m_completeCount >= 0 && m_completeCount == m_cache.size();
+    }
+
+    /**
+     * @brief All the cached entities. Counts as one hit.
+     *
+     * @return QList<T>
+     */
+    QList<T> values()
+    {
+        QList<T> l_list;
+        foreach (int l_id, m_cache.keys())
+        {
+            l_list.append(*m_cache.object(l_id));
+        }
+        m_hits++;
+
+        return l_list;
+    }
+
+    void clear()
+    {
+        m_cache.clear();
+        m_completeCount = -1;
+    }
+
+    int maxSize() const { return m_cache.maxCost(); }
+    void setMaxSize(int maxSize) { m_cache.setMaxCost(maxSize); }
+    int size() const { return m_cache.size(); }
+    int hits() const { return m_hits; }
+    int misses() const { return m_misses; }
+
+private:
+    void checkGeneration(int generation)
+    {
+        if (generation != m_generation)
+        {
+            clear();
+            m_generation = generation;
+        }
+    }
+
+    QCache<int, T> m_cache;
+    int m_generation;
+
+    /**
+     * @brief Number of entries when setComplete() was called, -1 if not complete
+     */
+    int m_completeCount;
+    int m_hits;
+    int m_misses;
+};
+
+#endif // ENTITYCACHE_H
@@ -21,6 +21,7 @@
 
 #include <QEventLoop>
 #include <QMessageBox>
+#include <QSet>
 #include <QTimer>
 
 #include "DatabaseManager.h"
@@ -52,12 +53,35 @@ FetchMetadata::~FetchMetadata()
     Macaw::DEBUG("[FetchMetadata] Object destructed");
 }
 
+/**
+ * @brief Adds movies to the queue. The movies already queued or being processed
+ * are skipped: each scan asks for all the movies not imported yet.
+ *
+ * @param QList<Movie> movieList
+ */
 void FetchMetadata::addMoviesToQueue(const QList<Movie> &movieList)
 {
     Macaw::DEBUG("[FetchMetadata] Add movies to the queue list");
 
-    m_movieQueue.append(movieList);
-    if (m_movieQueue.count() == movieList.count()) {
+    QSet<int> l_queuedIdSet;
+    l_queuedIdSet.insert(m_movie.id());
+    foreach (Movie l_movie, m_movieQueue) {
+        l_queuedIdSet.insert(l_movie.id());
+    }
+    QList<Movie> l_movieList;
+    foreach (Movie l_movie, movieList) {
+        if (!l_queuedIdSet.contains(l_movie.id())) {
+            l_queuedIdSet.insert(l_movie.id());
+            l_movieList.append(l_movie);
+        }
+    }
+    if (l_movieList.isEmpty()) {
+
+        return;
+    }
+
+    m_movieQueue.append(l_movieList);
+    if (m_movieQueue.count() == l_movieList.count()) {
         this->startMovieProcess();
     }
 }
@@ -0,0 +1,450 @@
+/* Copyright (C) 2014 Macaw-Movies
+ * (Olivier CHURLAUD, Sébastien TOUZÉ)
+ *
+ * This file is part of Macaw-Movies.
+ *
+ * Macaw-Movies is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Macaw-Movies is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Macaw-Movies.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "DirectoryWalker.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QMap>
+#include <QMutexLocker>
+#include <QThreadPool>
+
+#include <cerrno>
+#include <cstring>
+
+#include "MacawDebug.h"
+
+#ifdef Q_OS_UNIX
+    #include <dirent.h>
+    #include <sys/stat.h>
+#endif
+
+/**
+ * @brief Constructor
+ *
+ * @param int capacity, number of items above which push() waits
+ */
+ScanQueue::ScanQueue(int capacity) :
+    m_capacity(qMax(1, capacity)),
+    m_pendingDirectoryCount(0),
+    m_canceled(false)
+{
+}
+
+/**
+ * @brief Adds an item, waits while the queue is full
+ *
+ * @param ScanItem item
+ */
+void ScanQueue::push(const ScanItem &item)
+{
+    QMutexLocker l_locker(&m_mutex);
+    while (m_itemQueue.size() >= m_capacity && !m_canceled) {
+        m_notFull.wait(&m_mutex);
+    }
+    if (m_canceled) {
+
+        return;
+    }
+    m_itemQueue.enqueue(item);
+    m_notEmpty.wakeOne();
+}
+
+/**
+ * @brief Takes up to `maxCount` items, waits for some up to `timeout` milliseconds.
+ * `itemList` may be empty when the time is out.
+ *
+ * @param QList<ScanItem> itemList, receives the items
+ * @param int maxCount
+ * @param int timeout
+ * @return false once the scan is canceled, or over and all its items taken
+ */
+bool ScanQueue::pop(QList<ScanItem> &itemList, int maxCount, int timeout)
+{
+    QMutexLocker l_locker(&m_mutex);
+    if (m_itemQueue.isEmpty() && m_pendingDirectoryCount > 0 && !m_canceled) {
+        m_notEmpty.wait(&m_mutex, timeout);
+    }
+    if (m_canceled) {
+
+        return false;
+    }
+    if (m_itemQueue.isEmpty()) {
+
+        return m_pendingDirectoryCount > 0;
+    }
+
+    while (!m_itemQueue.isEmpty() && itemList.size() < maxCount) {
+        itemList.append(m_itemQueue.dequeue());
+    }
+    m_notFull.wakeAll();
+
+    return true;
+}
+
+/**
+ * @brief Counts a directory to walk. Must be called before its walker is started.
+ */
+void ScanQueue::addDirectory()
+{
+    QMutexLocker l_locker(&m_mutex);
+    m_pendingDirectoryCount++;
+}
+
+/**
+ * @brief Counts a directory as walked, its subdirectories being already counted
+ */
+void ScanQueue::directoryDone()
+{
+    QMutexLocker l_locker(&m_mutex);
+    m_pendingDirectoryCount--;
+    if (m_pendingDirectoryCount == 0) {
+        m_notEmpty.wakeAll();
+    }
+}
+
+/**
+ * @brief Drops the items and wakes everybody up. The walkers not started yet do nothing.
+ */
+void ScanQueue::cancel()
+{
+    QMutexLocker l_locker(&m_mutex);
+    m_canceled = true;
+    m_itemQueue.clear();
+    m_notEmpty.wakeAll();
+    m_notFull.wakeAll();
+}
+
+bool ScanQueue::isCanceled() const
+{
+    QMutexLocker l_locker(&m_mutex);
+
+    return m_canceled;
+}
+
+/**
+ * @brief Constructor. The directory must have been counted by ScanQueue::addDirectory().
+ *
+ * @param ScanContext context of the movies path
+ * @param ScanQueue queue receiving the files
+ * @param QString relativePath of the directory, empty for the movies path itself
+ */
+DirectoryWalker::DirectoryWalker(ScanContext *context, ScanQueue *queue, const QString &relativePath) :
+    m_context(context),
+    m_queue(queue),
+    m_relativePath(relativePath)
+{
+}
+
+void DirectoryWalker::run()
+{
+    if (!m_queue->isCanceled()) {
+        walk();
+    }
+    m_queue->directoryDone();
+}
+
+/**
+ * @brief Device of a path, so that the paths of different disks are walked by different pools
+ *
+ * @param QString path
+ * @return quint64, 0 when unknown
+ */
+quint64 DirectoryWalker::deviceOf(const QString &path)
+{
+#ifdef Q_OS_UNIX
+    struct stat l_stat;
+    if (::stat(QFile::encodeName(path).constData(), &l_stat) == 0) {
+
+        return l_stat.st_dev;
+    }
+#else
+    Q_UNUSED(path);
+#endif
+
+    return 0;
+}
+
+void DirectoryWalker::walk()
+{
+    QString l_absolutePath = m_context->moviesPath.path() + '/' + m_relativePath;
+    QString l_prefix = m_relativePath.isEmpty() ? QString() : m_relativePath + '/';
+
+    DirectoryState l_state;
+    l_state.path = m_relativePath;
+    int l_error = statDirectory(l_absolutePath, l_state);
+    if (l_error != 0) {
+        // The files of a directory that is gone are gone with it, not the ones of
+        // a directory that cannot be read
+        if (l_error != ENOENT && l_error != ENOTDIR) {
+            markFailed(l_absolutePath, l_error);
+        }
+
+        return;
+    }
+    {
+        QMutexLocker l_locker(&m_context->mutex);
+        m_context->foundPathSet.insert(m_relativePath);
+    }
+
+    bool l_known = m_context->storedStateHash.contains(m_relativePath);
+    DirectoryState l_storedState = m_context->storedStateHash.value(m_relativePath);
+    bool l_sameDevice = l_storedState.device == 0 || l_storedState.device == l_state.device;
+
+    // Another disk mounted there, or its empty mount point when it is not mounted
+    if (m_relativePath.isEmpty() && l_known
+            && (!l_sameDevice || l_storedState.inode != l_state.inode)) {
+        QMutexLocker l_locker(&m_context->mutex);
+        m_context->rootChanged = true;
+    }
+
+    if (l_known
+            && l_storedState.mtime != 0
+            && l_storedState.mtime == l_state.mtime
+            && l_storedState.inode == l_state.inode
+            && l_sameDevice) {
+        m_context->skippedDirectoryCount.ref();
+        if (m_relativePath.isEmpty()) {
+            QMutexLocker l_locker(&m_context->mutex);
+            m_context->rootEntryCount = l_storedState.entryCount;
+        }
+        foreach (QString l_childPath, m_context->storedChildHash.value(m_relativePath)) {
+            startWalker(l_childPath);
+        }
+
+        return;
+    }
+
+    QStringList l_directoryList;
+    QFileInfoList l_fileList;
+    l_error = listDirectory(l_absolutePath, l_state, l_directoryList, l_fileList);
+    if (l_error != 0) {
+        markFailed(l_absolutePath, l_error);
+
+        return;
+    }
+    m_context->listedDirectoryCount.ref();
+    foreach (QString l_name, l_directoryList) {
+        startWalker(l_prefix + l_name);
+    }
+
+    if (l_state.mtime > m_context->racyLimit) {
+        l_state.mtime = 0;
+    }
+    {
+        QMutexLocker l_locker(&m_context->mutex);
+        m_context->stateList.append(l_state);
+        if (m_relativePath.isEmpty()) {
+            m_context->rootEntryCount = l_state.entryCount;
+        }
+    }
+
+    if (l_known
+            && l_storedState.entryCount == l_state.entryCount
+            && l_storedState.listHash == l_state.listHash) {
+
+        return;
+    }
+    {
+        QMutexLocker l_locker(&m_context->mutex);
+        m_context->changedPathSet.insert(m_relativePath);
+    }
+
+    foreach (QFileInfo l_fileInfo, l_fileList) {
+        if (m_context->authorizedSuffixList.contains(l_fileInfo.suffix(), Qt::CaseInsensitive)) {
+            ScanItem l_item;
+            l_item.context = m_context;
+            l_item.relativePath = l_prefix + l_fileInfo.fileName();
+            l_item.fileInfo = l_fileInfo;
+            m_queue->push(l_item);
+        }
+    }
+}
+
+/**
+ * @brief Starts the walker of a subdirectory in the pool of the movies path
+ *
+ * @param QString relativePath of the subdirectory
+ */
+void DirectoryWalker::startWalker(const QString &relativePath)
+{
+    m_queue->addDirectory();
+    m_context->threadPool->start(new DirectoryWalker(m_context, m_queue, relativePath));
+}
+
+/**
+ * @brief Marks the directory as failed: the files under it are kept, and the
+ * states of the movies path are not saved
+ *
+ * @param QString path of the directory
+ * @param int error, the `errno` of the failure
+ */
+void DirectoryWalker::markFailed(const QString &path, int error)
+{
+    Macaw::DEBUG("[DirectoryWalker] Cannot read " + path + ": " + QString(strerror(error)));
+
+    QMutexLocker l_locker(&m_context->mutex);
+    m_context->failedPathSet.insert(m_relativePath);
+}
+
+/**
+ * @brief Reads the mtime, the inode and the device of a directory
+ *
+ * @param QString path
+ * @param DirectoryState state, receives the values
+ * @return int 0, or the `errno` of the failure: ENOTDIR if `path` is not a directory
+ */
+int DirectoryWalker::statDirectory(const QString &path, DirectoryState &state)
+{
+#ifdef Q_OS_UNIX
+    struct stat l_stat;
+    if (::stat(QFile::encodeName(path).constData(), &l_stat) != 0) {
+
+        return errno;
+    }
+    if (!S_ISDIR(l_stat.st_mode)) {
+
+        return ENOTDIR;
+    }
+    state.mtime = qint64(l_stat.st_mtime) * 1000;
+    state.inode = l_stat.st_ino;
+    state.device = l_stat.st_dev;
+#else
+    QFileInfo l_fileInfo(path);
+    if (!l_fileInfo.exists()) {
+
+        return ENOENT;
+    }
+    if (!l_fileInfo.isDir()) {
+
+        return ENOTDIR;
+    }
+    state.mtime = l_fileInfo.lastModified().toMSecsSinceEpoch();
+    state.inode = 0;
+    state.device = 0;
+#endif
+
+    return 0;
+}
+
+/**
+ * @brief Lists a directory, and sets the number of entries and their hash in `state`.
+ * Links to directories are not followed, the hidden entries are skipped.
+ *
+ * The listing fails as a whole if the directory cannot be read to the end:
+ * a part of its entries would look removed.
+ *
+ * @param QString path
+ * @param DirectoryState state
+ * @param QStringList directoryList, receives the names of the subdirectories
+ * @param QFileInfoList fileList, receives the files
+ * @return int 0, or the `errno` of the failure
+ */
+int DirectoryWalker::listDirectory(const QString &path, DirectoryState &state,
+                                   QStringList &directoryList, QFileInfoList &fileList)
+{
+    // Whether each entry is a directory, by name: sorted like QDir::Name
+    QMap<QString, bool> l_entryMap;
+
+#ifdef Q_OS_UNIX
+    QByteArray l_encodedPath = QFile::encodeName(path);
+    DIR *l_dir = ::opendir(l_encodedPath.constData());
+    if (l_dir == NULL) {
+
+        return errno;
+    }
+
+    int l_error = 0;
+    forever {
+        errno = 0;
+        struct dirent *l_dirent = ::readdir(l_dir);
+        if (l_dirent == NULL) {
+            l_error = errno;
+            break;
+        }
+        if (l_dirent->d_name[0] == '.') {
+            continue;
+        }
+
+        QByteArray l_entryPath = l_encodedPath + '/' + l_dirent->d_name;
+        bool l_isDir = l_dirent->d_type == DT_DIR;
+        bool l_isLink = l_dirent->d_type == DT_LNK;
+        struct stat l_stat;
+        if (l_dirent->d_type == DT_UNKNOWN) {
+            if (::lstat(l_entryPath.constData(), &l_stat) != 0) {
+                continue;
+            }
+            l_isDir = S_ISDIR(l_stat.st_mode);
+            l_isLink = S_ISLNK(l_stat.st_mode);
+        }
+        if (l_isLink) {
+            // Broken links are skipped, as by QDir
+            if (::stat(l_entryPath.constData(), &l_stat) != 0) {
+                continue;
+            }
+            l_isDir = S_ISDIR(l_stat.st_mode);
+        }
+
+        QString l_name = QFile::decodeName(l_dirent->d_name);
+        l_entryMap.insert(l_name, l_isDir);
+        if (l_isDir && !l_isLink) {
+            directoryList.append(l_name);
+        }
+    }
+    ::closedir(l_dir);
+    if (l_error != 0) {
+        directoryList.clear();
+
+        return l_error;
+    }
+#else
+    QDir l_dir(path);
+    if (!l_dir.isReadable()) {
+
+        return EACCES;
+    }
+    QFileInfoList l_entryList = l_dir.entryInfoList(QDir::Dirs | QDir::Files | QDir::NoDotAndDotDot);
+    foreach (QFileInfo l_entry, l_entryList) {
+        l_entryMap.insert(l_entry.fileName(), l_entry.isDir());
+        if (l_entry.isDir() && !l_entry.isSymLink()) {
+            directoryList.append(l_entry.fileName());
+        }
+    }
+#endif
+
+    directoryList.sort();
+    QCryptographicHash l_hash(QCryptographicHash::Sha1);
+    QMapIterator<QString, bool> l_iterator(l_entryMap);
+    while (l_iterator.hasNext()) {
+        l_iterator.next();
+        if (l_iterator.value()) {
+            l_hash.addData(QFile::encodeName(l_iterator.key() + "/\n"));
+        } else {
+            fileList.append(QFileInfo(path + '/' + l_iterator.key()));
+            l_hash.addData(QFile::encodeName(l_iterator.key() + "\n"));
+        }
+    }
+
+    state.entryCount = l_entryMap.count();
+    state.listHash = l_hash.result();
+
+    return 0;
+}
@@ -0,0 +1,140 @@
+/* Copyright (C) 2014 Macaw-Movies
+ * (Olivier CHURLAUD, Sébastien TOUZÉ)
+ *
+ * This file is part of Macaw-Movies.
+ *
+ * Macaw-Movies is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Macaw-Movies is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Macaw-Movies.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DIRECTORYWALKER_H
+#define DIRECTORYWALKER_H
+
+#include <QAtomicInt>
+#include <QFileInfo>
+#include <QFileInfoList>
+#include <QHash>
+#include <QMutex>
+#include <QQueue>
+#include <QRunnable>
+#include <QSet>
+#include <QStringList>
+#include <QWaitCondition>
+
+#include "DatabaseManager.h"
+#include "Entities/PathForMovies.h"
+
+class QThreadPool;
+
+/**
+ * @brief What the walkers of one movies path share during a scan
+ */
+struct ScanContext
+{
+    ScanContext() : racyLimit(0), threadPool(NULL), rootChanged(false), rootEntryCount(-1),
+                    failed(false) {}
+
+    PathForMovies moviesPath;
+
+    // Read-only during the walk
+    QHash<QString, DirectoryState> storedStateHash;
+    QHash<QString, QStringList> storedChildHash;    // subdirectories, by directory
+    QStringList authorizedSuffixList;
+    qint64 racyLimit;   // directories modified after it are saved with mtime 0
+    QThreadPool *threadPool;
+
+    QAtomicInt listedDirectoryCount;
+    QAtomicInt skippedDirectoryCount;
+
+    // Protected by `mutex`
+    QMutex mutex;
+    QList<DirectoryState> stateList;
+    QSet<QString> foundPathSet;
+    QSet<QString> changedPathSet;   // directories listed with new entries, all their files pushed
+    QSet<QString> failedPathSet;    // directories that could not be read, with their subdirectories
+    bool rootChanged;               // the movies path is not the directory of the last scan
+    int rootEntryCount;
+
+    // Only used by the thread committing the movies
+    bool failed;
+    QSet<QString> seenFileSet;
+};
+
+/**
+ * @brief A file found by a DirectoryWalker, that may be a new movie
+ */
+struct ScanItem
+{
+    ScanContext *context;
+    QString relativePath;   // relative to the movies path
+    QFileInfo fileInfo;
+};
+
+/**
+ * @brief Bounded queue between the walkers and the thread committing the movies.
+ *
+ * The walkers wait while it is full, so that a fast disk cannot fill the memory.
+ * It also counts the directories left to walk, to know when the scan is over.
+ */
+class ScanQueue
+{
+public:
+    explicit ScanQueue(int capacity);
+    void push(const ScanItem &item);
+    bool pop(QList<ScanItem> &itemList, int maxCount, int timeout);
+    void addDirectory();
+    void directoryDone();
+    void cancel();
+    bool isCanceled() const;
+
+private:
+    mutable QMutex m_mutex;
+    QWaitCondition m_notEmpty;
+    QWaitCondition m_notFull;
+    QQueue<ScanItem> m_itemQueue;
+    int m_capacity;
+    int m_pendingDirectoryCount;
+    bool m_canceled;
+};
+
+/**
+ * @brief Walks one directory of a movies path, in a thread pool.
+ *
+ * The files with an authorized suffix are pushed to the ScanQueue, and a
+ * new DirectoryWalker is started for each subdirectory. A directory whose
+ * mtime and inode did not change since the last scan is not listed: its
+ * subdirectories are taken from `scan_state`. A directory that cannot be
+ * read is marked as failed: the files under it are not known to be gone.
+ * See LibraryScanner.
+ */
+class DirectoryWalker : public QRunnable
+{
+public:
+    DirectoryWalker(ScanContext *context, ScanQueue *queue, const QString &relativePath);
+    void run();
+    static quint64 deviceOf(const QString &path);
+
+private:
+    void walk();
+    static int statDirectory(const QString &path, DirectoryState &state);
+    static int listDirectory(const QString &path, DirectoryState &state,
+                             QStringList &directoryList, QFileInfoList &fileList);
+    void markFailed(const QString &path, int error);
+    void startWalker(const QString &relativePath);
+
+    ScanContext *m_context;
+    ScanQueue *m_queue;
+    QString m_relativePath;
+};
+
+#endif // DIRECTORYWALKER_H
@@ -0,0 +1,116 @@
+/* Copyright (C) 2014 Macaw-Movies
+ * (Olivier CHURLAUD, Sébastien TOUZÉ)
+ *
+ * This file is part of Macaw-Movies.
+ *
+ * Macaw-Movies is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Macaw-Movies is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Macaw-Movies.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "FileFingerprint.h"
+
+#include <QCryptographicHash>
+#include <QFile>
+#include <QRunnable>
+#include <QThreadPool>
+#include <QVector>
+#include <QtEndian>
+
+static const qint64 s_sampleSize = 64 * 1024;
+
+/**
+ * @brief Computes one fingerprint in a thread pool, see FileFingerprint::computeAll()
+ */
+class FingerprintTask : public QRunnable
+{
+public:
+    FingerprintTask(const QString &filePath, QByteArray *fingerprint) :
+        m_filePath(filePath),
+        m_fingerprint(fingerprint)
+    {
+    }
+
+    void run()
+    {
+        *m_fingerprint = FileFingerprint::compute(m_filePath);
+    }
+
+private:
+    QString m_filePath;
+    QByteArray *m_fingerprint;
+};
+
+/**
+ * @brief Computes the fingerprint of a file
+ *
+ * @param QString filePath, absolute
+ * @return QByteArray, empty if the file cannot be read or is empty
+ */
+QByteArray FileFingerprint::compute(const QString &filePath)
+{
+    QFile l_file(filePath);
+    if (!l_file.open(QIODevice::ReadOnly)) {
+
+        return QByteArray();
+    }
+
+    qint64 l_size = l_file.size();
+    if (l_size <= 0) {
+
+        return QByteArray();
+    }
+
+    QCryptographicHash l_hash(QCryptographicHash::Sha1);
+    l_hash.addData(l_file.read(s_sampleSize));
+
+    // The end is read without reading the start again for the small files
+    if (l_size > s_sampleSize) {
+        if (!l_file.seek(qMax(s_sampleSize, l_size - s_sampleSize))) {
+
+            return QByteArray();
+        }
+        l_hash.addData(l_file.read(s_sampleSize));
+    }
+
+    QByteArray l_fingerprint(8, 0);
+    qToBigEndian<quint64>(l_size, reinterpret_cast<uchar*>(l_fingerprint.data()));
+    l_fingerprint.append(l_hash.result());
+
+    return l_fingerprint;
+}
+
+/**
+ * @brief Computes the fingerprints of several files at the same time, in a thread pool.
+ * Returns when they are all computed.
+ *
+ * @param QStringList filePathList
+ * @param QThreadPool threadPool, only used for these computations; NULL to compute
+ * them in the calling thread
+ * @return QList<QByteArray> fingerprints, in the order of `filePathList`
+ */
+QList<QByteArray> FileFingerprint::computeAll(const QStringList &filePathList, QThreadPool *threadPool)
+{
+    QVector<QByteArray> l_fingerprintVector(filePathList.size());
+    for (int i = 0 ; i < filePathList.size() ; i++) {
+        if (threadPool) {
+            threadPool->start(new FingerprintTask(filePathList.at(i), &l_fingerprintVector[i]));
+        } else {
+            l_fingerprintVector[i] = compute(filePathList.at(i));
+        }
+    }
+    if (threadPool) {
+        threadPool->waitForDone();
+    }
+
+    return l_fingerprintVector.toList();
+}
@@ -0,0 +1,43 @@
+/* Copyright (C) 2014 Macaw-Movies
+ * (Olivier CHURLAUD, Sébastien TOUZÉ)
+ *
+ * This file is part of Macaw-Movies.
+ *
+ * Macaw-Movies is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Macaw-Movies is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Macaw-Movies.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FILEFINGERPRINT_H
+#define FILEFINGERPRINT_H
+
+#include <QByteArray>
+#include <QList>
+#include <QStringList>
+
+class QThreadPool;
+
+/**
+ * @brief Fingerprint of the content of a file, to recognize it after a move or a rename
+ *
+ * It is made of the size of the file (8 bytes, big endian) followed by the SHA-1
+ * of its first and last 64 KiB. Only 128 KiB are read, whatever the size of the
+ * file: two different movies almost never have the same.
+ */
+class FileFingerprint
+{
+public:
+    static QByteArray compute(const QString &filePath);
+    static QList<QByteArray> computeAll(const QStringList &filePathList, QThreadPool *threadPool);
+};
+
+#endif // FILEFINGERPRINT_H
@@ -0,0 +1,626 @@
+/* Copyright (C) 2014 Macaw-Movies
+ * (Olivier CHURLAUD, Sébastien TOUZÉ)
+ *
+ * This file is part of Macaw-Movies.
+ *
+ * Macaw-Movies is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Macaw-Movies is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Macaw-Movies.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "LibraryScanner.h"
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QMetaType>
+#include <QThread>
+#include <QThreadPool>
+
+#include "MacawDebug.h"
+#include "LibraryScanner/DirectoryWalker.h"
+#include "LibraryScanner/FileFingerprint.h"
+#include "LibraryScanner/LibraryWatcher.h"
+
+// Time after which a movie whose file is missing is removed, in milliseconds
+static const qint64 s_missingDelay = qint64(30) * 24 * 3600 * 1000;
+
+/**
+ * @brief Constructor
+ *
+ * @param canceled set when the scan is canceled, owned by LibraryScanner
+ */
+ScanWorker::ScanWorker(QAtomicInt *canceled) :
+    m_databaseManager(NULL),
+    m_canceled(canceled),
+    m_fingerprintPool(NULL),
+    m_addedCount(0),
+    m_removedCount(0),
+    m_movedCount(0),
+    m_missingCount(0)
+{
+}
+
+/**
+ * @brief Scans the movies paths, see LibraryScanner.
+ * moviesImported() is emitted after each batch, progress() about 4 times per second.
+ *
+ * The files of the database are loaded at once, the files found are checked in memory.
+ * At the end, the movies whose file was not found anymore get the new file with the
+ * same fingerprint if there is one (see FileFingerprint), as the movies that were
+ * already missing, or are marked as missing. The movies missing for too long are removed. The files that have no fingerprint
+ * yet get one.
+ *
+ * @param QList<PathForMovies> moviesPathList
+ * @param int threadsPerDisk, number of walkers of each disk
+ */
+void ScanWorker::scan(QList<PathForMovies> moviesPathList, int threadsPerDisk)
+{
+    Macaw::DEBUG_IN("[ScanWorker] Enters scan()");
+    m_databaseManager = DatabaseManager::createThreadWriter();
+    m_addedCount = 0;
+    m_removedCount = 0;
+    m_movedCount = 0;
+    m_missingCount = 0;
+    m_knownFileHash = m_databaseManager->getKnownMovieFiles();
+    m_missingFileHash = m_databaseManager->getMissingMovieFiles();
+
+    ScanQueue l_queue(4 * m_databaseManager->insertBatchSize());
+    QHash<quint64, QThreadPool*> l_threadPoolHash;
+    QList<ScanContext*> l_contextList;
+    QStringList l_authorizedSuffixList = LibraryScanner::authorizedSuffixList();
+
+    // A directory modified just before its listing may change again
+    // without changing its mtime, if the file system stores it in seconds
+    qint64 l_racyLimit = QDateTime::currentMSecsSinceEpoch() - 2000;
+
+    foreach (PathForMovies l_moviesPath, moviesPathList) {
+        ScanContext *l_context = new ScanContext;
+        l_context->moviesPath = l_moviesPath;
+        l_context->storedStateHash = m_databaseManager->getDirectoryStates(l_moviesPath.id());
+        foreach (QString l_path, l_context->storedStateHash.keys()) {
+            if (!l_path.isEmpty()) {
+                l_context->storedChildHash[l_path.left(qMax(0, l_path.lastIndexOf('/')))].append(l_path);
+            }
+        }
+        l_context->authorizedSuffixList = l_authorizedSuffixList;
+        l_context->racyLimit = l_racyLimit;
+
+        quint64 l_device = DirectoryWalker::deviceOf(l_moviesPath.path());
+        if (!l_threadPoolHash.contains(l_device)) {
+            QThreadPool *l_threadPool = new QThreadPool;
+            l_threadPool->setMaxThreadCount(threadsPerDisk);
+            l_threadPoolHash.insert(l_device, l_threadPool);
+        }
+        l_context->threadPool = l_threadPoolHash.value(l_device);
+        l_contextList.append(l_context);
+    }
+
+    // The fingerprints are computed while the walkers run
+    m_fingerprintPool = new QThreadPool;
+    m_fingerprintPool->setMaxThreadCount(threadsPerDisk * qMax(1, l_threadPoolHash.count()));
+
+    // All the movies paths are counted first, so that the queue
+    // does not look over when the first one is done
+    for (int i = 0 ; i < l_contextList.count() ; i++) {
+        l_queue.addDirectory();
+    }
+    foreach (ScanContext *l_context, l_contextList) {
+        l_context->threadPool->start(new DirectoryWalker(l_context, &l_queue, QString()));
+    }
+
+    QHash<ScanContext*, QList<Movie> > l_newMovieHash;
+    QList<ScanItem> l_itemList;
+    QElapsedTimer l_scanTimer;
+    QElapsedTimer l_progressTimer;
+    QElapsedTimer l_flushTimer;
+    l_scanTimer.start();
+    l_progressTimer.start();
+    l_flushTimer.start();
+    while (l_queue.pop(l_itemList, m_databaseManager->insertBatchSize(), 200)) {
+        if (m_canceled->load()) {
+            l_queue.cancel();
+            break;
+        }
+        addItems(l_itemList, l_newMovieHash);
+        l_itemList.clear();
+
+        // The movies found are shown within a second, even if a batch is not full
+        if (l_flushTimer.elapsed() > 1000) {
+            foreach (ScanContext *l_context, l_newMovieHash.keys()) {
+                insertMovies(l_context, l_newMovieHash[l_context]);
+            }
+            l_flushTimer.restart();
+        }
+
+        if (l_progressTimer.elapsed() > 250) {
+            int l_directoryCount = 0;
+            foreach (ScanContext *l_context, l_contextList) {
+                l_directoryCount += l_context->listedDirectoryCount.load()
+                                    + l_context->skippedDirectoryCount.load();
+            }
+            emit progress(l_directoryCount, m_addedCount,
+                          int(l_directoryCount * 1000 / qMax(qint64(1), l_scanTimer.elapsed())));
+            l_progressTimer.restart();
+        }
+    }
+
+    bool l_canceled = m_canceled->load();
+    if (l_canceled) {
+        l_queue.cancel();
+    }
+    foreach (QThreadPool *l_threadPool, l_threadPoolHash.values()) {
+        l_threadPool->waitForDone();
+    }
+
+    int l_listedCount = 0;
+    int l_skippedCount = 0;
+    QList<Movie> l_vanishedMovieList;
+    QList<int> l_checkedPathIdList;
+    foreach (ScanContext *l_context, l_contextList) {
+        l_listedCount += l_context->listedDirectoryCount.load();
+        l_skippedCount += l_context->skippedDirectoryCount.load();
+        if (l_canceled) {
+            continue;
+        }
+
+        insertMovies(l_context, l_newMovieHash[l_context]);
+
+        int l_moviesPathId = l_context->moviesPath.id();
+
+        // The movies path may be on a disk that is not mounted: its files are kept
+        if (!l_context->foundPathSet.contains(QString())) {
+            Macaw::DEBUG("[ScanWorker] Movies path not found: " + l_context->moviesPath.path());
+            continue;
+        }
+        if (l_context->rootChanged) {
+            Macaw::DEBUG("[ScanWorker] Movies path changed since the last scan: "
+                         + l_context->moviesPath.path());
+        } else if (l_context->rootEntryCount == 0 && !m_knownFileHash.value(l_moviesPathId).isEmpty()) {
+            Macaw::DEBUG("[ScanWorker] Movies path empty: " + l_context->moviesPath.path());
+        } else {
+            l_vanishedMovieList.append(vanishedMovies(l_context));
+            if (!l_context->failed && l_context->failedPathSet.isEmpty()) {
+                l_checkedPathIdList.append(l_moviesPathId);
+            }
+        }
+        if (l_context->failed || !l_context->failedPathSet.isEmpty()) {
+            continue;
+        }
+
+        QStringList l_removedPathList;
+        foreach (QString l_path, l_context->storedStateHash.keys()) {
+            if (!l_context->foundPathSet.contains(l_path)) {
+                l_removedPathList.append(l_path);
+            }
+        }
+        m_databaseManager->updateDirectoryStates(l_context->moviesPath.id(),
+                                                 l_context->stateList, l_removedPathList);
+        if (!l_context->moviesPath.isImported()) {
+            m_databaseManager->setMoviesPathImported(l_context->moviesPath.path(), true);
+        }
+    }
+
+    // A file may have been moved from a movies path to another one
+    if (!l_canceled) {
+        m_databaseManager->setMoviesMissing(m_foundMovieIdList, false);
+        markVanishedMovies(l_vanishedMovieList);
+        relinkMissingMovies();
+        foreach (int l_moviesPathId, l_checkedPathIdList) {
+            removeMissingMovies(l_moviesPathId);
+        }
+        foreach (ScanContext *l_context, l_contextList) {
+            if (l_context->foundPathSet.contains(QString())) {
+                addMissingFingerprints(l_context->moviesPath.id());
+            }
+        }
+    }
+
+    qDeleteAll(l_threadPoolHash);
+    qDeleteAll(l_contextList);
+    delete m_fingerprintPool;
+    m_fingerprintPool = NULL;
+    m_knownFileHash.clear();
+    m_missingFileHash.clear();
+    m_foundMovieIdList.clear();
+    m_newMovieFingerprintHash.clear();
+    delete m_databaseManager;
+    m_databaseManager = NULL;
+
+    Macaw::DEBUG_OUT("[ScanWorker] Exits scan(): "
+                     + QString::number(l_listedCount) + " directories listed, "
+                     + QString::number(l_skippedCount) + " unchanged, "
+                     + QString::number(m_addedCount) + " movies added, "
+                     + QString::number(m_missingCount) + " marked as missing, "
+                     + QString::number(m_removedCount) + " removed, "
+                     + QString::number(m_movedCount) + " moved in "
+                     + QString::number(l_scanTimer.elapsed()) + " ms");
+    emit finished(m_addedCount, m_removedCount, m_movedCount, l_canceled);
+}
+
+/**
+ * @brief Keeps the files that are not in the database yet,
+ * and adds them by batches of DatabaseManager::insertBatchSize()
+ *
+ * @param QList<ScanItem> itemList
+ * @param QHash<ScanContext*, QList<Movie> > newMovieHash, new movies not added yet
+ */
+void ScanWorker::addItems(const QList<ScanItem> &itemList, QHash<ScanContext*, QList<Movie> > &newMovieHash)
+{
+    foreach (ScanItem l_item, itemList) {
+        int l_moviesPathId = l_item.context->moviesPath.id();
+        l_item.context->seenFileSet.insert(l_item.relativePath);
+        if (m_knownFileHash.value(l_moviesPathId).contains(l_item.relativePath)) {
+            int l_missingMovieId = m_missingFileHash.value(l_moviesPathId).value(l_item.relativePath);
+            if (l_missingMovieId > 0) {
+                m_foundMovieIdList.append(l_missingMovieId);
+            }
+            continue;
+        }
+
+        QList<Movie> &l_movieList = newMovieHash[l_item.context];
+        l_movieList.append(LibraryScanner::newMovie(l_item.context->moviesPath,
+                                                  l_item.fileInfo, l_item.relativePath));
+        if (l_movieList.size() >= m_databaseManager->insertBatchSize()) {
+            insertMovies(l_item.context, l_movieList);
+        }
+    }
+}
+
+/**
+ * @brief Finds the movies whose file was not found by a scan.
+ *
+ * Only the files of the directories listed with new entries are seen: the
+ * files of the other directories are still there. The files of a directory
+ * that was not found are gone with it. The files under a directory that
+ * could not be read are kept, as the ones already missing.
+ *
+ * @param ScanContext context of the movies path
+ * @return QList<Movie>
+ */
+QList<Movie> ScanWorker::vanishedMovies(ScanContext *context)
+{
+    QList<Movie> l_movieList;
+    QHash<QString, int> l_missingFileHash = m_missingFileHash.value(context->moviesPath.id());
+    foreach (QString l_filePath, m_knownFileHash.value(context->moviesPath.id())) {
+        QString l_directoryPath = l_filePath.left(qMax(0, l_filePath.lastIndexOf('/')));
+        if (context->seenFileSet.contains(l_filePath)
+                || l_missingFileHash.contains(l_filePath)
+                || (context->foundPathSet.contains(l_directoryPath)
+                    && !context->changedPathSet.contains(l_directoryPath))) {
+            continue;
+        }
+
+        bool l_unreadable = false;
+        foreach (QString l_failedPath, context->failedPathSet) {
+            if (l_failedPath.isEmpty() || l_filePath.startsWith(l_failedPath + '/')) {
+                l_unreadable = true;
+                break;
+            }
+        }
+        if (l_unreadable) {
+            continue;
+        }
+        l_movieList.append(m_databaseManager->getMoviesByFilePath(context->moviesPath.id(),
+                                                                  l_filePath));
+    }
+
+    return l_movieList;
+}
+
+/**
+ * @brief Marks the movies whose file is gone as missing
+ *
+ * @param QList<Movie> movieList, movies whose file is gone
+ */
+void ScanWorker::markVanishedMovies(const QList<Movie> &movieList)
+{
+    QList<int> l_movieIdList;
+    foreach (Movie l_movie, movieList) {
+        l_movieIdList.append(l_movie.id());
+    }
+
+    if (m_databaseManager->setMoviesMissing(l_movieIdList, true)) {
+        m_missingCount += l_movieIdList.count();
+    }
+}
+
+/**
+ * @brief Gives to the missing movies the new file with the same fingerprint, if
+ * there is exactly one of each. The movies missing since an older scan or since
+ * a removal seen by LibraryWatcher are relinked too.
+ */
+void ScanWorker::relinkMissingMovies()
+{
+    QHash<QByteArray, int> l_missingMovieIdHash =
+            m_databaseManager->getMissingMoviesByFingerprint(m_newMovieFingerprintHash.keys());
+
+    QHashIterator<QByteArray, int> l_iterator(l_missingMovieIdHash);
+    while (l_iterator.hasNext()) {
+        l_iterator.next();
+        int l_newMovieId = m_newMovieFingerprintHash.value(l_iterator.key());
+        if (l_iterator.value() > 0 && l_newMovieId > 0
+                && m_databaseManager->relinkMovie(l_iterator.value(), l_newMovieId)) {
+            m_movedCount++;
+            m_addedCount--;
+        }
+    }
+}
+
+/**
+ * @brief Removes the movies of a movies path whose file has been missing for too long.
+ * Only called when the whole movies path could be read.
+ *
+ * @param int moviesPathId
+ */
+void ScanWorker::removeMissingMovies(const int moviesPathId)
+{
+    QList<Movie> l_movieList = m_databaseManager->getMoviesMissingSince(
+                moviesPathId, QDateTime::currentMSecsSinceEpoch() - s_missingDelay);
+    if (!l_movieList.isEmpty() && m_databaseManager->deleteMovies(l_movieList)) {
+        m_removedCount += l_movieList.count();
+    }
+}
+
+/**
+ * @brief Computes the fingerprints of the files of some movies, and saves them
+ *
+ * @param QList<Movie> movieList, the movies that are not in the database are skipped
+ * @param bool added, true for the movies added by this scan, kept by fingerprint
+ * for relinkMissingMovies()
+ */
+void ScanWorker::fingerprintMovies(const QList<Movie> &movieList, bool added)
+{
+    QStringList l_filePathList;
+    QList<int> l_movieIdList;
+    foreach (Movie l_movie, movieList) {
+        if (l_movie.id() > 0) {
+            l_filePathList.append(l_movie.fileAbsolutePath());
+            l_movieIdList.append(l_movie.id());
+        }
+    }
+
+    QList<QByteArray> l_fingerprintList = FileFingerprint::computeAll(l_filePathList, m_fingerprintPool);
+    QHash<int, QByteArray> l_fingerprintHash;
+    for (int i = 0 ; i < l_fingerprintList.size() ; i++) {
+        QByteArray l_fingerprint = l_fingerprintList.at(i);
+        if (l_fingerprint.isEmpty()) {
+            continue;
+        }
+        l_fingerprintHash.insert(l_movieIdList.at(i), l_fingerprint);
+
+        // 0 when several new files have the same
+        if (added) {
+            m_newMovieFingerprintHash.insert(l_fingerprint,
+                                             m_newMovieFingerprintHash.contains(l_fingerprint)
+                                             ? 0 : l_movieIdList.at(i));
+        }
+    }
+    m_databaseManager->updateFingerprints(l_fingerprintHash);
+}
+
+/**
+ * @brief Computes the fingerprints of the files that have none yet, the ones
+ * added before fingerprints existed for instance
+ *
+ * @param int moviesPathId
+ */
+void ScanWorker::addMissingFingerprints(const int moviesPathId)
+{
+    QList<Movie> l_movieList = m_databaseManager->getMoviesWithoutFingerprint(moviesPathId);
+    int l_batchSize = m_databaseManager->insertBatchSize();
+    for (int l_begin = 0 ; l_begin < l_movieList.size() ; l_begin += l_batchSize) {
+        if (m_canceled->load()) {
+
+            return;
+        }
+        fingerprintMovies(l_movieList.mid(l_begin, l_batchSize), false);
+    }
+}
+
+/**
+ * @brief Adds a batch of new movies to the database and empties `movieList`
+ *
+ * @param ScanContext context of the movies path, marked as failed if a movie is not added
+ * @param QList<Movie> movieList
+ */
+void ScanWorker::insertMovies(ScanContext *context, QList<Movie> &movieList)
+{
+    if (movieList.isEmpty()) {
+
+        return;
+    }
+
+    int l_batchCount = m_databaseManager->insertMovies(movieList, context->moviesPath.id()).count();
+    if (l_batchCount != movieList.count()) {
+        context->failed = true;
+    }
+    m_addedCount += l_batchCount;
+    emit moviesImported(l_batchCount, m_addedCount);
+
+    fingerprintMovies(movieList, true);
+    movieList.clear();
+}
+
+/**
+ * @brief Constructor. Starts the scan thread, with the worker and the watcher.
+ *
+ * @param parent
+ */
+LibraryScanner::LibraryScanner(QObject *parent) :
+    QObject(parent),
+    m_running(false),
+    m_threadsPerDisk(4)
+{
+    // Types sent between the threads by queued signals
+    qRegisterMetaType<QList<PathForMovies> >("QList<PathForMovies>");
+    qRegisterMetaType<QList<Movie> >("QList<Movie>");
+
+    m_thread = new QThread(this);
+    m_worker = new ScanWorker(&m_canceled);
+    m_worker->moveToThread(m_thread);
+    m_watcher = new LibraryWatcher;
+    m_watcher->moveToThread(m_thread);
+
+    connect(this, SIGNAL(scanRequested(QList<PathForMovies>,int)),
+            m_worker, SLOT(scan(QList<PathForMovies>,int)));
+    connect(m_worker, SIGNAL(moviesImported(int,int)),
+            this, SIGNAL(moviesImported(int,int)));
+    connect(m_worker, SIGNAL(progress(int,int,int)),
+            this, SIGNAL(progress(int,int,int)));
+    connect(m_worker, SIGNAL(finished(int,int,int,bool)),
+            this, SLOT(on_worker_finished(int,int,int,bool)));
+    connect(m_watcher, SIGNAL(moviesChanged(QList<Movie>,int)),
+            this, SIGNAL(moviesChanged(QList<Movie>,int)));
+    connect(m_watcher, SIGNAL(rescanRequested()),
+            this, SIGNAL(rescanRequested()));
+    connect(QCoreApplication::instance(), SIGNAL(aboutToQuit()),
+            this, SLOT(stop()));
+
+    m_thread->start();
+}
+
+/**
+ * @brief Destructor. Cancels the scan and stops the scan thread.
+ */
+LibraryScanner::~LibraryScanner()
+{
+    stop();
+    delete m_worker;
+    delete m_watcher;
+    Macaw::DEBUG("[LibraryScanner] Destructed");
+}
+
+/**
+ * @brief Suffixes of the files considered as movies
+ *
+ * @return QStringList
+ */
+QStringList LibraryScanner::authorizedSuffixList()
+{
+    QStringList l_authorizedSuffixList;
+    l_authorizedSuffixList << "mkv"
+                           << "avi"
+                           << "mp4"
+                           << "mpg"
+                           << "flv"
+                           << "mov"
+                           << "m4v";
+
+    return l_authorizedSuffixList;
+}
+
+/**
+ * @brief Makes the movie of a new file
+ *
+ * @param PathForMovies moviesPath containing the file
+ * @param QFileInfo fileInfo of the file
+ * @param QString relativePath of the file, relative to the movies path
+ * @return Movie
+ */
+Movie LibraryScanner::newMovie(const PathForMovies &moviesPath, const QFileInfo &fileInfo,
+                               const QString &relativePath)
+{
+    Movie l_movie;
+    l_movie.setTitle(fileInfo.completeBaseName());
+    l_movie.setFileAbsolutePath(fileInfo.absoluteFilePath());
+    l_movie.setFileRelativePath(relativePath);
+    l_movie.setSuffix(fileInfo.suffix());
+
+    if (!moviesPath.hasMovies()) {
+        l_movie.setShow(true);
+    } else if (!moviesPath.hasShows()) {
+        l_movie.setShow(false);
+    }
+
+    return l_movie;
+}
+
+/**
+ * @brief Sets the number of directories walked at the same time on each disk.
+ * Used by the next scan.
+ *
+ * @param int threadsPerDisk, at least 1
+ */
+void LibraryScanner::setThreadsPerDisk(int threadsPerDisk)
+{
+    m_threadsPerDisk = qMax(1, threadsPerDisk);
+}
+
+/**
+ * @brief Starts a scan of the movies paths. finished() is emitted at the end.
+ *
+ * @param QList<PathForMovies> moviesPathList
+ * @return false if a scan is already running
+ */
+bool LibraryScanner::start(const QList<PathForMovies> &moviesPathList)
+{
+    if (m_running || !m_thread->isRunning())
+    {
+        return false;
+    }
+
+    m_running = true;
+    m_canceled.store(0);
+    emit scanRequested(moviesPathList, m_threadsPerDisk);
+
+    return true;
+}
+
+/**
+ * @brief Watches the directories of the movies paths saved by the last scan,
+ * see LibraryWatcher::watchMoviesPaths(). Should be called after each complete scan.
+ */
+void LibraryScanner::watchMoviesPaths()
+{
+    QMetaObject::invokeMethod(m_watcher, "watchMoviesPaths", Qt::QueuedConnection);
+}
+
+/**
+ * @brief Cancels the running scan. The movies already added stay in the database.
+ */
+void LibraryScanner::cancel()
+{
+    m_canceled.store(1);
+}
+
+/**
+ * @brief Cancels the running scan and stops the scan thread
+ */
+void LibraryScanner::stop()
+{
+    if (!m_thread->isRunning())
+    {
+        return;
+    }
+
+    cancel();
+    // Waits for the end of the scan, if one is running
+    QMetaObject::invokeMethod(m_watcher, "stop", Qt::BlockingQueuedConnection);
+    m_thread->quit();
+    m_thread->wait();
+}
+
+/**
+ * @brief Slot triggered when the worker is done with a scan
+ *
+ * @param int addedCount number of movies added
+ * @param int removedCount number of movies removed, their file having been missing for too long
+ * @param int movedCount number of movies whose file was moved
+ * @param bool canceled
+ */
+void LibraryScanner::on_worker_finished(int addedCount, int removedCount, int movedCount,
+                                        bool canceled)
+{
+    m_running = false;
+    emit finished(addedCount, removedCount, movedCount, canceled);
+}
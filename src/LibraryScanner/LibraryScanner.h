@@ -0,0 +1,177 @@
+/* Copyright (C) 2014 Macaw-Movies
+ * (Olivier CHURLAUD, Sébastien TOUZÉ)
+ *
+ * This file is part of Macaw-Movies.
+ *
+ * Macaw-Movies is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Macaw-Movies is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Macaw-Movies.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LIBRARYSCANNER_H
+#define LIBRARYSCANNER_H
+
+#include <QAtomicInt>
+#include <QFileInfo>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QSet>
+#include <QStringList>
+
+#include "DatabaseManager.h"
+#include "Entities/Movie.h"
+#include "Entities/PathForMovies.h"
+
+class LibraryWatcher;
+class QThread;
+class QThreadPool;
+struct ScanContext;
+struct ScanItem;
+
+/**
+ * @brief Runs the scans of LibraryScanner in the scan thread.
+ * Should not be used directly.
+ */
+class ScanWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ScanWorker(QAtomicInt *canceled);
+
+public slots:
+    void scan(QList<PathForMovies> moviesPathList, int threadsPerDisk);
+
+signals:
+    void moviesImported(int batchCount, int addedCount);
+    void progress(int directoryCount, int addedCount, int directoriesPerSecond);
+    void finished(int addedCount, int removedCount, int movedCount, bool canceled);
+
+private:
+    void addItems(const QList<ScanItem> &itemList, QHash<ScanContext*, QList<Movie> > &newMovieHash);
+    void insertMovies(ScanContext *context, QList<Movie> &movieList);
+    QList<Movie> vanishedMovies(ScanContext *context);
+    void markVanishedMovies(const QList<Movie> &movieList);
+    void relinkMissingMovies();
+    void removeMissingMovies(const int moviesPathId);
+    void fingerprintMovies(const QList<Movie> &movieList, bool added);
+    void addMissingFingerprints(const int moviesPathId);
+
+    /**
+     * @brief Made by DatabaseManager::createThreadWriter() for each scan, in the scan thread
+     */
+    DatabaseManager *m_databaseManager;
+    QAtomicInt *m_canceled;
+    QThreadPool *m_fingerprintPool;
+    int m_addedCount;
+    int m_removedCount;
+    int m_movedCount;
+    int m_missingCount;
+
+    /**
+     * @brief Files of the database when the scan started, by movies path id
+     */
+    QHash<int, QSet<QString> > m_knownFileHash;
+
+    /**
+     * @brief Ids of the movies marked as missing when the scan started,
+     * by relative path of their file, by movies path id
+     */
+    QHash<int, QHash<QString, int> > m_missingFileHash;
+
+    /**
+     * @brief Movies marked as missing whose file was found again
+     */
+    QList<int> m_foundMovieIdList;
+
+    /**
+     * @brief Movies added by the scan, by fingerprint of their file
+     */
+    QHash<QByteArray, int> m_newMovieFingerprintHash;
+};
+
+/**
+ * @brief Finds the new movie files of the movies paths and adds them to the database,
+ * without blocking the main thread
+ *
+ * The directories are walked by DirectoryWalker, on one thread pool per disk so
+ * that several disks are read at the same time. The files found are put in a
+ * bounded ScanQueue. The scan thread takes them from it and adds the new movies
+ * to the database in batches, with its own connection.
+ *
+ * The state of every directory (mtime, inode, number of entries and hash of
+ * their names) is saved in `scan_state` after a scan. The next scan only reads
+ * the mtime and inode of a directory: if they did not change, its entries did not
+ * either, and its subdirectories are taken from `scan_state` without listing it.
+ * A directory that is listed again with the same entries is not checked against
+ * the database. The states are saved only for a complete scan, which also finds
+ * the movies whose file is gone, and links them to their file if it was moved.
+ *
+ * A movie whose file is gone is not removed at once: it is marked as missing,
+ * and removed when it has been missing for 30 days. A movies path
+ * that is not found, that is empty, or that is not the directory of the last scan
+ * (a disk that is not mounted) keeps its movies, as the directories that cannot
+ * be read keep the files under them.
+ *
+ * Between the scans, the LibraryWatcher of the scan thread applies the changes
+ * of the files: the scans and the watcher never write at the same time.
+ */
+class LibraryScanner : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit LibraryScanner(QObject *parent = 0);
+    ~LibraryScanner();
+    bool start(const QList<PathForMovies> &moviesPathList);
+    bool isRunning() const { return m_running; }
+    int threadsPerDisk() const { return m_threadsPerDisk; }
+    void setThreadsPerDisk(int threadsPerDisk);
+    static QStringList authorizedSuffixList();
+    static Movie newMovie(const PathForMovies &moviesPath, const QFileInfo &fileInfo,
+                          const QString &relativePath);
+
+signals:
+    void moviesImported(int batchCount, int addedCount);
+    void progress(int directoryCount, int addedCount, int directoriesPerSecond);
+    void finished(int addedCount, int removedCount, int movedCount, bool canceled);
+
+    // Sent by the watcher, see LibraryWatcher
+    void moviesChanged(const QList<Movie> &addedMovieList, int missingCount);
+    void rescanRequested();
+
+    // Sent to the worker
+    void scanRequested(QList<PathForMovies> moviesPathList, int threadsPerDisk);
+
+public slots:
+    void watchMoviesPaths();
+    void cancel();
+    void stop();
+
+private slots:
+    void on_worker_finished(int addedCount, int removedCount, int movedCount, bool canceled);
+
+private:
+    QThread *m_thread;
+    ScanWorker *m_worker;
+    LibraryWatcher *m_watcher;
+    bool m_running;
+    int m_threadsPerDisk;
+
+    /**
+     * @brief Set by cancel(). Shared with the worker, which reads it from the scan thread.
+     */
+    QAtomicInt m_canceled;
+};
+
+#endif // LIBRARYSCANNER_H
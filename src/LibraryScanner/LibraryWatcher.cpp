@@ -0,0 +1,754 @@
+/* Copyright (C) 2014 Macaw-Movies
+ * (Olivier CHURLAUD, Sébastien TOUZÉ)
+ *
+ * This file is part of Macaw-Movies.
+ *
+ * Macaw-Movies is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Macaw-Movies is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Macaw-Movies.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "LibraryWatcher.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSocketNotifier>
+
+#include "DatabaseManager.h"
+#include "MacawDebug.h"
+#include "Entities/Movie.h"
+#include "LibraryScanner/FileFingerprint.h"
+#include "LibraryScanner/LibraryScanner.h"
+
+#ifdef Q_OS_LINUX
+    #include <errno.h>
+    #include <string.h>
+    #include <sys/inotify.h>
+    #include <unistd.h>
+
+    static const quint32 s_watchMask = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO
+                                       | IN_CLOSE_WRITE | IN_ONLYDIR | IN_DONT_FOLLOW | IN_EXCL_UNLINK;
+#endif
+
+/**
+ * @brief Constructor. Nothing is watched before watchMoviesPaths().
+ * The timers are children of the watcher, so that they follow it to the scan thread.
+ *
+ * @param parent
+ */
+LibraryWatcher::LibraryWatcher(QObject *parent) :
+    QObject(parent),
+    m_databaseManager(NULL),
+    m_fd(-1),
+    m_socketNotifier(NULL),
+    m_watchLimitReached(false),
+    m_applyTimer(this),
+    m_pollTimer(this)
+{
+    m_authorizedSuffixList = LibraryScanner::authorizedSuffixList();
+
+    m_applyTimer.setSingleShot(true);
+    m_applyTimer.setInterval(250);
+    connect(&m_applyTimer, SIGNAL(timeout()),
+            this, SLOT(applyChanges()));
+
+    m_pollTimer.setInterval(5 * 60 * 1000);
+    connect(&m_pollTimer, SIGNAL(timeout()),
+            this, SIGNAL(rescanRequested()));
+
+#ifdef Q_OS_LINUX
+    m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_fd < 0) {
+        Macaw::DEBUG("[LibraryWatcher] inotify not available: " + QString(strerror(errno)));
+    }
+#endif
+
+    if (!isActive()) {
+        Macaw::DEBUG("[LibraryWatcher] The movies paths will be rescanned regularly");
+    }
+}
+
+/**
+ * @brief Destructor. Removes all the watches. stop() must have been called
+ * in the scan thread before.
+ */
+LibraryWatcher::~LibraryWatcher()
+{
+#ifdef Q_OS_LINUX
+    if (m_fd >= 0) {
+        ::close(m_fd);
+    }
+#endif
+    Macaw::DEBUG("[LibraryWatcher] Destructed");
+}
+
+/**
+ * @brief Stops the timers and the notifier, and deletes the manager of the
+ * database. Called in the scan thread before it finishes.
+ */
+void LibraryWatcher::stop()
+{
+    m_applyTimer.stop();
+    m_pollTimer.stop();
+    delete m_socketNotifier;
+    m_socketNotifier = NULL;
+    delete m_databaseManager;
+    m_databaseManager = NULL;
+}
+
+/**
+ * @brief Gets the manager of the scan thread, created on first use
+ *
+ * @return DatabaseManager*
+ */
+DatabaseManager *LibraryWatcher::databaseManager()
+{
+    if (m_databaseManager == NULL) {
+        m_databaseManager = DatabaseManager::createThreadWriter();
+    }
+
+    return m_databaseManager;
+}
+
+/**
+ * @brief Whether the movies paths are watched, or rescanned regularly
+ *
+ * @return bool
+ */
+bool LibraryWatcher::isActive() const
+{
+    return m_fd >= 0;
+}
+
+/**
+ * @brief Watches all the directories of the movies paths, as saved by the last scan.
+ * Should be called after each complete scan. The directories that are not there
+ * anymore are not watched anymore.
+ */
+void LibraryWatcher::watchMoviesPaths()
+{
+    if (!isActive()) {
+        m_pollTimer.start();
+
+        return;
+    }
+    Macaw::DEBUG_IN("[LibraryWatcher] Enters watchMoviesPaths()");
+
+#ifdef Q_OS_LINUX
+    // Made here, in the thread of the watcher
+    if (m_socketNotifier == NULL) {
+        m_socketNotifier = new QSocketNotifier(m_fd, QSocketNotifier::Read, this);
+        connect(m_socketNotifier, SIGNAL(activated(int)),
+                this, SLOT(on_socketNotifier_activated()));
+    }
+#endif
+
+    QList<PathForMovies> l_moviesPathList = databaseManager()->getMoviesPaths(false);
+    l_moviesPathList.append(databaseManager()->getMoviesPaths(true));
+    m_moviesPathHash.clear();
+    m_watchLimitReached = false;
+
+    // Watching a directory again gives the same watch descriptor
+    QSet<int> l_watchSet;
+    foreach (PathForMovies l_moviesPath, l_moviesPathList) {
+        m_moviesPathHash.insert(l_moviesPath.id(), l_moviesPath);
+        QStringList l_directoryList = databaseManager()->getDirectoryStates(l_moviesPath.id()).keys();
+        if (!l_directoryList.contains(QString())) {
+            l_directoryList.append(QString());
+        }
+
+        foreach (QString l_relativePath, l_directoryList) {
+            int l_wd = addWatch(l_moviesPath.id(), l_relativePath);
+            if (l_wd >= 0) {
+                l_watchSet.insert(l_wd);
+            }
+        }
+    }
+
+    QMutableHashIterator<int, WatchedDirectory> l_iterator(m_watchHash);
+    while (l_iterator.hasNext()) {
+        l_iterator.next();
+        if (!l_watchSet.contains(l_iterator.key())) {
+#ifdef Q_OS_LINUX
+            inotify_rm_watch(m_fd, l_iterator.key());
+#endif
+            l_iterator.remove();
+        }
+    }
+
+    // The directories that are not watched are rescanned regularly
+    if (m_watchLimitReached) {
+        m_pollTimer.start();
+    } else {
+        m_pollTimer.stop();
+    }
+
+    Macaw::DEBUG_OUT("[LibraryWatcher] Exits watchMoviesPaths(): "
+                     + QString::number(m_watchHash.count()) + " directories watched");
+}
+
+void LibraryWatcher::on_socketNotifier_activated()
+{
+    readEvents();
+    if (!m_applyTimer.isActive()
+            && (!m_addedFileHash.isEmpty() || !m_writtenFileHash.isEmpty()
+                || !m_changeList.isEmpty() || !m_moveSourceHash.isEmpty())) {
+        m_applyTimer.start();
+    }
+}
+
+/**
+ * @brief Reads all the pending inotify events, and keeps the changes for applyChanges()
+ */
+void LibraryWatcher::readEvents()
+{
+#ifdef Q_OS_LINUX
+    bool l_overflow = false;
+    QByteArray l_buffer(64 * 1024, 0);
+
+    forever {
+        ssize_t l_length = ::read(m_fd, l_buffer.data(), l_buffer.size());
+        if (l_length <= 0) {
+            break;
+        }
+
+        ssize_t l_offset = 0;
+        while (l_offset + ssize_t(sizeof(struct inotify_event)) <= l_length) {
+            struct inotify_event l_event;
+            memcpy(&l_event, l_buffer.constData() + l_offset, sizeof(l_event));
+            const char *l_name = l_buffer.constData() + l_offset + sizeof(l_event);
+            l_offset += sizeof(l_event) + l_event.len;
+
+            if (l_event.mask & IN_Q_OVERFLOW) {
+                l_overflow = true;
+                continue;
+            }
+            if (l_event.mask & IN_IGNORED) {
+                m_watchHash.remove(l_event.wd);
+                continue;
+            }
+            // The events of the watched directory itself are followed by IN_IGNORED if needed
+            if (l_event.len == 0 || !m_watchHash.contains(l_event.wd)) {
+                continue;
+            }
+
+            QString l_fileName = QFile::decodeName(l_name);
+            if (l_fileName.startsWith('.')) {
+                continue;
+            }
+            WatchedDirectory l_directory = m_watchHash.value(l_event.wd);
+            QString l_relativePath = l_directory.relativePath.isEmpty()
+                                     ? l_fileName
+                                     : l_directory.relativePath + '/' + l_fileName;
+            bool l_isDirectory = l_event.mask & IN_ISDIR;
+
+            if (l_event.mask & IN_MOVED_FROM) {
+                MoveSource l_source;
+                l_source.moviesPathId = l_directory.moviesPathId;
+                l_source.relativePath = l_relativePath;
+                l_source.isDirectory = l_isDirectory;
+                m_moveSourceHash.insert(l_event.cookie, l_source);
+            } else if (l_event.mask & IN_MOVED_TO) {
+                if (m_moveSourceHash.contains(l_event.cookie)) {
+                    moveEntry(m_moveSourceHash.take(l_event.cookie), l_directory.moviesPathId,
+                              l_relativePath, l_isDirectory);
+                } else {
+                    addEntry(l_directory.moviesPathId, l_relativePath, l_isDirectory);
+                }
+                // A file renamed once written, a download for instance
+                if (!l_isDirectory && isMovieFile(l_relativePath)) {
+                    m_writtenFileHash[l_directory.moviesPathId].insert(l_relativePath);
+                }
+            } else if (l_event.mask & IN_CLOSE_WRITE) {
+                if (isMovieFile(l_relativePath)) {
+                    m_writtenFileHash[l_directory.moviesPathId].insert(l_relativePath);
+                }
+            } else if (l_event.mask & IN_CREATE) {
+                addEntry(l_directory.moviesPathId, l_relativePath, l_isDirectory);
+            } else if (l_event.mask & IN_DELETE) {
+                removeEntry(l_directory.moviesPathId, l_relativePath, l_isDirectory);
+            }
+        }
+    }
+
+    if (l_overflow) {
+        Macaw::DEBUG("[LibraryWatcher] Events lost, rescan requested");
+        emit rescanRequested();
+    }
+#endif
+}
+
+/**
+ * @brief Applies the changes read since the last call to the database.
+ * moviesChanged() gives the movies added, for their metadata to be fetched.
+ *
+ * The movies of the removed files are marked as missing last, so that the
+ * files written meanwhile are fingerprinted before.
+ */
+void LibraryWatcher::applyChanges()
+{
+    Macaw::DEBUG_IN("[LibraryWatcher] Enters applyChanges()");
+    DatabaseManager *l_databaseManager = databaseManager();
+
+    // The moves without a second half went out of the movies paths
+    foreach (MoveSource l_source, m_moveSourceHash.values()) {
+        removeEntry(l_source.moviesPathId, l_source.relativePath, l_source.isDirectory);
+        if (l_source.isDirectory) {
+            removeWatchTree(l_source.moviesPathId, l_source.relativePath);
+        }
+    }
+    m_moveSourceHash.clear();
+
+    QList<Movie> l_addedMovieList;
+    QList<Movie> l_removedMovieList;
+    int l_movedCount = 0;
+    foreach (FileChange l_change, m_changeList) {
+        if (!m_moviesPathHash.contains(l_change.moviesPathId)) {
+            continue;
+        }
+
+        if (l_change.newRelativePath.isEmpty()) {
+            QList<Movie> l_movieList = l_databaseManager->getMoviesByFilePath(l_change.moviesPathId,
+                                                                              l_change.relativePath);
+            foreach (Movie l_movie, l_movieList) {
+                // Removed, then made again
+                if (!QFile::exists(absolutePath(l_change.moviesPathId, l_movie.fileRelativePath()))) {
+                    l_removedMovieList.append(l_movie);
+                }
+            }
+        } else if (l_databaseManager->moveMovieFiles(l_change.moviesPathId,
+                                                     l_change.relativePath,
+                                                     l_change.newMoviesPathId,
+                                                     l_change.newRelativePath)) {
+            l_movedCount++;
+        }
+    }
+    m_changeList.clear();
+
+    foreach (int l_moviesPathId, m_addedFileHash.keys()) {
+        if (!m_moviesPathHash.contains(l_moviesPathId)) {
+            continue;
+        }
+
+        QList<Movie> l_movieList;
+        QList<int> l_foundMovieIdList;
+        foreach (QString l_relativePath, m_addedFileHash.value(l_moviesPathId)) {
+            QFileInfo l_fileInfo(absolutePath(l_moviesPathId, l_relativePath));
+            if (!l_fileInfo.isFile()) {
+                continue;
+            }
+
+            // A missing movie whose file is back
+            QList<Movie> l_knownMovieList = l_databaseManager->getMoviesByFilePath(l_moviesPathId,
+                                                                                   l_relativePath);
+            if (!l_knownMovieList.isEmpty()) {
+                foreach (Movie l_movie, l_knownMovieList) {
+                    l_foundMovieIdList.append(l_movie.id());
+                }
+                continue;
+            }
+            l_movieList.append(LibraryScanner::newMovie(m_moviesPathHash.value(l_moviesPathId),
+                                                        l_fileInfo, l_relativePath));
+        }
+        l_databaseManager->setMoviesMissing(l_foundMovieIdList, false);
+        if (l_movieList.isEmpty()) {
+            continue;
+        }
+
+        // The id of a movie not added is 0
+        l_databaseManager->insertMovies(l_movieList, l_moviesPathId);
+        foreach (Movie l_movie, l_movieList) {
+            if (l_movie.id() > 0) {
+                l_addedMovieList.append(l_movie);
+            }
+        }
+    }
+    m_addedFileHash.clear();
+
+    fingerprintWrittenFiles(l_addedMovieList, l_movedCount);
+    int l_missingCount = markMissingMovies(l_removedMovieList, l_movedCount);
+
+    Macaw::DEBUG_OUT("[LibraryWatcher] Exits applyChanges(): "
+                     + QString::number(l_addedMovieList.count()) + " movies added, "
+                     + QString::number(l_missingCount) + " missing, "
+                     + QString::number(l_movedCount) + " moved");
+    if (!l_addedMovieList.isEmpty() || l_missingCount > 0 || l_movedCount > 0) {
+        emit moviesChanged(l_addedMovieList, l_missingCount);
+    }
+}
+
+/**
+ * @brief Fingerprints the movie files written since the last call. A movie
+ * missing with the same fingerprint gets the file, and its new movie is removed.
+ * See FileFingerprint.
+ *
+ * @param QList<Movie> addedMovieList, the movies added: the ones removed are taken out
+ * @param int movedCount, increased by the number of movies given their file
+ */
+void LibraryWatcher::fingerprintWrittenFiles(QList<Movie> &addedMovieList, int &movedCount)
+{
+    DatabaseManager *l_databaseManager = databaseManager();
+    QStringList l_filePathList;
+    QList<int> l_movieIdList;
+    foreach (int l_moviesPathId, m_writtenFileHash.keys()) {
+        if (!m_moviesPathHash.contains(l_moviesPathId)) {
+            continue;
+        }
+
+        foreach (QString l_relativePath, m_writtenFileHash.value(l_moviesPathId)) {
+            foreach (Movie l_movie, l_databaseManager->getMoviesByFilePath(l_moviesPathId,
+                                                                           l_relativePath)) {
+                l_filePathList.append(absolutePath(l_moviesPathId, l_movie.fileRelativePath()));
+                l_movieIdList.append(l_movie.id());
+            }
+        }
+    }
+    m_writtenFileHash.clear();
+    if (l_movieIdList.isEmpty()) {
+
+        return;
+    }
+
+    // A few files at a time: computed in the scan thread
+    QList<QByteArray> l_fingerprintList = FileFingerprint::computeAll(l_filePathList, NULL);
+    QHash<int, QByteArray> l_fingerprintHash;
+    QHash<QByteArray, int> l_fingerprintCountHash;
+    for (int i = 0 ; i < l_fingerprintList.size() ; i++) {
+        if (!l_fingerprintList.at(i).isEmpty()) {
+            l_fingerprintHash.insert(l_movieIdList.at(i), l_fingerprintList.at(i));
+            l_fingerprintCountHash[l_fingerprintList.at(i)]++;
+        }
+    }
+    l_databaseManager->updateFingerprints(l_fingerprintHash);
+
+    QHash<QByteArray, int> l_missingMovieIdHash =
+            l_databaseManager->getMissingMoviesByFingerprint(l_fingerprintCountHash.keys());
+    QHashIterator<int, QByteArray> l_iterator(l_fingerprintHash);
+    while (l_iterator.hasNext()) {
+        l_iterator.next();
+        int l_movieId = l_iterator.key();
+        QByteArray l_fingerprint = l_iterator.value();
+
+        // Copies of a same file cannot be told apart
+        int l_missingMovieId = l_missingMovieIdHash.value(l_fingerprint);
+        if (l_missingMovieId > 0 && l_missingMovieId != l_movieId
+                && l_fingerprintCountHash.value(l_fingerprint) == 1
+                && l_databaseManager->relinkMovie(l_missingMovieId, l_movieId)) {
+            movedCount++;
+            for (int i = addedMovieList.size() - 1 ; i >= 0 ; i--) {
+                if (addedMovieList.at(i).id() == l_movieId) {
+                    addedMovieList.removeAt(i);
+                }
+            }
+            continue;
+        }
+
+        // For the removal of the original file, if it comes later
+        int l_knownMovieId = m_newMovieFingerprintHash.value(l_fingerprint, l_movieId);
+        m_newMovieFingerprintHash.insert(l_fingerprint, l_knownMovieId == l_movieId ? l_movieId : 0);
+    }
+}
+
+/**
+ * @brief Marks the movies of removed files as missing. A movie whose file was
+ * copied before, in a movies path, is given the copy instead: the new movie of
+ * the copy is removed.
+ *
+ * @param QList<Movie> movieList, movies whose file was removed
+ * @param int movedCount, increased by the number of movies given their file
+ * @return int number of movies marked as missing
+ */
+int LibraryWatcher::markMissingMovies(const QList<Movie> &movieList, int &movedCount)
+{
+    if (movieList.isEmpty()) {
+
+        return 0;
+    }
+
+    DatabaseManager *l_databaseManager = databaseManager();
+    QList<int> l_movieIdList;
+    foreach (Movie l_movie, movieList) {
+        l_movieIdList.append(l_movie.id());
+    }
+    QHash<int, QByteArray> l_fingerprintHash = l_databaseManager->getFingerprintsByMovieIds(l_movieIdList);
+
+    // A new movie whose own file was removed cannot be given to another one
+    QMutableHashIterator<QByteArray, int> l_iterator(m_newMovieFingerprintHash);
+    while (l_iterator.hasNext()) {
+        if (l_movieIdList.contains(l_iterator.next().value())) {
+            l_iterator.remove();
+        }
+    }
+
+    QList<int> l_missingMovieIdList;
+    foreach (int l_movieId, l_movieIdList) {
+        QByteArray l_fingerprint = l_fingerprintHash.value(l_movieId);
+        int l_newMovieId = m_newMovieFingerprintHash.value(l_fingerprint);
+        if (!l_fingerprint.isEmpty() && l_newMovieId > 0
+                && l_databaseManager->relinkMovie(l_movieId, l_newMovieId)) {
+            m_newMovieFingerprintHash.remove(l_fingerprint);
+            movedCount++;
+        } else {
+            l_missingMovieIdList.append(l_movieId);
+        }
+    }
+
+    if (!l_databaseManager->setMoviesMissing(l_missingMovieIdList, true)) {
+
+        return 0;
+    }
+
+    return l_missingMovieIdList.count();
+}
+
+/**
+ * @brief Watches a directory
+ *
+ * @param int moviesPathId
+ * @param QString relativePath of the directory
+ * @return int watch descriptor, -1 if the directory is not watched
+ */
+int LibraryWatcher::addWatch(const int moviesPathId, const QString &relativePath)
+{
+#ifdef Q_OS_LINUX
+    if (m_watchLimitReached) {
+
+        return -1;
+    }
+
+    QByteArray l_path = QFile::encodeName(absolutePath(moviesPathId, relativePath));
+    int l_wd = inotify_add_watch(m_fd, l_path.constData(), s_watchMask);
+    if (l_wd < 0) {
+        if (errno == ENOSPC) {
+            Macaw::DEBUG("[LibraryWatcher] Too many directories to watch, "
+                         "see /proc/sys/fs/inotify/max_user_watches");
+            m_watchLimitReached = true;
+            m_pollTimer.start();
+        }
+
+        return -1;
+    }
+
+    WatchedDirectory l_directory;
+    l_directory.moviesPathId = moviesPathId;
+    l_directory.relativePath = relativePath;
+    m_watchHash.insert(l_wd, l_directory);
+
+    return l_wd;
+#else
+    Q_UNUSED(moviesPathId);
+    Q_UNUSED(relativePath);
+
+    return -1;
+#endif
+}
+
+/**
+ * @brief Stops watching a directory and its subdirectories
+ *
+ * @param int moviesPathId
+ * @param QString relativePath of the directory
+ */
+void LibraryWatcher::removeWatchTree(const int moviesPathId, const QString &relativePath)
+{
+    QMutableHashIterator<int, WatchedDirectory> l_iterator(m_watchHash);
+    while (l_iterator.hasNext()) {
+        l_iterator.next();
+        if (l_iterator.value().moviesPathId == moviesPathId
+                && (l_iterator.value().relativePath == relativePath
+                    || isUnder(l_iterator.value().relativePath, relativePath))) {
+#ifdef Q_OS_LINUX
+            inotify_rm_watch(m_fd, l_iterator.key());
+#endif
+            l_iterator.remove();
+        }
+    }
+}
+
+/**
+ * @brief Follows a directory moved inside its movies path: its watches stay,
+ * but their paths change
+ *
+ * @param int moviesPathId
+ * @param QString oldRelativePath
+ * @param QString newRelativePath
+ */
+void LibraryWatcher::renameWatchTree(const int moviesPathId, const QString &oldRelativePath,
+                                     const QString &newRelativePath)
+{
+    QMutableHashIterator<int, WatchedDirectory> l_iterator(m_watchHash);
+    while (l_iterator.hasNext()) {
+        l_iterator.next();
+        WatchedDirectory &l_directory = l_iterator.value();
+        if (l_directory.moviesPathId == moviesPathId
+                && (l_directory.relativePath == oldRelativePath
+                    || isUnder(l_directory.relativePath, oldRelativePath))) {
+            l_directory.relativePath = newRelativePath
+                                       + l_directory.relativePath.mid(oldRelativePath.length());
+        }
+    }
+}
+
+/**
+ * @brief Watches a new directory and its subdirectories, and adds their movie files.
+ * The directory is watched before being listed, so that no file is missed.
+ *
+ * @param int moviesPathId
+ * @param QString relativePath of the directory
+ */
+void LibraryWatcher::watchNewDirectory(const int moviesPathId, const QString &relativePath)
+{
+    addWatch(moviesPathId, relativePath);
+
+    QFileInfoList l_entryList = QDir(absolutePath(moviesPathId, relativePath))
+                                .entryInfoList(QDir::Dirs | QDir::Files | QDir::NoDotAndDotDot);
+    foreach (QFileInfo l_entry, l_entryList) {
+        QString l_relativePath = relativePath + '/' + l_entry.fileName();
+        if (l_entry.isDir()) {
+            if (!l_entry.isSymLink()) {
+                watchNewDirectory(moviesPathId, l_relativePath);
+            }
+        } else {
+            addEntry(moviesPathId, l_relativePath, false);
+        }
+    }
+}
+
+/**
+ * @brief Keeps a new file, or watches a new directory
+ *
+ * @param int moviesPathId
+ * @param QString relativePath
+ * @param bool isDirectory
+ */
+void LibraryWatcher::addEntry(const int moviesPathId, const QString &relativePath,
+                              const bool isDirectory)
+{
+    if (isDirectory) {
+        watchNewDirectory(moviesPathId, relativePath);
+    } else if (isMovieFile(relativePath)) {
+        m_addedFileHash[moviesPathId].insert(relativePath);
+    }
+}
+
+/**
+ * @brief Keeps the removal of a file or a directory
+ *
+ * @param int moviesPathId
+ * @param QString relativePath
+ * @param bool isDirectory
+ */
+void LibraryWatcher::removeEntry(const int moviesPathId, const QString &relativePath,
+                                 const bool isDirectory)
+{
+    QSet<QString> &l_addedFileSet = m_addedFileHash[moviesPathId];
+    l_addedFileSet.remove(relativePath);
+    if (isDirectory) {
+        QMutableSetIterator<QString> l_iterator(l_addedFileSet);
+        while (l_iterator.hasNext()) {
+            if (isUnder(l_iterator.next(), relativePath)) {
+                l_iterator.remove();
+            }
+        }
+    }
+
+    // The file may also have been added by a scan
+    if (isDirectory || isMovieFile(relativePath)) {
+        FileChange l_change;
+        l_change.moviesPathId = moviesPathId;
+        l_change.relativePath = relativePath;
+        l_change.newMoviesPathId = moviesPathId;
+        m_changeList.append(l_change);
+    }
+}
+
+/**
+ * @brief Keeps the move of a file or a directory. The movies are kept with
+ * their new path, in the same movies path or in another one.
+ *
+ * @param MoveSource source, where the entry was
+ * @param int moviesPathId, where it is now
+ * @param QString relativePath
+ * @param bool isDirectory
+ */
+void LibraryWatcher::moveEntry(const MoveSource &source, const int moviesPathId,
+                               const QString &relativePath, const bool isDirectory)
+{
+    FileChange l_change;
+    l_change.moviesPathId = source.moviesPathId;
+    l_change.relativePath = source.relativePath;
+    l_change.newMoviesPathId = moviesPathId;
+    l_change.newRelativePath = relativePath;
+
+    if (isDirectory) {
+        QStringList l_movedFileList;
+        QMutableSetIterator<QString> l_iterator(m_addedFileHash[source.moviesPathId]);
+        while (l_iterator.hasNext()) {
+            QString l_filePath = l_iterator.next();
+            if (isUnder(l_filePath, source.relativePath)) {
+                l_movedFileList.append(relativePath + l_filePath.mid(source.relativePath.length()));
+                l_iterator.remove();
+            }
+        }
+        foreach (QString l_filePath, l_movedFileList) {
+            m_addedFileHash[moviesPathId].insert(l_filePath);
+        }
+
+        if (source.moviesPathId == moviesPathId) {
+            renameWatchTree(moviesPathId, source.relativePath, relativePath);
+        } else {
+            removeWatchTree(source.moviesPathId, source.relativePath);
+            watchNewDirectory(moviesPathId, relativePath);
+        }
+        m_changeList.append(l_change);
+
+        return;
+    }
+
+    // A file may be renamed from or to another suffix, once fully written for instance
+    bool l_wasMovie = isMovieFile(source.relativePath);
+    bool l_isMovie = isMovieFile(relativePath);
+    bool l_wasAdded = m_addedFileHash[source.moviesPathId].remove(source.relativePath);
+    if (l_wasMovie && l_isMovie) {
+        m_changeList.append(l_change);
+        if (l_wasAdded) {
+            m_addedFileHash[moviesPathId].insert(relativePath);
+        }
+    } else if (l_wasMovie) {
+        removeEntry(source.moviesPathId, source.relativePath, false);
+    } else if (l_isMovie) {
+        addEntry(moviesPathId, relativePath, false);
+    }
+}
+
+bool LibraryWatcher::isMovieFile(const QString &relativePath) const
+{
+    return m_authorizedSuffixList.contains(QFileInfo(relativePath).suffix(), Qt::CaseInsensitive);
+}
+
+QString LibraryWatcher::absolutePath(const int moviesPathId, const QString &relativePath) const
+{
+    QString l_moviesPath = m_moviesPathHash.value(moviesPathId).path();
+
+    return relativePath.isEmpty() ? l_moviesPath : l_moviesPath + '/' + relativePath;
+}
+
+/**
+ * @brief Whether `path` is inside the directory `directoryPath`
+ */
+bool LibraryWatcher::isUnder(const QString &path, const QString &directoryPath)
+{
+    return path.length() > directoryPath.length()
+            && path.startsWith(directoryPath)
+            && path.at(directoryPath.length()) == '/';
+}
@@ -0,0 +1,170 @@
+/* Copyright (C) 2014 Macaw-Movies
+ * (Olivier CHURLAUD, Sébastien TOUZÉ)
+ *
+ * This file is part of Macaw-Movies.
+ *
+ * Macaw-Movies is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Macaw-Movies is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Macaw-Movies.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LIBRARYWATCHER_H
+#define LIBRARYWATCHER_H
+
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QSet>
+#include <QStringList>
+#include <QTimer>
+
+#include "Entities/Movie.h"
+#include "Entities/PathForMovies.h"
+
+class DatabaseManager;
+class QSocketNotifier;
+
+/**
+ * @brief A directory of a movies path watched by LibraryWatcher
+ */
+struct WatchedDirectory
+{
+    int moviesPathId;
+    QString relativePath;   // empty for the movies path itself
+};
+
+/**
+ * @brief A file or directory moved or removed, waiting to be applied to the database
+ */
+struct FileChange
+{
+    int moviesPathId;
+    QString relativePath;
+    int newMoviesPathId;
+    QString newRelativePath;    // empty when removed
+};
+
+/**
+ * @brief The first half of a move, waiting for the second one
+ */
+struct MoveSource
+{
+    int moviesPathId;
+    QString relativePath;
+    bool isDirectory;
+};
+
+/**
+ * @brief Keeps the database up to date with the files of the movies paths,
+ * without scanning them
+ *
+ * On Linux, every directory of the movies paths is watched with inotify. The
+ * directories are taken from the snapshot of the last scan (see LibraryScanner),
+ * the new ones are added as they are created. The creations, moves and deletions
+ * of files are gathered for a short time, then applied to the database at once:
+ * a new file is added within a second. A file moved inside the movies paths keeps
+ * its movie, with its metadata.
+ *
+ * The movie of a removed file is marked as missing, not removed (see LibraryScanner).
+ * A file is fingerprinted once written (see FileFingerprint): a file moved from
+ * another disk is copied, then removed, and its movie is given the copy with the
+ * same fingerprint, whatever comes first.
+ *
+ * If the kernel drops events (queue overflow), rescanRequested() is emitted: the
+ * scan only lists the directories that changed since the snapshot.
+ *
+ * Elsewhere, or if inotify is not available, rescanRequested() is emitted
+ * regularly instead.
+ *
+ * It lives in the scan thread, and is owned by LibraryScanner: the changes are
+ * applied between two scans, never during one, and the new directories are
+ * listed there too. Should not be used directly.
+ */
+class LibraryWatcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit LibraryWatcher(QObject *parent = 0);
+    ~LibraryWatcher();
+    bool isActive() const;
+
+signals:
+    void moviesChanged(const QList<Movie> &addedMovieList, int missingCount);
+    void rescanRequested();
+
+public slots:
+    void watchMoviesPaths();
+    void stop();
+
+private slots:
+    void on_socketNotifier_activated();
+    void applyChanges();
+
+private:
+    void readEvents();
+    int addWatch(const int moviesPathId, const QString &relativePath);
+    void removeWatchTree(const int moviesPathId, const QString &relativePath);
+    void renameWatchTree(const int moviesPathId, const QString &oldRelativePath,
+                         const QString &newRelativePath);
+    void watchNewDirectory(const int moviesPathId, const QString &relativePath);
+    void addEntry(const int moviesPathId, const QString &relativePath, const bool isDirectory);
+    void removeEntry(const int moviesPathId, const QString &relativePath, const bool isDirectory);
+    void moveEntry(const MoveSource &source, const int moviesPathId,
+                   const QString &relativePath, const bool isDirectory);
+    void fingerprintWrittenFiles(QList<Movie> &addedMovieList, int &movedCount);
+    int markMissingMovies(const QList<Movie> &movieList, int &movedCount);
+    bool isMovieFile(const QString &relativePath) const;
+    QString absolutePath(const int moviesPathId, const QString &relativePath) const;
+    static bool isUnder(const QString &path, const QString &directoryPath);
+    DatabaseManager *databaseManager();
+
+    /**
+     * @brief Made by DatabaseManager::createThreadWriter() on first use, in the scan thread
+     */
+    DatabaseManager *m_databaseManager;
+    int m_fd;
+    QSocketNotifier *m_socketNotifier;
+    QHash<int, PathForMovies> m_moviesPathHash;
+    QHash<int, WatchedDirectory> m_watchHash;   // by watch descriptor
+    bool m_watchLimitReached;
+    QStringList m_authorizedSuffixList;
+
+    /**
+     * @brief The events read since the last applyChanges().
+     * The files added are applied after the moves and removals: an addition
+     * followed by another change of the same file is merged into it.
+     */
+    QHash<int, QSet<QString> > m_addedFileHash;    // by movies path id
+    QHash<int, QSet<QString> > m_writtenFileHash;  // by movies path id, to fingerprint
+    QList<FileChange> m_changeList;
+    QHash<quint32, MoveSource> m_moveSourceHash;    // by cookie of the move
+
+    /**
+     * @brief Movies added by the watcher, by fingerprint of their file (0 when
+     * several have the same), for the removals of their original files
+     */
+    QHash<QByteArray, int> m_newMovieFingerprintHash;
+
+    /**
+     * @brief Started by the first event, so that the changes are applied
+     * at most 250 ms after it
+     */
+    QTimer m_applyTimer;
+
+    /**
+     * @brief Requests a rescan regularly when inotify is not available
+     */
+    QTimer m_pollTimer;
+};
+
+#endif // LIBRARYWATCHER_H
@@ -38,11 +38,16 @@ RC_ICONS = img/logov0_256.ico
 
 SOURCES += main.cpp \
     Application.cpp \
+    AsyncDatabaseManager.cpp \
     DatabaseManager.cpp \
+    DatabaseManager_backup.cpp \
+    DatabaseManager_facets.cpp \
     DatabaseManager_getters.cpp \
     DatabaseManager_insert.cpp \
+    DatabaseManager_profiling.cpp \
     DatabaseManager_update.cpp \
     DatabaseManager_delete.cpp \
+    DatabaseManager_upgrade.cpp \
     MacawDebug.cpp \    
     MainWindow.cpp \    
     ServicesManager.cpp \
@@ -55,6 +60,10 @@ SOURCES += main.cpp \
     FetchMetadata/FetchMetadata.cpp \
     FetchMetadata/FetchMetadataDialog.cpp \
     FetchMetadata/FetchMetadataQuery.cpp \
+    LibraryScanner/DirectoryWalker.cpp \
+    LibraryScanner/FileFingerprint.cpp \
+    LibraryScanner/LibraryScanner.cpp \
+    LibraryScanner/LibraryWatcher.cpp \
     MainWindowWidgets/LeftPannel.cpp \
     MainWindowWidgets/MoviesPannel.cpp \
     MainWindowWidgets/MainPannel.cpp \
@@ -71,7 +80,9 @@ SOURCES += main.cpp \
 HEADERS  += \
     include_var.h \
     Application.h \
+    AsyncDatabaseManager.h \
     DatabaseManager.h \
+    EntityCache.h \
     MacawDebug.h \
     MainWindow.h \
     ServicesManager.h \
@@ -84,6 +95,10 @@ HEADERS  += \
     FetchMetadata/FetchMetadataDialog.h \
     FetchMetadata/FetchMetadata.h \
     FetchMetadata/FetchMetadataQuery.h \
+    LibraryScanner/DirectoryWalker.h \
+    LibraryScanner/FileFingerprint.h \
+    LibraryScanner/LibraryScanner.h \
+    LibraryScanner/LibraryWatcher.h \
     MainWindowWidgets/LeftPannel.h \
     MainWindowWidgets/MoviesPannel.h \
     MainWindowWidgets/MainPannel.h \
@@ -20,7 +20,6 @@
 #include "MainWindow.h"
 #include "ui_MainWindow.h"
 
-#include <QDirIterator>
 #include <QMessageBox>
 #include <QSettings>
 
@@ -30,6 +29,7 @@
 #include "MacawDebug.h"
 #include "ServicesManager.h"
 #include "Dialogs/SettingsDialog.h"
+#include "LibraryScanner/LibraryScanner.h"
 #include "MainWindowWidgets/LeftPannel.h"
 #include "MainWindowWidgets/MainPannel.h"
 #include "MainWindowWidgets/MetadataPannel.h"
@@ -76,15 +76,35 @@ MainWindow::MainWindow(QWidget *parent) :
             this, SLOT(selfUpdate()));
     connect(servicesManager, SIGNAL(requestTempStatusBarMessage(QString,int)),
             this, SLOT(putTempStatusBarMessage(QString,int)));
+    connect(servicesManager, SIGNAL(matchingMovieListChanged()),
+            this, SLOT(on_servicesManager_matchingMovieListChanged()));
     connect(m_leftPannel, SIGNAL(updateMainPannel()),
             this, SLOT(updateMainPannel()));
     connect(m_mainPannel, SIGNAL(fillMetadataPannel(Movie)),
             this, SLOT(fillMetadataPannel(Movie)));
+
+    m_rescanRequested = false;
+    m_libraryScanner = new LibraryScanner(this);
+    connect(m_libraryScanner, SIGNAL(moviesImported(int,int)),
+            this, SLOT(on_libraryScanner_moviesImported(int,int)));
+    connect(m_libraryScanner, SIGNAL(progress(int,int,int)),
+            this, SLOT(on_libraryScanner_progress(int,int,int)));
+    connect(m_libraryScanner, SIGNAL(finished(int,int,int,bool)),
+            this, SLOT(on_libraryScanner_finished(int,int,int,bool)));
+    connect(m_libraryScanner, SIGNAL(moviesChanged(QList<Movie>,int)),
+            this, SLOT(on_libraryScanner_moviesChanged(QList<Movie>,int)));
+    connect(m_libraryScanner, SIGNAL(rescanRequested()),
+            this, SLOT(addNewMovies()));
     this->readSettings();
 
     this->setWindowTitle(APP_NAME);
 
     this->updatePannels();
+
+    // The files changed while the application was closed are found by a scan,
+    // the next ones by the watcher
+    m_libraryScanner->watchMoviesPaths();
+    this->addNewMovies();
     Macaw::DEBUG_OUT("[MainWindow] Construction done");
 }
 
@@ -182,44 +202,45 @@ void MainWindow::on_showsButton_clicked()
 }
 
 /**
- * @brief Returns the movies to display in mainWindow, based on an id and m_typeElement.
+ * @brief Returns the cursor on the movies to display in mainWindow,
+ * based on an id and m_typeElement, the search field and the ToWatch state.
  *
  * @param id of the leftPannel element
- * @return QList of movies to display
+ * @return MovieCursor on the movies to display
  */
-QList<Movie> MainWindow::moviesToDisplay(int id, bool movieOrShow)
+MovieCursor MainWindow::moviesToDisplay(int id, bool movieOrShow)
 {
     Macaw::DEBUG("[MainWindow] moviesToDisplay()");
-    DatabaseManager *databaseManager = ServicesManager::instance()->databaseManager();
+    ServicesManager *servicesManager = ServicesManager::instance();
+
+    MovieCursor l_cursor;
+    l_cursor.show = movieOrShow;
+    l_cursor.searchText = m_ui->searchEdit->text();
+    l_cursor.toWatchOnly = servicesManager->toWatchState();
 
     m_leftPannel->setSelectedId(id);
     if(m_leftPannel->selectedId() == 0) {
-
-        return databaseManager->getAllMovies(movieOrShow);
+        l_cursor.filter = MovieCursor::All;
     } else if(m_leftPannel->typeElement() == Macaw::isPeople) {
+        l_cursor.peopleType = m_leftPannel->typePeople();
         if (m_leftPannel->selectedId() == -1) {
-
-            return databaseManager->getMoviesWithoutPeople(m_leftPannel->typePeople(),
-                                                           movieOrShow);
+            l_cursor.filter = MovieCursor::WithoutPeople;
         } else {
-
-            return databaseManager->getMoviesByPeople(m_leftPannel->selectedId(),
-                                                      m_leftPannel->typePeople(),
-                                                      movieOrShow);
+            l_cursor.filter = MovieCursor::ByPeople;
+            l_cursor.filterId = m_leftPannel->selectedId();
         }
     } else if (m_leftPannel->typeElement() == Macaw::isTag) {
         if (m_leftPannel->selectedId() == -1) {
-
-            return databaseManager->getMoviesWithoutTag(movieOrShow);
+            l_cursor.filter = MovieCursor::WithoutTag;
         } else {
-
-            return databaseManager->getMoviesByTag(m_leftPannel->selectedId(),
-                                                   movieOrShow);
+            l_cursor.filter = MovieCursor::ByTag;
+            l_cursor.filterId = m_leftPannel->selectedId();
         }
+    } else {
+        l_cursor.atEnd = true;
     }
-    QList<Movie> l_emptyList;
 
-    return  l_emptyList;
+    return l_cursor;
 }
 
 /**
@@ -249,8 +270,19 @@ void MainWindow::selfUpdate()
 void MainWindow::updateMainPannel()
 {
     Macaw::DEBUG("[MainWindow] updateMainWindow triggered");
-    QList<Movie> l_movieList = moviesToDisplay(m_leftPannel->selectedId(), m_moviesOrShows);
-    m_mainPannel->fill(l_movieList);
+    MovieCursor l_cursor = moviesToDisplay(m_leftPannel->selectedId(), m_moviesOrShows);
+    m_mainPannel->fill(l_cursor);
+}
+
+/**
+ * @brief Slot triggered when the search started by updatePannels() is over.
+ * The movies pannel filters with its cursor, only the shows pannel uses the result.
+ */
+void MainWindow::on_servicesManager_matchingMovieListChanged()
+{
+    if (m_moviesOrShows == Macaw::show) {
+        this->updateMainPannel();
+    }
 }
 
 /**
@@ -280,82 +312,129 @@ void MainWindow::updatePannels()
  * @brief Slot triggered to add the movies of the saved path.
  *
  * 1. Read all the paths
- * 2. For each file:
- *      -# Check that the suffix is correct
- *      -# Check that the file has not been already imported
- *      -# Import the movie in the database
+ * 2. Start the LibraryScanner, which in its own threads for each file:
+ *      -# Checks that the suffix is correct
+ *      -# Checks that the file has not been already imported
+ *      -# Imports the movie in the database
+ * 3. When it is finished (see on_libraryScanner_finished()):
  *      -# Request FetchMetadata to get the metadata on internet
- *      -# Update the movie
- * 3. Request the update of all pannels
+ *      -# Request the update of all pannels
+ *
+ * If a scan is running, a new one is started when it is finished.
  */
 void MainWindow::addNewMovies()
 {
     Macaw::DEBUG_IN("[MainWindow] Enter addNewMovies");
 
+    if (m_libraryScanner->isRunning()) {
+        Macaw::DEBUG("[MainWindow] Scan running, a new one will follow");
+        m_rescanRequested = true;
+        Macaw::DEBUG_OUT("[MainWindow] Exit addNewMovies");
+
+        return;
+    }
+
     DatabaseManager *databaseManager = ServicesManager::instance()->databaseManager();
 
-    bool l_imported = false;
-    int l_addedCount(0);
-    QList<PathForMovies> l_moviesPathList = databaseManager->getMoviesPaths(l_imported);
-    QStringList l_authorizedSuffixList;
-    l_authorizedSuffixList << "mkv"
-                           << "avi"
-                           << "mp4"
-                           << "mpg"
-                           << "flv"
-                           << "mov"
-                           << "m4v";
-
-    foreach (PathForMovies l_moviesPath, l_moviesPathList) {
-        QDirIterator l_file(l_moviesPath.path(),
-                            QDir::NoDotAndDotDot | QDir::Files,QDirIterator::Subdirectories);
-        while (l_file.hasNext()) {
-            l_file.next();
-            QString l_filePath = l_file.fileInfo().absoluteFilePath();
-            QString l_fileSuffix = l_file.fileInfo().suffix();
-
-            if (l_authorizedSuffixList.contains(l_fileSuffix, Qt::CaseInsensitive)) {
-                Macaw::DEBUG("[MainWindow.updateApp()] Suffix accepted");
-                bool l_movieExists = databaseManager->existMovie(l_filePath);
-                if (!l_movieExists) {
-                    Macaw::DEBUG("[MainWindow.updateApp()] Movie not already known");
-                    Movie l_movie;
-                    l_movie.setTitle(l_file.fileInfo().completeBaseName());
-                    l_movie.setFileAbsolutePath(l_file.fileInfo().absoluteFilePath());
-
-                    QString l_relativePath = l_movie.fileAbsolutePath();
-                    l_relativePath.remove(l_moviesPath.path()+'/');
-                    l_movie.setFileRelativePath(l_relativePath);
-                    l_movie.setSuffix(l_fileSuffix);
-
-                    if (!l_moviesPath.hasMovies()) {
-                        l_movie.setShow(true);
-                    } else if (!l_moviesPath.hasShows()) {
-                        l_movie.setShow(false);
-                    }
-
-                    databaseManager->insertNewMovie(l_movie, l_moviesPath.id());
-                    l_addedCount++;
-                    ServicesManager::instance()->requestTempStatusBarMessage("Movies imported: "
-                                                                             +QString::number(l_addedCount));
-                    if(l_addedCount == 5) {
-                        this->updatePannels();
-                    }
-                } else {
-                    Macaw::DEBUG("[MainWindow.updateApp()] Movie already known. Skipped");
-                }
-            }
-        }
-        databaseManager->setMoviesPathImported(l_moviesPath.path(), true);
+    // The paths already imported are scanned again: only their changed directories are listed
+    QList<PathForMovies> l_moviesPathList = databaseManager->getMoviesPaths(false);
+    l_moviesPathList.append(databaseManager->getMoviesPaths(true));
+
+    m_rescanRequested = false;
+    m_libraryScanner->start(l_moviesPathList);
+    Macaw::DEBUG_OUT("[MainWindow] Exit addNewMovies");
+}
+
+/**
+ * @brief Slot triggered when the LibraryScanner added a batch of movies.
+ * The pannels are updated after the first batch.
+ *
+ * @param int batchCount number of movies of the batch
+ * @param int addedCount number of movies added since the scan started
+ */
+void MainWindow::on_libraryScanner_moviesImported(int batchCount, int addedCount)
+{
+    ServicesManager::instance()->requestTempStatusBarMessage("Movies imported: "
+                                                             +QString::number(addedCount));
+    if (batchCount > 0 && batchCount == addedCount) {
+        this->updatePannels();
     }
+}
+
+/**
+ * @brief Slot triggered regularly while the LibraryScanner runs
+ *
+ * @param int directoryCount number of directories walked
+ * @param int addedCount number of movies added
+ * @param int directoriesPerSecond
+ */
+void MainWindow::on_libraryScanner_progress(int directoryCount, int addedCount, int directoriesPerSecond)
+{
+    ServicesManager::instance()->requestTempStatusBarMessage("Scanning: "
+                                                             +QString::number(directoryCount)
+                                                             +" directories ("
+                                                             +QString::number(directoriesPerSecond)
+                                                             +"/s), movies imported: "
+                                                             +QString::number(addedCount));
+}
 
+/**
+ * @brief Slot triggered when the LibraryScanner is done.
+ * Requests the metadata of the new movies and updates the pannels.
+ *
+ * @param int addedCount number of movies added
+ * @param int removedCount number of movies removed
+ * @param int movedCount number of movies whose file was moved
+ * @param bool canceled
+ */
+void MainWindow::on_libraryScanner_finished(int addedCount, int removedCount, int movedCount,
+                                            bool canceled)
+{
+    Macaw::DEBUG_IN("[MainWindow] Enter on_libraryScanner_finished");
+
+    if (!canceled) {
+        // The directories found by the scan are watched
+        m_libraryScanner->watchMoviesPaths();
+    }
+    if (m_rescanRequested && !canceled) {
+        this->addNewMovies();
+    }
+
+    // FetchMetadata skips the movies already queued by an earlier scan
+    DatabaseManager *databaseManager = ServicesManager::instance()->databaseManager();
     QList<Movie> l_moviesToFetch = databaseManager->getMoviesNotImported();
     if (!l_moviesToFetch.isEmpty()) {
         Macaw::DEBUG("[MainWindow] FetchingMetadata requested");
         emit startFetchingMetadata(l_moviesToFetch);
     }
+    if (addedCount > 0 || removedCount > 0 || movedCount > 0) {
+        this->updatePannels();
+    }
+    Macaw::DEBUG_OUT("[MainWindow] Exit on_libraryScanner_finished");
+}
+
+/**
+ * @brief Slot triggered when the LibraryWatcher applied changes of the movies paths.
+ * Only the movies it added are queued for their metadata: the other ones not
+ * imported yet are already queued.
+ *
+ * @param QList<Movie> addedMovieList movies added
+ * @param int missingCount number of movies whose file was removed
+ */
+void MainWindow::on_libraryScanner_moviesChanged(const QList<Movie> &addedMovieList, int missingCount)
+{
+    Macaw::DEBUG_IN("[MainWindow] Enter on_libraryScanner_moviesChanged");
+    ServicesManager::instance()->requestTempStatusBarMessage("Movies imported: "
+                                                             +QString::number(addedMovieList.count())
+                                                             +", missing: "
+                                                             +QString::number(missingCount));
+
+    if (!addedMovieList.isEmpty()) {
+        Macaw::DEBUG("[MainWindow] FetchingMetadata requested");
+        emit startFetchingMetadata(addedMovieList);
+    }
     this->updatePannels();
-    Macaw::DEBUG_OUT("[MainWindow] Exit addNewMovies");
+    Macaw::DEBUG_OUT("[MainWindow] Exit on_libraryScanner_moviesChanged");
 }
 
 /**
@@ -23,10 +23,12 @@
 #include <QMainWindow>
 
 class LeftPannel;
+class LibraryScanner;
 class MainPannel;
 class MetadataPannel;
 class MoviesPannel;
 class Movie;
+struct MovieCursor;
 class SeriesPannel;
 
 namespace Ui {
@@ -49,7 +51,13 @@ private slots:
     void on_toWatchButton_clicked();  
     void selfUpdate();
     void updateMainPannel();
+    void on_servicesManager_matchingMovieListChanged();
     void addNewMovies();
+    void on_libraryScanner_moviesImported(int batchCount, int addedCount);
+    void on_libraryScanner_progress(int directoryCount, int addedCount, int directoriesPerSecond);
+    void on_libraryScanner_finished(int addedCount, int removedCount, int movedCount,
+                                    bool canceled);
+    void on_libraryScanner_moviesChanged(const QList<Movie> &addedMovieList, int missingCount);
     void on_searchEdit_editingFinished();
     void on_actionAbout_triggered();
     void closeEvent(QCloseEvent *event);
@@ -67,10 +75,12 @@ private:
     LeftPannel *m_leftPannel;
     MainPannel *m_mainPannel;
     MetadataPannel *m_metadataPannel;
+    LibraryScanner *m_libraryScanner;
+    bool m_rescanRequested;
     bool m_moviesOrShows;
 
     void readSettings();
-    QList<Movie> moviesToDisplay(int id, bool movieOrSeries);
+    MovieCursor moviesToDisplay(int id, bool movieOrSeries);
     void updatePannels();
 
 };
@@ -69,73 +69,46 @@ void LeftPannel::fill()
 {
     Macaw::DEBUG_IN("[LefPannel] Enters fill()");
 
-    this->setElementIdList();
+    this->setFacetList();
     this->fillListWidget();
 
     Macaw::DEBUG_OUT("[LefPannel] Exits fill()");
 }
 
 /**
- * @brief Set the ElementIdList, used to fill the listWidget
+ * @brief Set the FacetList, used to fill the listWidget.
+ * The people or tags of the movies matching the search field and the ToWatch
+ * state are counted by one query.
  */
-void LeftPannel::setElementIdList()
+void LeftPannel::setFacetList()
 {
-    Macaw::DEBUG_IN("[LeftPannel] Enters setElementIdList()");
-
-    m_elementIdList.clear();
+    Macaw::DEBUG_IN("[LeftPannel] Enters setFacetList()");
 
     ServicesManager *servicesManager = ServicesManager::instance();
     DatabaseManager *databaseManager = servicesManager->databaseManager();
 
-    QList<Movie> l_matchingMovieList = servicesManager->matchingMovieList();
-
-    foreach(Movie l_movie, l_matchingMovieList) {
-        if( (servicesManager->toWatchState()
-                 && databaseManager->isMovieInPlaylist(l_movie.id(), Playlist::ToWatch)
-                 ) || !servicesManager->toWatchState()
-               ) {
-            switch (m_typeElement)
-            {
-                case Macaw::isPeople:
-                {
-                    QList<People> l_peopleList = databaseManager->getPeopleByMovie(l_movie, m_typePeople);
-                    this->updateElementIdList(l_peopleList);
-                    break;
-                }
-                case Macaw::isTag:
-                {
-                    QList<Tag> l_tagList = l_movie.tagList();
-                    this->updateElementIdList(l_tagList);
-                    break;
-                }
-            }
-        }
-    }
-    Macaw::DEBUG_OUT("[LefPannel] Exits setElementIdList()");
-}
+    MovieCursor l_cursor;
+    l_cursor.show = servicesManager->matchingShows();
+    l_cursor.searchText = servicesManager->matchingPattern();
+    l_cursor.toWatchOnly = servicesManager->toWatchState();
 
-/**
- * @brief Add/Update the elementIdList
- * @author Olivier CHURLAUD <olivier@churlaud.com>
- *
- * @param list of objects of the movie
- */
-template<typename T> void LeftPannel::updateElementIdList(const QList<T> &entityList)
-{
-    if(entityList.isEmpty()
-       && !m_elementIdList.contains(-1)
-      ) {
-        m_elementIdList.append(-1);
-    }
-    foreach(T l_entity, entityList) {
-        if(!m_elementIdList.contains(l_entity.id())) {
-            m_elementIdList.append(l_entity.id());
-        }
+    switch (m_typeElement)
+    {
+        case Macaw::isPeople:
+            m_facetList = databaseManager->getPeopleFacets(l_cursor, m_typePeople);
+            break;
+        case Macaw::isTag:
+            m_facetList = databaseManager->getTagFacets(l_cursor);
+            break;
+        default:
+            m_facetList.clear();
+            break;
     }
+    Macaw::DEBUG_OUT("[LefPannel] Exits setFacetList()");
 }
 
 /**
- * @brief fill the listWidget based on m_elementIdList
+ * @brief fill the listWidget based on m_facetList
  * @author Olivier CHURLAUD <olivier@churlaud.com>
  */
 void LeftPannel::fillListWidget()
@@ -144,41 +117,22 @@ void LeftPannel::fillListWidget()
 
     m_ui->listWidget->clear();
 
-    DatabaseManager *databaseManager = ServicesManager::instance()->databaseManager();
-
-    // Add the "All" element
-    if(m_typeElement != Macaw::isPlaylist) {
-        // First space needed for sorting
-        Entity l_entity(" All");
-        l_entity.setId(0);
-
-        this->addEntityToListWidget(l_entity);
-    }
-
-    // @TODO: this loop is too long
-    foreach(int l_objectId, m_elementIdList) {
-        if(l_objectId == -1) {
+    foreach(FacetCount l_facet, m_facetList) {
+        if(l_facet.id == 0) {
+            // Add the "All" element
             // First space needed for sorting
-            Entity l_entity(" Unknown");
-            l_entity.setId(-1);
-
-            this->addEntityToListWidget(l_entity);
-        } else {
-            Entity l_entity;
-            switch (m_typeElement)
-            {
-            case Macaw::isPeople:
-                l_entity = databaseManager->getOnePeopleById(l_objectId);
-                break;
-            case Macaw::isTag:
-                l_entity = databaseManager->getOneTagById(l_objectId);
-                break;
+            this->addElementToListWidget(0, " All", l_facet.movieCount);
+        } else if(l_facet.id == -1) {
+            if(l_facet.movieCount > 0) {
+                // First space needed for sorting
+                this->addElementToListWidget(-1, " Unknown", l_facet.movieCount);
             }
-
-            this->addEntityToListWidget(l_entity);
+        } else {
+            this->addElementToListWidget(l_facet.id, l_facet.name, l_facet.movieCount);
         }
     }
-    if(m_ui->listWidget->selectedItems().isEmpty()) {
+    if(m_ui->listWidget->count() > 0
+       && m_ui->listWidget->selectedItems().isEmpty()) {
         m_ui->listWidget->item(0)->setSelected(true);
     }
     m_ui->listWidget->sortItems();
@@ -187,19 +141,20 @@ void LeftPannel::fillListWidget()
 }
 
 /**
- * @brief Add an element to the list widget, based on an Entity
- * @author Olivier CHURLAUD <olivier@churlaud.com>
+ * @brief Add an element to the list widget, shown with its number of movies
  *
- * @param Entity to add in ListWidget
+ * @param int id of the element, 0 for "All" and -1 for "Unknown"
+ * @param QString name of the element
+ * @param int movieCount number of matching movies linked to the element
  */
-void LeftPannel::addEntityToListWidget(const Entity &entity)
+void LeftPannel::addElementToListWidget(const int id, const QString &name, const int movieCount)
 {
-    QListWidgetItem *l_item = new QListWidgetItem(entity.name());
-    l_item->setData(Macaw::ObjectId, entity.id());
+    QListWidgetItem *l_item = new QListWidgetItem(QString("%1 (%2)").arg(name).arg(movieCount));
+    l_item->setData(Macaw::ObjectId, id);
     l_item->setData(Macaw::ObjectType, m_typeElement);
     l_item->setData(Macaw::PeopleType, m_typePeople);
 
-    if (m_selectedId == entity.id()) {
+    if (m_selectedId == id) {
         l_item->setSelected(true);
     }
 
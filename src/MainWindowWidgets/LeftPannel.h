@@ -22,7 +22,7 @@
 
 #include <QWidget>
 
-class Entity;
+#include "DatabaseManager.h"
 
 namespace Ui {
     class LeftPannel;
@@ -74,14 +74,13 @@ private:
     int m_selectedId;
 
     /**
-     * @brief QList of ids of the leftPannel
+     * @brief Elements of the leftPannel, with their number of movies
      */
-    QList<int> m_elementIdList;
+    QList<FacetCount> m_facetList;
 
-    void setElementIdList();
-    template<typename T> void updateElementIdList(const QList<T> &list);
+    void setFacetList();
     void fillListWidget();
-    void addEntityToListWidget(const Entity &entity);
+    void addElementToListWidget(const int id, const QString &name, const int movieCount);
 };
 
 #endif // LEFTPANNEL_H
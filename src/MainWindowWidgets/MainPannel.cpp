@@ -32,6 +32,25 @@ MainPannel::MainPannel(QWidget *parent) :
 
 }
 
+/**
+ * @brief Fill the pannel with all the movies of a cursor.
+ * Pannels able to show the movies as they are read should override this function.
+ *
+ * @param cursor describing the movies to show
+ */
+void MainPannel::fill(const MovieCursor &cursor)
+{
+    DatabaseManager *databaseManager = ServicesManager::instance()->databaseManager();
+
+    MovieCursor l_cursor(cursor);
+    QList<Movie> l_movieList;
+    while (!l_cursor.atEnd) {
+        l_movieList.append(databaseManager->getMoviesPage(l_cursor, 500));
+    }
+
+    this->fill(l_movieList);
+}
+
 /**
  * @brief move the specified movie's file to trash bin.
  *
@@ -50,6 +69,7 @@ bool MainPannel::moveFileToTrash(QList<Movie> &movieList)
     l_confirmationDialog->setDefaultButton(QMessageBox::No);
 
     if(l_confirmationDialog->exec() == QMessageBox::Yes) {
+        QList<Movie> l_trashedMovieList;
         foreach (Movie l_movie, movieList) {
             bool l_successfullyDeleted = false;
             QFile *movieFileToDelete = new QFile(l_movie.fileAbsolutePath());
@@ -72,15 +92,17 @@ bool MainPannel::moveFileToTrash(QList<Movie> &movieList)
             }
 
             if(l_successfullyDeleted) {
-                if(!databaseManager->deleteMovie(l_movie)) {
-                    QMessageBox *msgBox = new QMessageBox(QMessageBox::Critical, tr("Error deleting"),
-                                                    tr("Error deleting the movie from the database."),
-                                                    QMessageBox::Ok, this);
-                    msgBox->exec();
-                    return false;
-                }
+                l_trashedMovieList.append(l_movie);
             }
         }
+        // One transaction and one question about the orphans for all the movies
+        if(!databaseManager->deleteMovies(l_trashedMovieList)) {
+            QMessageBox *msgBox = new QMessageBox(QMessageBox::Critical, tr("Error deleting"),
+                                            tr("Error deleting the movie from the database."),
+                                            QMessageBox::Ok, this);
+            msgBox->exec();
+            return false;
+        }
         emit updatePannels();
     }
     return true;
@@ -25,6 +25,7 @@
 class QFile;
 
 class Movie;
+struct MovieCursor;
 
 /**
  * @brief The MainPannel class
@@ -38,6 +39,7 @@ class MainPannel : public QWidget
 public:
     explicit MainPannel(QWidget *parent);
     virtual void fill(QList<Movie> const &movieList){ movieList.count(); }
+    virtual void fill(const MovieCursor &cursor);
 
 signals:
     void fillMetadataPannel(const Movie&);
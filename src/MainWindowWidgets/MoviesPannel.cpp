@@ -26,6 +26,7 @@
 #include <QMenu>
 #include <QMessageBox>
 #include <QProcess>
+#include <QScrollBar>
 #include <QUrl>
 
 #include "enumerations.h"
@@ -43,12 +44,18 @@
  */
 MoviesPannel::MoviesPannel(QWidget *parent) :
     MainPannel(parent),
-    m_ui(new Ui::MoviesPannel)
+    m_ui(new Ui::MoviesPannel),
+    m_pageTicket(0)
 {
     m_ui->setupUi(this);
     m_ui->tableWidget->setContentsMargins(0,0,0,0);
     connect(m_ui->tableWidget, SIGNAL(customContextMenuRequested(QPoint)),
                 this, SLOT(on_customContextMenuRequested(QPoint)));
+    connect(m_ui->tableWidget->verticalScrollBar(), SIGNAL(valueChanged(int)),
+                this, SLOT(on_scrollBar_valueChanged(int)));
+    connect(ServicesManager::instance()->asyncDatabaseManager(),
+            SIGNAL(moviesPageReady(int,MovieCursor,QList<Movie>)),
+            this, SLOT(on_moviesPageReady(int,MovieCursor,QList<Movie>)));
 
     this->setHeaders();
 
@@ -142,6 +149,83 @@ void MoviesPannel::fill(const QList<Movie> &movieList)
     Macaw::DEBUG_OUT("[MoviesPannel] Exits fill()");
 }
 
+/**
+ * @brief Fill the Main Pannel with the first page of a cursor.
+ * The next pages are read when the user scrolls to the bottom of the table.
+ *
+ * The cursor already contains the search and ToWatch filters.
+ *
+ * @param cursor describing the movies to show
+ */
+void MoviesPannel::fill(const MovieCursor &cursor)
+{
+    Macaw::DEBUG_IN("[MoviesPannel] Enters fill(MovieCursor)");
+
+    m_ui->tableWidget->clearContents();
+    m_ui->tableWidget->setRowCount(0);
+
+    m_cursor = cursor;
+    // A page of the previous cursor may still be read: it is cancelled
+    m_pageTicket = 0;
+    this->fetchNextPage();
+
+    Macaw::DEBUG_OUT("[MoviesPannel] Exits fill(MovieCursor)");
+}
+
+/**
+ * @brief Asks for the next page of m_cursor, in the database thread.
+ * The movies are added to the table by on_moviesPageReady().
+ */
+void MoviesPannel::fetchNextPage()
+{
+    if (m_cursor.atEnd || m_pageTicket != 0) {
+        return;
+    }
+
+    AsyncDatabaseManager *asyncDatabaseManager = ServicesManager::instance()->asyncDatabaseManager();
+    m_pageTicket = asyncDatabaseManager->getMoviesPage(m_cursor, MOVIES_PAGE_SIZE);
+}
+
+/**
+ * @brief Slot triggered when a page has been read.
+ * Adds its movies to the table, if it is the page that was asked for.
+ *
+ * @param ticket of the request
+ * @param cursor moved after the page
+ * @param movieList movies of the page
+ */
+void MoviesPannel::on_moviesPageReady(int ticket, const MovieCursor &cursor, const QList<Movie> &movieList)
+{
+    if (ticket != m_pageTicket) {
+        return;
+    }
+    m_pageTicket = 0;
+    m_cursor = cursor;
+
+    m_ui->tableWidget->setUpdatesEnabled(false);
+    foreach (Movie l_movie, movieList) {
+        this->addMovieToPannel(l_movie);
+    }
+    m_ui->tableWidget->setUpdatesEnabled(true);
+
+    // The table may not be filled enough to show a scroll bar
+    QScrollBar *l_scrollBar = m_ui->tableWidget->verticalScrollBar();
+    this->on_scrollBar_valueChanged(l_scrollBar->value());
+}
+
+/**
+ * @brief Slot triggered when the table is scrolled.
+ * Reads the next page when the last rows get close.
+ *
+ * @param value position of the scroll bar
+ */
+void MoviesPannel::on_scrollBar_valueChanged(int value)
+{
+    if (value >= m_ui->tableWidget->verticalScrollBar()->maximum() - MOVIES_PAGE_SIZE / 4) {
+        this->fetchNextPage();
+    }
+}
+
 /**
  * @brief Slot triggered when the context menu is requested.
  *
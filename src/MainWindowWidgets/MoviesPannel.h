@@ -22,6 +22,8 @@
 
 #include "MainWindowWidgets/MainPannel.h"
 
+#include "DatabaseManager.h"
+
 class QFile;
 class QTableWidgetItem;
 
@@ -39,14 +41,19 @@ class MoviesPannel;
  */
 class MoviesPannel : public MainPannel
 {
+    #define MOVIES_PAGE_SIZE 200
     Q_OBJECT
 
 public:
     explicit MoviesPannel(QWidget *parent = 0);
     ~MoviesPannel();
     void fill(const QList<Movie> &movieList);
+    void fill(const MovieCursor &cursor);
 
 private slots:
+    void fetchNextPage();
+    void on_moviesPageReady(int ticket, const MovieCursor &cursor, const QList<Movie> &movieList);
+    void on_scrollBar_valueChanged(int value);
     void on_customContextMenuRequested(const QPoint &point);
     void on_actionEdit_mainPannelMetadata_triggered();
     void on_actionDelete_triggered();
@@ -57,6 +64,16 @@ private slots:
 
 private:
     Ui::MoviesPannel *m_ui;
+
+    /**
+     * @brief Movies shown in the pannel, read page by page when scrolling
+     */
+    MovieCursor m_cursor;
+
+    /**
+     * @brief Ticket of the page being read by AsyncDatabaseManager, 0 if none
+     */
+    int m_pageTicket;
     void setHeaders();
     void addMovieToPannel(const Movie &movie);
     void removeMovieFromPlaylist(const QList<Movie> &movieList, Playlist &playlist);
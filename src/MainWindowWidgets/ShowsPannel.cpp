@@ -20,6 +20,8 @@
 #include "ShowsPannel.h"
 #include "ui_ShowsPannel.h"
 
+#include <QSet>
+
 #include "MacawDebug.h"
 #include "ServicesManager.h"
 #include "Entities/Episode.h"
@@ -46,20 +48,29 @@ void ShowsPannel::fill(const QList<Movie> &movieList)
     ServicesManager *servicesManager = ServicesManager::instance();
     DatabaseManager *databaseManager = servicesManager->databaseManager();
 
-    QList<Episode> l_episodeList = databaseManager->getEpisodesByMovies(movieList);
-    QList<Movie> l_matchingMovieList = servicesManager->matchingMovieList();
+    QSet<int> l_matchingMovieIdSet;
+    foreach (Movie l_movie, servicesManager->matchingMovieList()) {
+        l_matchingMovieIdSet.insert(l_movie.id());
+    }
+    QSet<int> l_toWatchIdSet;
+    if (servicesManager->toWatchState()) {
+        l_toWatchIdSet = databaseManager->getMovieIdsByPlaylist(Playlist::ToWatch);
+    }
 
-    foreach (Episode l_episode, l_episodeList) {
-        if(l_matchingMovieList.contains(l_episode.movie())) {
-            if( (servicesManager->toWatchState()
-                 && databaseManager->isMovieInPlaylist(l_episode.movie().id(),
-                                                       Playlist::ToWatch)
-                 ) || !servicesManager->toWatchState()
-               ) {
-                this->addEpisodeToPannel(l_episode);
+    // Only the episodes of the movies shown are read
+    QList<int> l_movieIdList;
+    foreach (Movie l_movie, movieList) {
+        int l_movieId = l_movie.id();
+        if(l_matchingMovieIdSet.contains(l_movieId)) {
+            if(!servicesManager->toWatchState() || l_toWatchIdSet.contains(l_movieId)) {
+                l_movieIdList.append(l_movieId);
             }
         }
     }
+
+    foreach (Episode l_episode, databaseManager->getEpisodesByMovieIds(l_movieIdList)) {
+        this->addEpisodeToPannel(l_episode);
+    }
     Macaw::DEBUG_OUT("[ShowsPannel] Exits fill()");
 }
 
@@ -24,9 +24,15 @@
 
 Q_GLOBAL_STATIC(ServicesManager, servicesManager)
 
-ServicesManager::ServicesManager(QObject *parent) : QObject(parent)
+ServicesManager::ServicesManager(QObject *parent) : QObject(parent),
+    m_matchingShows(false),
+    m_matchingGeneration(-1),
+    m_matchingTicket(0)
 {
     m_databaseManager = new DatabaseManager;
+    m_asyncDatabaseManager = new AsyncDatabaseManager(this);
+    connect(m_asyncDatabaseManager, SIGNAL(moviesByAnyReady(int,QList<Movie>)),
+            this, SLOT(on_asyncDatabaseManager_moviesByAnyReady(int,QList<Movie>)));
 }
 
 ServicesManager *ServicesManager::instance()
@@ -34,9 +40,46 @@ ServicesManager *ServicesManager::instance()
     return servicesManager;
 }
 
+/**
+ * @brief Starts the search of the movies matching the search field, in the thread
+ * of AsyncDatabaseManager. matchingMovieList() keeps the previous result until
+ * matchingMovieListChanged() is sent.
+ *
+ * @param QString pattern, as typed in the search field
+ * @param bool shows
+ */
 void ServicesManager::setMatchingMovieList(QString pattern, bool shows)
 {
-    m_matchingMovieList = m_databaseManager->getMoviesByAny(pattern, shows);
+    int l_generation = DatabaseManager::writeGeneration();
+    if (l_generation == m_matchingGeneration
+            && pattern == m_matchingPattern
+            && shows == m_matchingShows)
+    {
+        return;
+    }
+
+    // A search still running for other arguments is cancelled by the new ticket
+    m_matchingTicket = m_asyncDatabaseManager->getMoviesByAny(pattern, shows);
+    m_matchingPattern = pattern;
+    m_matchingShows = shows;
+    m_matchingGeneration = l_generation;
+}
+
+/**
+ * @brief Keeps the result of the latest search started by setMatchingMovieList()
+ *
+ * @param int ticket of the search
+ * @param QList<Movie> movieList
+ */
+void ServicesManager::on_asyncDatabaseManager_moviesByAnyReady(int ticket, const QList<Movie> &movieList)
+{
+    if (ticket != m_matchingTicket)
+    {
+        return;
+    }
+    m_matchingTicket = 0;
+    m_matchingMovieList = movieList;
+    emit matchingMovieListChanged();
 }
 
 void ServicesManager::pannelsUpdate()
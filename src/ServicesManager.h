@@ -22,9 +22,11 @@
 
 #include <QObject>
 
+#include "AsyncDatabaseManager.h"
 #include "DatabaseManager.h"
 #include "Entities/Movie.h"
 
+class AsyncDatabaseManager;
 class DatabaseManager;
 class Movie;
 
@@ -40,21 +42,39 @@ public:
     static ServicesManager* instance();
     QList<Movie> matchingMovieList() const { return m_matchingMovieList; }
     void setMatchingMovieList(const QString pattern, bool shows);
+    QString matchingPattern() const { return m_matchingPattern; }
+    bool matchingShows() const { return m_matchingShows; }
     bool toWatchState() const { return m_toWatchState; }
     void setToWatchState(const bool state) { m_toWatchState = state; }
     DatabaseManager* databaseManager() { return m_databaseManager; }
+    AsyncDatabaseManager* asyncDatabaseManager() { return m_asyncDatabaseManager; }
 
 signals:
     void requestPannelsUpdate();
     void requestTempStatusBarMessage(QString message, int time = 0);
+    void matchingMovieListChanged();
 
 public slots:
     void pannelsUpdate();
     void showTempStatusBarMessage(QString message, int time);
 
+private slots:
+    void on_asyncDatabaseManager_moviesByAnyReady(int ticket, const QList<Movie> &movieList);
+
 private:
     QList<Movie> m_matchingMovieList;
+
+    /**
+     * @brief Arguments and DatabaseManager::writeGeneration() of the search
+     * that gave m_matchingMovieList, or that is running if m_matchingTicket is not 0.
+     * The search is not run again while they do not change.
+     */
+    QString m_matchingPattern;
+    bool m_matchingShows;
+    int m_matchingGeneration;
+    int m_matchingTicket;
     DatabaseManager *m_databaseManager;
+    AsyncDatabaseManager *m_asyncDatabaseManager;
     bool m_toWatchState;
 };
 
@@ -0,0 +1,512 @@
+/* Copyright (C) 2014 Macaw-Movies
+ * (Olivier CHURLAUD, Sébastien TOUZÉ)
+ *
+ * This file is part of Macaw-Movies.
+ *
+ * Macaw-Movies is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Macaw-Movies is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Macaw-Movies.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "DatabaseTest.h"
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QRegExp>
+#include <QSet>
+#include <QSqlDatabase>
+#include <QTextStream>
+
+#include "DatabaseManager.h"
+#include "MacawDebug.h"
+#include "Benchmark/SyntheticLibrary.h"
+#include "Entities/Movie.h"
+#include "Entities/People.h"
+#include "Entities/Playlist.h"
+#include "Entities/Tag.h"
+
+/**
+ * @brief Constructor
+ *
+ * @param QString workPath, directory where the databases are made
+ */
+DatabaseTest::DatabaseTest(const QString &workPath) :
+    m_workPath(workPath),
+    m_databaseManager(NULL),
+    m_failureCount(0)
+{
+}
+
+/**
+ * @brief Names of the tests, as given to run()
+ *
+ * @return QStringList
+ */
+QStringList DatabaseTest::testNames()
+{
+    return QStringList() << "query-plans" << "movie-links" << "missing-movies";
+}
+
+/**
+ * @brief Runs one test
+ *
+ * @param QString testName, one of testNames()
+ * @return true if every check passed
+ */
+bool DatabaseTest::run(const QString &testName)
+{
+    m_failureCount = 0;
+    bool l_ret = false;
+    if (testName == "query-plans")
+    {
+        l_ret = testQueryPlans();
+    }
+    else if (testName == "movie-links")
+    {
+        l_ret = testMovieLinks();
+    }
+    else if (testName == "missing-movies")
+    {
+        l_ret = testMissingMovies();
+    }
+    else
+    {
+        check(false, "unknown test " + testName);
+    }
+    closeLibrary();
+
+    return l_ret && m_failureCount == 0;
+}
+
+/**
+ * @brief Checks that the main getters use the indexes: none of their queries
+ * may read a whole table of the library.
+ *
+ * Every query is written with its `EXPLAIN QUERY PLAN` to the slow-query log
+ * (threshold of 0 ms), which is then read back.
+ *
+ * @return bool
+ */
+bool DatabaseTest::testQueryPlans()
+{
+    if (!openLibrary("query_plans", 5000))
+    {
+        return false;
+    }
+    DatabaseManager *l_db = m_databaseManager;
+
+    // Entities of the library, see SyntheticLibrary
+    Movie l_movie = l_db->getOneMovieById(2503);
+    People l_people = l_db->getOnePeopleById(1);
+    Tag l_tag = l_db->getOneTagById(1);
+    PathForMovies l_moviesPath = l_db->getMoviesPaths().value(0);
+    QList<Movie> l_showMovieList = l_db->getAllMovies(true);
+    QList<int> l_showMovieIdList;
+    foreach (Movie l_showMovie, l_showMovieList)
+    {
+        l_showMovieIdList.append(l_showMovie.id());
+    }
+    check(l_movie.id() > 0 && l_people.id() > 0 && l_tag.id() > 0 && !l_showMovieList.isEmpty(),
+          "the library is filled");
+
+    QFile::remove(DatabaseManager::slowQueryLogPath());
+    l_db->setSlowQueryThreshold(0);
+
+    l_db->getOneMovieById(l_movie.id() + 1);
+    l_db->getMoviesByPeople(l_people.id(), People::Actor);
+    l_db->getMoviesByTag(l_tag.id());
+    l_db->getMoviesByPlaylist(Playlist::ToWatch);
+    l_db->getMoviesByFilePath(l_moviesPath.id(), "movies/5");
+    l_db->getMoviesByAny("Movie 12");
+    l_db->getMoviesNotImported();
+
+    MovieCursor l_cursor;
+    QList<Movie> l_pageMovieList = l_db->getMoviesPage(l_cursor, 200);
+    l_db->getMoviesPage(l_cursor, 200);
+    MovieCursor l_tagCursor;
+    l_tagCursor.filter = MovieCursor::ByTag;
+    l_tagCursor.filterId = l_tag.id();
+    l_db->getMoviesPage(l_tagCursor, 200);
+    QList<int> l_pageMovieIdList;
+    foreach (Movie l_pageMovie, l_pageMovieList)
+    {
+        l_pageMovieIdList.append(l_pageMovie.id());
+    }
+
+    l_db->getEpisodesByMovies(l_showMovieList);
+    l_db->getEpisodesByMovieIds(l_showMovieIdList);
+    l_db->getOnePeopleById(l_people.id() + 1);
+    l_db->getOnePeopleById(l_people.id(), People::Actor);
+    l_db->getOnePeopleByName(l_people.name());
+    l_db->getPeopleByMovie(l_movie, People::Actor);
+    l_db->getPeopleByMovieIds(l_pageMovieIdList);
+    l_db->getPeopleByAny("Person 12", People::Actor);
+    l_db->getOneTagById(l_tag.id() + 1);
+    l_db->getOneTagByName(l_tag.name());
+    l_db->getTagsByAny("Tag 1");
+    l_db->getTagsByMovieIds(l_pageMovieIdList);
+    l_db->getOnePlaylistById(2);
+    l_db->isMovieInPlaylist(l_movie.id(), Playlist::ToWatch);
+    l_db->getMovieIdsByPlaylist(Playlist::ToWatch);
+    l_db->setPeopleAndTagsToMovies(l_pageMovieList);
+    l_db->existMovie(l_moviesPath.id(), l_movie.fileRelativePath());
+
+    l_db->setSlowQueryThreshold(-1);
+
+    // One entry per query: a header ending with the caller, the query, then the plan
+    QFile l_logFile(DatabaseManager::slowQueryLogPath());
+    if (!check(l_logFile.open(QIODevice::ReadOnly | QIODevice::Text),
+               "the slow-query log " + l_logFile.fileName() + " is written"))
+    {
+        return false;
+    }
+    QStringList l_entryList = QString::fromUtf8(l_logFile.readAll()).split("\n\n", QString::SkipEmptyParts);
+    QSet<QString> l_callerSet;
+    foreach (QString l_entry, l_entryList)
+    {
+        QStringList l_lineList = l_entry.split('\n');
+        if (l_lineList.size() < 2)
+        {
+            continue;
+        }
+        QString l_caller = l_lineList.at(0).section(" | ", 3);
+        QString l_queryText = l_lineList.at(1);
+        QStringList l_planList;
+        for (int i = 2 ; i < l_lineList.size() ; i++)
+        {
+            l_planList.append(l_lineList.at(i).trimmed());
+        }
+        l_callerSet.insert(l_caller.section('(', 0, 0).section("::", -1));
+
+        // Without FTS5, the LIKE search reads all the titles by design
+        if (l_caller.contains("ByAnyLike"))
+        {
+            continue;
+        }
+        QStringList l_scanList = fullScans(l_queryText, l_planList);
+        check(l_scanList.isEmpty(),
+              "no full scan in " + l_caller + "\n    " + l_queryText
+              + "\n    " + l_planList.join("\n    "));
+    }
+
+    foreach (QString l_getter, QStringList() << "getOneMovieById" << "getMoviesByPeople"
+                                             << "getMoviesByTag" << "getMoviesPage"
+                                             << "getEpisodesOfIdList" << "getPeopleByMovieIds"
+                                             << "getTagsByMovieIds" << "existMovie")
+    {
+        check(l_callerSet.contains(l_getter), "the plans of " + l_getter + " are logged");
+    }
+
+    return true;
+}
+
+/**
+ * @brief Checks that updateMovie() writes and removes more links than SQLite
+ * accepts parameters in one statement (999)
+ *
+ * @return bool
+ */
+bool DatabaseTest::testMovieLinks()
+{
+    if (!openLibrary("movie_links", 100))
+    {
+        return false;
+    }
+    DatabaseManager *l_db = m_databaseManager;
+    QList<Movie> l_movieList = QList<Movie>() << l_db->getOneMovieById(51);
+    l_db->setPeopleAndTagsToMovies(l_movieList);
+    Movie l_movie = l_movieList.first();
+    int l_storedPeopleCount = l_movie.peopleList().size();
+
+    // New people and tags, added to the stored ones
+    QList<People> l_peopleList = l_movie.peopleList();
+    for (int i = 0 ; i < 700 ; i++)
+    {
+        People l_people("Test person " + QString::number(i));
+        l_people.setType(People::Actor);
+        l_peopleList.append(l_people);
+    }
+    l_movie.setPeopleList(l_peopleList);
+    QList<Tag> l_tagList;
+    for (int i = 0 ; i < 1100 ; i++)
+    {
+        l_tagList.append(Tag("Test tag " + QString::number(i)));
+    }
+    l_movie.setTagList(l_tagList);
+
+    if (!check(l_db->updateMovie(l_movie), "the movie is updated with 700 people and 1100 tags"))
+    {
+        return false;
+    }
+    check(l_db->getPeopleByMovieIds(QList<int>() << l_movie.id()).value(l_movie.id()).size()
+              == l_storedPeopleCount + 700,
+          "the movie has 700 more people");
+    check(l_db->getTagsByMovieIds(QList<int>() << l_movie.id()).value(l_movie.id()).size() == 1100,
+          "the movie has 1100 tags");
+
+    // All the links removed
+    l_movie.setPeopleList(QList<People>());
+    l_movie.setTagList(QList<Tag>());
+    if (!check(l_db->updateMovie(l_movie), "the movie is updated without people nor tags"))
+    {
+        return false;
+    }
+    check(l_db->getPeopleByMovieIds(QList<int>() << l_movie.id()).value(l_movie.id()).isEmpty(),
+          "the movie has no people");
+    check(l_db->getTagsByMovieIds(QList<int>() << l_movie.id()).value(l_movie.id()).isEmpty(),
+          "the movie has no tags");
+
+    return true;
+}
+
+/**
+ * @brief Checks that the movies whose file is gone are kept as missing, not listed
+ * nor counted, until they are found again, at the same place or by their fingerprint
+ *
+ * @return bool
+ */
+bool DatabaseTest::testMissingMovies()
+{
+    if (!openLibrary("missing_movies", 100))
+    {
+        return false;
+    }
+    DatabaseManager *l_db = m_databaseManager;
+    Movie l_movie = l_db->getOneMovieById(10);
+    Movie l_otherMovie = l_db->getOneMovieById(11);
+    int l_moviesPathId = l_db->getMoviesPaths().value(0).id();
+    qint64 l_now = QDateTime::currentMSecsSinceEpoch();
+    MovieCursor l_cursor;
+    l_cursor.show = l_movie.isShow();
+    int l_storedCount = l_db->getTagFacets(l_cursor).value(0).movieCount;
+    int l_missingCount = l_otherMovie.isShow() == l_movie.isShow() ? 2 : 1;
+
+    if (!check(l_db->setMoviesMissing(QList<int>() << l_movie.id() << l_otherMovie.id(), true),
+               "two movies are marked as missing"))
+    {
+        return false;
+    }
+    QHash<QString, int> l_missingFileHash = l_db->getMissingMovieFiles().value(l_moviesPathId);
+    check(l_missingFileHash.size() == 2
+              && l_missingFileHash.value(l_movie.fileRelativePath()) == l_movie.id()
+              && l_missingFileHash.value(l_otherMovie.fileRelativePath()) == l_otherMovie.id(),
+          "both movies are missing");
+    check(l_db->getMoviesMissingSince(l_moviesPathId, l_now - 3600 * 1000).isEmpty(),
+          "no movie is missing since an hour");
+    check(l_db->getMoviesMissingSince(l_moviesPathId, l_now + 3600 * 1000).size() == 2,
+          "both movies are missing since an hour from now");
+    check(listCount(l_movie) == 0, "the missing movie is not listed");
+    check(l_db->getTagFacets(l_cursor).value(0).movieCount == l_storedCount - l_missingCount,
+          "the missing movies are not counted");
+    check(l_db->rebuildFacetCounts()
+              && l_db->getTagFacets(l_cursor).value(0).movieCount == l_storedCount - l_missingCount,
+          "the missing movies are not counted again");
+
+    check(l_db->setMoviesMissing(QList<int>() << l_movie.id(), false), "a movie is found again");
+    check(listCount(l_movie) == 2, "the movie found again is listed");
+    check(l_db->getTagFacets(l_cursor).value(0).movieCount == l_storedCount - l_missingCount + 1,
+          "the movie found again is counted");
+    l_missingFileHash = l_db->getMissingMovieFiles().value(l_moviesPathId);
+    check(l_missingFileHash.size() == 1 && l_missingFileHash.contains(l_otherMovie.fileRelativePath()),
+          "the other movie is still missing");
+    check(l_db->getOneMovieById(l_otherMovie.id()).id() == l_otherMovie.id(),
+          "the missing movie is kept");
+
+    // The file of the missing movie, found at another place as a new movie
+    QByteArray l_fingerprint(28, 'f');
+    Movie l_newMovie;
+    l_newMovie.setTitle("movie_" + QString::number(l_otherMovie.id()));
+    l_newMovie.setFileRelativePath("moved/movie_" + QString::number(l_otherMovie.id()) + ".mkv");
+    l_newMovie.setSuffix("mkv");
+    if (!check(l_db->insertNewMovie(l_newMovie, l_moviesPathId), "the new movie is added"))
+    {
+        return false;
+    }
+    QHash<int, QByteArray> l_fingerprintHash;
+    l_fingerprintHash.insert(l_otherMovie.id(), l_fingerprint);
+    l_fingerprintHash.insert(l_newMovie.id(), l_fingerprint);
+    check(l_db->updateFingerprints(l_fingerprintHash), "the fingerprints are saved");
+    check(l_db->getMissingMoviesByFingerprint(QList<QByteArray>() << l_fingerprint).value(l_fingerprint)
+              == l_otherMovie.id(),
+          "the missing movie is found by its fingerprint");
+
+    // An imported movie keeps its metadata: it is not given to the missing movie
+    Movie l_importedMovie = l_db->getOneMovieById(12);
+    check(!l_db->relinkMovie(l_otherMovie.id(), l_importedMovie.id())
+              && l_db->getOneMovieById(l_importedMovie.id()).id() == l_importedMovie.id(),
+          "an imported movie is not relinked");
+    check(l_db->relinkMovie(l_otherMovie.id(), l_newMovie.id()), "the missing movie is relinked");
+    check(l_db->getOneMovieById(l_newMovie.id()).id() == 0, "the new movie is removed");
+    check(l_db->getMissingMovieFiles().value(l_moviesPathId).isEmpty(), "no movie is missing");
+    check(l_db->getOneMovieById(l_otherMovie.id()).fileRelativePath() == l_newMovie.fileRelativePath(),
+          "the missing movie has the file of the new one");
+
+    return true;
+}
+
+/**
+ * @brief Counts the lists of movies showing `movie`: getAllMovies() and getMoviesPage()
+ *
+ * @param Movie movie
+ * @return int from 0 to 2
+ */
+int DatabaseTest::listCount(const Movie &movie)
+{
+    int l_count = 0;
+    foreach (Movie l_listedMovie, m_databaseManager->getAllMovies(movie.isShow()))
+    {
+        if (l_listedMovie.id() == movie.id())
+        {
+            l_count++;
+        }
+    }
+
+    MovieCursor l_cursor;
+    l_cursor.show = movie.isShow();
+    while (!l_cursor.atEnd)
+    {
+        foreach (Movie l_listedMovie, m_databaseManager->getMoviesPage(l_cursor, 50))
+        {
+            if (l_listedMovie.id() == movie.id())
+            {
+                l_count++;
+            }
+        }
+    }
+
+    return l_count;
+}
+
+/**
+ * @brief The lines of a query plan reading a whole table of the library.
+ *
+ * Allowed: the temporary table `id_list` (it only holds the ids asked for),
+ * the full-text tables (their scans use their own index), the subqueries,
+ * and SCAN CONSTANT ROW. Both forms of the plans are read: "SCAN m" (SQLite 3.36
+ * and later) and "SCAN TABLE movies AS m".
+ *
+ * @param QString queryText
+ * @param QStringList planList, one line per node
+ * @return QStringList
+ */
+QStringList DatabaseTest::fullScans(const QString &queryText, const QStringList &planList)
+{
+    QSet<QString> l_allowedSet;
+    l_allowedSet << "id_list" << "CONSTANT" << "SUBQUERY";
+
+    QRegExp l_idListAlias("id_list AS (\\w+)");
+    int l_position = 0;
+    while ((l_position = l_idListAlias.indexIn(queryText, l_position)) != -1)
+    {
+        l_allowedSet.insert(l_idListAlias.cap(1));
+        l_position += l_idListAlias.matchedLength();
+    }
+
+    QRegExp l_materialized("^(MATERIALIZE|CO-ROUTINE) (\\S+)");
+    foreach (QString l_plan, planList)
+    {
+        if (l_materialized.indexIn(l_plan) != -1)
+        {
+            l_allowedSet.insert(l_materialized.cap(2));
+        }
+    }
+
+    QStringList l_scanList;
+    QRegExp l_scan("^SCAN (TABLE )?(\\S+)");
+    foreach (QString l_plan, planList)
+    {
+        if (l_scan.indexIn(l_plan) != -1
+                && !l_plan.contains("VIRTUAL TABLE")
+                && !l_allowedSet.contains(l_scan.cap(2)))
+        {
+            l_scanList.append(l_plan);
+        }
+    }
+
+    return l_scanList;
+}
+
+/**
+ * @brief Makes a database filled with a SyntheticLibrary in a new directory,
+ * and opens it with m_databaseManager
+ *
+ * @param QString name of the directory
+ * @param int movieCount
+ * @return bool
+ */
+bool DatabaseTest::openLibrary(const QString &name, int movieCount)
+{
+    closeLibrary();
+    QString l_path = m_workPath + "/" + name + "/";
+    QDir(l_path).removeRecursively();
+    QDir().mkpath(l_path + "posters");
+    QCoreApplication::instance()->setProperty("filesPath", l_path);
+    QCoreApplication::instance()->setProperty("postersPath", l_path + "posters/");
+
+    // The schema is made by DatabaseManager, the rows by SyntheticLibrary
+    m_databaseManager = new DatabaseManager();
+    m_databaseManager->open();
+    m_databaseManager->closeDB();
+    delete m_databaseManager;
+    m_databaseManager = NULL;
+
+    SyntheticLibrary l_library(movieCount);
+    bool l_generated;
+    {
+        QSqlDatabase l_db = QSqlDatabase::addDatabase("QSQLITE", "Test-generator");
+        l_db.setDatabaseName(DatabaseManager::databasePath());
+        l_generated = l_db.open() && l_library.generate(l_db);
+        l_db.close();
+    }
+    QSqlDatabase::removeDatabase("Test-generator");
+    if (!check(l_generated, "the library of " + QString::number(movieCount) + " movies is generated"))
+    {
+        return false;
+    }
+
+    m_databaseManager = new DatabaseManager();
+
+    return check(m_databaseManager->open(), "the library is opened");
+}
+
+/**
+ * @brief Closes the database opened by openLibrary()
+ */
+void DatabaseTest::closeLibrary()
+{
+    if (m_databaseManager != NULL)
+    {
+        m_databaseManager->closeDB();
+        delete m_databaseManager;
+        m_databaseManager = NULL;
+    }
+}
+
+/**
+ * @brief Counts a failure and writes it to the standard error if `condition` is false
+ *
+ * @param bool condition
+ * @param QString message, what is expected
+ * @return condition
+ */
+bool DatabaseTest::check(bool condition, const QString &message)
+{
+    if (!condition)
+    {
+        m_failureCount++;
+        QTextStream(stderr) << "FAIL: " << message << "\n";
+    }
+
+    return condition;
+}
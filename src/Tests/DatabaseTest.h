@@ -0,0 +1,57 @@
+/* Copyright (C) 2014 Macaw-Movies
+ * (Olivier CHURLAUD, Sébastien TOUZÉ)
+ *
+ * This file is part of Macaw-Movies.
+ *
+ * Macaw-Movies is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Macaw-Movies is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Macaw-Movies.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DATABASETEST_H
+#define DATABASETEST_H
+
+#include <QString>
+#include <QStringList>
+
+class DatabaseManager;
+class Movie;
+
+/**
+ * @brief Tests of DatabaseManager, run by ctest through macaw-test-db
+ *
+ * Each test works on its own database, made in `workPath`. A failed check is
+ * written to the standard error with what was expected.
+ */
+class DatabaseTest
+{
+public:
+    explicit DatabaseTest(const QString &workPath);
+    static QStringList testNames();
+    bool run(const QString &testName);
+
+private:
+    bool testQueryPlans();
+    bool testMovieLinks();
+    bool testMissingMovies();
+    bool openLibrary(const QString &name, int movieCount);
+    void closeLibrary();
+    bool check(bool condition, const QString &message);
+    int listCount(const Movie &movie);
+    static QStringList fullScans(const QString &queryText, const QStringList &planList);
+
+    QString m_workPath;
+    DatabaseManager *m_databaseManager;
+    int m_failureCount;
+};
+
+#endif // DATABASETEST_H
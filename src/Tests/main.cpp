@@ -0,0 +1,58 @@
+/* Copyright (C) 2014 Macaw-Movies
+ * (Olivier CHURLAUD, Sébastien TOUZÉ)
+ *
+ * This file is part of Macaw-Movies.
+ *
+ * Macaw-Movies is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Macaw-Movies is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Macaw-Movies.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QCoreApplication>
+#include <QStringList>
+#include <QTemporaryDir>
+#include <QTextStream>
+
+#include "MacawDebug.h"
+#include "Tests/DatabaseTest.h"
+
+/**
+ * @brief Runs the tests given as arguments, all of them if none is given.
+ * Returns EXIT_FAILURE if one of them fails.
+ */
+int main(int argc, char **argv)
+{
+    QCoreApplication l_app(argc, argv);
+    l_app.setApplicationName("macaw-test-db");
+    Macaw::macawDebug_extern.setDebug(false);
+
+    QStringList l_testList = l_app.arguments().mid(1);
+    if (l_testList.isEmpty())
+    {
+        l_testList = DatabaseTest::testNames();
+    }
+
+    QTemporaryDir l_temporaryDir;
+    DatabaseTest l_test(l_temporaryDir.path());
+    int l_failureCount = 0;
+    foreach (QString l_testName, l_testList)
+    {
+        bool l_passed = l_test.run(l_testName);
+        QTextStream(stdout) << (l_passed ? "PASS: " : "FAIL: ") << l_testName << "\n";
+        if (!l_passed)
+        {
+            l_failureCount++;
+        }
+    }
+
+    return l_failureCount == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -28,7 +28,7 @@
 
 //database version, must be follow the version:
 // 0.5.0 => 50, 12.5.2 => 1252
-#define DB_VERSION 50
+#define DB_VERSION 57
 #define APP_NAME "Macaw-Movies"
 #define APP_NAME_SMALL "macaw-movies"
 